@@ -44,6 +44,8 @@
 #include "i_sdlvideo.h"
 #include "m_fileio.h"
 #include "g_game.h"
+#include "doomstat.h"
+#include "cl_timedemo.h"
 
 bool M_FindFreeName(std::string &filename, const std::string &extension);
 
@@ -134,6 +136,11 @@ void I_FinishUpdateNoBlit ()
 	screen->Unlock ();
 }
 
+// Times of the last few presents in microseconds, for vid_stat
+#define NUMPRESENTTIMES		64
+static DWORD presenttimes[NUMPRESENTTIMES];
+static size_t presentframe;
+
 void I_FinishUpdate ()
 {
 	// Draws frame time and cumulative fps
@@ -183,7 +190,15 @@ void I_FinishUpdate ()
 			screen->buffer[(screen->height-1)*screen->pitch + i] = 0x0;
     }
 
-	Video->UpdateScreen (screen);
+	TD_BeginStage (TDS_BLIT);
+	if (!noblit)
+	{
+		QWORD start = I_UTime ();
+		Video->UpdateScreen (screen);
+		presenttimes[presentframe++ % NUMPRESENTTIMES] = (DWORD)(I_UTime () - start);
+	}
+	TD_EndStage (TDS_BLIT);
+
 	screen->Unlock(); // SoM: we should probably do this, eh?
 }
 
@@ -580,6 +595,7 @@ void IVideo::SetPalette (DWORD *palette) {}
 void IVideo::SetOldPalette (byte *doompalette) {}
 void IVideo::UpdateScreen (DCanvas *canvas) {}
 void IVideo::ReadScreen (byte *block) {}
+std::string IVideo::GetPresentName () { return "none"; }
 
 int IVideo::GetModeCount () { return 1; }
 void IVideo::StartModeIterator (int bits) {}
@@ -627,6 +643,27 @@ BEGIN_COMMAND (vid_listmodes)
 }
 END_COMMAND (vid_listmodes)
 
+BEGIN_COMMAND (vid_stat)
+{
+	size_t count = MIN (presentframe, (size_t)NUMPRESENTTIMES);
+	DWORD total = 0, most = 0;
+
+	Printf (PRINT_HIGH, "present: %s\n", Video->GetPresentName ().c_str ());
+
+	if (!count)
+		return;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		total += presenttimes[i];
+		most = MAX (most, presenttimes[i]);
+	}
+
+	Printf (PRINT_HIGH, "last %u frames: avg %.3f ms, max %.3f ms\n",
+		(unsigned)count, total / (count * 1000.0), most / 1000.0);
+}
+END_COMMAND (vid_stat)
+
 BEGIN_COMMAND (vid_currentmode)
 {
 	Printf (PRINT_HIGH, "%dx%dx%d\n", DisplayWidth, DisplayHeight, DisplayBits);
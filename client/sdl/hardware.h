@@ -48,6 +48,7 @@ class IVideo
 		
 	virtual void UpdateScreen (DCanvas *canvas);
 	virtual void ReadScreen (byte *block);
+	virtual std::string GetPresentName ();
 
 	virtual int GetModeCount ();
 	virtual void StartModeIterator (int bits);
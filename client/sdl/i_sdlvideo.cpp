@@ -49,6 +49,7 @@
 #endif
 
 EXTERN_CVAR (autoadjust_video_settings)
+EXTERN_CVAR (vid_32bpp)
 
 SDLVideo::SDLVideo(int parm)
 {
@@ -99,6 +100,7 @@ SDLVideo::SDLVideo(int parm)
     I_SetWindowCaption();
 
    sdlScreen = NULL;
+   palScreen = NULL;
    infullscreen = false;
    screenw = screenh = screenbits = 0;
    palettechanged = false;
@@ -174,6 +176,9 @@ SDLVideo::~SDLVideo(void)
    }
 
    delete chainHead;
+
+   if(palScreen)
+      SDL_FreeSurface(palScreen);
 }
 
 
@@ -253,9 +258,32 @@ bool SDLVideo::SetMode (int width, int height, int bits, bool fs)
    if (I_CheckVideoDriver("directx") && fs)
       sbits = 32;
 
+   // present the 8-bit screen through a 32-bit display surface
+   if (vid_32bpp && bits == 8)
+   {
+      sbits = 32;
+      flags &= ~SDL_HWPALETTE;
+   }
+
+   if(palScreen)
+   {
+      SDL_FreeSurface(palScreen);
+      palScreen = NULL;
+   }
+
    if(!(sdlScreen = SDL_SetVideoMode(width, height, sbits, flags)))
       return false;
 
+   // The engine draws 8-bit pixels, so with a 32-bit display it gets its
+   // own surface which UpdateScreen converts through the palette
+   if(bits == 8 && sdlScreen->format->BytesPerPixel == 4)
+   {
+      if(!(palScreen = SDL_CreateRGBSurface(SDL_SWSURFACE, width, height, 8, 0, 0, 0, 0)))
+         return false;
+
+      palettechanged = true;
+   }
+
    screenw = width;
    screenh = height;
    screenbits = bits;
@@ -289,8 +317,69 @@ void SDLVideo::SetOldPalette (byte *doompalette)
    palettechanged = true;
 }
 
+//
+// I_ConvertPaletted
+// Converts 8-bit pixels to 32-bit ones through a palette lookup table.
+//
+static void I_ConvertPaletted (const byte *source, int srcpitch, DWORD *dest, int destpitch,
+                               int width, int height, const DWORD *lut)
+{
+   for (int y = 0; y < height; y++)
+   {
+      const byte *src = source;
+      DWORD *dst = dest;
+      int x = width;
+
+      while (x >= 8)
+      {
+         DWORD a = lut[src[0]], b = lut[src[1]], c = lut[src[2]], d = lut[src[3]];
+         DWORD e = lut[src[4]], f = lut[src[5]], g = lut[src[6]], h = lut[src[7]];
+
+         dst[0] = a; dst[1] = b; dst[2] = c; dst[3] = d;
+         dst[4] = e; dst[5] = f; dst[6] = g; dst[7] = h;
+
+         src += 8;
+         dst += 8;
+         x -= 8;
+      }
+
+      while (x--)
+         *dst++ = lut[*src++];
+
+      source += srcpitch;
+      dest = (DWORD *)((byte *)dest + destpitch);
+   }
+}
+
 void SDLVideo::UpdateScreen (DCanvas *canvas)
 {
+   if(palScreen && canvas->m_Private == palScreen)
+   {
+      if(palettechanged)
+      {
+         for(int i = 0; i < 256; i++)
+            paletteLUT[i] = SDL_MapRGB(sdlScreen->format, newPalette[i].r, newPalette[i].g, newPalette[i].b);
+
+         // keep the palette with the pixels for ReadScreen
+         SDL_SetPalette(palScreen, SDL_LOGPAL, newPalette, 0, 256);
+         palettechanged = false;
+      }
+
+      if(SDL_MUSTLOCK(sdlScreen) && SDL_LockSurface(sdlScreen) == -1)
+         return;
+
+      I_ConvertPaletted((byte *)palScreen->pixels, palScreen->pitch,
+                        (DWORD *)sdlScreen->pixels, sdlScreen->pitch,
+                        std::min(palScreen->w, sdlScreen->w), std::min(palScreen->h, sdlScreen->h),
+                        paletteLUT);
+
+      if(SDL_MUSTLOCK(sdlScreen))
+         SDL_UnlockSurface(sdlScreen);
+
+      SDL_Flip(sdlScreen);
+      return;
+   }
+
    if(palettechanged)
    {
       // m_Private may or may not be the primary surface (sdlScreen)
@@ -316,23 +405,26 @@ void SDLVideo::ReadScreen (byte *block)
    byte *source;
    bool unlock = false;
 
-   if(SDL_MUSTLOCK(sdlScreen))
+   // with a 32-bit display the 8-bit pixels are in palScreen
+   SDL_Surface *s = palScreen ? palScreen : sdlScreen;
+
+   if(SDL_MUSTLOCK(s))
    {
       unlock = true;
-      SDL_LockSurface(sdlScreen);
+      SDL_LockSurface(s);
    }
 
-   source = (byte *)sdlScreen->pixels;
+   source = (byte *)s->pixels;
 
-   for (y = 0; y < sdlScreen->h; y++)
+   for (y = 0; y < s->h; y++)
    {
-      memcpy (block, source, sdlScreen->w);
-      block += sdlScreen->w;
-      source += sdlScreen->pitch;
+      memcpy (block, source, s->w);
+      block += s->w;
+      source += s->pitch;
    }
    
    if(unlock)
-      SDL_UnlockSurface(sdlScreen);
+      SDL_UnlockSurface(s);
 }
 
 
@@ -390,7 +482,10 @@ DCanvas *SDLVideo::AllocateSurface (int width, int height, int bits, bool primar
 
 	if(primary)
 	{
-	  scrn->m_Private = s = sdlScreen; // denis - let the engine write directly to screen
+	  if(palScreen)
+		 scrn->m_Private = s = palScreen; // converted to the 32-bit screen in UpdateScreen
+	  else
+		 scrn->m_Private = s = sdlScreen; // denis - let the engine write directly to screen
 	}
 	else
 	{
@@ -421,7 +516,7 @@ DCanvas *SDLVideo::AllocateSurface (int width, int height, int bits, bool primar
 
 void SDLVideo::ReleaseSurface (DCanvas *scrn)
 {
-   if(scrn->m_Private == sdlScreen) // primary stays
+   if(scrn->m_Private == sdlScreen || (palScreen && scrn->m_Private == palScreen)) // primary stays
       return;
 
    if(scrn->m_LockCount)
@@ -474,6 +569,14 @@ void SDLVideo::UnlockSurface (DCanvas *scrn)
    scrn->buffer = NULL;
 }
 
+std::string SDLVideo::GetPresentName (void)
+{
+   if(palScreen)
+      return "32-bit palette lookup";
+
+   return "SDL 8-bit";
+}
+
 bool SDLVideo::Blit (DCanvas *src, int sx, int sy, int sw, int sh, DCanvas *dst, int dx, int dy, int dw, int dh)
 {
    return false;
@@ -52,6 +52,7 @@ class SDLVideo : public IVideo
 
 	virtual void UpdateScreen (DCanvas *canvas);
 	virtual void ReadScreen (byte *block);
+	virtual std::string GetPresentName (void);
 
 	virtual int GetModeCount (void);
 	virtual void StartModeIterator (int bits);
@@ -128,6 +129,7 @@ class SDLVideo : public IVideo
    int vidModeIteratorBits;
 
    SDL_Surface *sdlScreen;
+   SDL_Surface *palScreen;    // 8-bit screen when the display is 32-bit
    bool infullscreen;
    int screenw, screenh;
    int screenbits;
@@ -135,6 +137,7 @@ class SDLVideo : public IVideo
    SDL_Color newPalette[256];
    SDL_Color palette[256];
    bool palettechanged;
+   DWORD paletteLUT[256];     // newPalette in the display's pixel format
 
    cChain      *chainHead;
 };
@@ -51,6 +51,7 @@
 // for getuid and geteuid
 #include <unistd.h>
 #include <sys/types.h>
+#include <sys/time.h>
 #include <limits.h>
 #endif
 
@@ -223,6 +224,31 @@ QWORD I_MSTime (void)
    return I_UnwrapTime(SDL_GetTicks());
 }
 
+//
+// I_UTime
+// SDL only has a millisecond timer, which is too coarse for timing the
+// stages of a single frame.
+//
+QWORD I_UTime (void)
+{
+#ifdef WIN32
+	static LARGE_INTEGER freq;
+	LARGE_INTEGER now;
+
+	if (!freq.QuadPart)
+		QueryPerformanceFrequency (&freq);
+	QueryPerformanceCounter (&now);
+
+	return (QWORD)now.QuadPart * 1000000 / (QWORD)freq.QuadPart;
+#else
+	struct timeval tv;
+
+	gettimeofday (&tv, NULL);
+
+	return (QWORD)tv.tv_sec * 1000000 + (QWORD)tv.tv_usec;
+#endif
+}
+
 //
 // I_GetTime
 // returns time in 1/35th second tics
@@ -129,6 +129,9 @@ void I_ResumeMouse (void);
 // [RH] Returns millisecond-accurate time
 QWORD I_MSTime (void);
 
+// Returns a microsecond timer for profiling; only differences are meaningful
+QWORD I_UTime (void);
+
 void I_Yield();
 
 // [RH] Title string to display at bottom of console during startup
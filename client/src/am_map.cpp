@@ -23,6 +23,8 @@
 
 
 #include <stdio.h>
+#include <vector>
+#include <algorithm>
 
 #include "doomdef.h"
 #include "g_level.h"
@@ -54,6 +56,7 @@ extern patch_t *hu_font[];
 #include "gstrings.h"
 
 #include "am_map.h"
+#include "cl_timedemo.h"
 
 static int Background, YourColor, WallColor, TSWallColor,
 		   FDWallColor, CDWallColor, ThingColor,
@@ -193,6 +196,32 @@ typedef struct {
 	fixed_t slp, islp;
 } islope_t;
 
+// A wall transformed and clipped to the frame buffer
+typedef struct {
+	int		line;
+	fline_t	fl;
+} amline_t;
+
+// The walls the automap window could see when they were last transformed.
+// They are reused for as long as the window does not move.
+static std::vector<amline_t> am_cachedlines;
+static std::vector<int> am_polylines;		// lines of polyobjects, which move
+static std::vector<int> am_linestamp;		// last lookup each line was found in
+static int		am_stamp;
+
+static struct {
+	bool		valid;
+	fixed_t		x, y, w, h, scale;
+	int			fw, fh;
+	bool		rotate;
+	fixed_t		camx, camy;
+	angle_t		camangle;
+	line_t		*lines;
+	vertex_t	*vertexes;
+	int			numlines;
+	int			time;
+} am_cache;
+
 
 
 //
@@ -342,6 +371,7 @@ static BOOL stopped = true;
 
 
 void AM_rotatePoint (fixed_t *x, fixed_t *y);
+void AM_rotate (fixed_t *x, fixed_t *y, angle_t a);
 
 //
 //
@@ -698,6 +728,7 @@ void AM_Start (void)
 
 	if (!stopped) AM_Stop();
 	stopped = false;
+	am_cache.valid = false;
 	if (strncmp (lastmap, level.mapname, 8))
 	{
 		AM_LevelInit();
@@ -1125,6 +1156,19 @@ AM_drawFline
 			x = fl->a.x;
 			y = fl->a.y;
 
+			// most walls run straight along one axis
+			if (!dy) {
+				memset (fb + y*f_p + (dx<0 ? fl->b.x : x), color, ax/2 + 1);
+				return;
+			}
+			if (!dx) {
+				byte *dest = fb + (dy<0 ? fl->b.y : y)*f_p + x;
+
+				for (d = ay/2 + 1; d; d--, dest += f_p)
+					*dest = (byte)color;
+				return;
+			}
+
 			if (ax > ay) {
 				d = ay - ax/2;
 
@@ -1225,122 +1269,343 @@ void AM_drawGrid(int color)
 	}
 }
 
+// Locked door colors worked out this frame, by key
+static int lockedcolors[3];
+
 //
-// Determines visible lines, draws them.
-// This is LineDef based, not LineSeg based.
+// AM_lockedColor
+// NES - Locked doors glow from a predefined color to either blue, yellow, or red.
 //
-void AM_drawWalls(void)
+static int AM_lockedColor (int key)
 {
 	int i, r, g, b;
-	static mline_t l;
 	float rdif, gdif, bdif;
 
-	for (i=0;i<numlines;i++) {
-		l.a.x = lines[i].v1->x;
-		l.a.y = lines[i].v1->y;
-		l.b.x = lines[i].v2->x;
-		l.b.y = lines[i].v2->y;
+	if (key == (BCard | CardIsSkull))
+		i = 0;
+	else if (key == (YCard | CardIsSkull))
+		i = 1;
+	else
+		i = 2;
+
+	if (lockedcolors[i] >= 0)
+		return lockedcolors[i];
+
+	r = RPART(LockedColor), g = GPART(LockedColor), b = BPART(LockedColor);
+
+	if (am_usecustomcolors) {
+		if (i == 0) {
+			rdif = (0 - r)/30;
+			gdif = (0 - g)/30;
+			bdif = (255 - b)/30;
+		} else if (i == 1) {
+			rdif = (255 - r)/30;
+			gdif = (255 - g)/30;
+			bdif = (0 - b)/30;
+		} else {
+			rdif = (255 - r)/30;
+			gdif = (0 - g)/30;
+			bdif = (0 - b)/30;
+		}
 
-		if (am_rotate) {
-			AM_rotatePoint (&l.a.x, &l.a.y);
-			AM_rotatePoint (&l.b.x, &l.b.y);
+		if (lockglow < 30) {
+			r += (int)rdif*lockglow;
+			g += (int)gdif*lockglow;
+			b += (int)bdif*lockglow;
+		} else if (lockglow < 60) {
+			r += (int)rdif*(60-lockglow);
+			g += (int)gdif*(60-lockglow);
+			b += (int)bdif*(60-lockglow);
 		}
+	}
 
-		if (cheating || (lines[i].flags & ML_MAPPED))
+	return lockedcolors[i] = BestColor (DefaultPalette->basecolors, r, g, b,
+										DefaultPalette->numcolors);
+}
+
+//
+// AM_wallColor
+// The color to draw a line in, or -1 if it isn't drawn.
+//
+static int AM_wallColor (line_t *line)
+{
+	if (cheating || (line->flags & ML_MAPPED))
+	{
+		if ((line->flags & ML_DONTDRAW) && !cheating)
+			return -1;
+		if (!line->backsector &&
+			(((am_usecustomcolors || viewactive) &&
+			line->special != Exit_Normal &&
+			line->special != Exit_Secret) ||
+			(!am_usecustomcolors && !viewactive)))
 		{
-			if ((lines[i].flags & ML_DONTDRAW) && !cheating)
-				continue;
-            if (!lines[i].backsector &&
-                (((am_usecustomcolors || viewactive) &&
-                lines[i].special != Exit_Normal &&
-                lines[i].special != Exit_Secret) ||
-                (!am_usecustomcolors && !viewactive)))
-            {
-				AM_drawMline(&l, WallColor);
+			return WallColor;
+		}
+		else
+		{
+			if ((line->special == Teleport ||
+				line->special == Teleport_NoFog ||
+				line->special == Teleport_Line) &&
+				(am_usecustomcolors || viewactive))
+			{ // teleporters
+				return TeleportColor;
 			}
-			else
+			else if ((line->special == Teleport_NewMap ||
+					 line->special == Teleport_EndGame ||
+					 line->special == Exit_Normal ||
+					 line->special == Exit_Secret) &&
+					 (am_usecustomcolors || viewactive))
+			{ // exit
+				return ExitColor;
+			}
+			else if (line->flags & ML_SECRET)
+			{ // secret door
+				if (cheating)
+					return SecretWallColor;
+				else
+					return WallColor;
+			}
+			else if (line->special == Door_LockedRaise)
 			{
-				if ((lines[i].special == Teleport ||
-					lines[i].special == Teleport_NoFog ||
-					lines[i].special == Teleport_Line) &&
-					(am_usecustomcolors || viewactive))
-				{ // teleporters
-					AM_drawMline(&l, TeleportColor);
-				}
-				else if ((lines[i].special == Teleport_NewMap ||
-						 lines[i].special == Teleport_EndGame ||
-						 lines[i].special == Exit_Normal ||
-						 lines[i].special == Exit_Secret) &&
-						 (am_usecustomcolors || viewactive))
-				{ // exit
-					AM_drawMline(&l, ExitColor);
-				}
-				else if (lines[i].flags & ML_SECRET)
-				{ // secret door
-					if (cheating)
-						AM_drawMline(&l, SecretWallColor);
-				    else
-						AM_drawMline(&l, WallColor);
-				}
-				else if (lines[i].special == Door_LockedRaise)
-				{
-				    // NES - Locked doors glow from a predefined color to either blue, yellow, or red.
-                    r = RPART(LockedColor), g = GPART(LockedColor), b = BPART(LockedColor);
-
-                    if (am_usecustomcolors) {
-                        if (lines[i].args[3] == (BCard | CardIsSkull)) {
-                            rdif = (0 - r)/30;
-                            gdif = (0 - g)/30;
-                            bdif = (255 - b)/30;
-                        } else if (lines[i].args[3] == (YCard | CardIsSkull)) {
-                            rdif = (255 - r)/30;
-                            gdif = (255 - g)/30;
-                            bdif = (0 - b)/30;
-                        } else {
-                            rdif = (255 - r)/30;
-                            gdif = (0 - g)/30;
-                            bdif = (0 - b)/30;
-                        }
-
-                        if (lockglow < 30) {
-                            AM_drawMline (&l, BestColor (DefaultPalette->basecolors, r + ((int)rdif*lockglow),
-                                          g + ((int)gdif*lockglow), b + ((int)bdif*lockglow),
-                                          DefaultPalette->numcolors));
-                        } else if (lockglow < 60) {
-                            AM_drawMline (&l, BestColor (DefaultPalette->basecolors, r + ((int)rdif*(60-lockglow)),
-                                          g + ((int)gdif*(60-lockglow)), b + ((int)bdif*(60-lockglow)),
-                                          DefaultPalette->numcolors));
-                        } else {
-                            AM_drawMline (&l, BestColor (DefaultPalette->basecolors, r, g, b,
-                                          DefaultPalette->numcolors));
-                        }
-				    } else {
-                        AM_drawMline (&l, BestColor (DefaultPalette->basecolors, r, g, b,
-                                      DefaultPalette->numcolors));
-                    }
-                }
-				else if (lines[i].backsector->floorheight
-					  != lines[i].frontsector->floorheight)
-				{
-					AM_drawMline(&l, FDWallColor); // floor level change
-				}
-				else if (lines[i].backsector->ceilingheight
-					  != lines[i].frontsector->ceilingheight)
-				{
-					AM_drawMline(&l, CDWallColor); // ceiling level change
-				}
-				else if (cheating)
+				return AM_lockedColor (line->args[3]);
+			}
+			else if (line->backsector->floorheight
+				  != line->frontsector->floorheight)
+			{
+				return FDWallColor; // floor level change
+			}
+			else if (line->backsector->ceilingheight
+				  != line->frontsector->ceilingheight)
+			{
+				return CDWallColor; // ceiling level change
+			}
+			else if (cheating)
+			{
+				return TSWallColor;
+			}
+		}
+	}
+	else if (consoleplayer().powers[pw_allmap])
+	{
+		if (!(line->flags & ML_DONTDRAW))
+			return NotSeenColor;
+	}
+
+	return -1;
+}
+
+//
+// AM_transformLine
+// Rotates a line with the view if needed and clips it to the frame buffer.
+//
+static BOOL AM_transformLine (int i, fline_t *fl)
+{
+	mline_t l;
+
+	l.a.x = lines[i].v1->x;
+	l.a.y = lines[i].v1->y;
+	l.b.x = lines[i].v2->x;
+	l.b.y = lines[i].v2->y;
+
+	if (am_rotate) {
+		AM_rotatePoint (&l.a.x, &l.a.y);
+		AM_rotatePoint (&l.b.x, &l.b.y);
+	}
+
+	return AM_clipMline (&l, fl);
+}
+
+//
+// AM_cacheLine
+//
+static void AM_cacheLine (int i)
+{
+	amline_t ml;
+
+	if (am_linestamp[i] == am_stamp)
+		return;
+	am_linestamp[i] = am_stamp;
+
+	ml.line = i;
+	if (AM_transformLine (i, &ml.fl))
+		am_cachedlines.push_back (ml);
+}
+
+//
+// AM_cacheWalls
+// Finds the walls inside the automap window through the blockmap and
+// transforms them. Lines of polyobjects are left out, since they move.
+//
+static void AM_cacheWalls (void)
+{
+	int i, bx, by;
+
+	am_cachedlines.clear ();
+
+	if ((int)am_linestamp.size () != numlines)
+	{
+		am_linestamp.assign (numlines, 0);
+		am_stamp = 0;
+
+		am_polylines.clear ();
+		for (i = 0; i < po_NumPolyobjs; i++)
+		{
+			for (int j = 0; j < polyobjs[i].numsegs; j++)
+			{
+				int line = polyobjs[i].segs[j]->linedef - lines;
+
+				if (am_linestamp[line] != -1)
 				{
-					AM_drawMline(&l, TSWallColor);
+					am_linestamp[line] = -1;
+					am_polylines.push_back (line);
 				}
 			}
 		}
-		else if (consoleplayer().powers[pw_allmap])
+	}
+
+	if (++am_stamp <= 0)
+	{
+		// start over rather than wrap into the polyobject marks
+		for (i = 0; i < numlines; i++)
+			if (am_linestamp[i] > 0)
+				am_linestamp[i] = 0;
+		am_stamp = 1;
+	}
+
+	// The window on the map, turned back if the map turns with the view
+	mpoint_t corner[4] = { {m_x, m_y}, {m_x2, m_y}, {m_x, m_y2}, {m_x2, m_y2} };
+	fixed_t minx = MAXINT, miny = MAXINT, maxx = MININT, maxy = MININT;
+
+	for (i = 0; i < 4; i++)
+	{
+		if (am_rotate)
 		{
-			if (!(lines[i].flags & ML_DONTDRAW))
-				AM_drawMline(&l, NotSeenColor);
+			player_t &p = consoleplayer();
+
+			corner[i].x -= p.camera->x;
+			corner[i].y -= p.camera->y;
+			AM_rotate (&corner[i].x, &corner[i].y, p.camera->angle - ANG90);
+			corner[i].x += p.camera->x;
+			corner[i].y += p.camera->y;
 		}
-    }
+
+		minx = std::min (minx, corner[i].x);
+		miny = std::min (miny, corner[i].y);
+		maxx = std::max (maxx, corner[i].x);
+		maxy = std::max (maxy, corner[i].y);
+	}
+
+	// allow for rounding in the rotation
+	int bx1 = std::max (0, (int)((minx - bmaporgx - FRACUNIT) >> MAPBLOCKSHIFT));
+	int by1 = std::max (0, (int)((miny - bmaporgy - FRACUNIT) >> MAPBLOCKSHIFT));
+	int bx2 = std::min (bmapwidth - 1, (int)((maxx - bmaporgx + FRACUNIT) >> MAPBLOCKSHIFT));
+	int by2 = std::min (bmapheight - 1, (int)((maxy - bmaporgy + FRACUNIT) >> MAPBLOCKSHIFT));
+
+	if (bx1 == 0 && by1 == 0 && bx2 == bmapwidth - 1 && by2 == bmapheight - 1)
+	{
+		// the whole map is in view
+		for (i = 0; i < numlines; i++)
+			if (am_linestamp[i] >= 0)
+				AM_cacheLine (i);
+		return;
+	}
+
+	for (by = by1; by <= by2; by++)
+	{
+		for (bx = bx1; bx <= bx2; bx++)
+		{
+			for (int *list = blockmaplump + blockmap[by*bmapwidth + bx]; *list != -1; list++)
+			{
+				if (am_linestamp[*list] >= 0)
+					AM_cacheLine (*list);
+			}
+		}
+	}
+}
+
+//
+// AM_cacheValid
+// True if the window has not moved since the walls were transformed.
+//
+static bool AM_cacheValid (void)
+{
+	player_t &p = consoleplayer();
+	bool rotate = am_rotate ? true : false;
+
+	if (am_cache.valid
+		&& am_cache.x == m_x && am_cache.y == m_y
+		&& am_cache.w == m_w && am_cache.h == m_h
+		&& am_cache.scale == scale_mtof
+		&& am_cache.fw == f_w && am_cache.fh == f_h
+		&& am_cache.rotate == rotate
+		&& (!rotate || (am_cache.camx == p.camera->x && am_cache.camy == p.camera->y
+						&& am_cache.camangle == p.camera->angle))
+		&& am_cache.lines == lines && am_cache.vertexes == vertexes
+		&& am_cache.numlines == numlines
+		&& am_cache.time <= level.time)
+	{
+		am_cache.time = level.time;
+		return true;
+	}
+
+	// a new level, so find its polyobjects again
+	if (am_cache.lines != lines || am_cache.vertexes != vertexes
+		|| am_cache.numlines != numlines || am_cache.time > level.time)
+		am_linestamp.clear ();
+
+	am_cache.x = m_x;
+	am_cache.y = m_y;
+	am_cache.w = m_w;
+	am_cache.h = m_h;
+	am_cache.scale = scale_mtof;
+	am_cache.fw = f_w;
+	am_cache.fh = f_h;
+	am_cache.rotate = rotate;
+	am_cache.camx = rotate ? p.camera->x : 0;
+	am_cache.camy = rotate ? p.camera->y : 0;
+	am_cache.camangle = rotate ? p.camera->angle : 0;
+	am_cache.lines = lines;
+	am_cache.vertexes = vertexes;
+	am_cache.numlines = numlines;
+	am_cache.time = level.time;
+	am_cache.valid = true;
+
+	return false;
+}
+
+//
+// Determines visible lines, draws them.
+// This is LineDef based, not LineSeg based.
+//
+void AM_drawWalls(void)
+{
+	size_t i;
+	int color;
+	fline_t fl;
+
+	lockedcolors[0] = lockedcolors[1] = lockedcolors[2] = -1;
+
+	if (!AM_cacheValid ())
+		AM_cacheWalls ();
+
+	for (i = 0; i < am_cachedlines.size (); i++)
+	{
+		color = AM_wallColor (&lines[am_cachedlines[i].line]);
+
+		if (color >= 0)
+		{
+			fl = am_cachedlines[i].fl;
+			AM_drawFline (&fl, color);
+		}
+	}
+
+	for (i = 0; i < am_polylines.size (); i++)
+	{
+		color = AM_wallColor (&lines[am_polylines[i]]);
+
+		if (color >= 0 && AM_transformLine (am_polylines[i], &fl))
+			AM_drawFline (&fl, color);
+	}
 }
 
 
@@ -1519,6 +1784,14 @@ void AM_drawThings (int color)
 				angle += ANG90 - consoleplayer().camera->angle;
 			}
 
+			// the triangle is 16 units across
+			if (p.x < m_x - (16<<FRACBITS) || p.x > m_x2 + (16<<FRACBITS)
+				|| p.y < m_y - (16<<FRACBITS) || p.y > m_y2 + (16<<FRACBITS))
+			{
+				t = t->snext;
+				continue;
+			}
+
 			AM_drawLineCharacter
 			(thintriangle_guy, NUMTHINTRIANGLEGUYLINES,
 			 16<<FRACBITS, angle, color, p.x, p.y);
@@ -1566,6 +1839,8 @@ void AM_Drawer (void)
 	if (!automapactive)
 		return;
 
+	TD_BeginStage (TDS_AUTOMAP);
+
 	fb = screen->buffer;
 	if (!viewactive)
 	{
@@ -1692,6 +1967,8 @@ void AM_Drawer (void)
 		}
 
 	}
+
+	TD_EndStage (TDS_AUTOMAP);
 }
 
 VERSION_CONTROL (am_map_cpp, "$Id: am_map.cpp 3174 2012-05-11 01:03:43Z mike $")
@@ -308,6 +308,8 @@ CVAR_FUNC_DECL (gammalevel, "1", "Gamma correction level, 1 - 4",	CVARTYPE_BYTE,
 CVAR_FUNC_DECL (hud_crosshair, "0", "Type of crosshair, 0 means no crosshair",	CVARTYPE_BYTE, CVAR_ARCHIVE | CVAR_NOENABLEDISABLE)
 // Column optimization method
 CVAR (r_columnmethod, "1", "Column optimization method",	CVARTYPE_BYTE, CVAR_CLIENTINFO | CVAR_ARCHIVE)
+// Number of threads used to draw the player view
+CVAR (r_threads, "1", "Number of threads used to draw the player view",	CVARTYPE_BYTE, CVAR_ARCHIVE | CVAR_NOENABLEDISABLE)
 // Detail level (affects performance)
 CVAR_FUNC_DECL (r_detail, "0", "Detail level (affects performance)",	CVARTYPE_BYTE, CVAR_CLIENTINFO | CVAR_ARCHIVE | CVAR_NOENABLEDISABLE)
 // Disables all texturing of walls
@@ -320,6 +322,8 @@ CVAR (r_particles, "1","Draw particles",	CVARTYPE_BOOL, CVAR_CLIENTINFO)
 CVAR_FUNC_DECL (r_stretchsky, "2", "",	CVARTYPE_BOOL, CVAR_CLIENTINFO | CVAR_ARCHIVE | CVAR_NOENABLEDISABLE)
 // Invulnerability sphere changes the palette of the sky
 CVAR (r_skypalette, "0", "Invulnerability sphere changes the palette of the sky",	CVARTYPE_BOOL, CVAR_ARCHIVE)
+// Draw frames between game tics, interpolating movement
+CVAR (r_interpolate, "1", "Draw frames between game tics, interpolating movement",	CVARTYPE_BOOL, CVAR_ARCHIVE)
 
 #ifdef _XBOX // The burn wipe works better in 720p
 CVAR (r_wipetype, "2", "",	CVARTYPE_BYTE, CVAR_ARCHIVE | CVAR_NOENABLEDISABLE)
@@ -348,6 +352,10 @@ CVAR (vid_defbits, "8", "",	CVARTYPE_BYTE, CVAR_CLIENTINFO | CVAR_ARCHIVE | CVAR
 CVAR (autoadjust_video_settings, "1", "",	CVARTYPE_BOOL, CVAR_CLIENTINFO | CVAR_ARCHIVE)
 // Frames per second counter
 CVAR (vid_fps, "0", "",	CVARTYPE_BOOL, CVAR_CLIENTINFO)
+// Present the 8-bit screen through a 32-bit display surface
+CVAR_FUNC_DECL (vid_32bpp, "0", "Present the 8-bit screen through a 32-bit display surface",	CVARTYPE_BOOL, CVAR_CLIENTINFO | CVAR_ARCHIVE)
+// Frame rate limit when r_interpolate is set, 0 for no limit
+CVAR (vid_maxfps, "0", "Frame rate limit when r_interpolate is set, 0 for no limit",	CVARTYPE_WORD, CVAR_ARCHIVE | CVAR_NOENABLEDISABLE)
 // Fullscreen mode
 #ifdef GCONSOLE
 	CVAR_FUNC_DECL (vid_fullscreen, "1", "",	CVARTYPE_BOOL, CVAR_CLIENTINFO | CVAR_ARCHIVE)
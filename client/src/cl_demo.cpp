@@ -33,6 +33,7 @@
 #include "c_dispatch.h"
 #include "d_net.h"
 #include "cl_demo.h"
+#include "cl_timedemo.h"
 #include "m_swap.h"
 #include "p_saveg.h"
 #include "version.h"
@@ -370,6 +371,64 @@ bool NetDemo::readMapIndex()
 
 
 
+//
+// rebuildIndex()
+//
+//   Rebuilds the snapshot and map indices of a netdemo that was not stopped
+//   properly, such as one recorded by a server that crashed.  Only message
+//   headers and index messages are read while scanning the file.
+
+bool NetDemo::rebuildIndex()
+{
+	snapshot_index.clear();
+	map_index.clear();
+
+	if (fseek(demofp, NetDemo::HEADER_SIZE, SEEK_SET) != 0)
+		return false;
+
+	netdemo_message_t type;
+	uint32_t len, tic;
+
+	while (readMessageHeader(type, len, tic))
+	{
+		if (type == NetDemo::msg_index && len == NetDemo::INDEX_MESSAGE_SIZE)
+		{
+			byte kind;
+			netdemo_index_entry_t entry;
+
+			size_t cnt = 0;
+			cnt += fread(&kind, sizeof(kind), 1, demofp);
+			cnt += fread(&entry.ticnum, sizeof(entry.ticnum), 1, demofp);
+			cnt += fread(&entry.offset, sizeof(entry.offset), 1, demofp);
+
+			if (cnt < 3)
+				break;
+
+			// convert from little-endian to native
+			entry.ticnum = LONG(entry.ticnum);
+			entry.offset = LONG(entry.offset);
+
+			if (kind == NetDemo::index_map)
+				map_index.push_back(entry);
+			else
+				snapshot_index.push_back(entry);
+		}
+		else if (fseek(demofp, len, SEEK_CUR) != 0)
+		{
+			break;
+		}
+
+		// the last complete message marks the end of the recording
+		header.ending_gametic = tic;
+	}
+
+	header.snapshot_index_size = snapshot_index.size();
+	header.map_index_size = map_index.size();
+
+	return true;
+}
+
+
 //
 // startRecording()
 //
@@ -489,10 +548,36 @@ bool NetDemo::startPlaying(const std::string &filename)
 		return false;
 	}
 
-    if (header.version != NETDEMOVER)
-    {
-        // Do nothing since there is only one version of netdemo files currently
-    }
+	// Version 2 netdemos are read the same way as version 3 ones, except
+	// that they have no index messages to rebuild a missing index from
+	if (header.version > NETDEMOVER)
+	{
+		error("Netdemo was recorded by a newer version of Odamex.");
+		return false;
+	}
+
+	// a netdemo that was never finished has no index tables, so rebuild
+	// them from the index messages in the file
+	if (header.snapshot_index_offset == 0 || header.map_index_offset == 0)
+	{
+		if (header.version < 3)
+		{
+			error("Unable to play unfinished netdemo.");
+			return false;
+		}
+
+		if (!rebuildIndex())
+		{
+			error("Unable to rebuild netdemo index.\n");
+			return false;
+		}
+
+		fseek(demofp, NetDemo::HEADER_SIZE, SEEK_SET);
+		state = NetDemo::st_playing;
+
+		Printf(PRINT_HIGH, "Playing unfinished netdemo %s.\n", filename.c_str());
+		return true;
+	}
 
 	// read the demo's index
 	if (fseek(demofp, header.snapshot_index_offset, SEEK_SET) != 0)
@@ -651,6 +736,8 @@ bool NetDemo::stopPlaying()
 	reset();
     gameaction = ga_fullconsole;
     gamestate = GS_FULLCONSOLE;
+
+	CL_EndTimeDemo();
 	
 	return true;
 }
@@ -910,7 +997,7 @@ void NetDemo::readMessages(buf_t* netbuffer)
 	// get the values for type, len and tic
 	readMessageHeader(type, len, tic);
 	
-	while (type == NetDemo::msg_snapshot)
+	while (type == NetDemo::msg_snapshot || type == NetDemo::msg_index)
 	{
 		// skip over snapshots and read the next message instead
 		fseek(demofp, len, SEEK_CUR);
@@ -1123,16 +1210,13 @@ void NetDemo::writeConnectionSequence(buf_t *netbuffer)
 	
 	// Server sends its settings
 	MSG_WriteMarker	(netbuffer, svc_serversettings);
-	cvar_t *var = GetFirstCvar();
+	cvar_t *var = GetFirstCvar(CVAR_SERVERINFO);
 	while (var)
 	{
-		if (var->flags() & CVAR_SERVERINFO)
-		{
-			MSG_WriteByte	(netbuffer, 1);
-			MSG_WriteString	(netbuffer,	var->name());
-			MSG_WriteString	(netbuffer,	var->cstring());
-		}
-		var = var->GetNext();
+		MSG_WriteByte	(netbuffer, 1);
+		MSG_WriteString	(netbuffer,	var->name());
+		MSG_WriteString	(netbuffer,	var->cstring());
+		var = var->GetNext(CVAR_SERVERINFO);
 	}
 	MSG_WriteByte	(netbuffer, 2);		// end of server settings marker
 
@@ -1431,60 +1515,9 @@ void NetDemo::writeIntermission()
 
 void NetDemo::writeSnapshotData(byte *buf, size_t &length)
 {
-	G_SnapshotLevel();
-
-	FLZOMemFile memfile;
-	memfile.Open();			// open for writing
-
-	FArchive arc(memfile);
-
-	// Save the server cvars
-	byte vars[4096], *vars_p;
-	vars_p = vars;
-
-	cvar_t::C_WriteCVars(&vars_p, CVAR_SERVERINFO);
-	arc.WriteCount(vars_p - vars);
-	arc.Write(vars, vars_p - vars);
-
-	arc << level.mapname;
-	arc << (BYTE)(gamestate == GS_INTERMISSION);
-
-	G_SerializeSnapshots(arc);
-	P_SerializeRNGState(arc);
-	P_SerializeACSDefereds(arc);
-
-	// Save the status of the flags in CTF
-	for (int i = 0; i < NUMFLAGS; i++)
-		arc << CTFdata[i];
-
-	// Save team points
-	for (int i = 0; i < NUMTEAMS; i++)
-		arc << TEAMpoints[i];
-	
-	arc << level.time;
-
-	for (int i = 0; i < NUM_WORLDVARS; i++)
-		arc << ACS_WorldVars[i];
-
-	for (int i = 0; i < NUM_GLOBALVARS; i++)
-		arc << ACS_GlobalVars[i];
-
-	byte check = 0x1d;
-	arc << check;          // consistancy marker
+	length = G_WriteNetDemoSnapshot(buf, NetDemo::MAX_SNAPSHOT_SIZE);
 
 	gameaction = ga_nothing;
-
-	arc.Close();
-
-	// get the size of the snapshot data	
-	length = memfile.Length();
-	memfile.WriteToBuffer(buf, NetDemo::MAX_SNAPSHOT_SIZE);
-			
-    if (level.info->snapshot != NULL)
-    {
-        delete level.info->snapshot;
-        level.info->snapshot = NULL;
-    }
 }
 
 
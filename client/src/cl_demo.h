@@ -58,9 +58,16 @@ private:
 	typedef enum
 	{
 		msg_packet		= 0xAA,
-		msg_snapshot
+		msg_snapshot,
+		msg_index		// index entry written by serverside netdemos
 	} netdemo_message_t;
 
+	typedef enum
+	{
+		index_snapshot,
+		index_map
+	} netdemo_index_t;
+
 	typedef struct
 	{
 		byte		type;
@@ -99,6 +106,7 @@ private:
 	bool readSnapshotIndex();
 	bool writeMapIndex();
 	bool readMapIndex();
+	bool rebuildIndex();
 	int getCurrentSnapshotIndex() const;
 	int getCurrentMapIndex() const;
 	
@@ -125,6 +133,7 @@ private:
 	static const size_t HEADER_SIZE = 64;
 	static const size_t MESSAGE_HEADER_SIZE = 9;
 	static const size_t INDEX_ENTRY_SIZE = 8;
+	static const size_t INDEX_MESSAGE_SIZE = 9;
 
 	static const uint16_t SNAPSHOT_SPACING = 20 * TICRATE;
 
@@ -61,6 +61,7 @@
 #include "cl_vote.h"
 #include "p_mobj.h"
 #include "p_pspr.h"
+#include "farchive.h"
 
 #include <string>
 #include <vector>
@@ -102,6 +103,8 @@ int       last_svgametic = 0;
 int       last_player_update = 0;
 
 bool		recv_full_update = false;
+static QWORD connect_time = 0;	// for measuring time to receive the full update
+static void CL_ClearLevelState(void);
 
 std::string connectpasshash = "";
 
@@ -365,6 +368,7 @@ void CL_QuitNetGame(void)
 	players.clear();
 
 	recv_full_update = false;
+	CL_ClearLevelState();
 	
 	if (netdemo.isRecording())
 		netdemo.stopRecording();
@@ -405,6 +409,7 @@ void CL_QuitNetGame(void)
 void CL_Reconnect(void)
 {
 	recv_full_update = false;
+	CL_ClearLevelState();
 	
 	if (netdemo.isRecording())
 		forcenetdemosplit = true;	
@@ -632,24 +637,21 @@ BEGIN_COMMAND (serverinfo)
 {   
 	std::vector<std::string> server_cvars;
 
-    cvar_t *Cvar = GetFirstCvar();
+    cvar_t *Cvar = GetFirstCvar(CVAR_SERVERINFO);
     size_t MaxFieldLength = 0;
     
     // [Russell] - Find the largest cvar name, used for formatting
     while (Cvar)
 	{			
-        if (Cvar->flags() & CVAR_SERVERINFO)
-        {
-            size_t FieldLength = strlen(Cvar->name());
-            
-            if (FieldLength > MaxFieldLength)
-                MaxFieldLength = FieldLength;                
+        size_t FieldLength = strlen(Cvar->name());
+        
+        if (FieldLength > MaxFieldLength)
+            MaxFieldLength = FieldLength;                
 
-			// store this cvar name in our vector to be sorted later
-			server_cvars.push_back(Cvar->name());
-        }
+		// store this cvar name in our vector to be sorted later
+		server_cvars.push_back(Cvar->name());
         
-        Cvar = Cvar->GetNext();
+        Cvar = Cvar->GetNext(CVAR_SERVERINFO);
     }
 
 	// sort the list of cvars
@@ -1352,6 +1354,9 @@ extern std::string missing_file, missing_hash;
 bool CL_Connect(void)
 {
 	players.clear();
+	CL_ClearLevelState();
+
+	connect_time = I_MSTime();
 
 	memset(packetseq, -1, sizeof(packetseq) );
 	packetnum = 0;
@@ -1803,6 +1808,7 @@ void CL_SpawnMobj()
 	{
 		mo->radius = int(MSG_ReadByte()) << FRACBITS;
 		mo->height = int(MSG_ReadByte()) << FRACBITS;
+		P_UpdateThingProxy (mo);
 	}
 }
 
@@ -2325,18 +2331,13 @@ void CL_ClearSectorSnapshots()
 }
 
 //
-// CL_UpdateSector
-// Updates floorheight and ceilingheight of a sector.
+// CL_SetSectorState
+// Sets the floorheight, ceilingheight and flats of a sector.
 //
-void CL_UpdateSector(void)
+static void CL_SetSectorState(unsigned short sectornum,
+							  unsigned short floorheight, unsigned short ceilingheight,
+							  unsigned short fp, unsigned short cp)
 {
-	unsigned short sectornum = (unsigned short)MSG_ReadShort();
-	unsigned short floorheight = MSG_ReadShort();
-	unsigned short ceilingheight = MSG_ReadShort();
-
-	unsigned short fp = MSG_ReadShort();
-	unsigned short cp = MSG_ReadShort();
-
 	if (!sectors || sectornum >= numsectors)
 		return;
 
@@ -2361,6 +2362,132 @@ void CL_UpdateSector(void)
 	sector_snaps[sectornum].addSnapshot(snap);
 }
 
+//
+// CL_UpdateSector
+// Updates floorheight and ceilingheight of a sector.
+//
+void CL_UpdateSector(void)
+{
+	unsigned short sectornum = (unsigned short)MSG_ReadShort();
+	unsigned short floorheight = MSG_ReadShort();
+	unsigned short ceilingheight = MSG_ReadShort();
+
+	unsigned short fp = MSG_ReadShort();
+	unsigned short cp = MSG_ReadShort();
+
+	CL_SetSectorState(sectornum, floorheight, ceilingheight, fp, cp);
+}
+
+//
+// CL_UpdateSectorRange
+// Updates floorheight and ceilingheight of a run of consecutive sectors.
+//
+void CL_UpdateSectorRange(void)
+{
+	unsigned short sectornum = (unsigned short)MSG_ReadShort();
+	byte count = MSG_ReadByte();
+
+	for (byte i = 0; i < count; i++, sectornum++)
+	{
+		unsigned short floorheight = MSG_ReadShort();
+		unsigned short ceilingheight = MSG_ReadShort();
+
+		unsigned short fp = MSG_ReadShort();
+		unsigned short cp = MSG_ReadShort();
+
+		CL_SetSectorState(sectornum, floorheight, ceilingheight, fp, cp);
+	}
+}
+
+//
+// Level state received from the server in chunks during a full update
+//
+static const size_t MAX_LEVELSTATE_SIZE = MAX_UDP_PACKET * 128;
+
+static std::vector<byte> levelstate;
+static std::set<size_t> levelstate_chunks;	// offsets of the chunks received
+static size_t levelstate_received = 0;
+static int levelstate_id = -1;
+
+//
+// CL_ClearLevelState
+// Drops a partly received level state.
+//
+static void CL_ClearLevelState(void)
+{
+	levelstate.clear();
+	levelstate_chunks.clear();
+	levelstate_received = 0;
+	levelstate_id = -1;
+}
+
+//
+// CL_ParseLevelState
+// Decompresses the level state and parses the server messages it contains
+// as if they had arrived in a packet.
+//
+static void CL_ParseLevelState()
+{
+	FLZOMemFile memfile;
+	memfile.Open(&levelstate[0]);		// open for reading
+
+	FArchive arc(memfile);
+
+	size_t len = arc.ReadCount();
+	if (len >= MAX_LEVELSTATE_SIZE)
+	{
+		Printf(PRINT_HIGH, "CL_ParseLevelState: Bad level state size %d\n", (int)len);
+		return;
+	}
+
+	buf_t msgs(len + 1);
+	arc.Read(msgs.ptr(), len);
+	msgs.setcursize(len);
+	arc.Close();
+
+	buf_t saved = net_message;
+	net_message = msgs;
+	CL_ParseCommands();
+	net_message = saved;
+}
+
+//
+// CL_LevelState
+// Reassembles a chunk of the level state.  Chunks can arrive out of order
+// when a reliable packet has to be resent.
+//
+void CL_LevelState(void)
+{
+	int id = MSG_ReadLong();
+	size_t size = MSG_ReadLong();
+	size_t offset = MSG_ReadLong();
+	size_t len = (unsigned short)MSG_ReadShort();
+	byte *data = (byte *)MSG_ReadChunk(len);
+
+	if (!data || size >= MAX_LEVELSTATE_SIZE || offset + len > size)
+		return;
+
+	if (id != levelstate_id || levelstate.size() != size)
+	{
+		CL_ClearLevelState();
+		levelstate.assign(size, 0);
+		levelstate_id = id;
+	}
+
+	// A resent chunk can arrive after the original made it
+	if (!levelstate_chunks.insert(offset).second)
+		return;
+
+	memcpy(&levelstate[offset], data, len);
+	levelstate_received += len;
+
+	if (levelstate_received == size)
+	{
+		CL_ParseLevelState();
+		CL_ClearLevelState();
+	}
+}
+
 //
 // CL_UpdateMovingSector
 // Updates floorheight and ceilingheight of a sector.
@@ -2631,6 +2758,9 @@ void CL_FinishedFullUpdate()
 {
 	recv_full_update = true;
 
+	DPrintf("Full update received %u ms after connecting\n",
+			(unsigned int)(I_MSTime() - connect_time));
+
 	// Write the first map snapshot to a netdemo
 	if (netdemo.isRecording())
 		netdemo.writeMapChange();
@@ -2981,6 +3111,8 @@ void CL_InitCommands(void)
 	cmds[svc_disconnectclient]	= &CL_DisconnectClient;
 	cmds[svc_activateline]		= &CL_ActivateLine;
 	cmds[svc_sector]			= &CL_UpdateSector;
+	cmds[svc_sectorrange]		= &CL_UpdateSectorRange;
+	cmds[svc_levelstate]		= &CL_LevelState;
 	cmds[svc_movingsector]		= &CL_UpdateMovingSector;
 	cmds[svc_switch]			= &CL_Switch;
 	cmds[svc_print]				= &CL_Print;
@@ -3325,6 +3457,7 @@ void CL_LocalDemoTic()
 		clientPlayer->mo->x = x;
 		clientPlayer->mo->y = y;
 		clientPlayer->mo->z = z;
+		P_UpdateThingProxy (clientPlayer->mo);
 		clientPlayer->mo->momx = momx;
 		clientPlayer->mo->momy = momy;
 		clientPlayer->mo->momz = momz;
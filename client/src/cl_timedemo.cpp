@@ -0,0 +1,351 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id$
+//
+// Copyright (C) 2006-2012 by The Odamex Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Timedemo: plays a netdemo back as fast as frames can be drawn and
+//	reports frame times with a per-stage breakdown of each frame.
+//
+//	While a timedemo runs, I_GetTime and I_WaitForTic are replaced by a
+//	clock that moves on exactly one tic per call to TryRunTics, so every
+//	pass through D_DoomLoop runs one gametic and draws one frame no
+//	matter how long the frame took.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#include "doomtype.h"
+#include "doomstat.h"
+#include "c_console.h"
+#include "c_dispatch.h"
+#include "d_net.h"
+#include "g_game.h"
+#include "i_system.h"
+#include "cl_main.h"
+#include "cl_demo.h"
+#include "cl_timedemo.h"
+
+extern NetDemo netdemo;
+extern int NoWipe;
+void CL_QuitCommand();
+void CL_NetDemoPlay(const std::string &filename);
+
+bool td_profiling = false;
+
+QWORD td_stagestart[NUMTDSTAGES];
+QWORD td_stagetime[NUMTDSTAGES];
+
+static const char *stagenames[NUMTDSTAGES] =
+{
+	"bsp",
+	"walls",
+	"planes",
+	"masked",
+	"drawqueue",
+	"automap",
+	"hud",
+	"blit"
+};
+
+// Times of one frame in microseconds
+typedef struct
+{
+	DWORD total;
+	DWORD stage[NUMTDSTAGES];
+} tdframe_t;
+
+static std::vector<tdframe_t> td_frames;
+static std::string td_demoname;
+static std::string td_outfile;
+static bool td_quit;
+static BOOL td_oldnoblit;
+static QWORD td_lastframe;
+
+static QWORD td_tic;
+static QWORD (*td_oldgettime) (void);
+static QWORD (*td_oldwaitfortic) (QWORD);
+
+static QWORD TD_GetTime (void)
+{
+	return td_tic;
+}
+
+static QWORD TD_WaitForTic (QWORD prevtic)
+{
+	td_tic = prevtic + 1;
+	return td_tic;
+}
+
+//
+// CL_StartTimeDemo
+//
+void CL_StartTimeDemo (const std::string &filename, const std::string &outfile, bool present, bool quit)
+{
+	if (td_profiling)
+	{
+		Printf (PRINT_HIGH, "A timedemo is already running.\n");
+		return;
+	}
+
+	CL_NetDemoPlay (filename);
+	if (!netdemo.isPlaying())
+		return;
+
+	td_frames.clear ();
+	td_demoname = filename;
+	td_outfile = outfile;
+	td_quit = quit;
+	td_lastframe = 0;
+	memset (td_stagetime, 0, sizeof(td_stagetime));
+
+	td_oldnoblit = noblit;
+	noblit = !present;
+
+	td_tic = I_GetTime ();
+	td_oldgettime = I_GetTime;
+	td_oldwaitfortic = I_WaitForTic;
+	I_GetTime = TD_GetTime;
+	I_WaitForTic = TD_WaitForTic;
+
+	td_profiling = true;
+}
+
+//
+// CL_TimeDemoFrame
+// Called after each frame is drawn. Frames drawn outside of a level, such
+// as while the netdemo is loading a map, are left out of the results.
+//
+void CL_TimeDemoFrame (void)
+{
+	if (!td_profiling)
+		return;
+
+	QWORD now = I_UTime ();
+
+	if (td_lastframe && gamestate == GS_LEVEL)
+	{
+		tdframe_t frame;
+
+		frame.total = (DWORD)(now - td_lastframe);
+		for (int i = 0; i < NUMTDSTAGES; i++)
+			frame.stage[i] = (DWORD)td_stagetime[i];
+
+		// walls are drawn during the BSP traversal
+		frame.stage[TDS_BSP] -= std::min (frame.stage[TDS_BSP], frame.stage[TDS_WALLS]);
+
+		td_frames.push_back (frame);
+	}
+
+	memset (td_stagetime, 0, sizeof(td_stagetime));
+	td_lastframe = now;
+
+	// Screen wipes draw several frames for one view, so keep them out
+	NoWipe = 1;
+}
+
+//
+// TD_Percentile
+// Nearest-rank percentile of a sorted list of frame times, in ms.
+//
+static double TD_Percentile (const std::vector<DWORD> &sorted, double pct)
+{
+	size_t rank = (size_t)ceil (pct / 100.0 * sorted.size ());
+
+	if (rank < 1)
+		rank = 1;
+
+	return sorted[rank - 1] / 1000.0;
+}
+
+//
+// TD_WriteJSON
+//
+static bool TD_WriteJSON (FILE *fp, const std::vector<DWORD> &sorted, double avg, const double *stageavg)
+{
+	std::string name;
+
+	// escape the demo name for the string literal
+	for (size_t i = 0; i < td_demoname.length (); i++)
+	{
+		if (td_demoname[i] == '"' || td_demoname[i] == '\\')
+			name += '\\';
+		name += td_demoname[i];
+	}
+
+	fprintf (fp, "{\n");
+	fprintf (fp, "\t\"demo\": \"%s\",\n", name.c_str ());
+	fprintf (fp, "\t\"frames\": %u,\n", (unsigned)sorted.size ());
+	fprintf (fp, "\t\"fps\": %.2f,\n", avg > 0.0 ? 1000.0 / avg : 0.0);
+	fprintf (fp, "\t\"frame_ms\": {\n");
+	fprintf (fp, "\t\t\"min\": %.3f,\n", sorted.front () / 1000.0);
+	fprintf (fp, "\t\t\"avg\": %.3f,\n", avg);
+	fprintf (fp, "\t\t\"p50\": %.3f,\n", TD_Percentile (sorted, 50.0));
+	fprintf (fp, "\t\t\"p90\": %.3f,\n", TD_Percentile (sorted, 90.0));
+	fprintf (fp, "\t\t\"p99\": %.3f,\n", TD_Percentile (sorted, 99.0));
+	fprintf (fp, "\t\t\"max\": %.3f\n", sorted.back () / 1000.0);
+	fprintf (fp, "\t},\n");
+	fprintf (fp, "\t\"stage_avg_ms\": {\n");
+	for (int i = 0; i < NUMTDSTAGES; i++)
+		fprintf (fp, "\t\t\"%s\": %.3f%s\n", stagenames[i], stageavg[i], i < NUMTDSTAGES - 1 ? "," : "");
+	fprintf (fp, "\t}\n");
+	fprintf (fp, "}\n");
+
+	return !ferror (fp);
+}
+
+//
+// TD_WriteCSV
+// One row per frame so the results can be plotted.
+//
+static bool TD_WriteCSV (FILE *fp)
+{
+	fprintf (fp, "frame,total_us");
+	for (int i = 0; i < NUMTDSTAGES; i++)
+		fprintf (fp, ",%s_us", stagenames[i]);
+	fprintf (fp, "\n");
+
+	for (size_t f = 0; f < td_frames.size (); f++)
+	{
+		fprintf (fp, "%u,%u", (unsigned)f, (unsigned)td_frames[f].total);
+		for (int i = 0; i < NUMTDSTAGES; i++)
+			fprintf (fp, ",%u", (unsigned)td_frames[f].stage[i]);
+		fprintf (fp, "\n");
+	}
+
+	return !ferror (fp);
+}
+
+//
+// TD_Report
+//
+static void TD_Report (void)
+{
+	if (td_frames.empty ())
+	{
+		Printf (PRINT_HIGH, "timedemo: no frames were drawn\n");
+		return;
+	}
+
+	std::vector<DWORD> sorted;
+	double total = 0.0;
+	double stageavg[NUMTDSTAGES];
+
+	sorted.reserve (td_frames.size ());
+	memset (stageavg, 0, sizeof(stageavg));
+
+	for (size_t f = 0; f < td_frames.size (); f++)
+	{
+		sorted.push_back (td_frames[f].total);
+		total += td_frames[f].total;
+		for (int i = 0; i < NUMTDSTAGES; i++)
+			stageavg[i] += td_frames[f].stage[i];
+	}
+
+	std::sort (sorted.begin (), sorted.end ());
+
+	double avg = total / td_frames.size () / 1000.0;
+	for (int i = 0; i < NUMTDSTAGES; i++)
+		stageavg[i] /= td_frames.size () * 1000.0;
+
+	Printf (PRINT_HIGH, "timedemo: %u frames in %.2f seconds (%.2f fps)\n",
+		(unsigned)td_frames.size (), total / 1000000.0, avg > 0.0 ? 1000.0 / avg : 0.0);
+	Printf (PRINT_HIGH, "frame ms: min %.2f avg %.2f p50 %.2f p90 %.2f p99 %.2f max %.2f\n",
+		sorted.front () / 1000.0, avg, TD_Percentile (sorted, 50.0),
+		TD_Percentile (sorted, 90.0), TD_Percentile (sorted, 99.0), sorted.back () / 1000.0);
+	for (int i = 0; i < NUMTDSTAGES; i++)
+		Printf (PRINT_HIGH, "%10s: %.3f ms\n", stagenames[i], stageavg[i]);
+
+	if (td_outfile.empty ())
+		return;
+
+	FILE *fp = fopen (td_outfile.c_str (), "w");
+	if (!fp)
+	{
+		Printf (PRINT_HIGH, "timedemo: could not open %s\n", td_outfile.c_str ());
+		return;
+	}
+
+	size_t dot = td_outfile.find_last_of ('.');
+	bool csv = (dot != std::string::npos && !stricmp (td_outfile.c_str () + dot, ".csv"));
+	bool ok = csv ? TD_WriteCSV (fp) : TD_WriteJSON (fp, sorted, avg, stageavg);
+
+	fclose (fp);
+
+	if (ok)
+		Printf (PRINT_HIGH, "timedemo: results written to %s\n", td_outfile.c_str ());
+	else
+		Printf (PRINT_HIGH, "timedemo: error writing %s\n", td_outfile.c_str ());
+}
+
+//
+// CL_EndTimeDemo
+// Called when netdemo playback stops.
+//
+void CL_EndTimeDemo (void)
+{
+	if (!td_profiling)
+		return;
+
+	td_profiling = false;
+
+	I_GetTime = td_oldgettime;
+	I_WaitForTic = td_oldwaitfortic;
+	D_ResyncTics ();
+	noblit = td_oldnoblit;
+
+	TD_Report ();
+	td_frames.clear ();
+
+	if (td_quit)
+		CL_QuitCommand ();
+}
+
+BEGIN_COMMAND (timedemo)
+{
+	if (argc < 2)
+	{
+		Printf (PRINT_HIGH, "Usage: timedemo <netdemo> [resultfile] [noblit]\n");
+		Printf (PRINT_HIGH, "Results are written as CSV if resultfile ends in .csv, otherwise as JSON.\n");
+		return;
+	}
+
+	std::string outfile;
+	bool present = true;
+
+	for (size_t i = 2; i < argc; i++)
+	{
+		if (!stricmp (argv[i], "noblit"))
+			present = false;
+		else
+			outfile = argv[i];
+	}
+
+	if (!connected)
+		G_CheckDemoStatus ();	// cleans up vanilla demo or single player game
+
+	CL_QuitNetGame ();
+	connected = false;
+
+	CL_StartTimeDemo (argv[1], outfile, present, false);
+}
+END_COMMAND (timedemo)
+
+VERSION_CONTROL (cl_timedemo_cpp, "$Id$")
@@ -0,0 +1,74 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id$
+//
+// Copyright (C) 2006-2012 by The Odamex Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Timedemo: plays a netdemo back as fast as frames can be drawn and
+//	reports frame times with a per-stage breakdown of each frame.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __CL_TIMEDEMO_H__
+#define __CL_TIMEDEMO_H__
+
+#include <string>
+
+#include "doomtype.h"
+#include "i_system.h"
+
+typedef enum
+{
+	TDS_BSP,			// BSP traversal, less the walls drawn during it
+	TDS_WALLS,			// R_StoreWallRange
+	TDS_PLANES,			// R_DrawPlanes
+	TDS_MASKED,			// R_DrawMasked
+	TDS_DRAWQUEUE,		// replaying queued draws on the render threads
+	TDS_AUTOMAP,		// AM_Drawer
+	TDS_HUD,			// status bar, HUD and CTF overlays
+	TDS_BLIT,			// presenting the frame
+
+	NUMTDSTAGES
+} tdstage_t;
+
+// True while a timedemo is being profiled
+extern bool td_profiling;
+
+extern QWORD td_stagestart[NUMTDSTAGES];
+extern QWORD td_stagetime[NUMTDSTAGES];
+
+void CL_StartTimeDemo (const std::string &filename, const std::string &outfile, bool present, bool quit);
+void CL_TimeDemoFrame (void);
+void CL_EndTimeDemo (void);
+
+//
+// TD_BeginStage
+//
+inline void TD_BeginStage (tdstage_t stage)
+{
+	if (td_profiling)
+		td_stagestart[stage] = I_UTime ();
+}
+
+//
+// TD_EndStage
+//
+inline void TD_EndStage (tdstage_t stage)
+{
+	if (td_profiling)
+		td_stagetime[stage] += I_UTime () - td_stagestart[stage];
+}
+
+#endif // __CL_TIMEDEMO_H__
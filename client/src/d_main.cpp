@@ -92,6 +92,8 @@
 #include "stats.h"
 #include "p_ctf.h"
 #include "cl_main.h"
+#include "cl_timedemo.h"
+#include "d_startup.h"
 
 #ifdef GEKKO
 #include "i_wii.h"
@@ -210,6 +212,9 @@ void D_PostEvent (const event_t* ev)
 		eventhead = 0;
 }
 
+// True while a wipe is drawn one step per frame during a net game
+bool d_livewiping = false;
+
 //
 // D_Display
 //  draw current display, possibly wiping it from the previous
@@ -295,10 +300,12 @@ void D_Display (void)
 				R_RenderPlayerView (&displayplayer());
 			if (automapactive)
 				AM_Drawer ();
+			TD_BeginStage (TDS_HUD);
 			C_DrawMid ();
 			CTF_DrawHud ();
 			ST_Drawer ();
 			HU_Drawer ();
+			TD_EndStage (TDS_HUD);
 			break;
 
 		case GS_INTERMISSION:
@@ -347,16 +354,14 @@ void D_Display (void)
 		NoWipe = 10;
 	}
 
-	static bool live_wiping = false;
-
 	if (!wipe)
 	{
-		if(live_wiping)
+		if(d_livewiping)
 		{
 			// wipe update online (multiple calls, not just looping here)
 			C_DrawConsole ();
 			wipe_EndScreen();
-			live_wiping = !wipe_ScreenWipe (1);
+			d_livewiping = !wipe_ScreenWipe (1);
 			M_Drawer ();			// menu is drawn even on top of wipes
 			I_FinishUpdate ();		// page flip or blit buffer
 		}
@@ -405,12 +410,12 @@ void D_Display (void)
 		else
 		{
 			// wipe update online
-			live_wiping = true;
+			d_livewiping = true;
 
 			// wipe update online (multiple calls, not just looping here)
 			C_DrawConsole ();
 			wipe_EndScreen();
-			live_wiping = !wipe_ScreenWipe (1);
+			d_livewiping = !wipe_ScreenWipe (1);
 			M_Drawer ();			// menu is drawn even on top of wipes
 			I_FinishUpdate ();		// page flip or blit buffer
 		}
@@ -439,6 +444,8 @@ void D_DoomLoop (void)
 
 			// Update display, next frame, with current state.
 			D_Display ();
+
+			CL_TimeDemoFrame ();
 		}
 		catch (CRecoverableError &error)
 		{
@@ -1296,6 +1303,8 @@ std::vector<size_t> D_DoomWadReboot(
 	// assume failure
 	lastWadRebootSuccess = false;
 
+	D_BeginStartupStage ("D_DoomWadReboot");
+
 	if (modifiedgame && (gameinfo.flags & GI_SHAREWARE))
 		I_Error ("\nYou cannot switch WAD with the shareware version. Register!");
 
@@ -1307,8 +1316,7 @@ std::vector<size_t> D_DoomWadReboot(
 
 	DThinker::DestroyAllThinkers();
 
-	// Close all open WAD files
-	W_Close();
+	// Wads that stay loaded are kept open by W_InitMultipleFiles
 
 	// [ML] 9/11/10: Reset custom wad level information from MAPINFO et al.
     // I have never used memset, I hope I am not invoking satan by doing this :(
@@ -1373,7 +1381,11 @@ std::vector<size_t> D_DoomWadReboot(
 	if(wadnames.size() > 1)
 		modifiedgame = true;
 
+	D_BeginStartupStage ("W_InitMultipleFiles");
 	wadhashes = W_InitMultipleFiles (wadfiles);
+	D_EndStartupStage ();
+
+	D_ReadAheadStartupLumps ();
 
     UndoDehPatch();
 
@@ -1405,6 +1417,8 @@ std::vector<size_t> D_DoomWadReboot(
 	S_Init (snd_sfxvolume, snd_musicvolume);
 	ST_Init();
 
+	D_FinishStartup ();
+
 	// preserve state
 	lastWadRebootSuccess = fails.empty();
 
@@ -1425,6 +1439,8 @@ void D_DoomMain (void)
 	const char *iwad;
 	extern std::string defdemoname;
 
+	D_BeginStartupStage ("D_DoomMain");
+
 	M_ClearRandom();
 
 	gamestate = GS_STARTUP;
@@ -1438,32 +1454,47 @@ void D_DoomMain (void)
 
 	Printf (PRINT_HIGH, "Heapsize: %u megabytes\n", got_heapsize);
 
+	D_BeginStartupStage ("M_LoadDefaults");
 	M_LoadDefaults ();					// load before initing other systems
+	D_EndStartupStage ();
 	C_ExecCmdLineParams (true, false);	// [RH] do all +set commands on the command line
 
 	iwad = Args.CheckValue("-iwad");
 	if(!iwad)
 		iwad = "";
 
+	D_BeginStartupStage ("W_InitMultipleFiles");
 	D_AddDefWads(iwad);
 	D_AddCmdParameterFiles();
 
 	wadhashes = W_InitMultipleFiles (wadfiles);
+	D_EndStartupStage ();
+
+	// Everything after this reads lumps, so start reading them
+	D_ReadAheadStartupLumps ();
 
 	// [RH] Initialize localizable strings.
+	D_BeginStartupStage ("GStrings");
 	GStrings.LoadStrings (W_GetNumForName ("LANGUAGE"), STRING_TABLE_SIZE, false);
 	GStrings.Compact ();
+	D_EndStartupStage ();
 
 	// [RH] Initialize configurable strings.
 	//D_InitStrings ();
+	D_BeginStartupStage ("DeHackEd");
 	D_DoDefDehackedPatch ();
+	D_EndStartupStage ();
 
 	// [RH] Moved these up here so that we can do most of our
 	//		startup output in a fullscreen console.
 
 	HU_Init ();
+	D_BeginStartupStage ("I_Init");
 	I_Init ();
+	D_EndStartupStage ();
+	D_BeginStartupStage ("V_Init");
 	V_Init ();
+	D_EndStartupStage ();
 
 	// Base systems have been inited; enable cvar callbacks
 	cvar_t::EnableCallbacks ();
@@ -1555,13 +1586,17 @@ void D_DoomMain (void)
 	G_SetLevelStrings ();
 
 	// [RH] Parse through all loaded mapinfo lumps
+	D_BeginStartupStage ("G_ParseMapInfo");
 	G_ParseMapInfo ();
+	D_EndStartupStage ();
 	
 	// [ML] Parse musinfo lump
 	G_ParseMusInfo ();
 
 	// [RH] Parse any SNDINFO lumps
+	D_BeginStartupStage ("S_ParseSndInfo");
 	S_ParseSndInfo();
+	D_EndStartupStage ();
 
 	// Check for -file in shareware
 	if (modifiedgame && (gameinfo.flags & GI_SHAREWARE))
@@ -1573,27 +1608,39 @@ void D_DoomMain (void)
 #endif
 
 	Printf (PRINT_HIGH, "M_Init: Init miscellaneous info.\n");
+	D_BeginStartupStage ("M_Init");
 	M_Init ();
+	D_EndStartupStage ();
 
 	Printf (PRINT_HIGH, "R_Init: Init DOOM refresh daemon.\n");
+	D_BeginStartupStage ("R_Init");
 	R_Init ();
+	D_EndStartupStage ();
 
 	Printf (PRINT_HIGH, "P_Init: Init Playloop state.\n");
+	D_BeginStartupStage ("P_Init");
 	P_InitEffects();	// [ML] Do this here so we don't have to put particle crap in server
 	P_Init ();
+	D_EndStartupStage ();
 
 	Printf (PRINT_HIGH, "S_Init: Setting up sound.\n");
 	Printf (PRINT_HIGH, "S_Init: default sfx volume is %g\n", (float)snd_sfxvolume);
 	Printf (PRINT_HIGH, "S_Init: default music volume is %g\n", (float)snd_musicvolume);
+	D_BeginStartupStage ("S_Init");
 	S_Init (snd_sfxvolume, snd_musicvolume);
+	D_EndStartupStage ();
 
 	I_FinishClockCalibration ();
 
 	Printf (PRINT_HIGH, "D_CheckNetGame: Checking network game status.\n");
+	D_BeginStartupStage ("D_CheckNetGame");
 	D_CheckNetGame ();
+	D_EndStartupStage ();
 
 	Printf (PRINT_HIGH, "ST_Init: Init status bar.\n");
+	D_BeginStartupStage ("ST_Init");
 	ST_Init ();
+	D_EndStartupStage ();
 
 	// [RH] Initialize items. Still only used for the give command. :-(
 	InitItems ();
@@ -1602,6 +1649,8 @@ void D_DoomMain (void)
 	// about to begin the game.
 	cvar_t::EnableNoSet ();
 
+	D_FinishStartup ();
+
 	// [RH] Now that all game subsystems have been initialized,
 	// do all commands on the command line other than +set
 	C_ExecCmdLineParams (false, false);
@@ -1628,6 +1677,22 @@ void D_DoomMain (void)
 		}
 	}
 
+	// Play a netdemo as fast as possible, report the frame times and quit
+	p = Args.CheckParm("-timedemo");
+	if (p)
+	{
+		if (Args.GetArg(p + 1))
+		{
+			const char *outfile = Args.CheckValue("-timedemoout");
+			CL_StartTimeDemo(Args.GetArg(p + 1), outfile ? outfile : "",
+							 !Args.CheckParm("-noblit"), true);
+		}
+		else
+		{
+			Printf(PRINT_HIGH, "No netdemo filename specified.\n");
+		}
+	}
+
 	// denis - bring back the demos
     if ( gameaction != ga_loadgame )
     {
@@ -43,9 +43,12 @@
 #include "cl_main.h"
 #include "m_argv.h"
 #include "cl_demo.h"
+#include "r_interp.h"
 
 extern NetDemo netdemo;
 
+EXTERN_CVAR (vid_maxfps)
+
 extern byte		*demo_p;		// [RH] Special "ticcmds" get recorded in demos
 
 void CL_RememberSkin(void);
@@ -113,6 +116,7 @@ void TryStepTics(QWORD tics)
 		if(canceltics && canceltics--)
 			continue;
 
+		R_InterpolationTic ();
 		NetUpdate ();
 
 		if (advancedemo)
@@ -132,12 +136,82 @@ void TryStepTics(QWORD tics)
 
 QWORD nextstep = 0;
 
+static QWORD oldentertics = 0;
+
+//
+// D_ResyncTics
+// Restarts tic counting from the current time. Needed after I_GetTime has
+// been swapped for a clock that ran ahead of real time, as a timedemo does.
+//
+void D_ResyncTics (void)
+{
+	oldentertics = I_GetTime ();
+}
+
+//
+// D_TicFrac
+// How far real time has moved on towards the next tic, as a fraction.
+//
+fixed_t D_TicFrac (void)
+{
+	QWORD now = I_MSTime () * TICRATE;
+	QWORD start = oldentertics * 1000;
+
+	if (now <= start)
+		return 0;
+	if (now - start >= 1000)
+		return FRACUNIT;
+
+	return (fixed_t)((now - start) * FRACUNIT / 1000);
+}
+
+//
+// D_LimitFrameRate
+// Waits until it is time for the next frame when vid_maxfps is set.
+// A late frame does not make the next one come sooner.
+//
+static void D_LimitFrameRate (void)
+{
+	static QWORD nextframe = 0;
+
+	if (vid_maxfps.asInt () <= 0)
+		return;
+
+	QWORD frametime = 1000000 / vid_maxfps.asInt ();
+	QWORD now = I_UTime ();
+
+	if (now >= nextframe || nextframe - now > frametime)
+	{
+		nextframe = now + frametime;
+		return;
+	}
+
+	while (nextframe > now + 2000)
+	{
+		I_Yield ();
+		now = I_UTime ();
+	}
+
+	while (now < nextframe)
+		now = I_UTime ();
+
+	nextframe += frametime;
+}
+
 void TryRunTics (void)
 {
+	QWORD entertic;
+
 	// get real tics
-	static QWORD oldentertics = 0;
+	if (R_DrawBetweenTics ())
+	{
+		// draw a frame whether or not a tic has gone by
+		D_LimitFrameRate ();
+		entertic = I_GetTime ();
+	}
+	else
+		entertic = I_WaitForTic (oldentertics);
 
-	QWORD entertic = I_WaitForTic (oldentertics);
 	QWORD realtics = entertic - oldentertics;
 	oldentertics = entertic;
 
@@ -159,7 +233,16 @@ void TryRunTics (void)
 	
 	// run the realtics tics
 	if(!step_mode)
-		TryStepTics(realtics);
+	{
+		if (realtics)
+			TryStepTics(realtics);
+		else
+		{
+			// gather input for the next tic's ticcmd
+			I_StartTic ();
+			D_ProcessEvents ();
+		}
+	}
 	else
 	{
 		NetUpdate();
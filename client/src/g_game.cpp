@@ -64,6 +64,7 @@
 #include "cl_main.h"
 #include "cl_demo.h"
 #include "gi.h"
+#include "r_interp.h"
 
 #ifdef _XBOX
 #include "i_xbox.h"
@@ -671,11 +672,31 @@ int G_ZDoomDIMouseScaleY(int y)
 	return int(y * mouse_sensitivity);
 }
 
+//
+// G_PendingMouseLook
+// The turn and look that mouse movement since the last ticcmd will add
+// to the next one, so frames drawn between tics can follow the mouse.
+//
+void G_PendingMouseLook (int &yaw, int &look)
+{
+	yaw = look = 0;
+
+	if (!(Actions[ACTION_STRAFE] || lookstrafe))
+		yaw = -(int)((float)(mousex*0x8) * m_yaw) / ticdup;
+
+	if ((Actions[ACTION_MLOOK]) || (cl_mouselook && sv_freelook))
+	{
+		int val = (int)((float)(mousey * 16) * m_pitch);
+		look = invertmouse ? -val : val;
+	}
+}
+
 void G_ProcessMouseMovementEvent(const event_t *ev)
 {
 	static int prevx = 0, prevy = 0;
 	int evx = ev->data2;
 	int evy = ev->data3;
+	int movex, movey;
 
 	if (m_filter)
 	{
@@ -705,19 +726,32 @@ void G_ProcessMouseMovementEvent(const event_t *ev)
 	if (dynres_state)
 	{
 		if (evx < 0)
-			mousex = -int(pow((double)(*scalexfunc)(-evx), (double)dynresval));
+			movex = -int(pow((double)(*scalexfunc)(-evx), (double)dynresval));
 		else
-			mousex = int(pow((double)(*scalexfunc)(evx), (double)dynresval));
+			movex = int(pow((double)(*scalexfunc)(evx), (double)dynresval));
 
 		if (evy < 0)
-			mousey = -int(pow((double)(*scaleyfunc)(-evy), (double)dynresval));
+			movey = -int(pow((double)(*scaleyfunc)(-evy), (double)dynresval));
 		else
-			mousey = int(pow((double)(*scaleyfunc)(evy), (double)dynresval));
+			movey = int(pow((double)(*scaleyfunc)(evy), (double)dynresval));
+	}
+	else
+	{
+		movex = (*scalexfunc)(evx);
+		movey = (*scaleyfunc)(evy);
+	}
+
+	// When frames are drawn between tics, several events can arrive in
+	// one tic, so they are added up until G_BuildTiccmd uses them
+	if (R_DrawBetweenTics ())
+	{
+		mousex += movex;
+		mousey += movey;
 	}
 	else
 	{
-		mousex = (*scalexfunc)(evx);
-		mousey = (*scaleyfunc)(evy);
+		mousex = movex;
+		mousey = movey;
 	}
 }
 
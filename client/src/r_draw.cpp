@@ -82,6 +82,8 @@ void (*R_DrawTranslatedColumn)(void);
 void (*R_DrawSpan)(void);
 void (*R_DrawSlopeSpan)(void);
 void (*rt_map4cols)(int,int,int);
+void (*rt_lucent4cols)(int,int,int);
+void (*rt_tlatelucent4cols)(int,int,int);
 
 
 //
@@ -91,17 +93,17 @@ void (*rt_map4cols)(int,int,int);
 extern "C" {
 int				dc_pitch=0x12345678;	// [RH] Distance between rows
 
-lighttable_t*	dc_colormap; 
-int 			dc_x; 
-int 			dc_yl; 
-int 			dc_yh; 
-fixed_t 		dc_iscale; 
+R_THREADLOCAL lighttable_t*	dc_colormap; 
+R_THREADLOCAL int 			dc_x; 
+R_THREADLOCAL int 			dc_yl; 
+R_THREADLOCAL int 			dc_yh; 
+R_THREADLOCAL fixed_t 		dc_iscale; 
 fixed_t 		dc_texturemid;
-fixed_t			dc_texturefrac;
-int				dc_color;				// [RH] Color for column filler
+R_THREADLOCAL fixed_t			dc_texturefrac;
+R_THREADLOCAL int				dc_color;				// [RH] Color for column filler
 
 // first pixel in a column (possibly virtual) 
-byte*			dc_source;				
+R_THREADLOCAL byte*			dc_source;				
 
 // just for profiling 
 int 			dccount;
@@ -380,7 +382,7 @@ void R_DrawFuzzColumnP_C (void)
 //
 // R_DrawTranlucentColumn
 //
-fixed_t dc_translevel;
+R_THREADLOCAL fixed_t dc_translevel;
 
 /*
 [RH] This translucency algorithm is based on DOSDoom 0.65's, but uses
@@ -491,7 +493,7 @@ void R_DrawTranslucentColumnP_C (void)
 //	of the BaronOfHell, the HellKnight, uses
 //	identical sprites, kinda brightened up.
 //
-byte*	dc_translation;
+R_THREADLOCAL byte*	dc_translation;
 byte*	translationtables;
 
 void R_DrawTranslatedColumnP_C (void)
@@ -616,33 +618,33 @@ void R_DrawTlatedLucentColumnP_C (void)
 //
 extern "C" {
 int						ds_colsize=0xdeadbeef;	// [RH] Distance between columns
-int						ds_color;				// [RH] color for non-textured spans
+R_THREADLOCAL int						ds_color;				// [RH] color for non-textured spans
 
-int 					ds_y; 
-int 					ds_x1; 
-int 					ds_x2;
+R_THREADLOCAL int 					ds_y; 
+R_THREADLOCAL int 					ds_x1; 
+R_THREADLOCAL int 					ds_x2;
 
-lighttable_t*			ds_colormap; 
+R_THREADLOCAL lighttable_t*			ds_colormap; 
 
-dsfixed_t 				ds_xfrac; 
-dsfixed_t 				ds_yfrac; 
-dsfixed_t 				ds_xstep; 
-dsfixed_t 				ds_ystep;
+R_THREADLOCAL dsfixed_t 				ds_xfrac; 
+R_THREADLOCAL dsfixed_t 				ds_yfrac; 
+R_THREADLOCAL dsfixed_t 				ds_xstep; 
+R_THREADLOCAL dsfixed_t 				ds_ystep;
 
 // start of a 64*64 tile image 
-byte*					ds_source;		
+R_THREADLOCAL byte*					ds_source;		
 
 // just for profiling
 int 					dscount;
 
 // [SL] 2012-03-19 - For sloped planes
-double					ds_iu;
-double					ds_iv;
-double					ds_iustep;
-double					ds_ivstep;
-double					ds_id;
-double					ds_idstep;
-byte					*slopelighting[MAXWIDTH];
+R_THREADLOCAL double					ds_iu;
+R_THREADLOCAL double					ds_iv;
+R_THREADLOCAL double					ds_iustep;
+R_THREADLOCAL double					ds_ivstep;
+R_THREADLOCAL double					ds_id;
+R_THREADLOCAL double					ds_idstep;
+R_THREADLOCAL byte					*slopelighting[MAXWIDTH];
 }
 
 //
@@ -1491,6 +1493,8 @@ void R_InitColumnDrawers (BOOL is8bit)
 			rt_map4cols			= rt_map4cols_asm2;
 		else
 			rt_map4cols			= rt_map4cols_asm1;
+		rt_lucent4cols			= rt_lucent4cols_c;
+		rt_tlatelucent4cols		= rt_tlatelucent4cols_c;
 #else
 		R_DrawColumnHoriz		= R_DrawColumnHorizP_C;
 		R_DrawColumn			= R_DrawColumnP_C;
@@ -1499,6 +1503,8 @@ void R_InitColumnDrawers (BOOL is8bit)
 		R_DrawTranslatedColumn	= R_DrawTranslatedColumnP_C;
 		R_DrawSpan				= R_DrawSpanP_C;
 		rt_map4cols				= rt_map4cols_c;
+		rt_lucent4cols			= rt_lucent4cols_c;
+		rt_tlatelucent4cols		= rt_tlatelucent4cols_c;
 		R_DrawSlopeSpan			= R_DrawSlopeSpanP_C;
 #endif
 	} else {
@@ -1521,6 +1527,10 @@ void R_InitColumnDrawers (BOOL is8bit)
 		// will be needed if > 8bit color is supported again.
 		R_DrawSlopeSpan			= R_DrawSlopeSpanP_C;
 	}
+
+#ifdef R_SIMDDRAWERS
+	R_InitSIMDDrawers (is8bit);
+#endif
 }
 
 VERSION_CONTROL (r_draw_cpp, "$Id: r_draw.cpp 3174 2012-05-11 01:03:43Z mike $")
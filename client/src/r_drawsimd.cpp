@@ -0,0 +1,951 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id$
+//
+// Copyright (C) 2006-2012 by The Odamex Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	SSE2 and AVX2 versions of the span drawers, picked at startup from
+//	what the CPU reports. They put out exactly the same pixels as the C
+//	drawers: the texture coordinates are stepped several pixels at a
+//	time in the same integer arithmetic and only the lookups are batched.
+//
+//	The rt_map4cols, rt_lucent4cols and rt_tlatelucent4cols drawers are
+//	here too. Their four pixels in a row are next to each other, so each
+//	row goes out in one store, and the AVX2 ones do two rows with each
+//	gather. They are no faster than C, though: the lookups are what they
+//	spend their time on, and a gather costs about as much as the loads
+//	it replaces. So they are only used with -simdcols, and translucency
+//	is drawn by the C drawers by default.
+//
+//	The other column drawers (plain, translated, translucent and their
+//	ARGB versions) are only in C. A column's pixels are a screen pitch
+//	apart, so each one needs its own store even after a gather.
+//
+//	drawertest checks the drawers here against the C ones.
+//
+//-----------------------------------------------------------------------------
+
+#include "doomtype.h"
+#include "doomdef.h"
+#include "m_argv.h"
+#include "r_local.h"
+#include "v_video.h"
+#include "c_console.h"
+#include "c_dispatch.h"
+
+#ifdef R_SIMDDRAWERS
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SIMD_TARGET(x)
+#else
+#include <cpuid.h>
+#define SIMD_TARGET(x)	__attribute__((target(x)))
+#endif
+
+#include <emmintrin.h>
+#include <immintrin.h>
+
+enum
+{
+	SIMD_NONE,
+	SIMD_SSE2,
+	SIMD_AVX2
+};
+
+static const char *simdnames[] = { "none", "SSE2", "AVX2" };
+
+//
+// R_CPUID
+//
+static void R_CPUID (unsigned int leaf, unsigned int regs[4])
+{
+#ifdef _MSC_VER
+	__cpuidex ((int *)regs, leaf, 0);
+#else
+	__cpuid_count (leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+//
+// R_DetectSIMD
+// AVX2 is only usable when the OS saves the YMM registers on a task
+// switch, which is what the OSXSAVE/XGETBV check is for.
+//
+static int R_DetectSIMD (void)
+{
+	unsigned int regs[4];
+	unsigned int maxleaf;
+
+	R_CPUID (0, regs);
+	maxleaf = regs[0];
+	if (maxleaf < 1)
+		return SIMD_NONE;
+
+	R_CPUID (1, regs);
+	if (!(regs[3] & (1 << 26)))
+		return SIMD_NONE;
+
+	if (maxleaf < 7 || (regs[2] & 0x18000000) != 0x18000000)
+		return SIMD_SSE2;
+
+	{
+		unsigned int xcr0;
+#ifdef _MSC_VER
+		xcr0 = (unsigned int)_xgetbv (0);
+#else
+		unsigned int xcr0hi;
+		__asm__ __volatile__ ("xgetbv" : "=a" (xcr0), "=d" (xcr0hi) : "c" (0));
+#endif
+		if ((xcr0 & 6) != 6)
+			return SIMD_SSE2;
+	}
+
+	R_CPUID (7, regs);
+	if (!(regs[1] & (1 << 5)))
+		return SIMD_SSE2;
+
+	return SIMD_AVX2;
+}
+
+/****************************************/
+/*										*/
+/* SSE2 drawers							*/
+/*										*/
+/****************************************/
+
+//
+// R_DrawSpanP_SSE2
+// SSE2 has no gather, so only the texture coordinates are stepped four
+// pixels at a time and the flat and colormap lookups stay scalar.
+//
+SIMD_TARGET("sse2")
+void R_DrawSpanP_SSE2 (void)
+{
+	dsfixed_t			xfrac;
+	dsfixed_t			yfrac;
+	dsfixed_t			xstep;
+	dsfixed_t			ystep;
+	byte*				dest;
+	int 				count;
+
+	if (ds_colsize != 1)
+	{
+		R_DrawSpanP_C ();
+		return;
+	}
+
+	xfrac = ds_xfrac;
+	yfrac = ds_yfrac;
+	xstep = ds_xstep;
+	ystep = ds_ystep;
+
+	dest = ylookup[ds_y] + columnofs[ds_x1];
+	count = ds_x2 - ds_x1 + 1;
+
+	{
+		byte *source = ds_source;
+		byte *colormap = ds_colormap;
+
+		if (count >= 4)
+		{
+			__m128i xf = _mm_setr_epi32 (xfrac, xfrac + xstep, xfrac + xstep*2, xfrac + xstep*3);
+			__m128i yf = _mm_setr_epi32 (yfrac, yfrac + ystep, yfrac + ystep*2, yfrac + ystep*3);
+			const __m128i xstep4 = _mm_set1_epi32 (xstep*4);
+			const __m128i ystep4 = _mm_set1_epi32 (ystep*4);
+			const __m128i ymask = _mm_set1_epi32 (63*64);
+
+			do
+			{
+				__m128i spot = _mm_add_epi32 (
+					_mm_and_si128 (_mm_srli_epi32 (yf, 32-6-6), ymask),
+					_mm_srli_epi32 (xf, 32-6));
+
+				dest[0] = colormap[source[_mm_cvtsi128_si32 (spot)]];
+				dest[1] = colormap[source[_mm_cvtsi128_si32 (_mm_srli_si128 (spot, 4))]];
+				dest[2] = colormap[source[_mm_cvtsi128_si32 (_mm_srli_si128 (spot, 8))]];
+				dest[3] = colormap[source[_mm_cvtsi128_si32 (_mm_srli_si128 (spot, 12))]];
+				dest += 4;
+
+				xf = _mm_add_epi32 (xf, xstep4);
+				yf = _mm_add_epi32 (yf, ystep4);
+			} while ((count -= 4) >= 4);
+
+			xfrac = _mm_cvtsi128_si32 (xf);
+			yfrac = _mm_cvtsi128_si32 (yf);
+		}
+
+		while (count--)
+		{
+			*dest++ = colormap[source[((yfrac>>(32-6-6))&(63*64)) + (xfrac>>(32-6))]];
+			xfrac += xstep;
+			yfrac += ystep;
+		}
+	}
+}
+
+//
+// R_DrawSpanD_SSE2
+//
+SIMD_TARGET("sse2")
+void R_DrawSpanD_SSE2 (void)
+{
+	fixed_t 			xfrac;
+	fixed_t 			yfrac;
+	unsigned int*		dest;
+	int 				count;
+
+	if (ds_colsize != 4)
+	{
+		R_DrawSpanD ();
+		return;
+	}
+
+	xfrac = ds_xfrac;
+	yfrac = ds_yfrac;
+
+	dest = (unsigned int *)(ylookup[ds_y] + columnofs[ds_x1]);
+	count = ds_x2 - ds_x1 + 1;
+
+	{
+		byte *source = ds_source;
+		unsigned int *shademap = (unsigned int *)ds_colormap;
+		int xstep = ds_xstep;
+		int ystep = ds_ystep;
+
+		if (count >= 4)
+		{
+			__m128i xf = _mm_setr_epi32 (xfrac, xfrac + xstep, xfrac + xstep*2, xfrac + xstep*3);
+			__m128i yf = _mm_setr_epi32 (yfrac, yfrac + ystep, yfrac + ystep*2, yfrac + ystep*3);
+			const __m128i xstep4 = _mm_set1_epi32 (xstep*4);
+			const __m128i ystep4 = _mm_set1_epi32 (ystep*4);
+			const __m128i xmask = _mm_set1_epi32 (63);
+			const __m128i ymask = _mm_set1_epi32 (63*64);
+
+			do
+			{
+				__m128i spot = _mm_add_epi32 (
+					_mm_and_si128 (_mm_srai_epi32 (yf, 16-6), ymask),
+					_mm_and_si128 (_mm_srai_epi32 (xf, 16), xmask));
+
+				_mm_storeu_si128 ((__m128i *)dest, _mm_setr_epi32 (
+					shademap[source[_mm_cvtsi128_si32 (spot)]],
+					shademap[source[_mm_cvtsi128_si32 (_mm_srli_si128 (spot, 4))]],
+					shademap[source[_mm_cvtsi128_si32 (_mm_srli_si128 (spot, 8))]],
+					shademap[source[_mm_cvtsi128_si32 (_mm_srli_si128 (spot, 12))]]));
+				dest += 4;
+
+				xf = _mm_add_epi32 (xf, xstep4);
+				yf = _mm_add_epi32 (yf, ystep4);
+			} while ((count -= 4) >= 4);
+
+			xfrac = _mm_cvtsi128_si32 (xf);
+			yfrac = _mm_cvtsi128_si32 (yf);
+		}
+
+		while (count--)
+		{
+			*dest++ = shademap[source[((yfrac>>(16-6))&(63*64)) + ((xfrac>>16)&63)]];
+			xfrac += xstep;
+			yfrac += ystep;
+		}
+	}
+}
+
+//
+// rt_map4cols_SSE2
+// The four pixels of a row are next to each other on the screen, so
+// they go out in one store. There is nothing else to vectorise: SSE2
+// has no gather for the colormap lookups.
+//
+SIMD_TARGET("sse2")
+void rt_map4cols_SSE2 (int sx, int yl, int yh)
+{
+	byte *colormap;
+	byte *source;
+	byte *dest;
+	int count;
+	int pitch;
+
+	count = yh-yl;
+	if (count < 0)
+		return;
+	count++;
+
+	colormap = dc_colormap;
+	dest = ylookup[yl] + columnofs[sx];
+	source = &dc_temp[yl*4];
+	pitch = dc_pitch;
+
+	do {
+		*(unsigned int *)dest = colormap[source[0]] | (colormap[source[1]] << 8)
+			| (colormap[source[2]] << 16) | (colormap[source[3]] << 24);
+		source += 4;
+		dest += pitch;
+	} while (--count);
+}
+
+//
+// Lucent4_SSE2
+// Mixes the four pixels of a row, given their fg2rgb and bg2rgb values,
+// and returns them packed for a single store.
+//
+SIMD_TARGET("sse2")
+static inline unsigned int Lucent4_SSE2 (__m128i fg, __m128i bg)
+{
+	const byte *rgb = &RGB32k[0][0][0];
+	__m128i c = _mm_or_si128 (_mm_add_epi32 (fg, bg), _mm_set1_epi32 (0x1f07c1f));
+
+	c = _mm_and_si128 (c, _mm_srli_epi32 (c, 15));
+
+	return rgb[_mm_cvtsi128_si32 (c)]
+		| (rgb[_mm_cvtsi128_si32 (_mm_srli_si128 (c, 4))] << 8)
+		| (rgb[_mm_cvtsi128_si32 (_mm_srli_si128 (c, 8))] << 16)
+		| (rgb[_mm_cvtsi128_si32 (_mm_srli_si128 (c, 12))] << 24);
+}
+
+//
+// rt_lucent4cols_SSE2
+//
+SIMD_TARGET("sse2")
+void rt_lucent4cols_SSE2 (int sx, int yl, int yh)
+{
+	byte *colormap;
+	byte *source;
+	byte *dest;
+	int count;
+	int pitch;
+	unsigned int *fg2rgb, *bg2rgb;
+
+	count = yh-yl;
+	if (count < 0)
+		return;
+	count++;
+
+	{
+		fixed_t fglevel, bglevel;
+
+		fglevel = dc_translevel & ~0x3ff;
+		bglevel = FRACUNIT-fglevel;
+		fg2rgb = Col2RGB8[fglevel>>10];
+		bg2rgb = Col2RGB8[bglevel>>10];
+	}
+
+	dest = ylookup[yl] + columnofs[sx];
+	source = &dc_temp[yl*4];
+	pitch = dc_pitch;
+	colormap = dc_colormap;
+
+	do {
+		*(unsigned int *)dest = Lucent4_SSE2 (
+			_mm_setr_epi32 (fg2rgb[colormap[source[0]]], fg2rgb[colormap[source[1]]],
+							fg2rgb[colormap[source[2]]], fg2rgb[colormap[source[3]]]),
+			_mm_setr_epi32 (bg2rgb[dest[0]], bg2rgb[dest[1]], bg2rgb[dest[2]], bg2rgb[dest[3]]));
+		source += 4;
+		dest += pitch;
+	} while (--count);
+}
+
+//
+// rt_tlatelucent4cols_SSE2
+//
+SIMD_TARGET("sse2")
+void rt_tlatelucent4cols_SSE2 (int sx, int yl, int yh)
+{
+	byte *translation;
+	byte *colormap;
+	byte *source;
+	byte *dest;
+	int count;
+	int pitch;
+	unsigned int *fg2rgb, *bg2rgb;
+
+	count = yh-yl;
+	if (count < 0)
+		return;
+	count++;
+
+	{
+		fixed_t fglevel, bglevel;
+
+		fglevel = dc_translevel & ~0x3ff;
+		bglevel = FRACUNIT-fglevel;
+		fg2rgb = Col2RGB8[fglevel>>10];
+		bg2rgb = Col2RGB8[bglevel>>10];
+	}
+
+	translation = dc_translation;
+	colormap = dc_colormap;
+	dest = ylookup[yl] + columnofs[sx];
+	source = &dc_temp[yl*4];
+	pitch = dc_pitch;
+
+	do {
+		*(unsigned int *)dest = Lucent4_SSE2 (
+			_mm_setr_epi32 (fg2rgb[colormap[translation[source[0]]]], fg2rgb[colormap[translation[source[1]]]],
+							fg2rgb[colormap[translation[source[2]]]], fg2rgb[colormap[translation[source[3]]]]),
+			_mm_setr_epi32 (bg2rgb[dest[0]], bg2rgb[dest[1]], bg2rgb[dest[2]], bg2rgb[dest[3]]));
+		source += 4;
+		dest += pitch;
+	} while (--count);
+}
+
+/****************************************/
+/*										*/
+/* AVX2 drawers							*/
+/*										*/
+/****************************************/
+
+//
+// GatherBytes
+// Looks up table[idx] for eight indices with a single dword gather. Each
+// lane loads the dword that ends at the wanted byte, so nothing past the
+// end of a table is touched. The up to three bytes read before the start
+// of a table are part of the same allocation or its header, or for
+// RGB32k, of the data segment around it.
+//
+SIMD_TARGET("avx2")
+static inline __m256i GatherBytes (const byte *table, __m256i idx)
+{
+	return _mm256_srli_epi32 (_mm256_i32gather_epi32 ((const int *)(table - 3), idx, 1), 24);
+}
+
+//
+// PackBytes
+// Narrows eight dwords holding byte values to eight bytes in the low
+// quadword of the result.
+//
+SIMD_TARGET("avx2")
+static inline __m128i PackBytes (__m256i v)
+{
+	const __m256i shuf = _mm256_setr_epi8 (
+		0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+
+	v = _mm256_shuffle_epi8 (v, shuf);
+	return _mm_unpacklo_epi32 (_mm256_castsi256_si128 (v), _mm256_extracti128_si256 (v, 1));
+}
+
+//
+// R_DrawSpanP_AVX2
+//
+SIMD_TARGET("avx2")
+void R_DrawSpanP_AVX2 (void)
+{
+	dsfixed_t			xfrac;
+	dsfixed_t			yfrac;
+	dsfixed_t			xstep;
+	dsfixed_t			ystep;
+	byte*				dest;
+	int 				count;
+
+	if (ds_colsize != 1)
+	{
+		R_DrawSpanP_C ();
+		return;
+	}
+
+	xfrac = ds_xfrac;
+	yfrac = ds_yfrac;
+	xstep = ds_xstep;
+	ystep = ds_ystep;
+
+	dest = ylookup[ds_y] + columnofs[ds_x1];
+	count = ds_x2 - ds_x1 + 1;
+
+	{
+		byte *source = ds_source;
+		byte *colormap = ds_colormap;
+
+		if (count >= 8)
+		{
+			const __m256i lanes = _mm256_setr_epi32 (0, 1, 2, 3, 4, 5, 6, 7);
+			const __m256i ymask = _mm256_set1_epi32 (63*64);
+			const __m256i xstep8 = _mm256_set1_epi32 (xstep*8);
+			const __m256i ystep8 = _mm256_set1_epi32 (ystep*8);
+			__m256i xf = _mm256_add_epi32 (_mm256_set1_epi32 (xfrac),
+				_mm256_mullo_epi32 (_mm256_set1_epi32 (xstep), lanes));
+			__m256i yf = _mm256_add_epi32 (_mm256_set1_epi32 (yfrac),
+				_mm256_mullo_epi32 (_mm256_set1_epi32 (ystep), lanes));
+
+			do
+			{
+				__m256i spot = _mm256_add_epi32 (
+					_mm256_and_si256 (_mm256_srli_epi32 (yf, 32-6-6), ymask),
+					_mm256_srli_epi32 (xf, 32-6));
+
+				_mm_storel_epi64 ((__m128i *)dest, PackBytes (GatherBytes (colormap, GatherBytes (source, spot))));
+				dest += 8;
+
+				xf = _mm256_add_epi32 (xf, xstep8);
+				yf = _mm256_add_epi32 (yf, ystep8);
+			} while ((count -= 8) >= 8);
+
+			xfrac = _mm256_cvtsi256_si32 (xf);
+			yfrac = _mm256_cvtsi256_si32 (yf);
+		}
+
+		while (count--)
+		{
+			*dest++ = colormap[source[((yfrac>>(32-6-6))&(63*64)) + (xfrac>>(32-6))]];
+			xfrac += xstep;
+			yfrac += ystep;
+		}
+	}
+}
+
+//
+// R_DrawSpanD_AVX2
+//
+SIMD_TARGET("avx2")
+void R_DrawSpanD_AVX2 (void)
+{
+	fixed_t 			xfrac;
+	fixed_t 			yfrac;
+	unsigned int*		dest;
+	int 				count;
+
+	if (ds_colsize != 4)
+	{
+		R_DrawSpanD ();
+		return;
+	}
+
+	xfrac = ds_xfrac;
+	yfrac = ds_yfrac;
+
+	dest = (unsigned int *)(ylookup[ds_y] + columnofs[ds_x1]);
+	count = ds_x2 - ds_x1 + 1;
+
+	{
+		byte *source = ds_source;
+		unsigned int *shademap = (unsigned int *)ds_colormap;
+		int xstep = ds_xstep;
+		int ystep = ds_ystep;
+
+		if (count >= 8)
+		{
+			const __m256i lanes = _mm256_setr_epi32 (0, 1, 2, 3, 4, 5, 6, 7);
+			const __m256i xmask = _mm256_set1_epi32 (63);
+			const __m256i ymask = _mm256_set1_epi32 (63*64);
+			const __m256i xstep8 = _mm256_set1_epi32 (xstep*8);
+			const __m256i ystep8 = _mm256_set1_epi32 (ystep*8);
+			__m256i xf = _mm256_add_epi32 (_mm256_set1_epi32 (xfrac),
+				_mm256_mullo_epi32 (_mm256_set1_epi32 (xstep), lanes));
+			__m256i yf = _mm256_add_epi32 (_mm256_set1_epi32 (yfrac),
+				_mm256_mullo_epi32 (_mm256_set1_epi32 (ystep), lanes));
+
+			do
+			{
+				__m256i spot = _mm256_add_epi32 (
+					_mm256_and_si256 (_mm256_srai_epi32 (yf, 16-6), ymask),
+					_mm256_and_si256 (_mm256_srai_epi32 (xf, 16), xmask));
+
+				_mm256_storeu_si256 ((__m256i *)dest,
+					_mm256_i32gather_epi32 ((const int *)shademap, GatherBytes (source, spot), 4));
+				dest += 8;
+
+				xf = _mm256_add_epi32 (xf, xstep8);
+				yf = _mm256_add_epi32 (yf, ystep8);
+			} while ((count -= 8) >= 8);
+
+			xfrac = _mm256_cvtsi256_si32 (xf);
+			yfrac = _mm256_cvtsi256_si32 (yf);
+		}
+
+		while (count--)
+		{
+			*dest++ = shademap[source[((yfrac>>(16-6))&(63*64)) + ((xfrac>>16)&63)]];
+			xfrac += xstep;
+			yfrac += ystep;
+		}
+	}
+}
+
+//
+// LoadRows
+// Widens the four pixels at p and the four at p+pitch to eight dwords.
+//
+SIMD_TARGET("avx2")
+static inline __m256i LoadRows (const byte *p, int pitch)
+{
+	return _mm256_cvtepu8_epi32 (_mm_unpacklo_epi32 (
+		_mm_cvtsi32_si128 (*(const int *)p), _mm_cvtsi32_si128 (*(const int *)(p + pitch))));
+}
+
+//
+// StoreRows
+// Stores eight dwords holding byte values as four pixels at p and four
+// at p+pitch.
+//
+SIMD_TARGET("avx2")
+static inline void StoreRows (byte *p, int pitch, __m256i v)
+{
+	__m128i b = PackBytes (v);
+
+	*(int *)(p + pitch) = _mm_cvtsi128_si32 (_mm_srli_si128 (b, 4));
+	*(int *)p = _mm_cvtsi128_si32 (b);
+}
+
+//
+// Lucent8_AVX2
+// Mixes eight pixels, given their fg2rgb values and the screen pixels
+// under them.
+//
+SIMD_TARGET("avx2")
+static inline __m256i Lucent8_AVX2 (__m256i fg, __m256i bg, const unsigned int *bg2rgb)
+{
+	__m256i c = _mm256_add_epi32 (fg, _mm256_i32gather_epi32 ((const int *)bg2rgb, bg, 4));
+
+	c = _mm256_or_si256 (c, _mm256_set1_epi32 (0x1f07c1f));
+	return GatherBytes (&RGB32k[0][0][0], _mm256_and_si256 (c, _mm256_srli_epi32 (c, 15)));
+}
+
+//
+// rt_map4cols_AVX2
+// Two rows are drawn at a time. A last odd row is drawn as a pair with
+// itself.
+//
+SIMD_TARGET("avx2")
+void rt_map4cols_AVX2 (int sx, int yl, int yh)
+{
+	byte *colormap;
+	byte *source;
+	byte *dest;
+	int count;
+	int pitch;
+
+	count = yh-yl;
+	if (count < 0)
+		return;
+	count++;
+
+	colormap = dc_colormap;
+	dest = ylookup[yl] + columnofs[sx];
+	source = &dc_temp[yl*4];
+	pitch = dc_pitch;
+
+	do {
+		int next = count > 1 ? pitch : 0;
+
+		StoreRows (dest, next, GatherBytes (colormap, LoadRows (source, count > 1 ? 4 : 0)));
+		source += 8;
+		dest += pitch*2;
+	} while ((count -= 2) > 0);
+}
+
+//
+// rt_lucent4cols_AVX2
+//
+SIMD_TARGET("avx2")
+void rt_lucent4cols_AVX2 (int sx, int yl, int yh)
+{
+	byte *colormap;
+	byte *source;
+	byte *dest;
+	int count;
+	int pitch;
+	unsigned int *fg2rgb, *bg2rgb;
+
+	count = yh-yl;
+	if (count < 0)
+		return;
+	count++;
+
+	{
+		fixed_t fglevel, bglevel;
+
+		fglevel = dc_translevel & ~0x3ff;
+		bglevel = FRACUNIT-fglevel;
+		fg2rgb = Col2RGB8[fglevel>>10];
+		bg2rgb = Col2RGB8[bglevel>>10];
+	}
+
+	dest = ylookup[yl] + columnofs[sx];
+	source = &dc_temp[yl*4];
+	pitch = dc_pitch;
+	colormap = dc_colormap;
+
+	do {
+		int next = count > 1 ? pitch : 0;
+		__m256i fg = _mm256_i32gather_epi32 ((const int *)fg2rgb,
+			GatherBytes (colormap, LoadRows (source, count > 1 ? 4 : 0)), 4);
+
+		StoreRows (dest, next, Lucent8_AVX2 (fg, LoadRows (dest, next), bg2rgb));
+		source += 8;
+		dest += pitch*2;
+	} while ((count -= 2) > 0);
+}
+
+//
+// rt_tlatelucent4cols_AVX2
+//
+SIMD_TARGET("avx2")
+void rt_tlatelucent4cols_AVX2 (int sx, int yl, int yh)
+{
+	byte *translation;
+	byte *colormap;
+	byte *source;
+	byte *dest;
+	int count;
+	int pitch;
+	unsigned int *fg2rgb, *bg2rgb;
+
+	count = yh-yl;
+	if (count < 0)
+		return;
+	count++;
+
+	{
+		fixed_t fglevel, bglevel;
+
+		fglevel = dc_translevel & ~0x3ff;
+		bglevel = FRACUNIT-fglevel;
+		fg2rgb = Col2RGB8[fglevel>>10];
+		bg2rgb = Col2RGB8[bglevel>>10];
+	}
+
+	translation = dc_translation;
+	colormap = dc_colormap;
+	dest = ylookup[yl] + columnofs[sx];
+	source = &dc_temp[yl*4];
+	pitch = dc_pitch;
+
+	do {
+		int next = count > 1 ? pitch : 0;
+		__m256i fg = _mm256_i32gather_epi32 ((const int *)fg2rgb,
+			GatherBytes (colormap, GatherBytes (translation, LoadRows (source, count > 1 ? 4 : 0))), 4);
+
+		StoreRows (dest, next, Lucent8_AVX2 (fg, LoadRows (dest, next), bg2rgb));
+		source += 8;
+		dest += pitch*2;
+	} while ((count -= 2) > 0);
+}
+
+//
+// R_TestRandom
+// Kept apart from M_Random so drawertest does not disturb demos.
+//
+static unsigned int R_TestRandom (void)
+{
+	static unsigned int seed = 0x1d872b41;
+
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+//
+// R_CompareSpans
+// Draws the same random spans with the C drawer and with drawer and
+// returns how many of them came out different.
+//
+static int R_CompareSpans (void (*cdrawer)(void), void (*drawer)(void), int pixelsize)
+{
+	// GatherBytes reads up to three bytes before the flat and colormap
+	static byte flat[4 + 64*64];
+	static unsigned int shades[1 + 256];
+	static byte cdest[320*4], dest[320*4];
+
+	byte **oldylookup = ylookup;
+	int *oldcolumnofs = columnofs;
+	int oldcolsize = ds_colsize;
+	byte *line;
+	int offset = 0;
+	int width = screen->width < 320 ? screen->width : 320;
+	int bad = 0;
+	int i;
+
+	for (i = 0; i < (int)sizeof(flat); i++)
+		flat[i] = R_TestRandom ();
+	for (i = 0; i < 1 + 256; i++)
+		shades[i] = R_TestRandom ();
+
+	ylookup = &line;
+	columnofs = &offset;
+	ds_colsize = pixelsize;
+	ds_source = flat + 4;
+	ds_colormap = (lighttable_t *)(shades + 1);
+	ds_y = 0;
+	ds_x1 = 0;
+
+	for (i = 0; i < 1000; i++)
+	{
+		ds_x2 = R_TestRandom () % width;
+		ds_xfrac = R_TestRandom ();
+		ds_yfrac = R_TestRandom ();
+		ds_xstep = (int)R_TestRandom () >> (R_TestRandom () % 24);
+		ds_ystep = (int)R_TestRandom () >> (R_TestRandom () % 24);
+
+		memset (cdest, 0, sizeof(cdest));
+		memset (dest, 0, sizeof(dest));
+
+		line = cdest;
+		cdrawer ();
+		line = dest;
+		drawer ();
+
+		if (memcmp (cdest, dest, sizeof(dest)))
+			bad++;
+	}
+
+	ylookup = oldylookup;
+	columnofs = oldcolumnofs;
+	ds_colsize = oldcolsize;
+
+	return bad;
+}
+
+//
+// R_Compare4Cols
+// Draws the same random rows of four columns over the same random screen
+// with the C drawer and with drawer, and returns how many of them came
+// out different.
+//
+static int R_Compare4Cols (void (*cdrawer)(int, int, int), void (*drawer)(int, int, int))
+{
+	// GatherBytes reads up to three bytes before the colormap and translation
+	static byte tables[4 + 256*2];
+	static byte background[320*200], cscreen[320*200], testscreen[320*200];
+	static byte *rows[200];
+	static int cols[320];
+
+	byte **oldylookup = ylookup;
+	int *oldcolumnofs = columnofs;
+	int oldpitch = dc_pitch;
+	lighttable_t *oldcolormap = dc_colormap;
+	byte *oldtranslation = dc_translation;
+	fixed_t oldtranslevel = dc_translevel;
+	int bad = 0;
+	int i, y;
+
+	for (i = 0; i < (int)sizeof(tables); i++)
+		tables[i] = R_TestRandom ();
+	for (i = 0; i < (int)sizeof(background); i++)
+		background[i] = R_TestRandom ();
+	for (i = 0; i < 320; i++)
+		cols[i] = i;
+
+	ylookup = rows;
+	columnofs = cols;
+	dc_pitch = 320;
+	dc_colormap = tables + 4;
+	dc_translation = tables + 4 + 256;
+
+	for (i = 0; i < 1000; i++)
+	{
+		int sx = R_TestRandom () % (320 - 3);
+		int yl = R_TestRandom () % 200;
+		int yh = R_TestRandom () % 200;
+
+		dc_translevel = R_TestRandom () % (FRACUNIT + 1);
+		for (y = 0; y < 200*4; y++)
+			dc_temp[y] = R_TestRandom ();
+
+		memcpy (cscreen, background, sizeof(background));
+		for (y = 0; y < 200; y++)
+			rows[y] = cscreen + y*320;
+		cdrawer (sx, yl, yh);
+
+		memcpy (testscreen, background, sizeof(background));
+		for (y = 0; y < 200; y++)
+			rows[y] = testscreen + y*320;
+		drawer (sx, yl, yh);
+
+		if (memcmp (cscreen, testscreen, sizeof(testscreen)))
+			bad++;
+	}
+
+	ylookup = oldylookup;
+	columnofs = oldcolumnofs;
+	dc_pitch = oldpitch;
+	dc_colormap = oldcolormap;
+	dc_translation = oldtranslation;
+	dc_translevel = oldtranslevel;
+
+	return bad;
+}
+
+//
+// drawertest
+// Compares the SIMD drawers the CPU can run with the C ones.
+//
+BEGIN_COMMAND (drawertest)
+{
+	int level = R_DetectSIMD ();
+	int bad = 0;
+
+	if (level >= SIMD_SSE2)
+	{
+		bad += R_CompareSpans (R_DrawSpanP_C, R_DrawSpanP_SSE2, 1);
+		bad += R_CompareSpans (R_DrawSpanD, R_DrawSpanD_SSE2, 4);
+		bad += R_Compare4Cols (rt_map4cols_c, rt_map4cols_SSE2);
+		bad += R_Compare4Cols (rt_lucent4cols_c, rt_lucent4cols_SSE2);
+		bad += R_Compare4Cols (rt_tlatelucent4cols_c, rt_tlatelucent4cols_SSE2);
+	}
+	if (level >= SIMD_AVX2)
+	{
+		bad += R_CompareSpans (R_DrawSpanP_C, R_DrawSpanP_AVX2, 1);
+		bad += R_CompareSpans (R_DrawSpanD, R_DrawSpanD_AVX2, 4);
+		bad += R_Compare4Cols (rt_map4cols_c, rt_map4cols_AVX2);
+		bad += R_Compare4Cols (rt_lucent4cols_c, rt_lucent4cols_AVX2);
+		bad += R_Compare4Cols (rt_tlatelucent4cols_c, rt_tlatelucent4cols_AVX2);
+	}
+
+	if (bad)
+		Printf (PRINT_HIGH, "drawertest: %d %s drawer runs differ from the C drawers\n", bad, simdnames[level]);
+	else
+		Printf (PRINT_HIGH, "drawertest: %s drawers match the C drawers\n", simdnames[level]);
+}
+END_COMMAND (drawertest)
+
+//
+// R_InitSIMDDrawers
+// Replaces the C drawers set up by R_InitColumnDrawers with the widest
+// versions the CPU can run. -nosimd keeps the C drawers, and the
+// rt_*4cols ones are only replaced with -simdcols.
+//
+void R_InitSIMDDrawers (BOOL is8bit)
+{
+	static int level = -1;
+
+	if (level < 0)
+	{
+		level = Args.CheckParm ("-nosimd") ? SIMD_NONE : R_DetectSIMD ();
+		Printf (PRINT_HIGH, "R_InitSIMDDrawers: Using %s drawers\n", simdnames[level]);
+	}
+
+	if (level == SIMD_NONE)
+		return;
+
+	if (is8bit)
+	{
+		R_DrawSpan = level >= SIMD_AVX2 ? R_DrawSpanP_AVX2 : R_DrawSpanP_SSE2;
+
+		if (Args.CheckParm ("-simdcols"))
+		{
+			rt_map4cols = level >= SIMD_AVX2 ? rt_map4cols_AVX2 : rt_map4cols_SSE2;
+			rt_lucent4cols = level >= SIMD_AVX2 ? rt_lucent4cols_AVX2 : rt_lucent4cols_SSE2;
+			rt_tlatelucent4cols = level >= SIMD_AVX2 ? rt_tlatelucent4cols_AVX2 : rt_tlatelucent4cols_SSE2;
+		}
+	}
+	else
+		R_DrawSpan = level >= SIMD_AVX2 ? R_DrawSpanD_AVX2 : R_DrawSpanD_SSE2;
+}
+
+#endif	// R_SIMDDRAWERS
+
+VERSION_CONTROL (r_drawsimd_cpp, "$Id$")
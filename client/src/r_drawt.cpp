@@ -35,9 +35,10 @@
 #include "r_draw.h"
 #include "r_main.h"
 #include "r_things.h"
+#include "r_thread.h"
 #include "v_video.h"
 
-byte dc_temp[1536*4]; // denis - todo - security, overflow
+R_THREADLOCAL byte dc_temp[1536*4]; // denis - todo - security, overflow
 unsigned int dc_tspans[4][256];
 unsigned int *dc_ctspan[4];
 unsigned int *horizspan[4];
@@ -448,7 +449,7 @@ void rt_lucent2cols (int hx, int sx, int yl, int yh)
 }
 
 // Mixes all four spans to the screen starting at sx.
-void rt_lucent4cols (int sx, int yl, int yh)
+void rt_lucent4cols_c (int sx, int yl, int yh)
 {
 	byte *colormap;
 	byte *source;
@@ -607,7 +608,7 @@ void rt_tlatelucent2cols (int hx, int sx, int yl, int yh)
 }
 
 // Translates and mixes all four spans to the screen starting at sx.
-void rt_tlatelucent4cols (int sx, int yl, int yh)
+void rt_tlatelucent4cols_c (int sx, int yl, int yh)
 {
 	byte *translation;
 	byte *colormap;
@@ -672,11 +673,37 @@ void rt_tlatelucent4cols (int sx, int yl, int yh)
 	} while (--count);
 }
 
+// Copies finished spans to the screen, or queues them when the view is
+// being drawn by the render threads.
+static inline void rt_post1 (int hx, int sx, int yl, int yh)
+{
+	if (r_drawqueue)
+		R_QueueHorizColumns (hcolfunc_post1, hx, sx, yl, yh);
+	else
+		hcolfunc_post1 (hx, sx, yl, yh);
+}
+
+static inline void rt_post2 (int hx, int sx, int yl, int yh)
+{
+	if (r_drawqueue)
+		R_QueueHorizColumns (hcolfunc_post2, hx, sx, yl, yh);
+	else
+		hcolfunc_post2 (hx, sx, yl, yh);
+}
+
+static inline void rt_post4 (int sx, int yl, int yh)
+{
+	if (r_drawqueue)
+		R_QueueHorizColumns4 (hcolfunc_post4, sx, yl, yh);
+	else
+		hcolfunc_post4 (sx, yl, yh);
+}
+
 // Draws all spans at hx to the screen at sx.
 void rt_draw1col (int hx, int sx)
 {
 	while (horizspan[hx] < dc_ctspan[hx]) {
-		hcolfunc_post1 (hx, sx, horizspan[hx][0], horizspan[hx][1]);
+		rt_post1 (hx, sx, horizspan[hx][0], horizspan[hx][1]);
 		horizspan[hx] += 2;
 	}
 }
@@ -690,7 +717,7 @@ spaghetti1:
 		// first column starts before the second; it might also end before it
 		if (horizspan[hx][1] < horizspan[hx+1][0]){
 			while (horizspan[hx] < dc_ctspan[hx] && horizspan[hx][1] < horizspan[hx+1][0]) {
-				hcolfunc_post1 (hx, sx, horizspan[hx][0], horizspan[hx][1]);
+				rt_post1 (hx, sx, horizspan[hx][0], horizspan[hx][1]);
 				horizspan[hx] += 2;
 			}
 			if (horizspan[hx] >= dc_ctspan[hx]) {
@@ -703,7 +730,7 @@ spaghetti1:
 			else if (horizspan[hx][0] == horizspan[hx+1][0])
 				return false;
 		}
-		hcolfunc_post1 (hx, sx, horizspan[hx][0], horizspan[hx+1][0] - 1);
+		rt_post1 (hx, sx, horizspan[hx][0], horizspan[hx+1][0] - 1);
 		horizspan[hx][0] = horizspan[hx+1][0];
 	}
 	if (horizspan[hx][0] > horizspan[hx+1][0]) {
@@ -711,7 +738,7 @@ spaghetti2:
 		// second column starts before the first; it might also end before it
 		if (horizspan[hx+1][1] < horizspan[hx][0]) {
 			while (horizspan[hx+1] < dc_ctspan[hx+1] && horizspan[hx+1][1] < horizspan[hx][0]) {
-				hcolfunc_post1 (hx+1, sx+1, horizspan[hx+1][0], horizspan[hx+1][1]);
+				rt_post1 (hx+1, sx+1, horizspan[hx+1][0], horizspan[hx+1][1]);
 				horizspan[hx+1] += 2;
 			}
 			if (horizspan[hx+1] >= dc_ctspan[hx+1]) {
@@ -724,7 +751,7 @@ spaghetti2:
 			else if (horizspan[hx][0] == horizspan[hx+1][0])
 				return false;
 		}
-		hcolfunc_post1 (hx+1, sx+1, horizspan[hx+1][0], horizspan[hx][0] - 1);
+		rt_post1 (hx+1, sx+1, horizspan[hx+1][0], horizspan[hx][0] - 1);
 		horizspan[hx+1][0] = horizspan[hx][0];
 	}
 	return false;
@@ -754,12 +781,12 @@ void rt_draw2cols (int hx, int sx)
         // now draw as much as possible as a series of words
         if (horizspan[hx][1] < horizspan[hx+1][1]) {
             // first column ends first, so draw down to its bottom
-            hcolfunc_post2 (hx, sx, horizspan[hx][0], horizspan[hx][1]);
+            rt_post2 (hx, sx, horizspan[hx][0], horizspan[hx][1]);
             horizspan[hx+1][0] = horizspan[hx][1] + 1;
             horizspan[hx] += 2;
         } else {
             // second column ends first, or they end at the same spot
-            hcolfunc_post2 (hx, sx, horizspan[hx+1][0], horizspan[hx+1][1]);
+            rt_post2 (hx, sx, horizspan[hx+1][0], horizspan[hx+1][1]);
             if (horizspan[hx][1] == horizspan[hx+1][1]) {
                 horizspan[hx] += 2;
                 horizspan[hx+1] += 2;
@@ -823,11 +850,11 @@ loop:
 			// first half starts before second half
 			if (bot1 >= horizspan[2][0]) {
 				// first half ends after second begins
-				hcolfunc_post2 (0, sx, horizspan[0][0], horizspan[2][0] - 1);
+				rt_post2 (0, sx, horizspan[0][0], horizspan[2][0] - 1);
 				horizspan[0][0] = horizspan[1][0] = horizspan[2][0];
 			} else {
 				// first half ends before second begins
-				hcolfunc_post2 (0, sx, horizspan[0][0], bot1);
+				rt_post2 (0, sx, horizspan[0][0], bot1);
 				if (horizspan[0][1] == bot1)
 					horizspan[0] += 2;
 				else
@@ -842,11 +869,11 @@ loop:
 			// second half starts before the first
 			if (bot2 >= horizspan[0][0]) {
 				// second half ends after first begins
-				hcolfunc_post2 (2, sx+2, horizspan[2][0], horizspan[0][0] - 1);
+				rt_post2 (2, sx+2, horizspan[2][0], horizspan[0][0] - 1);
 				horizspan[2][0] = horizspan[3][0] = horizspan[0][0];
 			} else {
 				// second half ends before first begins
-				hcolfunc_post2 (2, sx+2, horizspan[2][0], bot2);
+				rt_post2 (2, sx+2, horizspan[2][0], bot2);
 				if (horizspan[2][1] == bot2)
 					horizspan[2] += 2;
 				else
@@ -863,7 +890,7 @@ loop:
 		// until one ends.
 		bot1 = bot1 < bot2 ? bot1 : bot2;
 
-		hcolfunc_post4 (sx, horizspan[0][0], bot1);
+		rt_post4 (sx, horizspan[0][0], bot1);
 
 		{
 			int x;
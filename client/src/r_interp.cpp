@@ -0,0 +1,309 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id$
+//
+// Copyright (C) 2006-2012 by The Odamex Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Drawing frames between game tics. Actors, moving sector planes and
+//	the view are drawn between where they were at the start and at the
+//	end of the last tic.
+//
+//	Before each tic the positions of actors and the heights of sector
+//	planes are saved. While the player view is drawn they are moved to
+//	their in-between positions and afterwards put back, so the game
+//	itself never sees anything but the positions of the last tic.
+//
+//-----------------------------------------------------------------------------
+
+#include <vector>
+
+#include "doomtype.h"
+#include "doomstat.h"
+#include "c_cvars.h"
+#include "d_player.h"
+#include "g_game.h"
+#include "m_fixed.h"
+#include "tables.h"
+#include "p_local.h"
+#include "r_local.h"
+#include "r_state.h"
+#include "cl_demo.h"
+#include "cl_timedemo.h"
+#include "r_interp.h"
+
+EXTERN_CVAR (r_interpolate)
+EXTERN_CVAR (sv_freelook)
+
+extern bool step_mode;
+extern BOOL timingdemo;
+extern bool d_livewiping;
+extern NetDemo netdemo;
+
+void G_PendingMouseLook (int &yaw, int &look);
+
+// Anything that moved further than this in one tic was teleported
+#define INTERP_MAXMOVE		(128*FRACUNIT)
+
+typedef struct
+{
+	fixed_t		floorheight, ceilingheight;
+	fixed_t		floord, ceilingd;
+} secinterp_t;
+
+typedef struct
+{
+	AActor		*mo;
+	fixed_t		x, y, z;
+	angle_t		angle;
+	fixed_t		pitch;
+} actorinterp_t;
+
+static int		interptic = -1;		// gametic the saved positions are from
+
+static sector_t	*interpsectors;		// level the saved heights are for
+static std::vector<secinterp_t> prevsectors;
+
+static player_t	*interpviewplayer;
+static fixed_t	prevviewz;
+
+// What R_BeginInterpolation changed, to be put back
+static std::vector<actorinterp_t> savedactors;
+static std::vector<int> savedsectors;
+static std::vector<secinterp_t> savedheights;
+static player_t	*savedviewplayer;
+static fixed_t	savedviewz;
+
+//
+// R_DrawBetweenTics
+// True if frames should be drawn without waiting for the next tic.
+// Timedemos and stepping through tics draw exactly one frame per tic.
+//
+bool R_DrawBetweenTics (void)
+{
+	return r_interpolate && gamestate == GS_LEVEL && !d_livewiping
+		&& !td_profiling && !timingdemo && !step_mode;
+}
+
+//
+// R_InterpolationTic
+// Saves where everything is before a tic is run.
+//
+void R_InterpolationTic (void)
+{
+	if (gamestate != GS_LEVEL)
+	{
+		interptic = -1;
+		return;
+	}
+
+	interptic = gametic;
+
+	AActor *mo;
+	TThinkerIterator<AActor> iterator;
+
+	while ( (mo = iterator.Next ()) )
+	{
+		mo->prevx = mo->x;
+		mo->prevy = mo->y;
+		mo->prevz = mo->z;
+		mo->prevangle = mo->angle;
+		mo->prevtic = interptic;
+	}
+
+	if (interpsectors != sectors || prevsectors.size () != (size_t)numsectors)
+	{
+		interpsectors = sectors;
+		prevsectors.resize (numsectors);
+	}
+
+	for (int i = 0; i < numsectors; i++)
+	{
+		prevsectors[i].floorheight = sectors[i].floorheight;
+		prevsectors[i].ceilingheight = sectors[i].ceilingheight;
+		prevsectors[i].floord = sectors[i].floorplane.d;
+		prevsectors[i].ceilingd = sectors[i].ceilingplane.d;
+	}
+
+	interpviewplayer = NULL;
+
+	if (consoleplayer().camera && consoleplayer().camera->player)
+	{
+		interpviewplayer = consoleplayer().camera->player;
+		prevviewz = interpviewplayer->viewz;
+	}
+}
+
+//
+// R_Lerp
+//
+static inline fixed_t R_Lerp (fixed_t from, fixed_t to, fixed_t frac)
+{
+	return from + FixedMul (to - from, frac);
+}
+
+//
+// R_BeginInterpolation
+// Moves everything to where it was frac of the way through the last tic.
+//
+void R_BeginInterpolation (fixed_t frac)
+{
+	int i;
+
+	if (interptic < 0 || interpsectors != sectors)
+		return;
+
+	AActor *mo;
+	TThinkerIterator<AActor> iterator;
+
+	// The local player's view turns with the mouse instead, as the angle
+	// at the end of the tic already has the last tic's turn in it
+	AActor *viewmo = consoleplayer().mo;
+
+	if (viewmo != consoleplayer().camera || paused || demoplayback || netdemo.isPlaying())
+		viewmo = NULL;
+
+	while ( (mo = iterator.Next ()) )
+	{
+		if (mo->prevtic != interptic)
+			continue;	// spawned during the tic
+
+		if (mo->x == mo->prevx && mo->y == mo->prevy && mo->z == mo->prevz
+			&& mo->angle == mo->prevangle)
+			continue;
+
+		if (abs (mo->x - mo->prevx) > INTERP_MAXMOVE
+			|| abs (mo->y - mo->prevy) > INTERP_MAXMOVE
+			|| abs (mo->z - mo->prevz) > INTERP_MAXMOVE)
+			continue;	// teleported
+
+		actorinterp_t saved = { mo, mo->x, mo->y, mo->z, mo->angle, mo->pitch };
+		savedactors.push_back (saved);
+
+		mo->x = R_Lerp (mo->prevx, mo->x, frac);
+		mo->y = R_Lerp (mo->prevy, mo->y, frac);
+		mo->z = R_Lerp (mo->prevz, mo->z, frac);
+		if (mo != viewmo)
+			mo->angle = mo->prevangle + (angle_t)FixedMul ((int)(mo->angle - mo->prevangle), frac);
+	}
+
+	for (i = 0; i < numsectors; i++)
+	{
+		sector_t *sec = sectors + i;
+		secinterp_t &prev = prevsectors[i];
+
+		if (sec->floorplane.d == prev.floord && sec->ceilingplane.d == prev.ceilingd)
+			continue;
+
+		secinterp_t saved = { sec->floorheight, sec->ceilingheight,
+							  sec->floorplane.d, sec->ceilingplane.d };
+		savedsectors.push_back (i);
+		savedheights.push_back (saved);
+
+		sec->floorheight = R_Lerp (prev.floorheight, sec->floorheight, frac);
+		sec->ceilingheight = R_Lerp (prev.ceilingheight, sec->ceilingheight, frac);
+		sec->floorplane.d = R_Lerp (prev.floord, sec->floorplane.d, frac);
+		sec->ceilingplane.d = R_Lerp (prev.ceilingd, sec->ceilingplane.d, frac);
+	}
+
+	player_t *player = consoleplayer().camera ? consoleplayer().camera->player : NULL;
+
+	if (player && player == interpviewplayer && abs (player->viewz - prevviewz) <= INTERP_MAXMOVE)
+	{
+		savedviewplayer = player;
+		savedviewz = player->viewz;
+		player->viewz = R_Lerp (prevviewz, player->viewz, frac);
+	}
+
+	// Turn the view with mouse movement the next tic will carry
+	mo = viewmo;
+
+	if (mo)
+	{
+		int yaw, look;
+
+		G_PendingMouseLook (yaw, look);
+
+		if (yaw || look)
+		{
+			// The actor may not have moved, so it might not be saved yet
+			if (savedactors.empty () || savedactors.back ().mo != mo)
+			{
+				for (i = savedactors.size () - 1; i >= 0; i--)
+					if (savedactors[i].mo == mo)
+						break;
+
+				if (i < 0)
+				{
+					actorinterp_t saved = { mo, mo->x, mo->y, mo->z, mo->angle, mo->pitch };
+					savedactors.push_back (saved);
+				}
+			}
+
+			mo->angle += yaw << 16;
+
+			if (sv_freelook && look)
+			{
+				mo->pitch -= look << 16;
+
+				if (mo->pitch < -ANG(32))
+					mo->pitch = -ANG(32);
+				else if (mo->pitch > ANG(56))
+					mo->pitch = ANG(56);
+			}
+		}
+	}
+}
+
+//
+// R_EndInterpolation
+// Puts everything back where the game left it.
+//
+void R_EndInterpolation (void)
+{
+	size_t i;
+
+	for (i = 0; i < savedactors.size (); i++)
+	{
+		AActor *mo = savedactors[i].mo;
+
+		mo->x = savedactors[i].x;
+		mo->y = savedactors[i].y;
+		mo->z = savedactors[i].z;
+		mo->angle = savedactors[i].angle;
+		mo->pitch = savedactors[i].pitch;
+	}
+
+	for (i = 0; i < savedsectors.size (); i++)
+	{
+		sector_t *sec = sectors + savedsectors[i];
+
+		sec->floorheight = savedheights[i].floorheight;
+		sec->ceilingheight = savedheights[i].ceilingheight;
+		sec->floorplane.d = savedheights[i].floord;
+		sec->ceilingplane.d = savedheights[i].ceilingd;
+	}
+
+	if (savedviewplayer)
+	{
+		savedviewplayer->viewz = savedviewz;
+		savedviewplayer = NULL;
+	}
+
+	savedactors.clear ();
+	savedsectors.clear ();
+	savedheights.clear ();
+}
+
+VERSION_CONTROL (r_interp_cpp, "$Id$")
@@ -0,0 +1,35 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id$
+//
+// Copyright (C) 2006-2012 by The Odamex Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Drawing frames between game tics. Actors, moving sector planes and
+//	the view are drawn between where they were at the start and at the
+//	end of the last tic.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __R_INTERP_H__
+#define __R_INTERP_H__
+
+#include "m_fixed.h"
+
+bool R_DrawBetweenTics (void);
+void R_InterpolationTic (void);
+void R_BeginInterpolation (fixed_t frac);
+void R_EndInterpolation (void);
+
+#endif // __R_INTERP_H__
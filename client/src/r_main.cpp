@@ -35,6 +35,9 @@
 #include "p_local.h"
 #include "r_local.h"
 #include "r_sky.h"
+#include "r_thread.h"
+#include "r_interp.h"
+#include "cl_timedemo.h"
 #include "st_stuff.h"
 #include "c_cvars.h"
 #include "v_video.h"
@@ -1181,6 +1184,10 @@ void R_SetupFrame (player_t *player)
 
 void R_RenderPlayerView (player_t *player)
 {
+	// Draw actors and moving planes between where the last tic moved them
+	if (R_DrawBetweenTics ())
+		R_BeginInterpolation (D_TicFrac ());
+
 	R_SetupFrame (player);
 
 	// Clear buffers.
@@ -1211,6 +1218,9 @@ void R_RenderPlayerView (player_t *player)
 		spanslopefunc = R_DrawSlopeSpan;
 	}
 
+	// Queue the draws for the render threads if r_threads is set
+	R_BeginDrawQueue ();
+
 	// [RH] Hack to make windows into underwater areas possible
 	r_fakingunderwater = false;
 
@@ -1222,18 +1232,36 @@ void R_RenderPlayerView (player_t *player)
 	if (camera && camera->player && !(player->cheats & CF_CHASECAM))
 	{
 		camera->flags2 |= MF2_DONTDRAW;
+		TD_BeginStage (TDS_BSP);
 		R_RenderBSPNode (numnodes - 1);
+		TD_EndStage (TDS_BSP);
 		camera->flags2 &= ~MF2_DONTDRAW;
 	}
 	else
+	{
+		TD_BeginStage (TDS_BSP);
 		R_RenderBSPNode (numnodes-1);	// The head node is the last node output.
+		TD_EndStage (TDS_BSP);
+	}
 
+	TD_BeginStage (TDS_PLANES);
 	R_DrawPlanes ();
+	TD_EndStage (TDS_PLANES);
 
+	TD_BeginStage (TDS_MASKED);
 	R_DrawMasked ();
+	TD_EndStage (TDS_MASKED);
+
+	TD_BeginStage (TDS_DRAWQUEUE);
+	R_FinishDrawQueue ();
+	TD_EndStage (TDS_DRAWQUEUE);
+
+	R_ReleaseFlats ();
 
 	// [RH] Apply detail mode doubling
 	R_DetailDouble ();
+
+	R_EndInterpolation ();
 }
 
 //
@@ -44,12 +44,15 @@
 #include "p_local.h"
 #include "r_local.h"
 #include "r_sky.h"
+#include "r_thread.h"
 
 #include "m_alloc.h"
 #include "v_video.h"
 
 #include "vectors.h"
 #include <math.h>
+#include <vector>
+#include <algorithm>
 
 planefunction_t 		floorfunc;
 planefunction_t 		ceilingfunc;
@@ -116,6 +119,36 @@ static angle_t			baseangle;
 v3double_t				a, b, c;
 float					ixscale, iyscale;
 
+//
+// Spans of level planes are collected by R_MapLevelPlane for the whole
+// frame and drawn together by R_DrawPlaneSpans, with the planes sorted so
+// spans sharing a flat and light level come one after another.
+//
+typedef struct
+{
+	int				y, x1, x2;
+	dsfixed_t		xfrac, yfrac;
+	dsfixed_t		xstep, ystep;
+	lighttable_t	*colormap;
+	byte			*source;
+	int				color;
+} planespan_t;
+
+static planespan_t		*planespans;
+static size_t			numplanespans, maxplanespans;
+
+typedef struct
+{
+	visplane_t		*pl;
+	byte			*source;
+	int				color;
+} flatplane_t;
+
+static std::vector<flatplane_t> flatplanes;
+
+// Flats cached at PU_STATIC for this frame, let go by R_ReleaseFlats
+static std::vector<byte *> framepins;
+
 EXTERN_CVAR (r_skypalette)
 
 #ifdef USEASM
@@ -208,7 +241,7 @@ void R_MapSlopedPlane(int y, int x1, int x2)
 	ds_x1 = x1;
 	ds_x2 = x2;
 
-	spanslopefunc();
+	R_DispatchSlopeSpan (spanslopefunc);
 }
 
 
@@ -256,8 +289,16 @@ R_MapLevelPlane
 	// should find the (u,v) coordinates at the left and right edges of the
 	// span and step between them, but that involves more math (including
 	// some divides).
-	ds_xstep = FixedMul (xstepscale, distance) << 10;
-	ds_ystep = FixedMul (ystepscale, distance) << 10;
+	if (numplanespans == maxplanespans)
+	{
+		maxplanespans = maxplanespans ? maxplanespans * 2 : 1024;
+		planespans = (planespan_t *)Realloc (planespans, maxplanespans * sizeof(*planespans));
+	}
+
+	planespan_t *span = &planespans[numplanespans++];
+
+	span->xstep = FixedMul (xstepscale, distance) << 10;
+	span->ystep = FixedMul (ystepscale, distance) << 10;
 
 	// Find the length of a 2D vector from the camera to the left edge of
 	// the span in camera space. This is accomplished using some trig:
@@ -276,13 +317,13 @@ R_MapLevelPlane
 	// ray from the camera position out into texture space. (For all intents and
 	// purposes, texture space is equivalent to world space here.) The (u,v) values
 	// are multiplied by scaling factors for the plane to scale the texture.
-	ds_xfrac = FixedMul (xscale, pviewx + FixedMul (finecosine[angle], length)) << 10;
-	ds_yfrac = FixedMul (yscale, pviewy - FixedMul (finesine[angle], length)) << 10;
+	span->xfrac = FixedMul (xscale, pviewx + FixedMul (finecosine[angle], length)) << 10;
+	span->yfrac = FixedMul (yscale, pviewy - FixedMul (finesine[angle], length)) << 10;
 
 	if (fixedlightlev)
-		ds_colormap = basecolormap + fixedlightlev;
+		span->colormap = basecolormap + fixedlightlev;
 	else if (fixedcolormap)
-		ds_colormap = fixedcolormap;
+		span->colormap = fixedcolormap;
 	else
 	{
 		// Determine lighting based on the span's distance from the viewer.
@@ -291,19 +332,48 @@ R_MapLevelPlane
 		if (index >= MAXLIGHTZ)
 			index = MAXLIGHTZ-1;
 
-		ds_colormap = planezlight[index] + basecolormap;
+		span->colormap = planezlight[index] + basecolormap;
 	}
 
+	span->y = y;
+	span->x1 = x1;
+	span->x2 = x2;
+	span->source = ds_source;
+	span->color = ds_color;
+}
+
+//
+// R_DrawPlaneSpans
+// Draws the spans R_MapLevelPlane collected.
+//
+static void R_DrawPlaneSpans (void)
+{
+	for (size_t i = 0; i < numplanespans; i++)
+	{
+		const planespan_t &span = planespans[i];
+
+		ds_y = span.y;
+		ds_x1 = span.x1;
+		ds_x2 = span.x2;
+		ds_xfrac = span.xfrac;
+		ds_yfrac = span.yfrac;
+		ds_xstep = span.xstep;
+		ds_ystep = span.ystep;
+		ds_colormap = span.colormap;
+		ds_source = span.source;
+		ds_color = span.color;
+
 #ifdef USEASM
-	if (ds_colormap != ds_curcolormap)
-		R_SetSpanColormap_ASM (ds_colormap);
+		if (ds_source != ds_cursource)
+			R_SetSpanSource_ASM (ds_source);
+		if (ds_colormap != ds_curcolormap)
+			R_SetSpanColormap_ASM (ds_colormap);
 #endif
 
-	ds_y = y;
-	ds_x1 = x1;
-	ds_x2 = x2;
+		R_DispatchSpan (spanfunc);
+	}
 
-	spanfunc ();
+	numplanespans = 0;
 }
 
 //
@@ -396,11 +466,23 @@ visplane_t *R_FindPlane (plane_t secplane, int picnum, int lightlevel,
 	check->minx = viewwidth;			// Was SCREENWIDTH -- killough 11/98
 	check->maxx = -1;
 
-	memset (check->top, 0xff, sizeof(*check->top) * screen->width);
+	// top is cleared by R_CheckPlane as minx and maxx take in columns
 
 	return check;
 }
 
+//
+// R_ClearPlaneTop
+// Marks columns x1 to x2 of a visplane as empty. Only the columns between
+// minx and maxx are ever read, so a plane is cleared as it grows instead
+// of across the whole screen when it is made.
+//
+static inline void R_ClearPlaneTop (visplane_t *pl, int x1, int x2)
+{
+	if (x1 <= x2)
+		memset (pl->top + x1, 0xff, sizeof(*pl->top) * (x2 - x1 + 1));
+}
+
 //
 // R_CheckPlane
 //
@@ -443,7 +525,17 @@ R_CheckPlane
 
 	if (x > intrh)
 	{
-		// use the same visplane
+		// use the same visplane, clearing the columns it gains
+		if (pl->minx > pl->maxx)
+			R_ClearPlaneTop (pl, start, stop);
+		else
+		{
+			if (unionl < pl->minx)
+				R_ClearPlaneTop (pl, unionl, pl->minx - 1);
+			if (unionh > pl->maxx)
+				R_ClearPlaneTop (pl, pl->maxx + 1, unionh);
+		}
+
 		pl->minx = unionl;
 		pl->maxx = unionh;
 	}
@@ -465,7 +557,7 @@ R_CheckPlane
 		pl = new_pl;
 		pl->minx = start;
 		pl->maxx = stop;
-		memset (pl->top, 0xff, sizeof(*pl->top) * screen->width);
+		R_ClearPlaneTop (pl, start, stop);
 	}
 	return pl;
 }
@@ -494,7 +586,7 @@ static void _skycolumn (void (*drawfunc)(void), int x)
 
 		dc_texturefrac = dc_texturemid + (dc_yl - centery + 1) * dc_iscale;
 		dc_source = R_GetColumn (skytex, angle);
-		drawfunc ();
+		R_DispatchColumn (drawfunc);
 	}
 }
 
@@ -751,6 +843,84 @@ void R_DrawLevelPlane(visplane_t *pl)
 }
 
 
+//
+// R_GetFlatSource
+// Returns the pixels of a flat, warping it first if it warps. The flat
+// stays at PU_STATIC until R_ReleaseFlats, as the spans using it are
+// drawn after all planes are mapped, or later still by the render threads.
+//
+static byte *R_GetFlatSource (int useflatnum)
+{
+	byte *source = (byte *)W_CacheLumpNum (firstflat + useflatnum, PU_STATIC);
+
+	if (!R_FlatPinned (useflatnum))
+		framepins.push_back (source);
+
+	// [RH] warp a flat if desired
+	if (!flatwarp[useflatnum])
+		return source;
+
+	if ((!warpedflats[useflatnum]
+		 && Z_Malloc (64*64, PU_STATIC, &warpedflats[useflatnum]))
+		|| flatwarpedwhen[useflatnum] != level.time)
+	{
+		static byte buffer[64];
+		int timebase = level.time*23;
+
+		flatwarpedwhen[useflatnum] = level.time;
+		byte *warped = warpedflats[useflatnum];
+
+		for (int x = 63; x >= 0; x--)
+		{
+			int yt, yf = (finesine[(timebase + ((x+17) << 7))&FINEMASK]>>13) & 63;
+			byte *src = source + x;
+			byte *dest = warped + x;
+			for (yt = 64; yt; yt--, yf = (yf+1)&63, dest += 64)
+				*dest = *(src + (yf << 6));
+		}
+		timebase = level.time*32;
+		for (int y = 63; y >= 0; y--)
+		{
+			int xt, xf = (finesine[(timebase + (y << 7))&FINEMASK]>>13) & 63;
+			byte *src = warped + (y << 6);
+			byte *dest = buffer;
+			for (xt = 64; xt; xt--, xf = (xf+1) & 63)
+				*dest++ = *(src+xf);
+			memcpy (warped + (y << 6), buffer, 64);
+		}
+	}
+
+	Z_ChangeTag (warpedflats[useflatnum], PU_STATIC);
+	framepins.push_back (warpedflats[useflatnum]);
+
+	return warpedflats[useflatnum];
+}
+
+//
+// R_ReleaseFlats
+// Lets the zone purge the flats R_GetFlatSource held for this frame.
+// Flats R_PrecacheLevel holds for the level are left alone.
+//
+void R_ReleaseFlats (void)
+{
+	for (size_t i = 0; i < framepins.size (); i++)
+		Z_ChangeTag (framepins[i], PU_CACHE);
+
+	framepins.clear ();
+}
+
+//
+// R_FlatPlaneBefore
+//
+static bool R_FlatPlaneBefore (const flatplane_t &a, const flatplane_t &b)
+{
+	if (a.source != b.source)
+		return a.source < b.source;
+	if (a.pl->colormap != b.pl->colormap)
+		return a.pl->colormap < b.pl->colormap;
+	return a.pl->lightlevel < b.pl->lightlevel;
+}
+
 //
 // R_DrawPlanes
 //
@@ -845,66 +1015,43 @@ void R_DrawPlanes (void)
 			{
 				// regular flat
 				int useflatnum = flattranslation[pl->picnum < numflats ? pl->picnum : 0];
+				flatplane_t fp;
 
 				ds_color += 4;	// [RH] color if r_drawflat is 1
-				ds_source = (byte *)W_CacheLumpNum (firstflat + useflatnum, PU_STATIC);
-										   
-				// [RH] warp a flat if desired
-				if (flatwarp[useflatnum])
-				{
-					if ((!warpedflats[useflatnum]
-						 && Z_Malloc (64*64, PU_STATIC, &warpedflats[useflatnum]))
-						|| flatwarpedwhen[useflatnum] != level.time)
-					{
-						static byte buffer[64];
-						int timebase = level.time*23;
-
-						flatwarpedwhen[useflatnum] = level.time;
-						byte *warped = warpedflats[useflatnum];
-
-						for (int x = 63; x >= 0; x--)
-						{
-							int yt, yf = (finesine[(timebase + ((x+17) << 7))&FINEMASK]>>13) & 63;
-							byte *source = ds_source + x;
-							byte *dest = warped + x;
-							for (yt = 64; yt; yt--, yf = (yf+1)&63, dest += 64)
-								*dest = *(source + (yf << 6));
-						}
-						timebase = level.time*32;
-						for (int y = 63; y >= 0; y--)
-						{
-							int xt, xf = (finesine[(timebase + (y << 7))&FINEMASK]>>13) & 63;
-							byte *source = warped + (y << 6);
-							byte *dest = buffer;
-							for (xt = 64; xt; xt--, xf = (xf+1) & 63)
-								*dest++ = *(source+xf);
-							memcpy (warped + (y << 6), buffer, 64);
-						}
-						Z_ChangeTag (ds_source, PU_CACHE);
-						ds_source = warped;
-					}
-					else
-					{
-						Z_ChangeTag (ds_source, PU_CACHE);
-						ds_source = warpedflats[useflatnum];
-						Z_ChangeTag (ds_source, PU_STATIC);
-					}
-				}
-				
-#ifdef USEASM
-				if (ds_source != ds_cursource)
-					R_SetSpanSource_ASM (ds_source);
-#endif
 
-				if (P_IsPlaneLevel(&pl->secplane))
-					R_DrawLevelPlane(pl);
-				else
-					R_DrawSlopedPlane(pl);
-					
-				Z_ChangeTag (ds_source, PU_CACHE);
+				fp.pl = pl;
+				fp.source = R_GetFlatSource (useflatnum);
+				fp.color = ds_color;
+				flatplanes.push_back (fp);
 			}
 		}
 	}
+
+	// Group the planes by flat and light so the spans drawn one after
+	// another share their source and colormaps
+	std::sort (flatplanes.begin (), flatplanes.end (), R_FlatPlaneBefore);
+
+	for (i = 0; i < (int)flatplanes.size (); i++)
+	{
+		pl = flatplanes[i].pl;
+		ds_source = flatplanes[i].source;
+		ds_color = flatplanes[i].color;
+
+		if (P_IsPlaneLevel(&pl->secplane))
+			R_DrawLevelPlane(pl);
+		else
+		{
+#ifdef USEASM
+			if (ds_source != ds_cursource)
+				R_SetSpanSource_ASM (ds_source);
+#endif
+			R_DrawSlopedPlane(pl);
+		}
+	}
+
+	R_DrawPlaneSpans ();
+
+	flatplanes.clear ();
 }
 
 //
@@ -37,6 +37,8 @@
 #include "p_local.h"
 #include "r_local.h"
 #include "r_sky.h"
+#include "r_thread.h"
+#include "cl_timedemo.h"
 #include "v_video.h"
 
 #include "vectors.h"
@@ -401,7 +403,7 @@ static void BlastColumn (void (*blastfunc)())
 		dc_yh = yh;
 		dc_texturefrac = rw_midtexturemid + dc_yl * dc_iscale - texfracdiff;
 		dc_source = R_GetColumn (midtexture, texturecolumn);
-		blastfunc ();
+		R_DispatchColumn (blastfunc);
 		ceilingclip[rw_x] = viewheight;
 		floorclip[rw_x] = -1;
 	}
@@ -422,7 +424,7 @@ static void BlastColumn (void (*blastfunc)())
 				dc_yh = mid;
 				dc_texturefrac = rw_toptexturemid + dc_yl * dc_iscale - texfracdiff;
 				dc_source = R_GetColumn (toptexture, texturecolumn);
-				blastfunc ();
+				R_DispatchColumn (blastfunc);
 				ceilingclip[rw_x] = mid;
 			}
 			else
@@ -450,7 +452,7 @@ static void BlastColumn (void (*blastfunc)())
 				dc_yh = yh;
 				dc_texturefrac = rw_bottomtexturemid + dc_yl * dc_iscale - texfracdiff;
 				dc_source = R_GetColumn (bottomtexture, texturecolumn);
-				blastfunc ();
+				R_DispatchColumn (blastfunc);
 				floorclip[rw_x] = mid;
 			}
 			else
@@ -675,6 +677,8 @@ void R_StoreWallRange(int start, int stop)
 		I_FatalError ("Bad R_StoreWallRange: %i to %i", start , stop);
 #endif
 
+	TD_BeginStage (TDS_WALLS);
+
 	// don't overflow and crash
 	if (ds_p == &drawsegs[MaxDrawSegs])
 	{ // [RH] Grab some more drawsegs
@@ -1139,6 +1143,8 @@ void R_StoreWallRange(int start, int stop)
 	}
 
 	ds_p++;
+
+	TD_EndStage (TDS_WALLS);
 }
 
 
@@ -21,6 +21,8 @@
 //
 //-----------------------------------------------------------------------------
 
+#include <algorithm>
+
 #include "m_alloc.h"
 
 #include "doomdef.h"
@@ -32,6 +34,7 @@
 #include "w_wad.h"
 
 #include "r_local.h"
+#include "r_thread.h"
 #include "p_local.h"
 
 #include "c_console.h"
@@ -45,8 +48,6 @@
 #include "cmdlib.h"
 #include "s_sound.h"
 
-#include "qsort.h"
-
 extern fixed_t FocalLengthX, FocalLengthY;
 
 #define MINZ							(FRACUNIT*4)
@@ -562,7 +563,9 @@ void R_InitSprites (const char **namelist)
 
 	numskins = 0; // [Toke - skins] Reset skin count
 
-	MaxVisSprites = 128;	// [RH] This is the initial default value. It grows as needed.
+	// [RH] This is the initial default value. It grows as needed, though
+	// it is large enough that it seldom has to.
+	MaxVisSprites = 1024;
 
 	M_Free(vissprites);
     
@@ -677,7 +680,7 @@ void R_DrawMaskedColumn (column_t *column)
 		if (dc_yl <= dc_yh)
 		{
 			dc_source = (byte *)column + 3;
-			colfunc ();
+			R_DispatchColumn (colfunc);
 		}
 		column = (column_t *)((byte *)column + column->length + 4);
 	}
@@ -1339,19 +1342,85 @@ void R_DrawPlayerSprites (void)
 //		more vissprites that need to be sorted, the better the performance
 //		gain compared to the old function.
 //
+// Sorting is now a radix sort on depth, which takes linear time however
+// far the sprites have moved since the last frame. A handful of sprites
+// are simply insertion sorted.
+//
 static struct vissort_s {
 	vissprite_t *sprite;
 	fixed_t		depth;
-}				*spritesorter;
+}				*spritesorter, *radixtemp;
 static int		spritesortersize = 0;
 static int		vsprcount;
 
-#define cmp_sprites(a, b) (b->depth < a->depth)
+// Fewer sprites than this are insertion sorted
+#define SORT_MINRADIX		32
 
-void R_SortVisSprites (void)
+// Far sprites sort first, so the key is the depth inverted
+#define SORTKEY(d)			(~((DWORD)(d) ^ 0x80000000u))
+
+//
+// R_InsertionSortSprites
+// Sorts spritesorter far to near.
+//
+static void R_InsertionSortSprites (void)
 {
-	int i;
+	for (int i = 1; i < vsprcount; i++)
+	{
+		vissort_s cur = spritesorter[i];
+		int j = i;
+
+		while (j > 0 && spritesorter[j-1].depth < cur.depth)
+		{
+			spritesorter[j] = spritesorter[j-1];
+			j--;
+		}
+
+		spritesorter[j] = cur;
+	}
+}
+
+//
+// R_RadixSortSprites
+// Sorts spritesorter far to near, a byte of depth at a time.
+//
+static void R_RadixSortSprites (void)
+{
+	int count[256], total;
+	vissort_s *src = spritesorter, *dst = radixtemp;
 
+	for (int shift = 0; shift < 32; shift += 8)
+	{
+		int i;
+
+		memset (count, 0, sizeof(count));
+
+		for (i = 0; i < vsprcount; i++)
+			count[(SORTKEY(src[i].depth) >> shift) & 255]++;
+
+		// all sprites alike in this byte
+		if (count[(SORTKEY(src[0].depth) >> shift) & 255] == vsprcount)
+			continue;
+
+		for (i = 0, total = 0; i < 256; i++)
+		{
+			int c = count[i];
+			count[i] = total;
+			total += c;
+		}
+
+		for (i = 0; i < vsprcount; i++)
+			dst[count[(SORTKEY(src[i].depth) >> shift) & 255]++] = src[i];
+
+		std::swap (src, dst);
+	}
+
+	if (src != spritesorter)
+		memcpy (spritesorter, src, vsprcount * sizeof(*spritesorter));
+}
+
+void R_SortVisSprites (void)
+{
 	vsprcount = vissprite_p - vissprites;
 
 	if (!vsprcount)
@@ -1360,16 +1429,20 @@ void R_SortVisSprites (void)
 	if (spritesortersize < MaxVisSprites)
 	{
 		spritesorter = (vissort_s *)Realloc (spritesorter, sizeof(struct vissort_s) * MaxVisSprites);
+		radixtemp = (vissort_s *)Realloc (radixtemp, sizeof(struct vissort_s) * MaxVisSprites);
 		spritesortersize = MaxVisSprites;
 	}
 
-	for (i = 0; i < vsprcount; i++)
+	for (int i = 0; i < vsprcount; i++)
 	{
 		spritesorter[i].sprite = &vissprites[i];
 		spritesorter[i].depth = vissprites[i].depth;
 	}
 
-    QSORT(vissort_s, spritesorter, vsprcount, cmp_sprites);
+	if (vsprcount < SORT_MINRADIX)
+		R_InsertionSortSprites ();
+	else
+		R_RadixSortSprites ();
 }
 
 
@@ -1384,77 +1457,207 @@ int *r_dsclipbot, *r_dscliptop;
 #define NOT_CLIPPED		(-32768)
 
 //
-// R_DrawSprite
+// DRAWSEG INDEX
+// Sprites are clipped against the drawsegs that overlap them, newest
+// first. So that every sprite does not have to look at every drawseg,
+// the drawsegs that can clip a sprite or have a masked mid texture are
+// listed by the screen columns they cover, in buckets of
+// 1 << DSBUCKETSHIFT columns. Each list is in drawing order.
 //
-void R_DrawSprite (vissprite_t *spr)
+#define DSBUCKETSHIFT		5
+
+// Sprites covering more buckets than this scan dsclipsegs instead
+#define MAXMERGEBUCKETS		8
+
+static int		*dsbucketstart;		// first entry of each bucket, and the end
+static int		*dsbucketfill;
+static int		*dsbucketsegs;		// drawseg numbers
+static int		*dsclipsegs;		// every drawseg in the index
+static int		numdsbuckets, numdsclipsegs;
+static size_t	maxdsbuckets, maxdsbucketsegs, maxdsclipsegs;
+
+//
+// R_BuildDrawSegIndex
+// Called once the BSP has been rendered, before any sprites are drawn.
+//
+static void R_BuildDrawSegIndex (void)
+{
+	int numds = ds_p - drawsegs;
+	int i, b, total;
+
+	numdsbuckets = (viewwidth + (1 << DSBUCKETSHIFT) - 1) >> DSBUCKETSHIFT;
+
+	if ((size_t)numdsbuckets + 1 > maxdsbuckets)
+	{
+		maxdsbuckets = numdsbuckets + 1;
+		dsbucketstart = (int *)Realloc (dsbucketstart, maxdsbuckets * sizeof(int));
+		dsbucketfill = (int *)Realloc (dsbucketfill, maxdsbuckets * sizeof(int));
+	}
+	if ((size_t)numds > maxdsclipsegs)
+	{
+		maxdsclipsegs = MaxDrawSegs;
+		dsclipsegs = (int *)Realloc (dsclipsegs, maxdsclipsegs * sizeof(int));
+	}
+
+	// count the entries of each bucket
+	memset (dsbucketstart, 0, (numdsbuckets + 1) * sizeof(int));
+	numdsclipsegs = 0;
+
+	for (i = 0; i < numds; i++)
+	{
+		drawseg_t *ds = drawsegs + i;
+
+		if (!ds->silhouette && !ds->maskedtexturecol)
+			continue;
+
+		dsclipsegs[numdsclipsegs++] = i;
+		for (b = ds->x1 >> DSBUCKETSHIFT; b <= ds->x2 >> DSBUCKETSHIFT; b++)
+			dsbucketstart[b + 1]++;
+	}
+
+	for (b = 0, total = 0; b <= numdsbuckets; b++)
+	{
+		total += dsbucketstart[b];
+		dsbucketstart[b] = dsbucketfill[b] = total;
+	}
+
+	if ((size_t)total > maxdsbucketsegs)
+	{
+		maxdsbucketsegs = total * 2;
+		dsbucketsegs = (int *)Realloc (dsbucketsegs, maxdsbucketsegs * sizeof(int));
+	}
+
+	// then fill them
+	for (i = 0; i < numdsclipsegs; i++)
+	{
+		drawseg_t *ds = drawsegs + dsclipsegs[i];
+
+		for (b = ds->x1 >> DSBUCKETSHIFT; b <= ds->x2 >> DSBUCKETSHIFT; b++)
+			dsbucketsegs[dsbucketfill[b]++] = dsclipsegs[i];
+	}
+}
+
+//
+// R_ClipSpriteToDrawSeg
+//
+static inline void R_ClipSpriteToDrawSeg (vissprite_t *spr, drawseg_t *ds)
 {
-	drawseg_t*			ds;
 	int 				x;
 	int 				r1;
 	int 				r2;
 	fixed_t 			scale;
 	fixed_t 			lowscale;
 
-	for (x = spr->x1 ; x<=spr->x2 ; x++)
-		r_dsclipbot[x] = r_dscliptop[x] = NOT_CLIPPED;
+	// determine if the drawseg obscures the sprite
+	if (ds->x1 > spr->x2 || ds->x2 < spr->x1)
+	{
+		// does not cover sprite
+		return;
+	}
 
-	// Scan drawsegs from end to start for obscuring segs.
-	// The first drawseg that has a greater scale is the clip seg.
+	r1 = ds->x1 < spr->x1 ? spr->x1 : ds->x1;
+	r2 = ds->x2 > spr->x2 ? spr->x2 : ds->x2;
 
-	// Modified by Lee Killough:
-	// (pointer check was originally nonportable
-	// and buggy, by going past LEFT end of array):
+	if (ds->scale1 > ds->scale2)
+	{
+		lowscale = ds->scale2;
+		scale = ds->scale1;
+	}
+	else
+	{
+		lowscale = ds->scale1;
+		scale = ds->scale2;
+	}
 
-	for (ds = ds_p ; ds-- > drawsegs ; )  // new -- killough
+	if (scale < spr->yscale
+		|| ( lowscale < spr->yscale
+			 && !R_PointOnSegSide (spr->gx, spr->gy, ds->curline) ) )
 	{
-		// determine if the drawseg obscures the sprite
-		if (ds->x1 > spr->x2
-			|| ds->x2 < spr->x1
-			|| (!ds->silhouette && !ds->maskedtexturecol) )
-		{
-			// does not cover sprite
-			continue;
-		}
+		// masked mid texture?
+		if (ds->maskedtexturecol)
+			R_RenderMaskedSegRange (ds, r1, r2);
+		// seg is behind sprite
+		return;
+	}
 
-		r1 = ds->x1 < spr->x1 ? spr->x1 : ds->x1;
-		r2 = ds->x2 > spr->x2 ? spr->x2 : ds->x2;
 
-		if (ds->scale1 > ds->scale2)
-		{
-			lowscale = ds->scale2;
-			scale = ds->scale1;
-		}
-		else
-		{
-			lowscale = ds->scale1;
-			scale = ds->scale2;
-		}
+	// clip this piece of the sprite
+	// killough 3/27/98: optimized and made much shorter
+
+	if (ds->silhouette&SIL_BOTTOM && spr->gz < ds->bsilheight) //bottom sil
+		for (x = r1; x <= r2; x++)
+			if (r_dsclipbot[x] == NOT_CLIPPED)
+				r_dsclipbot[x] = ds->sprbottomclip[x];
+
+	if (ds->silhouette&SIL_TOP && spr->gzt > ds->tsilheight)   // top sil
+		for (x = r1; x <= r2; x++)
+			if (r_dscliptop[x] == NOT_CLIPPED)
+				r_dscliptop[x] = ds->sprtopclip[x];
+}
+
+//
+// R_ClipSpriteToDrawSegs
+// Visits the drawsegs that overlap the sprite from the last drawn to
+// the first, exactly as a scan of every drawseg would.
+//
+static void R_ClipSpriteToDrawSegs (vissprite_t *spr)
+{
+	int b1 = spr->x1 >> DSBUCKETSHIFT;
+	int b2 = spr->x2 >> DSBUCKETSHIFT;
+	int i;
 
-		if (scale < spr->yscale
-			|| ( lowscale < spr->yscale
-				 && !R_PointOnSegSide (spr->gx, spr->gy, ds->curline) ) )
+	if (b2 - b1 >= MAXMERGEBUCKETS)
+	{
+		for (i = numdsclipsegs; i-- > 0; )
+			R_ClipSpriteToDrawSeg (spr, drawsegs + dsclipsegs[i]);
+	}
+	else if (b1 == b2)
+	{
+		for (i = dsbucketstart[b1 + 1]; i-- > dsbucketstart[b1]; )
+			R_ClipSpriteToDrawSeg (spr, drawsegs + dsbucketsegs[i]);
+	}
+	else
+	{
+		// merge the buckets, a drawseg may be in several of them
+		int pos[MAXMERGEBUCKETS];
+		int count = b2 - b1 + 1;
+
+		for (i = 0; i < count; i++)
+			pos[i] = dsbucketstart[b1 + i + 1];
+
+		for (;;)
 		{
-			// masked mid texture?
-			if (ds->maskedtexturecol)
-				R_RenderMaskedSegRange (ds, r1, r2);
-			// seg is behind sprite
-			continue;
-		}
+			int next = -1;
 
+			for (i = 0; i < count; i++)
+				if (pos[i] > dsbucketstart[b1 + i] && dsbucketsegs[pos[i] - 1] > next)
+					next = dsbucketsegs[pos[i] - 1];
 
-		// clip this piece of the sprite
-		// killough 3/27/98: optimized and made much shorter
+			if (next < 0)
+				break;
 
-		if (ds->silhouette&SIL_BOTTOM && spr->gz < ds->bsilheight) //bottom sil
-			for (x = r1; x <= r2; x++)
-				if (r_dsclipbot[x] == NOT_CLIPPED)
-					r_dsclipbot[x] = ds->sprbottomclip[x];
+			for (i = 0; i < count; i++)
+				if (pos[i] > dsbucketstart[b1 + i] && dsbucketsegs[pos[i] - 1] == next)
+					pos[i]--;
 
-		if (ds->silhouette&SIL_TOP && spr->gzt > ds->tsilheight)   // top sil
-			for (x = r1; x <= r2; x++)
-				if (r_dscliptop[x] == NOT_CLIPPED)
-					r_dscliptop[x] = ds->sprtopclip[x];
+			R_ClipSpriteToDrawSeg (spr, drawsegs + next);
+		}
 	}
+}
+
+//
+// R_DrawSprite
+//
+void R_DrawSprite (vissprite_t *spr)
+{
+	int 				x;
+
+	for (x = spr->x1 ; x<=spr->x2 ; x++)
+		r_dsclipbot[x] = r_dscliptop[x] = NOT_CLIPPED;
+
+	// Scan drawsegs from end to start for obscuring segs.
+	// The first drawseg that has a greater scale is the clip seg.
+	R_ClipSpriteToDrawSegs (spr);
 
 	// killough 3/27/98:
 	// Clip the sprite against deep water and/or fake ceilings.
@@ -1597,6 +1800,8 @@ void R_DrawMasked (void)
 
 	if (vsprcount)
 	{
+		R_BuildDrawSegIndex ();
+
 		sorttail = spritesorter + vsprcount;
 		vsprcount = -vsprcount;
 		do
@@ -1856,48 +2061,50 @@ void R_DrawParticle (vissprite_t *vis, int x1, int x2)
 	if (yl <= mceilingclip[x2])
 		yl = mceilingclip[x2]+1;
 
+	if (yh < yl)
+		return;
+
 	// vis->mobjflags holds translucency level (0-255)
 	{
-		unsigned int *bg2rgb;
-		int countbase = x2 - x1 + 1;
-		int ycount;
-		int colsize = ds_colsize;
-		int spacing;
-		byte *dest;
-		unsigned int fg;
-
-		ycount = yh - yl;
-		if (ycount < 0)
-			return;
-		ycount++;
+		fixed_t fglevel, bglevel;
+		unsigned int *fg2rgb, *bg2rgb;
 
-		{
-			fixed_t fglevel, bglevel;
-			unsigned int *fg2rgb;
-
-			fglevel = ((vis->mobjflags + 1) << 8) & ~0x3ff;
-			bglevel = FRACUNIT-fglevel;
-			fg2rgb = Col2RGB8[fglevel>>10];
-			bg2rgb = Col2RGB8[bglevel>>10];
-			fg = fg2rgb[color];
-		}
+		fglevel = ((vis->mobjflags + 1) << 8) & ~0x3ff;
+		bglevel = FRACUNIT-fglevel;
+		fg2rgb = Col2RGB8[fglevel>>10];
+		bg2rgb = Col2RGB8[bglevel>>10];
+
+		if (r_drawqueue)
+			R_QueueParticle (x1, x2, yl, yh, fg2rgb[color], bg2rgb);
+		else
+			R_FillParticle (x1, x2, yl, yh, fg2rgb[color], bg2rgb);
+	}
+}
 
-		spacing = screen->pitch - (countbase << detailxshift);
-		dest = ylookup[yl] + columnofs[x1];
+//
+// R_FillParticle
+// Blends rows yl through yh of a particle's square into the screen.
+//
+void R_FillParticle (int x1, int x2, int yl, int yh, unsigned int fg, unsigned int *bg2rgb)
+{
+	int countbase = x2 - x1 + 1;
+	int ycount = yh - yl + 1;
+	int colsize = ds_colsize;
+	int spacing = screen->pitch - (countbase << detailxshift);
+	byte *dest = ylookup[yl] + columnofs[x1];
 
+	do
+	{
+		int count = countbase;
 		do
 		{
-			int count = countbase;
-			do
-			{
-				unsigned int bg = bg2rgb[*dest];
-				bg = (fg+bg) | 0x1f07c1f;
-				*dest = RGB32k[0][0][bg & (bg>>15)];
-				dest += colsize;
-			} while (--count);
-			dest += spacing;
-		} while (--ycount);
-	}
+			unsigned int bg = bg2rgb[*dest];
+			bg = (fg+bg) | 0x1f07c1f;
+			*dest = RGB32k[0][0][bg & (bg>>15)];
+			dest += colsize;
+		} while (--count);
+		dest += spacing;
+	} while (--ycount);
 }
 
 VERSION_CONTROL (r_things_cpp, "$Id: r_things.cpp 3174 2012-05-11 01:03:43Z mike $")
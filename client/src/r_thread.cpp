@@ -0,0 +1,511 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id$
+//
+// Copyright (C) 2006-2012 by The Odamex Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Multi-threaded drawing of the player view.
+//
+//	The BSP walk, clipping and visplane/vissprite bookkeeping stay on the
+//	main thread. Every column, span and particle it would have drawn is
+//	recorded instead, with a copy of the drawer state, and when the view is
+//	finished the render threads replay the whole list in order. Each thread
+//	owns a horizontal band of rows and clips every draw to it.
+//
+//	Bands rather than vertical strips keep the output pixel-identical to
+//	the single-threaded renderer: a span's texture coordinates are worked
+//	out from its left edge, so splitting a span changes its pixels, while
+//	a column steps linearly from its top and can be cut anywhere.
+//
+//-----------------------------------------------------------------------------
+
+#include <string.h>
+#include <limits.h>
+#include <vector>
+
+#include <SDL.h>
+#include <SDL_thread.h>
+
+#include "doomtype.h"
+#include "c_console.h"
+#include "c_cvars.h"
+#include "i_system.h"
+#include "z_zone.h"
+#include "r_local.h"
+#include "r_thread.h"
+
+EXTERN_CVAR (r_threads)
+
+#define MAXRENDERTHREADS	16
+
+bool r_drawqueue = false;
+
+typedef enum
+{
+	cmd_column,
+	cmd_fuzzcolumn,
+	cmd_span,
+	cmd_slopespan,
+	cmd_horiz,
+	cmd_horiz4,
+	cmd_particle
+} drawcmdtype_t;
+
+//
+// A queued draw and the drawer state it needs. Spans keep their row in
+// yl/yh and their extent in x/x2.
+//
+typedef struct
+{
+	drawcmdtype_t	type;
+	void			(*drawfunc)(void);
+	void			(*postfunc)(int, int, int, int);
+	void			(*post4func)(int, int, int);
+
+	lighttable_t*	colormap;
+	byte*			source;
+	byte*			translation;
+	fixed_t			translevel;
+	unsigned int	mask;
+	int				color;
+
+	int				x, x2, hx;
+	int				yl, yh;
+	fixed_t			iscale;
+	fixed_t			texturefrac;
+
+	dsfixed_t		xfrac, yfrac;
+	dsfixed_t		xstep, ystep;
+
+	size_t			data;			// offset of any extra state in drawdata
+} drawcmd_t;
+
+static std::vector<drawcmd_t> drawcmds;
+static std::vector<byte> drawdata;
+
+typedef struct
+{
+	SDL_Thread*		thread;
+	SDL_sem*		start;
+	SDL_sem*		done;
+	int				top, bottom;	// band of rows this thread owns
+	int				y1, y2;			// rows to draw for the current batch
+	size_t			first, last;	// commands in the current batch
+	bool			quit;
+} renderthread_t;
+
+static renderthread_t renderthreads[MAXRENDERTHREADS];
+static int numrenderthreads;
+static int failedthreads;
+
+//
+// R_NewDrawCmd
+//
+static drawcmd_t &R_NewDrawCmd (drawcmdtype_t type)
+{
+	drawcmds.resize (drawcmds.size() + 1);
+
+	drawcmd_t &cmd = drawcmds.back();
+	cmd.type = type;
+	return cmd;
+}
+
+//
+// R_QueueData
+// Copies state that does not fit in a drawcmd_t to the side buffer.
+//
+static size_t R_QueueData (const void *src, size_t length)
+{
+	size_t ofs = drawdata.size();
+
+	drawdata.insert (drawdata.end(), (const byte *)src, (const byte *)src + length);
+	return ofs;
+}
+
+void R_QueueColumn (void (*drawfunc)(void))
+{
+	if (dc_yl > dc_yh)
+		return;
+
+	drawcmd_t &cmd = R_NewDrawCmd (drawfunc == fuzzcolfunc ? cmd_fuzzcolumn : cmd_column);
+
+	cmd.drawfunc = drawfunc;
+	cmd.colormap = dc_colormap;
+	cmd.source = dc_source;
+	cmd.translation = dc_translation;
+	cmd.translevel = dc_translevel;
+	cmd.mask = dc_mask;
+	cmd.color = dc_color;
+	cmd.x = dc_x;
+	cmd.yl = dc_yl;
+	cmd.yh = dc_yh;
+	cmd.iscale = dc_iscale;
+	cmd.texturefrac = dc_texturefrac;
+}
+
+static drawcmd_t &R_QueueSpanState (drawcmdtype_t type, void (*drawfunc)(void))
+{
+	drawcmd_t &cmd = R_NewDrawCmd (type);
+
+	cmd.drawfunc = drawfunc;
+	cmd.colormap = ds_colormap;
+	cmd.source = ds_source;
+	cmd.color = ds_color;
+	cmd.x = ds_x1;
+	cmd.x2 = ds_x2;
+	cmd.yl = cmd.yh = ds_y;
+	cmd.xfrac = ds_xfrac;
+	cmd.yfrac = ds_yfrac;
+	cmd.xstep = ds_xstep;
+	cmd.ystep = ds_ystep;
+	return cmd;
+}
+
+void R_QueueSpan (void (*drawfunc)(void))
+{
+	R_QueueSpanState (cmd_span, drawfunc);
+}
+
+void R_QueueSlopeSpan (void (*drawfunc)(void))
+{
+	if (ds_x2 < ds_x1)
+		return;
+
+	drawcmd_t &cmd = R_QueueSpanState (cmd_slopespan, drawfunc);
+	double slope[6] = { ds_iu, ds_iv, ds_iustep, ds_ivstep, ds_id, ds_idstep };
+
+	cmd.data = R_QueueData (slope, sizeof(slope));
+	R_QueueData (slopelighting, (ds_x2 - ds_x1 + 1) * sizeof(*slopelighting));
+}
+
+static drawcmd_t &R_QueueHorizState (drawcmdtype_t type, int sx, int yl, int yh)
+{
+	drawcmd_t &cmd = R_NewDrawCmd (type);
+
+	cmd.colormap = dc_colormap;
+	cmd.translation = dc_translation;
+	cmd.translevel = dc_translevel;
+	cmd.x = sx;
+	cmd.yl = yl;
+	cmd.yh = yh;
+	cmd.data = R_QueueData (&dc_temp[yl*4], (yh - yl + 1) * 4);
+	return cmd;
+}
+
+void R_QueueHorizColumns (void (*postfunc)(int, int, int, int), int hx, int sx, int yl, int yh)
+{
+	if (yl > yh)
+		return;
+
+	drawcmd_t &cmd = R_QueueHorizState (cmd_horiz, sx, yl, yh);
+	cmd.postfunc = postfunc;
+	cmd.hx = hx;
+}
+
+void R_QueueHorizColumns4 (void (*post4func)(int, int, int), int sx, int yl, int yh)
+{
+	if (yl > yh)
+		return;
+
+	drawcmd_t &cmd = R_QueueHorizState (cmd_horiz4, sx, yl, yh);
+	cmd.post4func = post4func;
+}
+
+void R_QueueParticle (int x1, int x2, int yl, int yh, unsigned int fg, unsigned int *bg2rgb)
+{
+	if (yl > yh)
+		return;
+
+	drawcmd_t &cmd = R_NewDrawCmd (cmd_particle);
+
+	cmd.x = x1;
+	cmd.x2 = x2;
+	cmd.yl = yl;
+	cmd.yh = yh;
+	cmd.color = fg;
+	cmd.source = (byte *)bg2rgb;
+}
+
+//
+// R_ReplayDrawCommands
+// Draws the part of each queued command that falls in rows y1 to y2-1.
+//
+static void R_ReplayDrawCommands (size_t first, size_t last, int y1, int y2)
+{
+	for (size_t i = first; i < last; i++)
+	{
+		const drawcmd_t &cmd = drawcmds[i];
+		int yl = cmd.yl < y1 ? y1 : cmd.yl;
+		int yh = cmd.yh >= y2 ? y2 - 1 : cmd.yh;
+
+		if (yl > yh)
+			continue;
+
+		switch (cmd.type)
+		{
+		case cmd_column:
+		case cmd_fuzzcolumn:
+			dc_colormap = cmd.colormap;
+			dc_source = cmd.source;
+			dc_translation = cmd.translation;
+			dc_translevel = cmd.translevel;
+			dc_mask = cmd.mask;
+			dc_color = cmd.color;
+			dc_x = cmd.x;
+			dc_yl = yl;
+			dc_yh = yh;
+			dc_iscale = cmd.iscale;
+			dc_texturefrac = (fixed_t)((unsigned int)cmd.texturefrac +
+							(unsigned int)(yl - cmd.yl) * (unsigned int)cmd.iscale);
+			cmd.drawfunc ();
+			break;
+
+		case cmd_span:
+		case cmd_slopespan:
+			ds_colormap = cmd.colormap;
+			ds_source = cmd.source;
+			ds_color = cmd.color;
+			ds_y = cmd.yl;
+			ds_x1 = cmd.x;
+			ds_x2 = cmd.x2;
+			ds_xfrac = cmd.xfrac;
+			ds_yfrac = cmd.yfrac;
+			ds_xstep = cmd.xstep;
+			ds_ystep = cmd.ystep;
+
+			if (cmd.type == cmd_slopespan)
+			{
+				double slope[6];
+				memcpy (slope, &drawdata[cmd.data], sizeof(slope));
+				ds_iu = slope[0];
+				ds_iv = slope[1];
+				ds_iustep = slope[2];
+				ds_ivstep = slope[3];
+				ds_id = slope[4];
+				ds_idstep = slope[5];
+				memcpy (slopelighting, &drawdata[cmd.data + sizeof(slope)],
+						(cmd.x2 - cmd.x + 1) * sizeof(*slopelighting));
+			}
+			cmd.drawfunc ();
+			break;
+
+		case cmd_horiz:
+		case cmd_horiz4:
+			memcpy (&dc_temp[yl*4], &drawdata[cmd.data + (yl - cmd.yl)*4], (yh - yl + 1) * 4);
+			dc_colormap = cmd.colormap;
+			dc_translation = cmd.translation;
+			dc_translevel = cmd.translevel;
+
+			if (cmd.type == cmd_horiz4)
+				cmd.post4func (cmd.x, yl, yh);
+			else
+				cmd.postfunc (cmd.hx, cmd.x, yl, yh);
+			break;
+
+		case cmd_particle:
+			R_FillParticle (cmd.x, cmd.x2, yl, yh, cmd.color, (unsigned int *)cmd.source);
+			break;
+		}
+	}
+}
+
+static int R_RenderThread (void *data)
+{
+	renderthread_t *rt = (renderthread_t *)data;
+
+	while (true)
+	{
+		SDL_SemWait (rt->start);
+
+		if (rt->quit)
+			break;
+
+		R_ReplayDrawCommands (rt->first, rt->last, rt->y1, rt->y2);
+		SDL_SemPost (rt->done);
+	}
+
+	return 0;
+}
+
+//
+// R_RunDrawQueue
+// Has the render threads replay everything queued so far and waits for
+// them to finish.
+//
+static void R_RunDrawQueue (void)
+{
+	size_t count = drawcmds.size();
+	size_t first = 0;
+
+	while (first < count)
+	{
+		// Fuzz reads the pixels above and below the one it draws, which can
+		// belong to another thread's band, so a run of fuzz columns is drawn
+		// in order by a single thread over the whole view.
+		bool serial = (drawcmds[first].type == cmd_fuzzcolumn);
+		size_t last = first + 1;
+		int i, threads;
+
+		while (last < count && (drawcmds[last].type == cmd_fuzzcolumn) == serial)
+			last++;
+
+		threads = serial ? 1 : numrenderthreads;
+
+		for (i = 0; i < threads; i++)
+		{
+			renderthread_t *rt = &renderthreads[i];
+
+			rt->first = first;
+			rt->last = last;
+			rt->y1 = serial ? INT_MIN : rt->top;
+			rt->y2 = serial ? INT_MAX : rt->bottom;
+			SDL_SemPost (rt->start);
+		}
+
+		for (i = 0; i < threads; i++)
+			SDL_SemWait (renderthreads[i].done);
+
+		first = last;
+	}
+
+	drawcmds.clear();
+	drawdata.clear();
+}
+
+//
+// R_FlushDrawQueue
+// Draws everything queued so far. Called by the zone allocator before it
+// purges cached lumps that queued draws may still be reading from.
+//
+void R_FlushDrawQueue (void)
+{
+	if (r_drawqueue && !drawcmds.empty())
+		R_RunDrawQueue();
+}
+
+void STACK_ARGS R_ShutdownRenderThreads (void)
+{
+	int i;
+
+	for (i = 0; i < numrenderthreads; i++)
+	{
+		renderthread_t *rt = &renderthreads[i];
+
+		rt->quit = true;
+		SDL_SemPost (rt->start);
+		SDL_WaitThread (rt->thread, NULL);
+		SDL_DestroySemaphore (rt->start);
+		SDL_DestroySemaphore (rt->done);
+	}
+
+	numrenderthreads = 0;
+	Z_PurgeHook = NULL;
+}
+
+static bool R_StartRenderThreads (int count)
+{
+	static bool registered = false;
+	int i;
+
+	if (!registered)
+	{
+		atterm (R_ShutdownRenderThreads);
+		registered = true;
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		renderthread_t *rt = &renderthreads[i];
+
+		rt->quit = false;
+		rt->start = SDL_CreateSemaphore (0);
+		rt->done = SDL_CreateSemaphore (0);
+		rt->thread = NULL;
+
+		if (rt->start && rt->done)
+			rt->thread = SDL_CreateThread (R_RenderThread, rt);
+
+		if (!rt->thread)
+		{
+			if (rt->start)
+				SDL_DestroySemaphore (rt->start);
+			if (rt->done)
+				SDL_DestroySemaphore (rt->done);
+
+			R_ShutdownRenderThreads();
+			Printf (PRINT_HIGH, "Could not start %d render threads: %s\n", count, SDL_GetError());
+			return false;
+		}
+
+		numrenderthreads = i + 1;
+	}
+
+	Z_PurgeHook = R_FlushDrawQueue;
+	return true;
+}
+
+//
+// R_BeginDrawQueue
+// Called at the start of R_RenderPlayerView. Starts queueing draws if
+// r_threads asks for more than one thread.
+//
+void R_BeginDrawQueue (void)
+{
+#ifdef R_THREADED_DRAWING
+	int count = r_threads.asInt();
+	int i;
+
+	if (count > MAXRENDERTHREADS)
+		count = MAXRENDERTHREADS;
+	if (count < 2)
+		count = 0;
+
+	if (count != numrenderthreads && count != failedthreads)
+	{
+		R_ShutdownRenderThreads();
+		failedthreads = 0;
+
+		if (count && !R_StartRenderThreads (count))
+			failedthreads = count;
+	}
+
+	if (numrenderthreads < 2)
+		return;
+
+	for (i = 0; i < numrenderthreads; i++)
+	{
+		renderthreads[i].top = i ? viewheight * i / numrenderthreads : INT_MIN;
+		renderthreads[i].bottom = (i < numrenderthreads - 1) ?
+			viewheight * (i + 1) / numrenderthreads : INT_MAX;
+	}
+
+	r_drawqueue = true;
+#endif
+}
+
+//
+// R_FinishDrawQueue
+// Draws everything queued for this view and goes back to drawing directly.
+//
+void R_FinishDrawQueue (void)
+{
+	if (!r_drawqueue)
+		return;
+
+	R_RunDrawQueue();
+	r_drawqueue = false;
+}
+
+VERSION_CONTROL (r_thread_cpp, "$Id$")
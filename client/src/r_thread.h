@@ -0,0 +1,83 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id$
+//
+// Copyright (C) 2006-2012 by The Odamex Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Multi-threaded drawing of the player view. While the view is being
+//	rendered, column and span draws are queued instead of drawn, then
+//	replayed by the render threads with each thread owning a band of
+//	screen rows.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __R_THREAD_H__
+#define __R_THREAD_H__
+
+#include "doomtype.h"
+#include "r_main.h"
+
+// True while draws are being queued for the render threads
+extern bool r_drawqueue;
+
+void R_BeginDrawQueue (void);
+void R_FinishDrawQueue (void);
+void R_FlushDrawQueue (void);
+void STACK_ARGS R_ShutdownRenderThreads (void);
+
+void R_QueueColumn (void (*drawfunc)(void));
+void R_QueueSpan (void (*drawfunc)(void));
+void R_QueueSlopeSpan (void (*drawfunc)(void));
+void R_QueueHorizColumns (void (*postfunc)(int, int, int, int), int hx, int sx, int yl, int yh);
+void R_QueueHorizColumns4 (void (*postfunc)(int, int, int), int sx, int yl, int yh);
+void R_QueueParticle (int x1, int x2, int yl, int yh, unsigned int fg, unsigned int *bg2rgb);
+
+//
+// R_DispatchColumn
+// Draws the column described by dc_* now, or queues it when the view is
+// being drawn by the render threads. hcolfunc_pre only fills dc_temp on
+// this thread; it is the copy to the screen that gets queued.
+//
+inline void R_DispatchColumn (void (*drawfunc)(void))
+{
+	if (r_drawqueue && drawfunc != hcolfunc_pre)
+		R_QueueColumn (drawfunc);
+	else
+		drawfunc ();
+}
+
+//
+// R_DispatchSpan
+//
+inline void R_DispatchSpan (void (*drawfunc)(void))
+{
+	if (r_drawqueue)
+		R_QueueSpan (drawfunc);
+	else
+		drawfunc ();
+}
+
+//
+// R_DispatchSlopeSpan
+//
+inline void R_DispatchSlopeSpan (void (*drawfunc)(void))
+{
+	if (r_drawqueue)
+		R_QueueSlopeSpan (drawfunc);
+	else
+		drawfunc ();
+}
+
+#endif // __R_THREAD_H__
@@ -103,6 +103,17 @@ CVAR_FUNC_IMPL (vid_fullscreen)
 	NewBits = DisplayBits;
 }
 
+CVAR_FUNC_IMPL (vid_32bpp)
+{
+	if (!screen)
+		return;
+
+	setmodeneeded = true;
+	NewWidth = screen->width;
+	NewHeight = screen->height;
+	NewBits = DisplayBits;
+}
+
 
 //
 // V_MarkRect
@@ -352,8 +352,8 @@ public:
 	DWORD			effects;			// [RH] see p_effect.h
 
     // Interaction info, by BLOCKMAP.
-    // Links in blocks (if needed).
-	AActor			*bnext, **bprev;
+    // Entry in thingproxies, which links it into its block (if needed).
+	int				blockproxy;
 	struct subsector_s		*subsector;
 
     // The closest interval over all contacted Sectors.
@@ -418,6 +418,7 @@ public:
 	byte			args[5];		// special arguments
 
 	AActor			*inext, *iprev;	// Links to other mobjs in same bucket
+	AActor			*tnext, *tprev;	// Links to other mobjs of the same type
 
 	// denis - playerids of players to whom this object has been sent
 	// [SL] changed to use a bitfield instead of a vector for O(1) lookups
@@ -448,13 +449,32 @@ public:
 	AActor *FindGoal (int tid, int kind) const;
 	static AActor *FindGoal (const AActor *first, int tid, int kind);
 
+	// Mobjs by type, in the order they were spawned
+	static AActor *FirstOfType (mobjtype_t type) { return TypeHead[type]; }
+	AActor *NextOfType () const { return tnext; }
+	static int CountOfType (mobjtype_t type) { return TypeCount[type]; }
+	static int CountAll () { return ActorCount; }
+
 	int             netid;          // every object has its own netid
 	short			tid;			// thing identifier
 
+	// Where the actor was before the last tic, used only to draw frames
+	// between tics (r_interp.cpp)
+	fixed_t			prevx, prevy, prevz;
+	angle_t			prevangle;
+	int				prevtic;
+
 private:
 	static AActor *TIDHash[128];
 	static inline int TIDHASH (int key) { return key & 127; }
 
+	static AActor *TypeHead[NUMMOBJTYPES];
+	static AActor *TypeTail[NUMMOBJTYPES];
+	static int TypeCount[NUMMOBJTYPES];
+	static int ActorCount;
+	void AddToTypeList ();
+	void RemoveFromTypeList ();
+
 	friend class FActorIterator;
 
 public:
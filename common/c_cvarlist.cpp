@@ -218,6 +218,12 @@ CVAR (sv_unblockplayers, "0", "Allows players to walk through other players",
 // [Spleen] Allow custom WAD directories to be specified in a cvar
 CVAR (waddirs, "", "Allow custom WAD directories to be specified", 
       CVARTYPE_STRING, CVAR_ARCHIVE | CVAR_NOENABLEDISABLE)
+// Save composited wall textures to disk for later loads of the same wads
+CVAR (r_texturecache, "1", "Save composited wall textures so later loads of the same wads are faster", 
+      CVARTYPE_BOOL, CVAR_CLIENTARCHIVE)
+// Save the blockmap and sector line lists built for each map
+CVAR (levelcache, "1", "Save the blockmap and line lists built for each map so later loads of it are faster", 
+      CVARTYPE_BOOL, CVAR_ARCHIVE)
 // [Xyltol 02/27/2012] Hostname retrieval for Scoreboard
 CVAR (sv_hostname,		"Untitled Odamex Server", "Server name to appear on masters, clients and launchers",
 	CVARTYPE_STRING, CVAR_SERVERARCHIVE | CVAR_NOENABLEDISABLE | CVAR_SERVERINFO)
@@ -24,6 +24,7 @@
 
 #include <string.h>
 #include <stdio.h>
+#include <ctype.h>
 
 #include "cmdlib.h"
 #include "c_console.h"
@@ -65,6 +66,82 @@ cvar_t* GetFirstCvar(void)
 	return ad.GetCVars();
 }
 
+// Cvars are also indexed by name, and the ones with a flag that is often
+// looked for are kept in a list for that flag. These are plain arrays so
+// they are ready before any cvar is constructed.
+#define CVAR_HASHSIZE		512
+
+static cvar_t *cvarhash[CVAR_HASHSIZE];
+
+static const DWORD listflags[] = { CVAR_SERVERINFO, CVAR_DEMOSAVE };
+#define NUMCVARLISTS		(sizeof(listflags) / sizeof(listflags[0]))
+
+static cvar_t *cvarlists[NUMCVARLISTS];
+
+#define MAX_CVARSUBSCRIBERS	16
+
+static struct cvarsubscriber_s
+{
+	DWORD filter;
+	void (*func)(cvar_t &);
+} subscribers[MAX_CVARSUBSCRIBERS];
+
+static int numsubscribers;
+
+//
+// C_HashCVarName
+// Case insensitive, like the names are compared.
+//
+static unsigned int C_HashCVarName (const char *name)
+{
+	unsigned int hash = 2166136261u;
+
+	while (*name)
+	{
+		hash ^= (unsigned char)tolower (*name++);
+		hash *= 16777619u;
+	}
+
+	return hash & (CVAR_HASHSIZE - 1);
+}
+
+//
+// C_CVarList
+// Index of the list kept for flag, or -1 if there is none.
+//
+static int C_CVarList (DWORD flag)
+{
+	for (size_t i = 0; i < NUMCVARLISTS; i++)
+		if (listflags[i] == flag)
+			return i;
+
+	return -1;
+}
+
+cvar_t* GetFirstCvar(DWORD flag)
+{
+	int list = C_CVarList (flag);
+	cvar_t *var = list < 0 ? ad.GetCVars() : cvarlists[list];
+
+	// flags can be taken away after a cvar is listed
+	if (var && !(var->m_Flags & flag))
+		var = var->GetNext (flag);
+
+	return var;
+}
+
+cvar_t *cvar_t::GetNext (DWORD flag)
+{
+	int list = C_CVarList (flag);
+	cvar_t *var = this;
+
+	do
+		var = list < 0 ? var->m_Next : var->m_FlagNext[list];
+	while (var && !(var->m_Flags & flag));
+
+	return var;
+}
+
 int cvar_defflags;
 
 cvar_t::cvar_t (const char *var_name, const char *def, const char *help, cvartype_t type, DWORD flags)
@@ -96,12 +173,12 @@ void cvar_t::InitSelf (const char *var_name, const char *def, const char *help,
 	else
 		m_Default = "";
 
+	m_Linked = false;
+
 	if (var_name)
 	{
 		C_AddTabCommand (var_name);
 		m_Name = var_name;
-		m_Next = ad.GetCVars();
-		ad.GetCVars() = this;
 	}
 	else
 		m_Name = "";
@@ -118,22 +195,126 @@ void cvar_t::InitSelf (const char *var_name, const char *def, const char *help,
 		ForceSet (def);
 
 	m_Flags = var_flags | CVAR_ISDEFAULT;
+
+	// the lists for flags need to know the flags first
+	if (var_name)
+	{
+		Link ();
+		Notify ();
+	}
 }
 
 cvar_t::~cvar_t ()
 {
-	if (m_Name.length())
+	if (m_Linked)
 	{
-		cvar_t *var, *dummy = NULL;
+		Notify ();
+		Unlink ();
+	}
+}
+
+//
+// cvar_t::Link
+// Adds the cvar to the front of the list of all cvars, its hash bucket
+// and the lists for any of its flags.
+//
+void cvar_t::Link ()
+{
+	m_Prev = NULL;
+	m_Next = ad.GetCVars();
+	if (m_Next)
+		m_Next->m_Prev = this;
+	ad.GetCVars() = this;
+
+	cvar_t **bucket = &cvarhash[C_HashCVarName (m_Name.c_str())];
 
-		var = FindCVar (m_Name.c_str(), &dummy);
+	m_HashNext = *bucket;
+	*bucket = this;
 
-		if (var == this)
+	for (size_t i = 0; i < NUMCVARLISTS; i++)
+	{
+		if (m_Flags & listflags[i])
 		{
-			if (dummy)
-				dummy->m_Next = m_Next;
-			else
-				ad.GetCVars() = m_Next;
+			m_FlagNext[i] = cvarlists[i];
+			cvarlists[i] = this;
+		}
+		else
+			m_FlagNext[i] = NULL;
+	}
+
+	m_Linked = true;
+}
+
+//
+// cvar_t::Unlink
+//
+void cvar_t::Unlink ()
+{
+	cvar_t **link;
+
+	if (m_Prev)
+		m_Prev->m_Next = m_Next;
+	else
+		ad.GetCVars() = m_Next;
+	if (m_Next)
+		m_Next->m_Prev = m_Prev;
+
+	for (link = &cvarhash[C_HashCVarName (m_Name.c_str())]; *link; link = &(*link)->m_HashNext)
+	{
+		if (*link == this)
+		{
+			*link = m_HashNext;
+			break;
+		}
+	}
+
+	for (size_t i = 0; i < NUMCVARLISTS; i++)
+	{
+		for (link = &cvarlists[i]; *link; link = &(*link)->m_FlagNext[i])
+		{
+			if (*link == this)
+			{
+				*link = m_FlagNext[i];
+				break;
+			}
+		}
+	}
+
+	m_Next = m_Prev = m_HashNext = NULL;
+	m_Linked = false;
+}
+
+//
+// cvar_t::Notify
+// Tells subscribers that this cvar has changed.
+//
+void cvar_t::Notify ()
+{
+	for (int i = 0; i < numsubscribers; i++)
+		if (!subscribers[i].filter || (m_Flags & subscribers[i].filter))
+			subscribers[i].func (*this);
+}
+
+void cvar_t::Subscribe (DWORD filter, void (*func)(cvar_t &))
+{
+	Unsubscribe (func);
+
+	if (numsubscribers == MAX_CVARSUBSCRIBERS)
+		I_Error ("cvar_t::Subscribe: Too many subscribers (%d)", MAX_CVARSUBSCRIBERS);
+
+	subscribers[numsubscribers].filter = filter;
+	subscribers[numsubscribers].func = func;
+	numsubscribers++;
+}
+
+void cvar_t::Unsubscribe (void (*func)(cvar_t &))
+{
+	for (int i = 0; i < numsubscribers; i++)
+	{
+		if (subscribers[i].func == func)
+		{
+			subscribers[i] = subscribers[--numsubscribers];
+			return;
 		}
 	}
 }
@@ -152,6 +333,8 @@ void cvar_t::ForceSet (const char *val)
 	}
 	else
 	{
+		bool changed = m_String != (val ? val : "");
+
 		m_Flags |= CVAR_MODIFIED;
 		if(val)
 			m_String = val;
@@ -159,6 +342,9 @@ void cvar_t::ForceSet (const char *val)
 			m_String = "";
 		m_Value = atof (val);
 
+		if (changed && m_Linked)
+			Notify ();
+
 		if (m_Flags & CVAR_USERINFO)
 			D_UserInfoChanged (this);
 		if (m_Flags & CVAR_SERVERINFO)
@@ -254,12 +440,11 @@ static int STACK_ARGS sortcvars (const void *a, const void *b)
 
 void cvar_t::FilterCompactCVars (TArray<cvar_t *> &cvars, DWORD filter)
 {
-	cvar_t *cvar = ad.GetCVars();
+	cvar_t *cvar = GetFirstCvar (filter);
 	while (cvar)
 	{
-		if (cvar->m_Flags & filter)
-			cvars.Push (cvar);
-		cvar = cvar->m_Next;
+		cvars.Push (cvar);
+		cvar = cvar->GetNext (filter);
 	}
 	if (cvars.Size () > 0)
 	{
@@ -284,15 +469,12 @@ void cvar_t::C_WriteCVars (byte **demo_p, DWORD filter, bool compact)
 	}
 	else
 	{
-		cvar = ad.GetCVars();
+		cvar = GetFirstCvar (filter);
 		while (cvar)
 		{
-			if (cvar->m_Flags & filter)
-			{
-				ptr += sprintf ((char *)ptr, "\\%s\\%s",
-								cvar->name(), cvar->cstring());
-			}
-			cvar = cvar->m_Next;
+			ptr += sprintf ((char *)ptr, "\\%s\\%s",
+							cvar->name(), cvar->cstring());
+			cvar = cvar->GetNext (filter);
 		}
 	}
 
@@ -375,11 +557,11 @@ static int numbackedup = 0;
 void cvar_t::C_BackupCVars (void)
 {
 	struct backup_s *backup = CVarBackups;
-	cvar_t *cvar = ad.GetCVars();
+	cvar_t *cvar = GetFirstCvar (CVAR_DEMOSAVE);
 
 	while (cvar)
 	{
-		if (((cvar->m_Flags & CVAR_DEMOSAVE)) && !(cvar->m_Flags & CVAR_LATCH))
+		if (!(cvar->m_Flags & CVAR_LATCH))
 		{
 			if (backup == &CVarBackups[MAX_DEMOCVARS])
 				I_Error ("C_BackupDemoCVars: Too many cvars to save (%d)", MAX_DEMOCVARS);
@@ -387,7 +569,7 @@ void cvar_t::C_BackupCVars (void)
 			backup->string = cvar->m_String;
 			backup++;
 		}
-		cvar = cvar->m_Next;
+		cvar = cvar->GetNext (CVAR_DEMOSAVE);
 	}
 	numbackedup = backup - CVarBackups;
 }
@@ -412,15 +594,14 @@ cvar_t *cvar_t::FindCVar (const char *var_name, cvar_t **prev)
 	if (var_name == NULL)
 		return NULL;
 
-	var = ad.GetCVars();
-	*prev = NULL;
+	var = cvarhash[C_HashCVarName (var_name)];
 	while (var)
 	{
 		if (StdStringCompare(var->m_Name, var_name, true) == 0)
 			break;
-		*prev = var;
-		var = var->m_Next;
+		var = var->m_HashNext;
 	}
+	*prev = var ? var->m_Prev : NULL;
 	return var;
 }
 
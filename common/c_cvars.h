@@ -123,6 +123,11 @@ public:
 	// Finds a named cvar
 	static cvar_t *FindCVar (const char *var_name, cvar_t **prev);
 
+	// Calls func whenever the value of a cvar with any of the flags in
+	// filter changes, or such a cvar is created or destroyed
+	static void Subscribe (DWORD filter, void (*func)(cvar_t &));
+	static void Unsubscribe (void (*func)(cvar_t &));
+
 	// Called from G_InitNew()
 	static void UnlatchCVars (void);
 
@@ -147,14 +152,21 @@ public:
 	cvar_t &operator = (const char *other) { ForceSet(other); return *this; }
 
 	cvar_t *GetNext() { return m_Next; }
+	cvar_t *GetNext(DWORD flag);
 
 private:
 
 	cvar_t (const cvar_t &var) {}
 
 	void InitSelf (const char *name, const char *def, const char *help, cvartype_t, DWORD flags, void (*callback)(cvar_t &));
+	void Link ();
+	void Unlink ();
+	void Notify ();
 	void (*m_Callback)(cvar_t &);
-	cvar_t *m_Next;
+	cvar_t *m_Next, *m_Prev;
+	cvar_t *m_HashNext;				// next cvar in the same hash bucket
+	cvar_t *m_FlagNext[2];			// next cvar with CVAR_SERVERINFO, CVAR_DEMOSAVE
+	bool m_Linked;
 
     cvartype_t m_Type;
 
@@ -170,11 +182,16 @@ private:
 
  protected:
 
-	cvar_t () : m_Flags(0), m_Name(0), m_String(0), m_Value(0.f) {}
+	cvar_t () : m_Flags(0), m_Linked(false), m_Name(0), m_String(0), m_Value(0.f) {}
 };
 
 cvar_t* GetFirstCvar(void);
 
+// First cvar with flag set, follow with GetNext(flag). CVAR_SERVERINFO and
+// CVAR_DEMOSAVE cvars are kept in lists of their own, so walking them does
+// not visit every cvar.
+cvar_t* GetFirstCvar(DWORD flag);
+
 // Maximum number of cvars that can be saved across a demo. If you need
 // to save more, bump this up.
 #define MAX_DEMOCVARS 32
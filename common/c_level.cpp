@@ -899,6 +899,70 @@ void P_SerializeACSDefereds (FArchive &arc)
 	}
 }
 
+//
+// G_WriteNetDemoSnapshot
+// Archives the entire state of the game for a netdemo snapshot, for the
+// client's netdemos and for the ones the server records for each player.
+// Returns the length of the snapshot, of which at most bufsize bytes are
+// copied into buf.
+//
+size_t G_WriteNetDemoSnapshot (byte *buf, size_t bufsize)
+{
+	G_SnapshotLevel ();
+
+	FLZOMemFile memfile;
+	memfile.Open ();			// open for writing
+
+	FArchive arc (memfile);
+
+	// Save the server cvars
+	byte vars[4096], *vars_p;
+	vars_p = vars;
+
+	cvar_t::C_WriteCVars (&vars_p, CVAR_SERVERINFO);
+	arc.WriteCount (vars_p - vars);
+	arc.Write (vars, vars_p - vars);
+
+	arc << level.mapname;
+	arc << (BYTE)(gamestate == GS_INTERMISSION);
+
+	G_SerializeSnapshots (arc);
+	P_SerializeRNGState (arc);
+	P_SerializeACSDefereds (arc);
+
+	// Save the status of the flags in CTF
+	for (int i = 0; i < NUMFLAGS; i++)
+		arc << CTFdata[i];
+
+	// Save team points
+	for (int i = 0; i < NUMTEAMS; i++)
+		arc << TEAMpoints[i];
+
+	arc << level.time;
+
+	for (int i = 0; i < NUM_WORLDVARS; i++)
+		arc << ACS_WorldVars[i];
+
+	for (int i = 0; i < NUM_GLOBALVARS; i++)
+		arc << ACS_GlobalVars[i];
+
+	byte check = 0x1d;
+	arc << check;          // consistancy marker
+
+	arc.Close ();
+
+	size_t length = memfile.Length ();
+	memfile.WriteToBuffer (buf, bufsize);
+
+	if (level.info->snapshot != NULL)
+	{
+		delete level.info->snapshot;
+		level.info->snapshot = NULL;
+	}
+
+	return length;
+}
+
 static int		startpos;	// [RH] Support for multiple starts per level
 
 void G_DoWorldDone (void)
@@ -26,6 +26,7 @@
 #define __D_NET__
 
 #include "doomdef.h"
+#include "m_fixed.h"
 
 #define BACKUPTICS		12	// number of tics to remember
 
@@ -35,6 +36,12 @@ void NetUpdate (void);
 //? how many ticks to run?
 void TryRunTics (void);
 
+// Restart tic counting after I_GetTime has been swapped
+void D_ResyncTics (void);
+
+// Fraction of the way from the last tic to the next one
+fixed_t D_TicFrac (void);
+
 #endif
 
 
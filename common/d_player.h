@@ -273,6 +273,11 @@ public:
 		int         last_sequence;
 		byte        packetnum;
 
+		// sector change generations for incremental sector updates
+		unsigned int packetsectorgen[256];	// generation covered by a packet
+		unsigned int pendingsectorgen;		// generation covered by netbuf
+		unsigned int sectorgen;				// most recently acknowledged
+
 		int         rate;
 		int         reliable_bps;	// bytes per second
 		int         unreliable_bps;
@@ -281,6 +286,15 @@ public:
 
 		int			lastcmdtic, lastclientcmdtic;
 
+		// adaptive ticcmd buffer
+		QWORD		lastcmdarrival;		// time the most recent ticcmd arrived
+		int			lastcmdarrivaltic;	// client tic of that ticcmd
+		int			cmdjitter;			// smoothed arrival jitter in 1/16 ms
+		int			cmddelay;			// smoothed time queued in 1/16 ms
+		size_t		cmdtarget;			// desired ticcmd queue depth
+		int			cmdstarvations;		// tics with no ticcmd to process
+		int			cmdcatchups;		// tics that processed extra ticcmds
+
 		std::string	digest;			// randomly generated string that the client must use for any hashes it sends back
 		bool        allow_rcon;     // allow remote admin
 		bool		displaydisconnect; // display disconnect message when disconnecting
@@ -309,16 +323,26 @@ public:
 				packetbegin[i] = 0;
 				packetsize[i] = 0;
 				packetseq[i] = 0;
+				packetsectorgen[i] = 0;
 			}
 			sequence = 0;
 			last_sequence = 0;
 			packetnum = 0;
+			pendingsectorgen = 0;
+			sectorgen = 0;
 			rate = 0;
 			reliable_bps = 0;
 			unreliable_bps = 0;
 			last_received = 0;
 			lastcmdtic = 0;
 			lastclientcmdtic = 0;
+			lastcmdarrival = 0;
+			lastcmdarrivaltic = 0;
+			cmdjitter = 0;
+			cmddelay = 0;
+			cmdtarget = 1;
+			cmdstarvations = 0;
+			cmdcatchups = 0;
 
 
 			// GhostlyDeath -- done with the {}
@@ -342,12 +366,21 @@ public:
 			sequence(other.sequence),
 			last_sequence(other.last_sequence),
 			packetnum(other.packetnum),
+			pendingsectorgen(other.pendingsectorgen),
+			sectorgen(other.sectorgen),
 			rate(other.rate),
 			reliable_bps(other.reliable_bps),
 			unreliable_bps(other.unreliable_bps),
 			last_received(other.last_received),
 			lastcmdtic(other.lastcmdtic),
 			lastclientcmdtic(other.lastclientcmdtic),
+			lastcmdarrival(other.lastcmdarrival),
+			lastcmdarrivaltic(other.lastcmdarrivaltic),
+			cmdjitter(other.cmdjitter),
+			cmddelay(other.cmddelay),
+			cmdtarget(other.cmdtarget),
+			cmdstarvations(other.cmdstarvations),
+			cmdcatchups(other.cmdcatchups),
 			digest(other.digest),
 			allow_rcon(false),
 			displaydisconnect(true),
@@ -357,6 +390,7 @@ public:
 				memcpy(packetbegin, other.packetbegin, sizeof(packetbegin));
 				memcpy(packetsize, other.packetsize, sizeof(packetsize));
 				memcpy(packetseq, other.packetseq, sizeof(packetseq));
+				memcpy(packetsectorgen, other.packetsectorgen, sizeof(packetsectorgen));
 		}
 	} client;
 
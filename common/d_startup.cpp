@@ -0,0 +1,479 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id$
+//
+// Copyright (C) 2006-2012 by The Odamex Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Startup stages and the tasks that run beside them on worker threads.
+//
+//	The zone, the script parser and the wad handles are not thread safe,
+//	so every stage that uses them stays on the game thread. Tasks are for
+//	work that doesn't, such as reading lumps into the file cache of the
+//	OS ahead of the stages that parse them.
+//
+//-----------------------------------------------------------------------------
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "doomtype.h"
+#include "c_console.h"
+#include "i_system.h"
+#include "m_argv.h"
+#include "m_swap.h"
+#include "z_zone.h"
+#include "w_wad.h"
+#include "d_startup.h"
+
+#define STARTUP_MAXTHREADS	2		// the tasks are mostly disk bound
+
+//
+// Stages
+//
+
+typedef struct
+{
+	const char	*name;
+	int			depth;
+	QWORD		time;			// microseconds
+} startupstage_t;
+
+static std::vector<startupstage_t> stages;
+static std::vector<size_t> openstages;
+static std::vector<QWORD> openstagestart;
+static QWORD startup_start;
+
+//
+// D_BeginStartupStage
+//
+void D_BeginStartupStage (const char *name)
+{
+	startupstage_t stage;
+	QWORD now = I_UTime ();
+
+	if (stages.empty ())
+		startup_start = now;
+
+	stage.name = name;
+	stage.depth = openstages.size ();
+	stage.time = 0;
+
+	openstages.push_back (stages.size ());
+	openstagestart.push_back (now);
+	stages.push_back (stage);
+}
+
+//
+// D_EndStartupStage
+//
+void D_EndStartupStage (void)
+{
+	if (openstages.empty ())
+		return;
+
+	stages[openstages.back ()].time = I_UTime () - openstagestart.back ();
+
+	openstages.pop_back ();
+	openstagestart.pop_back ();
+}
+
+//
+// Tasks
+//
+
+typedef enum
+{
+	TASK_WAITING,		// for the task it runs after
+	TASK_READY,
+	TASK_RUNNING,
+	TASK_DONE
+} taskstate_t;
+
+typedef struct
+{
+	const char		*name;
+	startupfunc_t	func;
+	void			*data;
+	taskstate_t		state;
+	std::vector<int> next;		// tasks that run after this one
+	QWORD			start;		// microseconds after startup began
+	QWORD			time;
+} startuptask_t;
+
+volatile bool startup_cancel;
+
+// Only touched with tasklock held, since the workers read them too
+static std::vector<startuptask_t> tasks;
+static bool stopping;
+
+static bool workers_started;
+#ifdef _WIN32
+static CRITICAL_SECTION tasklock;
+static HANDLE taskready;			// a semaphore counting ready tasks
+static std::vector<HANDLE> workers;
+#else
+static pthread_mutex_t tasklock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t taskready = PTHREAD_COND_INITIALIZER;
+static std::vector<pthread_t> workers;
+#endif
+
+static void D_LockTasks (void)
+{
+#ifdef _WIN32
+	EnterCriticalSection (&tasklock);
+#else
+	pthread_mutex_lock (&tasklock);
+#endif
+}
+
+static void D_UnlockTasks (void)
+{
+#ifdef _WIN32
+	LeaveCriticalSection (&tasklock);
+#else
+	pthread_mutex_unlock (&tasklock);
+#endif
+}
+
+//
+// D_TaskReady
+// Wakes a worker for a task that has become ready. Called with tasklock
+// held.
+//
+static void D_TaskReady (int task)
+{
+	tasks[task].state = TASK_READY;
+
+#ifdef _WIN32
+	ReleaseSemaphore (taskready, 1, NULL);
+#else
+	pthread_cond_broadcast (&taskready);
+#endif
+}
+
+//
+// D_NextReadyTask
+// The oldest task that is ready, or -1. Called with tasklock held.
+//
+static int D_NextReadyTask (void)
+{
+	for (size_t i = 0; i < tasks.size (); i++)
+		if (tasks[i].state == TASK_READY)
+			return i;
+
+	return -1;
+}
+
+//
+// D_StartupWorker
+//
+#ifdef _WIN32
+static DWORD WINAPI D_StartupWorker (LPVOID)
+#else
+static void *D_StartupWorker (void *)
+#endif
+{
+	D_LockTasks ();
+
+	for (;;)
+	{
+		int task;
+
+#ifdef _WIN32
+		D_UnlockTasks ();
+		WaitForSingleObject (taskready, INFINITE);
+		D_LockTasks ();
+		task = D_NextReadyTask ();
+#else
+		while (!stopping && (task = D_NextReadyTask ()) == -1)
+			pthread_cond_wait (&taskready, &tasklock);
+#endif
+
+		if (stopping)
+			break;
+		if (task == -1)
+			continue;
+
+		startupfunc_t func = tasks[task].func;
+		void *data = tasks[task].data;
+		QWORD start = I_UTime ();
+
+		tasks[task].state = TASK_RUNNING;
+		D_UnlockTasks ();
+
+		func (data);
+
+		QWORD end = I_UTime ();
+
+		D_LockTasks ();
+		tasks[task].state = TASK_DONE;
+		tasks[task].start = start - startup_start;
+		tasks[task].time = end - start;
+
+		for (size_t i = 0; i < tasks[task].next.size (); i++)
+			D_TaskReady (tasks[task].next[i]);
+	}
+
+	D_UnlockTasks ();
+	return 0;
+}
+
+//
+// D_StartWorkers
+//
+static void D_StartWorkers (void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+
+	GetSystemInfo (&info);
+	int cpus = info.dwNumberOfProcessors;
+#else
+	int cpus = (int)sysconf (_SC_NPROCESSORS_ONLN);
+#endif
+	int numthreads = std::max (1, std::min (cpus, STARTUP_MAXTHREADS));
+
+	workers_started = true;
+
+#ifdef _WIN32
+	InitializeCriticalSection (&tasklock);
+	taskready = CreateSemaphore (NULL, 0, 0x7fffffff, NULL);
+
+	for (int i = 0; taskready && i < numthreads; i++)
+	{
+		HANDLE thread = CreateThread (NULL, 0, D_StartupWorker, NULL, 0, NULL);
+
+		if (thread)
+			workers.push_back (thread);
+	}
+#else
+	for (int i = 0; i < numthreads; i++)
+	{
+		pthread_t thread;
+
+		if (pthread_create (&thread, NULL, D_StartupWorker, NULL) == 0)
+			workers.push_back (thread);
+	}
+#endif
+}
+
+//
+// D_AddStartupTask
+//
+int D_AddStartupTask (const char *name, startupfunc_t func, void *data, int after)
+{
+	if (!workers_started)
+		D_StartWorkers ();
+
+	if (workers.empty ())
+	{
+		func (data);
+		return -1;
+	}
+
+	startuptask_t task;
+
+	task.name = name;
+	task.func = func;
+	task.data = data;
+	task.state = TASK_WAITING;
+	task.start = task.time = 0;
+
+	D_LockTasks ();
+
+	int num = tasks.size ();
+	tasks.push_back (task);
+
+	if (after >= 0 && after < num && tasks[after].state != TASK_DONE)
+		tasks[after].next.push_back (num);
+	else
+		D_TaskReady (num);
+
+	D_UnlockTasks ();
+
+	return num;
+}
+
+//
+// D_StopWorkers
+// Lets the running tasks finish. Tasks that haven't started never will.
+//
+static void D_StopWorkers (void)
+{
+	size_t i;
+
+	if (!workers_started)
+		return;
+
+	startup_cancel = true;
+
+	D_LockTasks ();
+	stopping = true;
+#ifdef _WIN32
+	ReleaseSemaphore (taskready, workers.size (), NULL);
+#else
+	pthread_cond_broadcast (&taskready);
+#endif
+	D_UnlockTasks ();
+
+	for (i = 0; i < workers.size (); i++)
+	{
+#ifdef _WIN32
+		WaitForSingleObject (workers[i], INFINITE);
+		CloseHandle (workers[i]);
+#else
+		pthread_join (workers[i], NULL);
+#endif
+	}
+
+#ifdef _WIN32
+	if (taskready)
+		CloseHandle (taskready);
+	DeleteCriticalSection (&tasklock);
+#endif
+
+	workers.clear ();
+	workers_started = false;
+	stopping = false;
+	startup_cancel = false;
+}
+
+//
+// Reading lumps ahead
+//
+
+static std::vector<readaheadspan_t> readahead_scripts;
+static std::vector<readaheadspan_t> readahead_textures;
+
+static void D_ReadAheadTask (void *data)
+{
+	W_ReadAhead (*(std::vector<readaheadspan_t> *)data, &startup_cancel);
+}
+
+//
+// D_ReadAheadStartupLumps
+// The lumps are read in the order the stages after the wads need them,
+// one list after the other so the disk doesn't have to seek between them.
+//
+void D_ReadAheadStartupLumps (void)
+{
+	static const char *scriptlumps[] =
+	{
+		"LANGUAGE", "DEHACKED", "PLAYPAL", "MAPINFO", "MUSINFO",
+		"SNDINFO", "COLORMAP", "SNDCURVE", "SNDSEQ", NULL
+	};
+	std::vector<unsigned> lumps;
+	int lump, last;
+
+	for (int i = 0; scriptlumps[i]; i++)
+	{
+		last = 0;
+		while ((lump = W_FindLump (scriptlumps[i], &last)) != -1)
+			lumps.push_back (lump);
+	}
+
+	readahead_scripts.clear ();
+	W_PlanReadAhead (lumps, readahead_scripts);
+
+	// Every patch in PNAMES is looked at by R_InitTextures
+	lumps.clear ();
+	if ((lump = W_CheckNumForName ("PNAMES")) != -1 && W_LumpLength (lump) >= 4)
+	{
+		const char *names = (const char *)W_CacheLumpNum (lump, PU_CACHE);
+		int numnames = LONG (*(int *)names);
+
+		numnames = std::min (numnames, (int)(W_LumpLength (lump) - 4) / 8);
+		lumps.push_back (lump);
+
+		for (int i = 0; i < numnames; i++)
+		{
+			char name[9];
+
+			strncpy (name, names + 4 + i*8, 8);
+			name[8] = 0;
+
+			if ((lump = W_CheckNumForName (name)) != -1)
+				lumps.push_back (lump);
+		}
+	}
+	if ((lump = W_CheckNumForName ("TEXTURE1")) != -1)
+		lumps.push_back (lump);
+	if ((lump = W_CheckNumForName ("TEXTURE2")) != -1)
+		lumps.push_back (lump);
+
+	readahead_textures.clear ();
+	W_PlanReadAhead (lumps, readahead_textures);
+
+	int scripts = D_AddStartupTask ("read scripts", D_ReadAheadTask, &readahead_scripts);
+	D_AddStartupTask ("read textures", D_ReadAheadTask, &readahead_textures, scripts);
+}
+
+//
+// D_PrintStartupProfile
+//
+static void D_PrintStartupProfile (void)
+{
+	size_t i;
+
+	Printf (PRINT_HIGH, "Startup profile:\n");
+
+	for (i = 0; i < stages.size (); i++)
+		Printf (PRINT_HIGH, "%9.1f ms  %*s%s\n", stages[i].time / 1000.0,
+				stages[i].depth * 2, "", stages[i].name);
+
+	if (tasks.empty ())
+		return;
+
+	Printf (PRINT_HIGH, "Startup tasks:\n");
+
+	for (i = 0; i < tasks.size (); i++)
+	{
+		if (tasks[i].state == TASK_DONE)
+			Printf (PRINT_HIGH, "%9.1f ms  %s, from %.1f ms\n", tasks[i].time / 1000.0,
+					tasks[i].name, tasks[i].start / 1000.0);
+		else
+			Printf (PRINT_HIGH, "  skipped    %s\n", tasks[i].name);
+	}
+}
+
+//
+// D_FinishStartup
+//
+void D_FinishStartup (void)
+{
+	while (!openstages.empty ())
+		D_EndStartupStage ();
+
+	D_StopWorkers ();
+
+	if (Args.CheckParm ("-profilestartup"))
+		D_PrintStartupProfile ();
+
+	stages.clear ();
+	tasks.clear ();
+	readahead_scripts.clear ();
+	readahead_textures.clear ();
+}
+
+VERSION_CONTROL (d_startup_cpp, "$Id$")
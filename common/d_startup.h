@@ -0,0 +1,49 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id$
+//
+// Copyright (C) 2006-2012 by The Odamex Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Startup stages and the tasks that run beside them on worker threads.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __D_STARTUP_H__
+#define __D_STARTUP_H__
+
+typedef void (*startupfunc_t) (void *data);
+
+// Stages of startup on the game thread. They nest, and are timed so
+// -profilestartup can print them as a tree.
+void D_BeginStartupStage (const char *name);
+void D_EndStartupStage (void);
+
+// Runs func on a worker thread once the task after has finished, or
+// right away if after is -1. Returns the new task, or -1 if it was run
+// on the game thread because no worker could be started.
+int D_AddStartupTask (const char *name, startupfunc_t func, void *data, int after = -1);
+
+// Set when the tasks that haven't finished are no longer needed
+extern volatile bool startup_cancel;
+
+// Starts reading the lumps that the rest of startup reads, once the
+// lump directory is known
+void D_ReadAheadStartupLumps (void);
+
+// Stops the tasks and waits for the workers, then prints the profile if
+// -profilestartup was given
+void D_FinishStartup (void);
+
+#endif // __D_STARTUP_H__
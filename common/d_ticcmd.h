@@ -37,6 +37,7 @@ struct ticcmd_t
 	usercmd_t	ucmd;
 	int			tic;	// the client's tic when this cmd was sent
 	byte		svgametic;	// from the clc_svgametic sent along with this cmd
+	QWORD		arrivaltime;	// server time in ms when this cmd was received
 /*
 	char		forwardmove;	// *2048 for move
 	char		sidemove;		// *2048 for move
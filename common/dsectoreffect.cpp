@@ -131,6 +131,9 @@ DMover::EResult DMover::MovePlane (fixed_t speed, fixed_t dest, bool crush,
 	bool	 	flag;
 	fixed_t 	lastpos;
 
+	// let the server know this sector needs to be sent to clients
+	P_MarkSectorChanged(m_Sector);
+
 	switch (floorOrCeiling)
 	{
 	case 0:
@@ -215,6 +215,7 @@ void G_ClearSnapshots (void);
 void G_SnapshotLevel (void);
 void G_UnSnapshotLevel (bool keepPlayers);
 void G_SerializeSnapshots (FArchive &arc);
+size_t G_WriteNetDemoSnapshot (byte *buf, size_t bufsize);
 
 void cmd_maplist(const std::vector<std::string> &arguments, std::vector<std::string> &response);
 
@@ -978,7 +978,9 @@ void InitNetMessageFormats()
 	MSG(svc_inttimeleft,		"x"),
 	MSG(svc_mobjtranslation,	"x"),
 	MSG(svc_fullupdatedone,		"x"),
-	MSG(svc_railtrail,			"x")
+	MSG(svc_railtrail,			"x"),
+	MSG(svc_sectorrange,		"x"),
+	MSG(svc_levelstate,			"x")
    };
 
    size_t i;
@@ -120,6 +120,8 @@ enum svc_t
 	svc_fullupdatedone,		// [SL] Inform client the full update is over
 	svc_railtrail,			// [SL] Draw railgun trail and play sound
 	svc_readystate,			// [AM] Broadcast ready state to client
+	svc_sectorrange,		// [short:first] [byte:count] count * [short] [short] [short] [short]
+	svc_levelstate,			// [long:id] [long:size] [long:offset] [short:len] [byte[]:data]
 
 	// for co-op
 	svc_mobjstate = 70,
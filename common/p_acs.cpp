@@ -38,6 +38,10 @@
 #include "s_sndseq.h"
 #include "i_system.h"
 #include "vectors.h"
+#include "m_argv.h"
+
+#include <vector>
+#include <algorithm>
 
 #define CLAMPCOLOR(c)	(EColorRange)((unsigned)(c)>CR_UNTRANSLATED?CR_UNTRANSLATED:(c))
 #define LANGREGIONMASK	MAKE_ID(0,0,0xff,0xff)
@@ -52,6 +56,14 @@ struct CallReturn
 
 static int Stack[STACK_SIZE];
 
+// CPU time taken by each script since the map was loaded, for scriptstat
+static struct scriptprofile_s
+{
+	QWORD time;				// in microseconds
+	DWORD runs;
+	QWORD instructions;
+} ScriptProfile[1000];
+
 static bool P_GetScriptGoing (AActor *who, line_t *where, int num, int *code,
 	int lineSide, int arg0, int arg1, int arg2, int always, bool delay);
 
@@ -77,6 +89,12 @@ FBehavior::FBehavior (BYTE *object, int len)
 	Functions = NULL;
 	Arrays = NULL;
 	Chunks = NULL;
+	Code = NULL;
+	CodeSize = 0;
+	CodeIndex = NULL;
+	CodeOffset = NULL;
+
+	memset (ScriptProfile, 0, sizeof(ScriptProfile));
 
 	if (object[0] != 'A' || object[1] != 'C' || object[2] != 'S')
 	{
@@ -231,6 +249,10 @@ FBehavior::FBehavior (BYTE *object, int len)
 		}
 	}
 
+	// -acsreference runs scripts straight from the lump
+	if (!Args.CheckParm ("-acsreference"))
+		Decode ();
+
 	DPrintf ("Loaded %d scripts, %d Functions\n", NumScripts, NumFunctions);
 }
 
@@ -250,6 +272,10 @@ FBehavior::~FBehavior ()
 		delete[] Arrays;
 		Arrays = NULL;
 	}
+
+	delete[] Code;
+	delete[] CodeIndex;
+	delete[] CodeOffset;
 }
 
 int STACK_ARGS FBehavior::SortScripts (const void *a, const void *b)
@@ -301,6 +327,350 @@ void FBehavior::SetArrayVal (int arraynum, int index, int value)
 	array->Elements[index] = value;
 }
 
+//---- Decoding scripts ----//
+
+// Instructions that are only found in decoded scripts. The last three
+// each stand for a sequence of p-codes that scripts run a lot.
+enum
+{
+	PCDX_UNKNOWN = DLevelScript::PCODE_COMMAND_COUNT,	// p-code number
+	PCDX_SETSCRIPTVAR,		// var, value: PUSHNUMBER, ASSIGNSCRIPTVAR
+	PCDX_PUSHSCRIPTVARS,	// var, var: PUSHSCRIPTVAR, PUSHSCRIPTVAR
+	PCDX_IFSCRIPTVARCMP,	// var, value, compare, target: PUSHSCRIPTVAR,
+							// PUSHNUMBER, EQ..GE, IFNOTGOTO
+
+	NUM_DECODED_PCODES
+};
+
+// Operands of each p-code:
+//	b - a byte in little-enhanced scripts and a word in others
+//	w - a word, byte swapped
+//	r - a word as it is
+//	B - a byte
+//	j - a jump target
+//	n - a byte count followed by that many bytes
+//	? - not implemented, the script ends there
+static const char *const pcodeoperands[DLevelScript::PCODE_COMMAND_COUNT] =
+{
+/*  0*/	"", "", "", "w", "b", "b", "b", "b", "b", "br",
+/* 10*/	"brr", "brrr", "brrrr", "brrrrr", "", "", "", "", "", "",
+/* 20*/	"", "", "", "", "", "b", "b", "b", "b", "b",
+/* 30*/	"b", "b", "b", "b", "b", "b", "b", "b", "b", "b",
+/* 40*/	"b", "b", "b", "b", "b", "b", "b", "b", "b", "b",
+/* 50*/	"b", "b", "j", "j", "", "", "w", "", "rr", "",
+/* 60*/	"rr", "", "w", "", "w", "", "rr", "", "rr", "",
+/* 70*/	"", "", "", "", "", "", "", "", "", "j",
+/* 80*/	"", "", "w", "", "wj", "", "", "", "", "",
+/* 90*/	"", "", "", "", "", "", "", "", "", "",
+/*100*/	"", "", "", "", "", "?", "?", "?", "?", "?",
+/*110*/	"?", "?", "?", "?", "?", "?", "?", "?", "?", "?",
+/*120*/	"", "", "", "?", "?", "?", "?", "?", "?", "?",
+/*130*/	"?", "", "", "?", "?", "", "", "", "", "r",
+/*140*/	"", "r", "?", "?", "?", "?", "?", "?", "?", "?",
+/*150*/	"?", "?", "?", "", "rrr", "", "rrr", "", "", "?",
+/*160*/	"?", "?", "?", "?", "?", "?", "?", "B", "BB", "BBB",
+/*170*/	"BBBB", "BBBBB", "BBBBBB", "B", "BB", "n", "BB", "BBB", "BBBB", "BBBBB",
+/*180*/	"", "b", "b", "b", "b", "b", "b", "b", "b", "b",
+/*190*/	"", "", "", "?", "", "", "", "", "", "?",
+/*200*/	"?", "?", "?", "b", "b", "", "", "b", "b", "b",
+/*210*/	"b", "b", "b", "b", "b", "b", "", "", "?", "?",
+/*220*/	"", "", "", "?", "?"
+};
+
+struct FBehavior::PCode
+{
+	int pcd;
+	int length;				// in bytes
+	std::vector<int> operands;
+	int target;				// lump offset of a jump target, or -1
+	bool next;				// whether the next p-code can run after it
+};
+
+//
+// FBehavior::ReadPCode
+// Reads the p-code at lump offset ofs, false if it is cut off by the end.
+//
+bool FBehavior::ReadPCode (int ofs, PCode &pcode) const
+{
+	const int start = ofs;
+	int word;
+
+	pcode.operands.clear ();
+	pcode.target = -1;
+	pcode.next = true;
+
+	if (Format == ACS_LittleEnhanced)
+	{
+		if (ofs + 1 > DataSize)
+			return false;
+		pcode.pcd = Data[ofs++];
+	}
+	else
+	{
+		if (ofs + 4 > DataSize)
+			return false;
+		memcpy (&word, Data + ofs, 4);
+		pcode.pcd = LONG(word);
+		ofs += 4;
+	}
+
+	if ((unsigned)pcode.pcd >= DLevelScript::PCODE_COMMAND_COUNT)
+	{
+		pcode.operands.push_back (pcode.pcd);
+		pcode.pcd = PCDX_UNKNOWN;
+		pcode.next = false;
+		pcode.length = ofs - start;
+		return true;
+	}
+
+	for (const char *op = pcodeoperands[pcode.pcd]; *op; op++)
+	{
+		switch (*op)
+		{
+		case 'b':
+			if (Format == ACS_LittleEnhanced)
+			{
+				if (ofs + 1 > DataSize)
+					return false;
+				pcode.operands.push_back (Data[ofs++]);
+				break;
+			}
+			// fall through
+		case 'w':
+		case 'r':
+		case 'j':
+			if (ofs + 4 > DataSize)
+				return false;
+			memcpy (&word, Data + ofs, 4);
+			ofs += 4;
+			if (*op == 'j')
+				pcode.target = word;
+			pcode.operands.push_back (*op == 'r' || *op == 'j' ? word : LONG(word));
+			break;
+
+		case 'n':
+			if (ofs + 1 > DataSize || ofs + 1 + Data[ofs] > DataSize)
+				return false;
+			pcode.operands.push_back (Data[ofs]);
+			for (int i = 1; i <= Data[ofs]; i++)
+				pcode.operands.push_back (Data[ofs + i]);
+			ofs += 1 + Data[ofs];
+			break;
+
+		case 'B':
+			if (ofs + 1 > DataSize)
+				return false;
+			pcode.operands.push_back (Data[ofs++]);
+			break;
+
+		case '?':
+			pcode.next = false;
+			break;
+		}
+	}
+
+	switch (pcode.pcd)
+	{
+	case DLevelScript::PCD_TERMINATE:
+	case DLevelScript::PCD_GOTO:
+	case DLevelScript::PCD_RESTART:
+	case DLevelScript::PCD_RETURNVOID:
+	case DLevelScript::PCD_RETURNVAL:
+		pcode.next = false;
+		break;
+	}
+
+	pcode.length = ofs - start;
+	return true;
+}
+
+//
+// FBehavior::Decode
+// Translates every p-code that can be reached from a script or function
+// into an array of ints with all operands read and jump targets turned
+// into indices in that array, so nothing needs decoding while scripts
+// run. If anything doesn't make sense, scripts are run from the lump.
+//
+void FBehavior::Decode ()
+{
+	std::vector<int> length (DataSize, 0);		// p-code starting at an offset
+	std::vector<bool> target (DataSize, false);	// offset is jumped to
+	std::vector<int> pending;
+	std::vector<int> code;
+	std::vector<int> codeofs;
+	std::vector<int> jumps;						// operands to turn into indices
+	PCode pcode;
+	int i, ofs;
+
+	if (Format == ACS_Unknown || DataSize <= 0)
+		return;
+
+	for (i = 0; i < NumScripts; i++)
+		pending.push_back (((ScriptPtr *)Scripts)[i].Address);
+	for (i = 0; i < NumFunctions; i++)
+		pending.push_back (((ScriptFunction *)Functions)[i].Address);
+	for (i = 0; i < (int)pending.size (); i++)
+		target[std::min<unsigned> (pending[i], DataSize - 1)] = true;
+
+	// Find where every p-code starts
+	while (!pending.empty ())
+	{
+		ofs = pending.back ();
+		pending.pop_back ();
+
+		if ((unsigned)ofs >= (unsigned)DataSize)
+			return;
+		if (length[ofs])
+			continue;
+		if (!ReadPCode (ofs, pcode))
+			return;
+
+		length[ofs] = pcode.length;
+
+		if (pcode.target != -1)
+		{
+			if ((unsigned)pcode.target >= (unsigned)DataSize)
+				return;
+			target[pcode.target] = true;
+			pending.push_back (pcode.target);
+		}
+		if (pcode.next)
+			pending.push_back (ofs + pcode.length);
+	}
+
+	// They can't overlap
+	for (ofs = 0, i = 0; ofs < DataSize; ofs++)
+	{
+		if (!length[ofs])
+			continue;
+		if (ofs < i)
+			return;
+		i = ofs + length[ofs];
+	}
+
+	std::vector<int> index (DataSize, -1);
+
+	for (ofs = 0; ofs < DataSize; ofs++)
+	{
+		if (!length[ofs])
+			continue;
+
+		ReadPCode (ofs, pcode);
+
+		index[ofs] = code.size ();
+		codeofs.resize (code.size (), -1);
+		codeofs.push_back (ofs);
+
+		// Look for sequences that can be run as one, none of which may be
+		// jumped into past their first p-code
+		int seq[4], n;
+		PCode more;
+
+		seq[0] = pcode.pcd;
+		for (n = 1, i = ofs + pcode.length; n < 4; n++)
+		{
+			if (i >= DataSize || !length[i] || target[i] || !ReadPCode (i, more))
+				break;
+			seq[n] = more.pcd;
+			i += more.length;
+		}
+
+		if (n >= 2 && (seq[0] == DLevelScript::PCD_PUSHNUMBER || seq[0] == DLevelScript::PCD_PUSHBYTE)
+			&& seq[1] == DLevelScript::PCD_ASSIGNSCRIPTVAR)
+		{
+			int value = pcode.operands[0];
+
+			ReadPCode (ofs + pcode.length, more);
+			code.push_back (PCDX_SETSCRIPTVAR);
+			code.push_back (more.operands[0]);
+			code.push_back (value);
+			ofs += pcode.length + more.length - 1;
+			continue;
+		}
+
+		if (n >= 4 && seq[0] == DLevelScript::PCD_PUSHSCRIPTVAR
+			&& (seq[1] == DLevelScript::PCD_PUSHNUMBER || seq[1] == DLevelScript::PCD_PUSHBYTE)
+			&& seq[2] >= DLevelScript::PCD_EQ && seq[2] <= DLevelScript::PCD_GE
+			&& seq[3] == DLevelScript::PCD_IFNOTGOTO)
+		{
+			int var = pcode.operands[0];
+			int end = ofs + pcode.length;
+
+			ReadPCode (end, more);
+			code.push_back (PCDX_IFSCRIPTVARCMP);
+			code.push_back (var);
+			code.push_back (more.operands[0]);
+			code.push_back (seq[2]);
+			end += more.length;
+			ReadPCode (end, more);
+			end += more.length;
+			ReadPCode (end, more);
+			jumps.push_back (code.size ());
+			code.push_back (more.target);
+			ofs = end + more.length - 1;
+			continue;
+		}
+
+		if (n >= 2 && seq[0] == DLevelScript::PCD_PUSHSCRIPTVAR
+			&& seq[1] == DLevelScript::PCD_PUSHSCRIPTVAR)
+		{
+			int var = pcode.operands[0];
+
+			ReadPCode (ofs + pcode.length, more);
+			code.push_back (PCDX_PUSHSCRIPTVARS);
+			code.push_back (var);
+			code.push_back (more.operands[0]);
+			ofs += pcode.length + more.length - 1;
+			continue;
+		}
+
+		code.push_back (pcode.pcd);
+		for (i = 0; i < (int)pcode.operands.size (); i++)
+		{
+			if (pcode.pcd != PCDX_UNKNOWN && pcodeoperands[pcode.pcd][i] == 'j')
+				jumps.push_back (code.size ());
+			code.push_back (pcode.operands[i]);
+		}
+	}
+
+	for (i = 0; i < (int)jumps.size (); i++)
+	{
+		// targets were checked to be p-codes that aren't part of a sequence
+		code[jumps[i]] = index[code[jumps[i]]];
+	}
+
+	CodeSize = code.size ();
+	Code = new int[CodeSize];
+	CodeIndex = new int[DataSize];
+	CodeOffset = new int[CodeSize];
+	std::copy (code.begin (), code.end (), Code);
+	std::copy (index.begin (), index.end (), CodeIndex);
+	codeofs.resize (CodeSize, -1);
+	std::copy (codeofs.begin (), codeofs.end (), CodeOffset);
+
+	DPrintf ("Decoded %d bytes of p-code to %d\n", DataSize, CodeSize * 4);
+}
+
+int *FBehavior::DecodedPC (int *pc) const
+{
+	unsigned ofs = (BYTE *)pc - Data;
+
+	if (Code == NULL || pc == NULL || ofs >= (unsigned)DataSize || CodeIndex[ofs] < 0)
+		return NULL;
+
+	return Code + CodeIndex[ofs];
+}
+
+int *FBehavior::UndecodedPC (int *pc) const
+{
+	unsigned index = pc - Code;
+
+	if (Code == NULL || pc == NULL || index >= (unsigned)CodeSize || CodeOffset[index] < 0)
+		return NULL;
+
+	return (int *)(Data + CodeOffset[index]);
+}
+
 BYTE *FBehavior::FindChunk (DWORD id) const
 {
 	BYTE *chunk = Chunks;
@@ -514,8 +884,29 @@ void FBehavior::StartTypedScripts (WORD type, AActor *activator) const
 
 
 
-#define NEXTWORD	(LONG(*pc++))
-#define NEXTBYTE	(fmt==ACS_LittleEnhanced?getbyte(pc):NEXTWORD)
+// Operands are read through these so that the interpreter can run both
+// scripts in the lump and decoded ones, where every operand is an int and
+// jump targets are indices in the decoded code.
+#define NEXTWORD		(DECODED ? *pc++ : LONG(*pc++))
+#define NEXTBYTE		(DECODED ? *pc++ : fmt==ACS_LittleEnhanced?getbyte(pc):LONG(*pc++))
+#define PCBYTE(n)		(DECODED ? pc[n] : ((BYTE *)pc)[n])
+#define SKIPBYTES(n)	(pc = DECODED ? pc + (n) : (int *)((BYTE *)pc + (n)))
+#define GOTOOPERAND		(pc = DECODED ? code + *pc : level.behavior->Ofs2PC (*pc))
+#define SAVEPC(p)		(DECODED ? (int)((p) - code) : (int)level.behavior->PC2Ofs (p))
+#define RESTOREPC(ofs)	(DECODED ? code + (ofs) : level.behavior->Ofs2PC (ofs))
+#define FUNCPC(ofs)		(DECODED ? level.behavior->DecodedPC (level.behavior->Ofs2PC (ofs)) : level.behavior->Ofs2PC (ofs))
+#define SCRIPTPC(num)	(DECODED ? level.behavior->DecodedPC (level.behavior->FindScript (num)) : level.behavior->FindScript (num))
+
+// GCC can jump straight to each p-code through a table of labels
+#ifdef __GNUC__
+#define ACS_THREADED
+#define PCD_CASE(op)		case op: pcd_##op
+#define PCD_CASE_DEFAULT	default: pcd_default
+#else
+#define PCD_CASE(op)		case op
+#define PCD_CASE_DEFAULT	default
+#endif
+
 #define STACK(a)	(Stack[sp - (a)])
 #define PushToStack(a)	(Stack[sp++] = (a))
 
@@ -963,7 +1354,7 @@ int DLevelScript::ThingCount (int type, int tid)
 	AActor *mobj = NULL;
 	int count = 0;
 
-	if (type >= NumSpawnableThings)
+	if (type < 0 || type >= NumSpawnableThings)
 	{
 		return 0;
 	}
@@ -984,21 +1375,17 @@ int DLevelScript::ThingCount (int type, int tid)
 			mobj = mobj->FindByTID (tid);
 		}
 	}
+	else if (type == 0)
+	{
+		count = AActor::CountAll ();
+	}
 	else
 	{
-		AActor *actor;
-		TThinkerIterator<AActor> iterator;
-
-		while ( (actor = iterator.Next ()) )
+		// only mobjs of this type need to be looked at
+		for (mobj = AActor::FirstOfType ((mobjtype_t)type); mobj; mobj = mobj->NextOfType ())
 		{
-			if (type == 0)
-			{
-				count++;
-			}
-			else if (actor->type == type && actor->health > 0)
-			{
+			if (mobj->health > 0)
 				count++;
-			}
 		}
 	}
 	return count;
@@ -1156,77 +1543,92 @@ inline int getbyte (int *&pc)
 	return res;
 }
 
-void DLevelScript::RunScript ()
+//
+// DLevelScript::Interpret
+// Runs the script until it stops running. The same code runs scripts
+// straight from the lump and decoded ones, which is what DECODED picks;
+// the lump interpreter is kept as the reference for the decoded one.
+// Returns the number of p-codes run.
+//
+template <bool DECODED> int DLevelScript::Interpret (DACSThinker *controller)
 {
-	DACSThinker *controller = DACSThinker::ActiveThinker;
-	if (!controller)
-		return;
-
-    TeleportSide = lineSide;
-    int *locals = localvars;
-    ScriptFunction *activeFunction = NULL;
-
-	switch (state)
-	{
-	case SCRIPT_Delayed:
-		// Decrement the delay counter and enter state running
-		// if it hits 0
-		if (--statedata == 0)
-			state = SCRIPT_Running;
-		break;
-
-	case SCRIPT_TagWait:
-		// Wait for tagged sector(s) to go inactive, then enter
-		// state running
-	{
-		int secnum = -1;
-
-		while ((secnum = P_FindSectorFromTag (statedata, secnum)) >= 0)
-			if (sectors[secnum].floordata || sectors[secnum].ceilingdata)
-				return;
-
-		// If we got here, none of the tagged sectors were busy
-		state = SCRIPT_Running;
-	}
-	break;
-
-	case SCRIPT_PolyWait:
-		// Wait for polyobj(s) to stop moving, then enter state running
-		if (!PO_Busy (statedata))
-		{
-			state = SCRIPT_Running;
-		}
-		break;
-
-	case SCRIPT_ScriptWaitPre:
-		// Wait for a script to start running, then enter state scriptwait
-		if (controller->RunningScripts[statedata])
-			state = SCRIPT_ScriptWait;
-		break;
-
-	case SCRIPT_ScriptWait:
-		// Wait for a script to stop running, then enter state running
-		if (controller->RunningScripts[statedata])
-			return;
-
-		state = SCRIPT_Running;
-		PutFirst ();
-		break;
-
-	default:
-		break;
-	}
-
 	int *pc = this->pc;
 	int sp = this->sp;
+	int *code = level.behavior->GetCode();
 	const ACSFormat fmt = level.behavior->GetFormat();
 	int runaway = 0;	// used to prevent infinite loops
+	int *locals = localvars;
+	ScriptFunction *activeFunction = NULL;
 	int pcd;
 	char work[4096], *workwhere = work;
 	const char *lookup;
 	int optstart = -1;
 	int temp;
 
+#ifdef ACS_THREADED
+	static void *const dispatch[NUM_DECODED_PCODES] =
+	{
+		/*  0*/ &&pcd_PCD_NOP, &&pcd_PCD_TERMINATE, &&pcd_PCD_SUSPEND, &&pcd_PCD_PUSHNUMBER,
+		/*  4*/ &&pcd_PCD_LSPEC1, &&pcd_PCD_LSPEC2, &&pcd_PCD_LSPEC3, &&pcd_PCD_LSPEC4,
+		/*  8*/ &&pcd_PCD_LSPEC5, &&pcd_PCD_LSPEC1DIRECT, &&pcd_PCD_LSPEC2DIRECT, &&pcd_PCD_LSPEC3DIRECT,
+		/* 12*/ &&pcd_PCD_LSPEC4DIRECT, &&pcd_PCD_LSPEC5DIRECT, &&pcd_PCD_ADD, &&pcd_PCD_SUBTRACT,
+		/* 16*/ &&pcd_PCD_MULTIPLY, &&pcd_PCD_DIVIDE, &&pcd_PCD_MODULUS, &&pcd_PCD_EQ,
+		/* 20*/ &&pcd_PCD_NE, &&pcd_PCD_LT, &&pcd_PCD_GT, &&pcd_PCD_LE,
+		/* 24*/ &&pcd_PCD_GE, &&pcd_PCD_ASSIGNSCRIPTVAR, &&pcd_PCD_ASSIGNMAPVAR, &&pcd_PCD_ASSIGNWORLDVAR,
+		/* 28*/ &&pcd_PCD_PUSHSCRIPTVAR, &&pcd_PCD_PUSHMAPVAR, &&pcd_PCD_PUSHWORLDVAR, &&pcd_PCD_ADDSCRIPTVAR,
+		/* 32*/ &&pcd_PCD_ADDMAPVAR, &&pcd_PCD_ADDWORLDVAR, &&pcd_PCD_SUBSCRIPTVAR, &&pcd_PCD_SUBMAPVAR,
+		/* 36*/ &&pcd_PCD_SUBWORLDVAR, &&pcd_PCD_MULSCRIPTVAR, &&pcd_PCD_MULMAPVAR, &&pcd_PCD_MULWORLDVAR,
+		/* 40*/ &&pcd_PCD_DIVSCRIPTVAR, &&pcd_PCD_DIVMAPVAR, &&pcd_PCD_DIVWORLDVAR, &&pcd_PCD_MODSCRIPTVAR,
+		/* 44*/ &&pcd_PCD_MODMAPVAR, &&pcd_PCD_MODWORLDVAR, &&pcd_PCD_INCSCRIPTVAR, &&pcd_PCD_INCMAPVAR,
+		/* 48*/ &&pcd_PCD_INCWORLDVAR, &&pcd_PCD_DECSCRIPTVAR, &&pcd_PCD_DECMAPVAR, &&pcd_PCD_DECWORLDVAR,
+		/* 52*/ &&pcd_PCD_GOTO, &&pcd_PCD_IFGOTO, &&pcd_PCD_DROP, &&pcd_PCD_DELAY,
+		/* 56*/ &&pcd_PCD_DELAYDIRECT, &&pcd_PCD_RANDOM, &&pcd_PCD_RANDOMDIRECT, &&pcd_PCD_THINGCOUNT,
+		/* 60*/ &&pcd_PCD_THINGCOUNTDIRECT, &&pcd_PCD_TAGWAIT, &&pcd_PCD_TAGWAITDIRECT, &&pcd_PCD_POLYWAIT,
+		/* 64*/ &&pcd_PCD_POLYWAITDIRECT, &&pcd_PCD_CHANGEFLOOR, &&pcd_PCD_CHANGEFLOORDIRECT, &&pcd_PCD_CHANGECEILING,
+		/* 68*/ &&pcd_PCD_CHANGECEILINGDIRECT, &&pcd_PCD_RESTART, &&pcd_PCD_ANDLOGICAL, &&pcd_PCD_ORLOGICAL,
+		/* 72*/ &&pcd_PCD_ANDBITWISE, &&pcd_PCD_ORBITWISE, &&pcd_PCD_EORBITWISE, &&pcd_PCD_NEGATELOGICAL,
+		/* 76*/ &&pcd_PCD_LSHIFT, &&pcd_PCD_RSHIFT, &&pcd_PCD_UNARYMINUS, &&pcd_PCD_IFNOTGOTO,
+		/* 80*/ &&pcd_PCD_LINESIDE, &&pcd_PCD_SCRIPTWAIT, &&pcd_PCD_SCRIPTWAITDIRECT, &&pcd_PCD_CLEARLINESPECIAL,
+		/* 84*/ &&pcd_PCD_CASEGOTO, &&pcd_PCD_BEGINPRINT, &&pcd_PCD_ENDPRINT, &&pcd_PCD_PRINTSTRING,
+		/* 88*/ &&pcd_PCD_PRINTNUMBER, &&pcd_PCD_PRINTCHARACTER, &&pcd_PCD_PLAYERCOUNT, &&pcd_PCD_GAMETYPE,
+		/* 92*/ &&pcd_PCD_GAMESKILL, &&pcd_PCD_TIMER, &&pcd_PCD_SECTORSOUND, &&pcd_PCD_AMBIENTSOUND,
+		/* 96*/ &&pcd_PCD_SOUNDSEQUENCE, &&pcd_PCD_SETLINETEXTURE, &&pcd_PCD_SETLINEBLOCKING, &&pcd_PCD_SETLINESPECIAL,
+		/*100*/ &&pcd_PCD_THINGSOUND, &&pcd_PCD_ENDPRINTBOLD, &&pcd_PCD_ACTIVATORSOUND, &&pcd_PCD_LOCALAMBIENTSOUND,
+		/*104*/ &&pcd_PCD_SETLINEMONSTERBLOCKING, &&pcd_default, &&pcd_default, &&pcd_default,
+		/*108*/ &&pcd_default, &&pcd_default, &&pcd_default, &&pcd_default,
+		/*112*/ &&pcd_default, &&pcd_default, &&pcd_default, &&pcd_default,
+		/*116*/ &&pcd_default, &&pcd_default, &&pcd_default, &&pcd_default,
+		/*120*/ &&pcd_PCD_PLAYERHEALTH, &&pcd_PCD_PLAYERARMORPOINTS, &&pcd_PCD_PLAYERFRAGS, &&pcd_default,
+		/*124*/ &&pcd_default, &&pcd_default, &&pcd_default, &&pcd_default,
+		/*128*/ &&pcd_default, &&pcd_default, &&pcd_default, &&pcd_PCD_PRINTNAME,
+		/*132*/ &&pcd_PCD_MUSICCHANGE, &&pcd_default, &&pcd_default, &&pcd_PCD_SINGLEPLAYER,
+		/*136*/ &&pcd_PCD_FIXEDMUL, &&pcd_PCD_FIXEDDIV, &&pcd_PCD_SETGRAVITY, &&pcd_PCD_SETGRAVITYDIRECT,
+		/*140*/ &&pcd_PCD_SETAIRCONTROL, &&pcd_PCD_SETAIRCONTROLDIRECT, &&pcd_default, &&pcd_default,
+		/*144*/ &&pcd_default, &&pcd_default, &&pcd_default, &&pcd_default,
+		/*148*/ &&pcd_default, &&pcd_default, &&pcd_default, &&pcd_default,
+		/*152*/ &&pcd_default, &&pcd_PCD_SETMUSIC, &&pcd_PCD_SETMUSICDIRECT, &&pcd_PCD_LOCALSETMUSIC,
+		/*156*/ &&pcd_PCD_LOCALSETMUSICDIRECT, &&pcd_PCD_PRINTFIXED, &&pcd_PCD_PRINTLOCALIZED, &&pcd_default,
+		/*160*/ &&pcd_default, &&pcd_default, &&pcd_default, &&pcd_default,
+		/*164*/ &&pcd_default, &&pcd_default, &&pcd_default, &&pcd_PCD_PUSHBYTE,
+		/*168*/ &&pcd_PCD_LSPEC1DIRECTB, &&pcd_PCD_LSPEC2DIRECTB, &&pcd_PCD_LSPEC3DIRECTB, &&pcd_PCD_LSPEC4DIRECTB,
+		/*172*/ &&pcd_PCD_LSPEC5DIRECTB, &&pcd_PCD_DELAYDIRECTB, &&pcd_PCD_RANDOMDIRECTB, &&pcd_PCD_PUSHBYTES,
+		/*176*/ &&pcd_PCD_PUSH2BYTES, &&pcd_PCD_PUSH3BYTES, &&pcd_PCD_PUSH4BYTES, &&pcd_PCD_PUSH5BYTES,
+		/*180*/ &&pcd_PCD_SETTHINGSPECIAL, &&pcd_PCD_ASSIGNGLOBALVAR, &&pcd_PCD_PUSHGLOBALVAR, &&pcd_PCD_ADDGLOBALVAR,
+		/*184*/ &&pcd_PCD_SUBGLOBALVAR, &&pcd_PCD_MULGLOBALVAR, &&pcd_PCD_DIVGLOBALVAR, &&pcd_PCD_MODGLOBALVAR,
+		/*188*/ &&pcd_PCD_INCGLOBALVAR, &&pcd_PCD_DECGLOBALVAR, &&pcd_PCD_FADETO, &&pcd_PCD_FADERANGE,
+		/*192*/ &&pcd_PCD_CANCELFADE, &&pcd_default, &&pcd_PCD_SETFLOORTRIGGER, &&pcd_PCD_SETCEILINGTRIGGER,
+		/*196*/ &&pcd_PCD_GETACTORX, &&pcd_PCD_GETACTORY, &&pcd_PCD_GETACTORZ, &&pcd_default,
+		/*200*/ &&pcd_default, &&pcd_default, &&pcd_default, &&pcd_PCD_CALL,
+		/*204*/ &&pcd_PCD_CALLDISCARD, &&pcd_PCD_RETURNVOID, &&pcd_PCD_RETURNVAL, &&pcd_PCD_PUSHMAPARRAY,
+		/*208*/ &&pcd_PCD_ASSIGNMAPARRAY, &&pcd_PCD_ADDMAPARRAY, &&pcd_PCD_SUBMAPARRAY, &&pcd_PCD_MULMAPARRAY,
+		/*212*/ &&pcd_PCD_DIVMAPARRAY, &&pcd_PCD_MODMAPARRAY, &&pcd_PCD_INCMAPARRAY, &&pcd_PCD_DECMAPARRAY,
+		/*216*/ &&pcd_PCD_DUP, &&pcd_PCD_SWAP, &&pcd_default, &&pcd_default,
+		/*220*/ &&pcd_PCD_SIN, &&pcd_PCD_COS, &&pcd_PCD_VECTORANGLE, &&pcd_default,
+		/*224*/ &&pcd_default, &&pcd_PCDX_UNKNOWN, &&pcd_PCDX_SETSCRIPTVAR, &&pcd_PCDX_PUSHSCRIPTVARS,
+		/*228*/ &&pcd_PCDX_IFSCRIPTVARCMP
+	};
+#endif
+
 	while (state == SCRIPT_Running)
 	{
 		if (++runaway > 500000)
@@ -1237,184 +1639,227 @@ void DLevelScript::RunScript ()
 		}
 
 		pcd = NEXTBYTE;
-		switch (pcd)
+#ifdef ACS_THREADED
+		if (DECODED)
+			goto *dispatch[pcd];
+#endif
+		// p-codes past the real ones are only ever found in decoded scripts
+		switch (DECODED || (unsigned)pcd < PCODE_COMMAND_COUNT ? pcd : -1)
 		{
-		default:
+		PCD_CASE (PCDX_UNKNOWN):
+			if (DECODED)
+				pcd = NEXTWORD;
+			// fall through
+		PCD_CASE_DEFAULT:
 			Printf (PRINT_HIGH,"Unknown P-Code %d in script %d\n", pcd, script);
 			// fall through
-		case PCD_TERMINATE:
+		PCD_CASE (PCD_TERMINATE):
 			state = SCRIPT_PleaseRemove;
 			break;
 
-		case PCD_NOP:
+		PCD_CASE (PCD_NOP):
+			break;
+
+		PCD_CASE (PCDX_SETSCRIPTVAR):
+			locals[pc[0]] = pc[1];
+			pc += 2;
+			runaway += 1;
+			break;
+
+		PCD_CASE (PCDX_PUSHSCRIPTVARS):
+			Stack[sp] = locals[pc[0]];
+			Stack[sp+1] = locals[pc[1]];
+			sp += 2;
+			pc += 2;
+			runaway += 1;
+			break;
+
+		PCD_CASE (PCDX_IFSCRIPTVARCMP):
+			{
+				int a = locals[pc[0]], b = pc[1];
+				bool cond;
+
+				switch (pc[2])
+				{
+				case PCD_EQ:	cond = a == b;	break;
+				case PCD_NE:	cond = a != b;	break;
+				case PCD_LT:	cond = a < b;	break;
+				case PCD_GT:	cond = a > b;	break;
+				case PCD_LE:	cond = a <= b;	break;
+				default:		cond = a >= b;	break;
+				}
+
+				pc = cond ? pc + 4 : code + pc[3];
+				runaway += 3;
+			}
 			break;
 
-		case PCD_SUSPEND:
+		PCD_CASE (PCD_SUSPEND):
 			state = SCRIPT_Suspended;
 			break;
 
-		case PCD_PUSHNUMBER:
+		PCD_CASE (PCD_PUSHNUMBER):
 			PushToStack (NEXTWORD);
 			break;
 
-		case PCD_PUSHBYTE:
-			PushToStack (*(BYTE *)pc);
-			pc = (int *)((BYTE *)pc + 1);
+		PCD_CASE (PCD_PUSHBYTE):
+			PushToStack (PCBYTE(0));
+			SKIPBYTES(1);
 			break;
 
-		case PCD_PUSH2BYTES:
-			Stack[sp] = ((BYTE *)pc)[0];
-			Stack[sp+1] = ((BYTE *)pc)[1];
+		PCD_CASE (PCD_PUSH2BYTES):
+			Stack[sp] = PCBYTE(0);
+			Stack[sp+1] = PCBYTE(1);
 			sp += 2;
-			pc = (int *)((BYTE *)pc + 2);
+			SKIPBYTES(2);
 			break;
 
-		case PCD_PUSH3BYTES:
-			Stack[sp] = ((BYTE *)pc)[0];
-			Stack[sp+1] = ((BYTE *)pc)[1];
-			Stack[sp+2] = ((BYTE *)pc)[2];
+		PCD_CASE (PCD_PUSH3BYTES):
+			Stack[sp] = PCBYTE(0);
+			Stack[sp+1] = PCBYTE(1);
+			Stack[sp+2] = PCBYTE(2);
 			sp += 3;
-			pc = (int *)((BYTE *)pc + 3);
+			SKIPBYTES(3);
 			break;
 
-		case PCD_PUSH4BYTES:
-			Stack[sp] = ((BYTE *)pc)[0];
-			Stack[sp+1] = ((BYTE *)pc)[1];
-			Stack[sp+2] = ((BYTE *)pc)[2];
-			Stack[sp+3] = ((BYTE *)pc)[3];
+		PCD_CASE (PCD_PUSH4BYTES):
+			Stack[sp] = PCBYTE(0);
+			Stack[sp+1] = PCBYTE(1);
+			Stack[sp+2] = PCBYTE(2);
+			Stack[sp+3] = PCBYTE(3);
 			sp += 4;
-			pc = (int *)((BYTE *)pc + 4);
+			SKIPBYTES(4);
 			break;
 
-		case PCD_PUSH5BYTES:
-			Stack[sp] = ((BYTE *)pc)[0];
-			Stack[sp+1] = ((BYTE *)pc)[1];
-			Stack[sp+2] = ((BYTE *)pc)[2];
-			Stack[sp+3] = ((BYTE *)pc)[3];
-			Stack[sp+4] = ((BYTE *)pc)[4];
+		PCD_CASE (PCD_PUSH5BYTES):
+			Stack[sp] = PCBYTE(0);
+			Stack[sp+1] = PCBYTE(1);
+			Stack[sp+2] = PCBYTE(2);
+			Stack[sp+3] = PCBYTE(3);
+			Stack[sp+4] = PCBYTE(4);
 			sp += 5;
-			pc = (int *)((BYTE *)pc + 5);
+			SKIPBYTES(5);
 			break;
 
-		case PCD_PUSHBYTES:
-			temp = *(BYTE *)pc;
-			pc = (int *)((BYTE *)pc + temp + 1);
+		PCD_CASE (PCD_PUSHBYTES):
+			temp = PCBYTE(0);
+			SKIPBYTES(temp + 1);
 			for (temp = -temp; temp; temp++)
 			{
-				PushToStack (*((BYTE *)pc + temp));
+				PushToStack (PCBYTE(temp));
 			}
 			break;
 
-		case PCD_DUP:
+		PCD_CASE (PCD_DUP):
 			Stack[sp] = Stack[sp-1];
 			sp++;
 			break;
 
-		case PCD_SWAP:
+		PCD_CASE (PCD_SWAP):
 			std::swap(Stack[sp-2], Stack[sp-1]);
 			break;
 
-		case PCD_LSPEC1:
+		PCD_CASE (PCD_LSPEC1):
 			LineSpecials[NEXTBYTE] (activationline, activator,
 									STACK(1), 0, 0, 0, 0);
 			sp -= 1;
 			break;
 
-		case PCD_LSPEC2:
+		PCD_CASE (PCD_LSPEC2):
 			LineSpecials[NEXTBYTE] (activationline, activator,
 									STACK(2), STACK(1), 0, 0, 0);
 			sp -= 2;
 			break;
 
-		case PCD_LSPEC3:
+		PCD_CASE (PCD_LSPEC3):
 			LineSpecials[NEXTBYTE] (activationline, activator,
 									STACK(3), STACK(2), STACK(1), 0, 0);
 			sp -= 3;
 			break;
 
-		case PCD_LSPEC4:
+		PCD_CASE (PCD_LSPEC4):
 			LineSpecials[NEXTBYTE] (activationline, activator,
 									STACK(4), STACK(3), STACK(2),
 									STACK(1), 0);
 			sp -= 4;
 			break;
 
-		case PCD_LSPEC5:
+		PCD_CASE (PCD_LSPEC5):
 			LineSpecials[NEXTBYTE] (activationline, activator,
 									STACK(5), STACK(4), STACK(3),
 									STACK(2), STACK(1));
 			sp -= 5;
 			break;
 
-		case PCD_LSPEC1DIRECT:
+		PCD_CASE (PCD_LSPEC1DIRECT):
 			temp = NEXTBYTE;
 			LineSpecials[temp] (activationline, activator,
 								pc[0], 0, 0, 0, 0);
 			pc += 1;
 			break;
 
-		case PCD_LSPEC2DIRECT:
+		PCD_CASE (PCD_LSPEC2DIRECT):
 			temp = NEXTBYTE;
 			LineSpecials[temp] (activationline, activator,
 								pc[0], pc[1], 0, 0, 0);
 			pc += 2;
 			break;
 
-		case PCD_LSPEC3DIRECT:
+		PCD_CASE (PCD_LSPEC3DIRECT):
 			temp = NEXTBYTE;
 			LineSpecials[temp] (activationline, activator,
 								pc[0], pc[1], pc[2], 0, 0);
 			pc += 3;
 			break;
 
-		case PCD_LSPEC4DIRECT:
+		PCD_CASE (PCD_LSPEC4DIRECT):
 			temp = NEXTBYTE;
 			LineSpecials[temp] (activationline, activator,
 								pc[0], pc[1], pc[2], pc[3], 0);
 			pc += 4;
 			break;
 
-		case PCD_LSPEC5DIRECT:
+		PCD_CASE (PCD_LSPEC5DIRECT):
 			temp = NEXTBYTE;
 			LineSpecials[temp] (activationline, activator,
 								pc[0], pc[1], pc[2], pc[3], pc[4]);
 			pc += 5;
 			break;
 
-		case PCD_LSPEC1DIRECTB:
-			LineSpecials[((BYTE *)pc)[0]] (activationline, activator,
-				((BYTE *)pc)[1], 0, 0, 0, 0);
-			pc = (int *)((BYTE *)pc + 2);
+		PCD_CASE (PCD_LSPEC1DIRECTB):
+			LineSpecials[PCBYTE(0)] (activationline, activator,
+				PCBYTE(1), 0, 0, 0, 0);
+			SKIPBYTES(2);
 			break;
 
-		case PCD_LSPEC2DIRECTB:
-			LineSpecials[((BYTE *)pc)[0]] (activationline, activator,
-				((BYTE *)pc)[1], ((BYTE *)pc)[2], 0, 0, 0);
-			pc = (int *)((BYTE *)pc + 3);
+		PCD_CASE (PCD_LSPEC2DIRECTB):
+			LineSpecials[PCBYTE(0)] (activationline, activator,
+				PCBYTE(1), PCBYTE(2), 0, 0, 0);
+			SKIPBYTES(3);
 			break;
 
-		case PCD_LSPEC3DIRECTB:
-			LineSpecials[((BYTE *)pc)[0]] (activationline, activator,
-				((BYTE *)pc)[1], ((BYTE *)pc)[2], ((BYTE *)pc)[3], 0, 0);
-			pc = (int *)((BYTE *)pc + 4);
+		PCD_CASE (PCD_LSPEC3DIRECTB):
+			LineSpecials[PCBYTE(0)] (activationline, activator,
+				PCBYTE(1), PCBYTE(2), PCBYTE(3), 0, 0);
+			SKIPBYTES(4);
 			break;
 
-		case PCD_LSPEC4DIRECTB:
-			LineSpecials[((BYTE *)pc)[0]] (activationline, activator,
-				((BYTE *)pc)[1], ((BYTE *)pc)[2], ((BYTE *)pc)[3],
-				((BYTE *)pc)[4], 0);
-			pc = (int *)((BYTE *)pc + 5);
+		PCD_CASE (PCD_LSPEC4DIRECTB):
+			LineSpecials[PCBYTE(0)] (activationline, activator,
+				PCBYTE(1), PCBYTE(2), PCBYTE(3),
+				PCBYTE(4), 0);
+			SKIPBYTES(5);
 			break;
 
-		case PCD_LSPEC5DIRECTB:
-			LineSpecials[((BYTE *)pc)[0]] (activationline, activator,
-				((BYTE *)pc)[1], ((BYTE *)pc)[2], ((BYTE *)pc)[3],
-				((BYTE *)pc)[4], ((BYTE *)pc)[5]);
-			pc = (int *)((BYTE *)pc + 6);
+		PCD_CASE (PCD_LSPEC5DIRECTB):
+			LineSpecials[PCBYTE(0)] (activationline, activator,
+				PCBYTE(1), PCBYTE(2), PCBYTE(3),
+				PCBYTE(4), PCBYTE(5));
+			SKIPBYTES(6);
 			break;
 
-		case PCD_CALL:
-		case PCD_CALLDISCARD:
+		PCD_CASE (PCD_CALL):
+		PCD_CASE (PCD_CALLDISCARD):
 			{
 				int funcnum;
 				int i;
@@ -1442,17 +1887,17 @@ void DLevelScript::RunScript ()
 					Stack[sp+i] = 0;
 				}
 				sp += i;
-				((CallReturn *)&Stack[sp])->ReturnAddress = level.behavior->PC2Ofs (pc);
+				((CallReturn *)&Stack[sp])->ReturnAddress = SAVEPC (pc);
 				((CallReturn *)&Stack[sp])->ReturnFunction = activeFunction;
 				((CallReturn *)&Stack[sp])->bDiscardResult = (pcd == PCD_CALLDISCARD);
 				sp += sizeof(CallReturn)/sizeof(int);
-				pc = level.behavior->Ofs2PC (func->Address);
+				pc = FUNCPC (func->Address);
 				activeFunction = func;
 			}
 			break;
 
-		case PCD_RETURNVOID:
-		case PCD_RETURNVAL:
+		PCD_CASE (PCD_RETURNVOID):
+		PCD_CASE (PCD_RETURNVAL):
 			{
 				int value;
 				CallReturn *retState;
@@ -1467,7 +1912,7 @@ void DLevelScript::RunScript ()
 				}
 				sp -= sizeof(CallReturn)/sizeof(int);
 				retState = (CallReturn *)&Stack[sp];
-				pc = level.behavior->Ofs2PC (retState->ReturnAddress);
+				pc = RESTOREPC (retState->ReturnAddress);
 				sp -= activeFunction->ArgCount + activeFunction->LocalCount;
 				activeFunction = retState->ReturnFunction;
 				if (activeFunction == NULL)
@@ -1485,128 +1930,128 @@ void DLevelScript::RunScript ()
 			}
 			break;
 
-		case PCD_ADD:
+		PCD_CASE (PCD_ADD):
 			STACK(2) = STACK(2) + STACK(1);
 			sp--;
 			break;
 
-		case PCD_SUBTRACT:
+		PCD_CASE (PCD_SUBTRACT):
 			STACK(2) = STACK(2) - STACK(1);
 			sp--;
 			break;
 
-		case PCD_MULTIPLY:
+		PCD_CASE (PCD_MULTIPLY):
 			STACK(2) = STACK(2) * STACK(1);
 			sp--;
 			break;
 
-		case PCD_DIVIDE:
+		PCD_CASE (PCD_DIVIDE):
 			STACK(2) = STACK(2) / STACK(1);
 			sp--;
 			break;
 
-		case PCD_MODULUS:
+		PCD_CASE (PCD_MODULUS):
 			STACK(2) = STACK(2) % STACK(1);
 			sp--;
 			break;
 
-		case PCD_EQ:
+		PCD_CASE (PCD_EQ):
 			STACK(2) = (STACK(2) == STACK(1));
 			sp--;
 			break;
 
-		case PCD_NE:
+		PCD_CASE (PCD_NE):
 			STACK(2) = (STACK(2) != STACK(1));
 			sp--;
 			break;
 
-		case PCD_LT:
+		PCD_CASE (PCD_LT):
 			STACK(2) = (STACK(2) < STACK(1));
 			sp--;
 			break;
 
-		case PCD_GT:
+		PCD_CASE (PCD_GT):
 			STACK(2) = (STACK(2) > STACK(1));
 			sp--;
 			break;
 
-		case PCD_LE:
+		PCD_CASE (PCD_LE):
 			STACK(2) = (STACK(2) <= STACK(1));
 			sp--;
 			break;
 
-		case PCD_GE:
+		PCD_CASE (PCD_GE):
 			STACK(2) = (STACK(2) >= STACK(1));
 			sp--;
 			break;
 
-		case PCD_ASSIGNSCRIPTVAR:
+		PCD_CASE (PCD_ASSIGNSCRIPTVAR):
 			locals[NEXTBYTE] = STACK(1);
 			sp--;
 			break;
 
 
-		case PCD_ASSIGNMAPVAR:
+		PCD_CASE (PCD_ASSIGNMAPVAR):
 			level.vars[NEXTBYTE] = STACK(1);
 			sp--;
 			break;
 
-		case PCD_ASSIGNWORLDVAR:
+		PCD_CASE (PCD_ASSIGNWORLDVAR):
 			ACS_WorldVars[NEXTBYTE] = STACK(1);
 			sp--;
 			break;
 
-		case PCD_ASSIGNGLOBALVAR:
+		PCD_CASE (PCD_ASSIGNGLOBALVAR):
 			ACS_GlobalVars[NEXTBYTE] = STACK(1);
 			sp--;
 			break;
 
-		case PCD_ASSIGNMAPARRAY:
+		PCD_CASE (PCD_ASSIGNMAPARRAY):
 			level.behavior->SetArrayVal (ACS_WorldVars[NEXTBYTE], STACK(2), STACK(1));
 			sp -= 2;
 			break;
 
-		case PCD_PUSHSCRIPTVAR:
+		PCD_CASE (PCD_PUSHSCRIPTVAR):
 			PushToStack (locals[NEXTBYTE]);
 			break;
 
-		case PCD_PUSHMAPVAR:
+		PCD_CASE (PCD_PUSHMAPVAR):
 			PushToStack (level.vars[NEXTBYTE]);
 			break;
 
-		case PCD_PUSHWORLDVAR:
+		PCD_CASE (PCD_PUSHWORLDVAR):
 			PushToStack (ACS_WorldVars[NEXTBYTE]);
 			break;
 
-		case PCD_PUSHGLOBALVAR:
+		PCD_CASE (PCD_PUSHGLOBALVAR):
 			PushToStack (ACS_GlobalVars[NEXTBYTE]);
 			break;
 
-		case PCD_PUSHMAPARRAY:
+		PCD_CASE (PCD_PUSHMAPARRAY):
 			STACK(1) = level.behavior->GetArrayVal (level.vars[NEXTBYTE], STACK(1));
 			break;
 
-		case PCD_ADDSCRIPTVAR:
+		PCD_CASE (PCD_ADDSCRIPTVAR):
 			locals[NEXTBYTE] += STACK(1);
 			sp--;
 			break;
 
-		case PCD_ADDMAPVAR:
+		PCD_CASE (PCD_ADDMAPVAR):
 			level.vars[NEXTBYTE] += STACK(1);
 			sp--;
 			break;
 
-		case PCD_ADDWORLDVAR:
+		PCD_CASE (PCD_ADDWORLDVAR):
 			ACS_WorldVars[NEXTBYTE] += STACK(1);
 			sp--;
 			break;
 
-		case PCD_ADDGLOBALVAR:
+		PCD_CASE (PCD_ADDGLOBALVAR):
 			ACS_GlobalVars[NEXTBYTE] += STACK(1);
 			sp--;
 			break;
 
-		case PCD_ADDMAPARRAY:
+		PCD_CASE (PCD_ADDMAPARRAY):
 			{
 				int a = ACS_WorldVars[NEXTBYTE];
 				int i = STACK(2);
@@ -1616,27 +2061,27 @@ void DLevelScript::RunScript ()
 			}
 			break;
 
-		case PCD_SUBSCRIPTVAR:
+		PCD_CASE (PCD_SUBSCRIPTVAR):
 			locals[NEXTBYTE] -= STACK(1);
 			sp--;
 			break;
 
-		case PCD_SUBMAPVAR:
+		PCD_CASE (PCD_SUBMAPVAR):
 			level.vars[NEXTBYTE] -= STACK(1);
 			sp--;
 			break;
 
-		case PCD_SUBWORLDVAR:
+		PCD_CASE (PCD_SUBWORLDVAR):
 			ACS_WorldVars[NEXTBYTE] -= STACK(1);
 			sp--;
 			break;
 
-		case PCD_SUBGLOBALVAR:
+		PCD_CASE (PCD_SUBGLOBALVAR):
 			ACS_GlobalVars[NEXTBYTE] -= STACK(1);
 			sp--;
 			break;
 
-		case PCD_SUBMAPARRAY:
+		PCD_CASE (PCD_SUBMAPARRAY):
 			{
 				int a = ACS_WorldVars[NEXTBYTE];
 				int i = STACK(2);
@@ -1646,27 +2091,27 @@ void DLevelScript::RunScript ()
 			}
 			break;
 
-		case PCD_MULSCRIPTVAR:
+		PCD_CASE (PCD_MULSCRIPTVAR):
 			locals[NEXTBYTE] *= STACK(1);
 			sp--;
 			break;
 
-		case PCD_MULMAPVAR:
+		PCD_CASE (PCD_MULMAPVAR):
 			level.vars[NEXTBYTE] *= STACK(1);
 			sp--;
 			break;
 
-		case PCD_MULWORLDVAR:
+		PCD_CASE (PCD_MULWORLDVAR):
 			ACS_WorldVars[NEXTBYTE] *= STACK(1);
 			sp--;
 			break;
 
-		case PCD_MULGLOBALVAR:
+		PCD_CASE (PCD_MULGLOBALVAR):
 			ACS_GlobalVars[NEXTBYTE] *= STACK(1);
 			sp--;
 			break;
 
-		case PCD_MULMAPARRAY:
+		PCD_CASE (PCD_MULMAPARRAY):
 			{
 				int a = ACS_WorldVars[NEXTBYTE];
 				int i = STACK(2);
@@ -1676,27 +2121,27 @@ void DLevelScript::RunScript ()
 			}
 			break;
 
-		case PCD_DIVSCRIPTVAR:
+		PCD_CASE (PCD_DIVSCRIPTVAR):
 			locals[NEXTBYTE] /= STACK(1);
 			sp--;
 			break;
 
-		case PCD_DIVMAPVAR:
+		PCD_CASE (PCD_DIVMAPVAR):
 			level.vars[NEXTBYTE] /= STACK(1);
 			sp--;
 			break;
 
-		case PCD_DIVWORLDVAR:
+		PCD_CASE (PCD_DIVWORLDVAR):
 			ACS_WorldVars[NEXTBYTE] /= STACK(1);
 			sp--;
 			break;
 
-		case PCD_DIVGLOBALVAR:
+		PCD_CASE (PCD_DIVGLOBALVAR):
 			ACS_GlobalVars[NEXTBYTE] /= STACK(1);
 			sp--;
 			break;
 
-		case PCD_DIVMAPARRAY:
+		PCD_CASE (PCD_DIVMAPARRAY):
 			{
 				int a = ACS_WorldVars[NEXTBYTE];
 				int i = STACK(2);
@@ -1706,27 +2151,27 @@ void DLevelScript::RunScript ()
 			}
 			break;
 
-		case PCD_MODSCRIPTVAR:
+		PCD_CASE (PCD_MODSCRIPTVAR):
 			locals[NEXTBYTE] %= STACK(1);
 			sp--;
 			break;
 
-		case PCD_MODMAPVAR:
+		PCD_CASE (PCD_MODMAPVAR):
 			level.vars[NEXTBYTE] %= STACK(1);
 			sp--;
 			break;
 
-		case PCD_MODWORLDVAR:
+		PCD_CASE (PCD_MODWORLDVAR):
 			ACS_WorldVars[NEXTBYTE] %= STACK(1);
 			sp--;
 			break;
 
-		case PCD_MODGLOBALVAR:
+		PCD_CASE (PCD_MODGLOBALVAR):
 			ACS_GlobalVars[NEXTBYTE] %= STACK(1);
 			sp--;
 			break;
 
-		case PCD_MODMAPARRAY:
+		PCD_CASE (PCD_MODMAPARRAY):
 			{
 				int a = ACS_WorldVars[NEXTBYTE];
 				int i = STACK(2);
@@ -1736,23 +2181,23 @@ void DLevelScript::RunScript ()
 			}
 			break;
 
-		case PCD_INCSCRIPTVAR:
+		PCD_CASE (PCD_INCSCRIPTVAR):
 			++locals[NEXTBYTE];
 			break;
 
-		case PCD_INCMAPVAR:
+		PCD_CASE (PCD_INCMAPVAR):
 			++level.vars[NEXTBYTE];
 			break;
 
-		case PCD_INCWORLDVAR:
+		PCD_CASE (PCD_INCWORLDVAR):
 			++ACS_WorldVars[NEXTBYTE];
 			break;
 
-		case PCD_INCGLOBALVAR:
+		PCD_CASE (PCD_INCGLOBALVAR):
 			++ACS_GlobalVars[NEXTBYTE];
 			break;
 
-		case PCD_INCMAPARRAY:
+		PCD_CASE (PCD_INCMAPARRAY):
 			{
 				int a = ACS_WorldVars[NEXTBYTE];
 				int i = STACK(2);
@@ -1762,23 +2207,23 @@ void DLevelScript::RunScript ()
 			}
 			break;
 
-		case PCD_DECSCRIPTVAR:
+		PCD_CASE (PCD_DECSCRIPTVAR):
 			--locals[NEXTBYTE];
 			break;
 
-		case PCD_DECMAPVAR:
+		PCD_CASE (PCD_DECMAPVAR):
 			--level.vars[NEXTBYTE];
 			break;
 
-		case PCD_DECWORLDVAR:
+		PCD_CASE (PCD_DECWORLDVAR):
 			--ACS_WorldVars[NEXTBYTE];
 			break;
 
-		case PCD_DECGLOBALVAR:
+		PCD_CASE (PCD_DECGLOBALVAR):
 			--ACS_GlobalVars[NEXTBYTE];
 			break;
 
-		case PCD_DECMAPARRAY:
+		PCD_CASE (PCD_DECMAPARRAY):
 			{
 				int a = ACS_WorldVars[NEXTBYTE];
 				int i = STACK(2);
@@ -1788,166 +2233,166 @@ void DLevelScript::RunScript ()
 			}
 			break;
 
-		case PCD_GOTO:
-			pc = level.behavior->Ofs2PC (*pc);
+		PCD_CASE (PCD_GOTO):
+			GOTOOPERAND;
 			break;
 
-		case PCD_IFGOTO:
+		PCD_CASE (PCD_IFGOTO):
 			if (STACK(1))
-				pc = level.behavior->Ofs2PC (*pc);
+				GOTOOPERAND;
 			else
 				pc++;
 			sp--;
 			break;
 
-		case PCD_DROP:
+		PCD_CASE (PCD_DROP):
 			sp--;
 			break;
 
-		case PCD_DELAY:
+		PCD_CASE (PCD_DELAY):
 			state = SCRIPT_Delayed;
 			statedata = STACK(1);
 			sp--;
 			break;
 
-		case PCD_DELAYDIRECT:
+		PCD_CASE (PCD_DELAYDIRECT):
 			state = SCRIPT_Delayed;
 			statedata = NEXTWORD;
 			break;
 
-		case PCD_DELAYDIRECTB:
+		PCD_CASE (PCD_DELAYDIRECTB):
 			state = SCRIPT_Delayed;
-			statedata = *(BYTE *)pc;
-			pc = (int *)((BYTE *)pc + 1);
+			statedata = PCBYTE(0);
+			SKIPBYTES(1);
 			break;
 
-		case PCD_RANDOM:
+		PCD_CASE (PCD_RANDOM):
 			STACK(2) = Random (STACK(2), STACK(1));
 			sp--;
 			break;
 
-		case PCD_RANDOMDIRECT:
+		PCD_CASE (PCD_RANDOMDIRECT):
 			PushToStack (Random (pc[0], pc[1]));
 			pc += 2;
 			break;
 
-		case PCD_RANDOMDIRECTB:
-			PushToStack (Random (((BYTE *)pc)[0], ((BYTE *)pc)[1]));
-			pc = (int *)((BYTE *)pc + 2);
+		PCD_CASE (PCD_RANDOMDIRECTB):
+			PushToStack (Random (PCBYTE(0), PCBYTE(1)));
+			SKIPBYTES(2);
 			break;
 
-		case PCD_THINGCOUNT:
+		PCD_CASE (PCD_THINGCOUNT):
 			STACK(2) = ThingCount (STACK(2), STACK(1));
 			sp--;
 			break;
 
-		case PCD_THINGCOUNTDIRECT:
+		PCD_CASE (PCD_THINGCOUNTDIRECT):
 			PushToStack (ThingCount (pc[0], pc[1]));
 			pc += 2;
 			break;
 
-		case PCD_TAGWAIT:
+		PCD_CASE (PCD_TAGWAIT):
 			state = SCRIPT_TagWait;
 			statedata = STACK(1);
 			sp--;
 			break;
 
-		case PCD_TAGWAITDIRECT:
+		PCD_CASE (PCD_TAGWAITDIRECT):
 			state = SCRIPT_TagWait;
 			statedata = NEXTWORD;
 			break;
 
-		case PCD_POLYWAIT:
+		PCD_CASE (PCD_POLYWAIT):
 			state = SCRIPT_PolyWait;
 			statedata = STACK(1);
 			sp--;
 			break;
 
-		case PCD_POLYWAITDIRECT:
+		PCD_CASE (PCD_POLYWAITDIRECT):
 			state = SCRIPT_PolyWait;
 			statedata = NEXTWORD;
 			break;
 
-		case PCD_CHANGEFLOOR:
+		PCD_CASE (PCD_CHANGEFLOOR):
 			ChangeFlat (STACK(2), STACK(1), 0);
 			sp -= 2;
 			break;
 
-		case PCD_CHANGEFLOORDIRECT:
+		PCD_CASE (PCD_CHANGEFLOORDIRECT):
 			ChangeFlat (pc[0], pc[1], 0);
 			pc += 2;
 			break;
 
-		case PCD_CHANGECEILING:
+		PCD_CASE (PCD_CHANGECEILING):
 			ChangeFlat (STACK(2), STACK(1), 1);
 			sp -= 2;
 			break;
 
-		case PCD_CHANGECEILINGDIRECT:
+		PCD_CASE (PCD_CHANGECEILINGDIRECT):
 			ChangeFlat (pc[0], pc[1], 1);
 			pc += 2;
 			break;
 
-		case PCD_RESTART:
-			pc = level.behavior->FindScript (script);
+		PCD_CASE (PCD_RESTART):
+			pc = SCRIPTPC (script);
 			break;
 
-		case PCD_ANDLOGICAL:
+		PCD_CASE (PCD_ANDLOGICAL):
 			STACK(2) = (STACK(2) && STACK(1));
 			sp--;
 			break;
 
-		case PCD_ORLOGICAL:
+		PCD_CASE (PCD_ORLOGICAL):
 			STACK(2) = (STACK(2) || STACK(1));
 			sp--;
 			break;
 
-		case PCD_ANDBITWISE:
+		PCD_CASE (PCD_ANDBITWISE):
 			STACK(2) = (STACK(2) & STACK(1));
 			sp--;
 			break;
 
-		case PCD_ORBITWISE:
+		PCD_CASE (PCD_ORBITWISE):
 			STACK(2) = (STACK(2) | STACK(1));
 			sp--;
 			break;
 
-		case PCD_EORBITWISE:
+		PCD_CASE (PCD_EORBITWISE):
 			STACK(2) = (STACK(2) ^ STACK(1));
 			sp--;
 			break;
 
-		case PCD_NEGATELOGICAL:
+		PCD_CASE (PCD_NEGATELOGICAL):
 			STACK(1) = !STACK(1);
 			break;
 
-		case PCD_LSHIFT:
+		PCD_CASE (PCD_LSHIFT):
 			STACK(2) = (STACK(2) << STACK(1));
 			sp--;
 			break;
 
-		case PCD_RSHIFT:
+		PCD_CASE (PCD_RSHIFT):
 			STACK(2) = (STACK(2) >> STACK(1));
 			sp--;
 			break;
 
-		case PCD_UNARYMINUS:
+		PCD_CASE (PCD_UNARYMINUS):
 			STACK(1) = -STACK(1);
 			break;
 
-		case PCD_IFNOTGOTO:
+		PCD_CASE (PCD_IFNOTGOTO):
 			if (!STACK(1))
-				pc = level.behavior->Ofs2PC (*pc);
+				GOTOOPERAND;
 			else
 				pc++;
 			sp--;
 			break;
 
-		case PCD_LINESIDE:
+		PCD_CASE (PCD_LINESIDE):
 			PushToStack (lineSide);
 			break;
 
-		case PCD_SCRIPTWAIT:
+		PCD_CASE (PCD_SCRIPTWAIT):
 			statedata = STACK(1);
 			if (controller->RunningScripts[statedata])
 				state = SCRIPT_ScriptWait;
@@ -1957,21 +2402,21 @@ void DLevelScript::RunScript ()
 			PutLast ();
 			break;
 
-		case PCD_SCRIPTWAITDIRECT:
+		PCD_CASE (PCD_SCRIPTWAITDIRECT):
 			state = SCRIPT_ScriptWait;
 			statedata = NEXTWORD;
 			PutLast ();
 			break;
 
-		case PCD_CLEARLINESPECIAL:
+		PCD_CASE (PCD_CLEARLINESPECIAL):
 			if (activationline)
 				activationline->special = 0;
 			break;
 
-		case PCD_CASEGOTO:
+		PCD_CASE (PCD_CASEGOTO):
 			if (STACK(1) == NEXTWORD)
 			{
-				pc = level.behavior->Ofs2PC (*pc);
+				GOTOOPERAND;
 				sp--;
 			}
 			else
@@ -1980,13 +2425,13 @@ void DLevelScript::RunScript ()
 			}
 			break;
 
-		case PCD_BEGINPRINT:
+		PCD_CASE (PCD_BEGINPRINT):
 			workwhere = work;
 			work[0] = 0;
 			break;
 
-		case PCD_PRINTSTRING:
-		case PCD_PRINTLOCALIZED:
+		PCD_CASE (PCD_PRINTSTRING):
+		PCD_CASE (PCD_PRINTLOCALIZED):
 			lookup = (pcd == PCD_PRINTSTRING ?
 				level.behavior->LookupString (STACK(1)) :
 				level.behavior->LocalizeString (STACK(1)));
@@ -1997,26 +2442,26 @@ void DLevelScript::RunScript ()
 			--sp;
 			break;
 
-		case PCD_PRINTNUMBER:
+		PCD_CASE (PCD_PRINTNUMBER):
 			workwhere += sprintf (workwhere, "%d", STACK(1));
 			--sp;
 			break;
 
-		case PCD_PRINTCHARACTER:
+		PCD_CASE (PCD_PRINTCHARACTER):
 			workwhere[0] = STACK(1);
 			workwhere[1] = 0;
 			workwhere++;
 			--sp;
 			break;
 
-		case PCD_PRINTFIXED:
+		PCD_CASE (PCD_PRINTFIXED):
 			workwhere += sprintf (workwhere, "%g", FIXED2FLOAT(STACK(1)));
 			--sp;
 			break;
 
 		// [BC] Print activator's name
 		// [RH] Fancied up a bit
-		case PCD_PRINTNAME:
+		PCD_CASE (PCD_PRINTNAME):
 			{
 				player_t *player = NULL;
 
@@ -2056,8 +2501,8 @@ void DLevelScript::RunScript ()
 			}
 			break;
 
-		case PCD_ENDPRINT:
-		case PCD_ENDPRINTBOLD:
+		PCD_CASE (PCD_ENDPRINT):
+		PCD_CASE (PCD_ENDPRINTBOLD):
 		//case PCD_MOREHUDMESSAGE:
 			strbin (work);
 			if (pcd != PCD_MOREHUDMESSAGE)
@@ -2133,11 +2578,11 @@ void DLevelScript::RunScript ()
 			pc++;
 			break;
         */
-		case PCD_PLAYERCOUNT:
+		PCD_CASE (PCD_PLAYERCOUNT):
 			PushToStack (CountPlayers ());
 			break;
 
-		case PCD_GAMETYPE:
+		PCD_CASE (PCD_GAMETYPE):
 		    if (sv_gametype == 3)
                 PushToStack (GAME_NET_CTF);
             else if (sv_gametype == 2)
@@ -2150,27 +2595,27 @@ void DLevelScript::RunScript ()
 				PushToStack (GAME_SINGLE_PLAYER);
 			break;
 
-		case PCD_GAMESKILL:
+		PCD_CASE (PCD_GAMESKILL):
 			PushToStack (sv_skill);
 			break;
 
 // [BC] Start ST PCD's
-		case PCD_PLAYERHEALTH:
+		PCD_CASE (PCD_PLAYERHEALTH):
 			if (activator)
 				PushToStack (activator->health);
 			break;
 
-		case PCD_PLAYERARMORPOINTS:
+		PCD_CASE (PCD_PLAYERARMORPOINTS):
 			if (activator && activator->player)
 				PushToStack (activator->player->armorpoints);
 			break;
 
-		case PCD_PLAYERFRAGS:
+		PCD_CASE (PCD_PLAYERFRAGS):
 			if (activator && activator->player)
 				PushToStack (activator->player->fragcount);
 			break;
 
-		case PCD_MUSICCHANGE:
+		PCD_CASE (PCD_MUSICCHANGE):
 			lookup = level.behavior->LookupString (STACK(2));
 			if (lookup != NULL)
 			{
@@ -2179,16 +2624,16 @@ void DLevelScript::RunScript ()
 			sp -= 2;
 			break;
 
-		case PCD_SINGLEPLAYER:
+		PCD_CASE (PCD_SINGLEPLAYER):
 			PushToStack (!netgame);
 			break;
 // [BC] End ST PCD's
 
-		case PCD_TIMER:
+		PCD_CASE (PCD_TIMER):
 			PushToStack (level.time);
 			break;
 
-		case PCD_SECTORSOUND:
+		PCD_CASE (PCD_SECTORSOUND):
 			lookup = level.behavior->LookupString (STACK(2));
 			if (lookup != NULL)
 			{
@@ -2213,7 +2658,7 @@ void DLevelScript::RunScript ()
 			sp -= 2;
 			break;
 
-		case PCD_AMBIENTSOUND:
+		PCD_CASE (PCD_AMBIENTSOUND):
 			lookup = level.behavior->LookupString (STACK(2));
 			if (lookup != NULL)
 			{
@@ -2224,7 +2669,7 @@ void DLevelScript::RunScript ()
 			sp -= 2;
 			break;
 
-		case PCD_LOCALAMBIENTSOUND:
+		PCD_CASE (PCD_LOCALAMBIENTSOUND):
 			lookup = level.behavior->LookupString (STACK(2));
 			if (lookup != NULL && consoleplayer().camera == activator)
 			{
@@ -2235,7 +2680,7 @@ void DLevelScript::RunScript ()
 			sp -= 2;
 			break;
 
-		case PCD_ACTIVATORSOUND:
+		PCD_CASE (PCD_ACTIVATORSOUND):
 			lookup = level.behavior->LookupString (STACK(2));
 			if (lookup != NULL)
 			{
@@ -2246,7 +2691,7 @@ void DLevelScript::RunScript ()
 			sp -= 2;
 			break;
 
-		case PCD_SOUNDSEQUENCE:
+		PCD_CASE (PCD_SOUNDSEQUENCE):
 			lookup = level.behavior->LookupString (STACK(1));
 			if (lookup != NULL)
 			{
@@ -2260,12 +2705,12 @@ void DLevelScript::RunScript ()
 			sp--;
 			break;
 
-		case PCD_SETLINETEXTURE:
+		PCD_CASE (PCD_SETLINETEXTURE):
 			SetLineTexture (STACK(4), STACK(3), STACK(2), STACK(1));
 			sp -= 4;
 			break;
 
-		case PCD_SETLINEBLOCKING:
+		PCD_CASE (PCD_SETLINEBLOCKING):
 			{
 				int line = -1;
 
@@ -2291,7 +2736,7 @@ void DLevelScript::RunScript ()
 			}
 			break;
 
-		case PCD_SETLINEMONSTERBLOCKING:
+		PCD_CASE (PCD_SETLINEMONSTERBLOCKING):
 			{
 				int line = -1;
 
@@ -2307,7 +2752,7 @@ void DLevelScript::RunScript ()
 			}
 			break;
 
-		case PCD_SETLINESPECIAL:
+		PCD_CASE (PCD_SETLINESPECIAL):
 			{
 				int linenum = -1;
 
@@ -2325,7 +2770,7 @@ void DLevelScript::RunScript ()
 			}
 			break;
 
-		case PCD_SETTHINGSPECIAL:
+		PCD_CASE (PCD_SETTHINGSPECIAL):
 			{
 				FActorIterator iterator (STACK(7));
 				AActor *actor;
@@ -2342,7 +2787,7 @@ void DLevelScript::RunScript ()
 				sp -= 7;
 			}
 
-		case PCD_THINGSOUND:
+		PCD_CASE (PCD_THINGSOUND):
 			lookup = level.behavior->LookupString (STACK(2));
 			if (lookup != NULL)
 			{
@@ -2360,33 +2805,33 @@ void DLevelScript::RunScript ()
 			break;
 
 
-		case PCD_FIXEDMUL:
+		PCD_CASE (PCD_FIXEDMUL):
 			STACK(2) = FixedMul (STACK(2), STACK(1));
 			sp--;
 			break;
 
-		case PCD_FIXEDDIV:
+		PCD_CASE (PCD_FIXEDDIV):
 			STACK(2) = FixedDiv (STACK(2), STACK(1));
 			sp--;
 			break;
 
-		case PCD_SETGRAVITY:
+		PCD_CASE (PCD_SETGRAVITY):
 			level.gravity = (float)STACK(1) / 65536.f;
 			sp--;
 			break;
 
-		case PCD_SETGRAVITYDIRECT:
+		PCD_CASE (PCD_SETGRAVITYDIRECT):
 			level.gravity = (float)pc[0] / 65536.f;
 			pc++;
 			break;
 
-		case PCD_SETAIRCONTROL:
+		PCD_CASE (PCD_SETAIRCONTROL):
 			level.aircontrol = STACK(1);
 			sp--;
 			G_AirControlChanged ();
 			break;
 
-		case PCD_SETAIRCONTROLDIRECT:
+		PCD_CASE (PCD_SETAIRCONTROLDIRECT):
 			level.aircontrol = pc[0];
 			pc++;
 			G_AirControlChanged ();
@@ -2446,17 +2891,17 @@ void DLevelScript::RunScript ()
 			break;
         */
 
-		case PCD_SETMUSIC:
+		PCD_CASE (PCD_SETMUSIC):
 			S_ChangeMusic (level.behavior->LookupString (STACK(3)), STACK(2));
 			sp -= 3;
 			break;
 
-		case PCD_SETMUSICDIRECT:
+		PCD_CASE (PCD_SETMUSICDIRECT):
 			S_ChangeMusic (level.behavior->LookupString (pc[0]), pc[1]);
 			pc += 3;
 			break;
 
-		case PCD_LOCALSETMUSIC:
+		PCD_CASE (PCD_LOCALSETMUSIC):
 			if (activator == consoleplayer().mo)
 			{
 				S_ChangeMusic (level.behavior->LookupString (STACK(3)), STACK(2));
@@ -2464,7 +2909,7 @@ void DLevelScript::RunScript ()
 			sp -= 3;
 			break;
 
-		case PCD_LOCALSETMUSICDIRECT:
+		PCD_CASE (PCD_LOCALSETMUSICDIRECT):
 			if (activator == consoleplayer().mo)
 			{
 				S_ChangeMusic (level.behavior->LookupString (pc[0]), pc[1]);
@@ -2472,18 +2917,18 @@ void DLevelScript::RunScript ()
 			pc += 3;
 			break;
 
-		case PCD_FADETO:
+		PCD_CASE (PCD_FADETO):
 			DoFadeTo (STACK(5), STACK(4), STACK(3), STACK(2), STACK(1));
 			sp -= 5;
 			break;
 
-		case PCD_FADERANGE:
+		PCD_CASE (PCD_FADERANGE):
 			DoFadeRange (STACK(9), STACK(8), STACK(7), STACK(6),
 						 STACK(5), STACK(4), STACK(3), STACK(2), STACK(1));
 			sp -= 9;
 			break;
 
-		case PCD_CANCELFADE:
+		PCD_CASE (PCD_CANCELFADE):
 			{
 				TThinkerIterator<DFlashFader> iterator;
 				DFlashFader *fader;
@@ -2502,9 +2947,9 @@ void DLevelScript::RunScript ()
 			STACK(1) = I_PlayMovie (level.behavior->LookupString (STACK(1)));
 			break;
         */
-		case PCD_GETACTORX:
-		case PCD_GETACTORY:
-		case PCD_GETACTORZ:
+		PCD_CASE (PCD_GETACTORX):
+		PCD_CASE (PCD_GETACTORY):
+		PCD_CASE (PCD_GETACTORZ):
 			{
 				AActor *actor;
 
@@ -2528,13 +2973,13 @@ void DLevelScript::RunScript ()
 			}
 			break;
 
-		case PCD_SETFLOORTRIGGER:
+		PCD_CASE (PCD_SETFLOORTRIGGER):
 			new DPlaneWatcher (activator, activationline, lineSide, false, STACK(8),
 				STACK(7), STACK(6), STACK(5), STACK(4), STACK(3), STACK(2), STACK(1));
 			sp -= 8;
 			break;
 
-		case PCD_SETCEILINGTRIGGER:
+		PCD_CASE (PCD_SETCEILINGTRIGGER):
 			new DPlaneWatcher (activator, activationline, lineSide, true, STACK(8),
 				STACK(7), STACK(6), STACK(5), STACK(4), STACK(3), STACK(2), STACK(1));
 			sp -= 8;
@@ -2652,15 +3097,15 @@ void DLevelScript::RunScript ()
 			break;
         */
 
-		case PCD_SIN:
+		PCD_CASE (PCD_SIN):
 			STACK(1) = finesine[(STACK(1)<<16)>>ANGLETOFINESHIFT];
 			break;
 
-		case PCD_COS:
+		PCD_CASE (PCD_COS):
 			STACK(1) = finecosine[(STACK(1)<<16)>>ANGLETOFINESHIFT];
 			break;
 
-		case PCD_VECTORANGLE:
+		PCD_CASE (PCD_VECTORANGLE):
 			STACK(2) = R_PointToAngle2 (0, 0, STACK(2), STACK(1)) >> 16;
 			sp--;
 			break;
@@ -2715,6 +3160,93 @@ void DLevelScript::RunScript ()
 	this->pc = pc;
 	this->sp = sp;
 
+	return runaway;
+}
+
+void DLevelScript::RunScript ()
+{
+	DACSThinker *controller = DACSThinker::ActiveThinker;
+	if (!controller)
+		return;
+
+    TeleportSide = lineSide;
+
+	switch (state)
+	{
+	case SCRIPT_Delayed:
+		// Decrement the delay counter and enter state running
+		// if it hits 0
+		if (--statedata == 0)
+			state = SCRIPT_Running;
+		break;
+
+	case SCRIPT_TagWait:
+		// Wait for tagged sector(s) to go inactive, then enter
+		// state running
+	{
+		int secnum = -1;
+
+		while ((secnum = P_FindSectorFromTag (statedata, secnum)) >= 0)
+			if (sectors[secnum].floordata || sectors[secnum].ceilingdata)
+				return;
+
+		// If we got here, none of the tagged sectors were busy
+		state = SCRIPT_Running;
+	}
+	break;
+
+	case SCRIPT_PolyWait:
+		// Wait for polyobj(s) to stop moving, then enter state running
+		if (!PO_Busy (statedata))
+		{
+			state = SCRIPT_Running;
+		}
+		break;
+
+	case SCRIPT_ScriptWaitPre:
+		// Wait for a script to start running, then enter state scriptwait
+		if (controller->RunningScripts[statedata])
+			state = SCRIPT_ScriptWait;
+		break;
+
+	case SCRIPT_ScriptWait:
+		// Wait for a script to stop running, then enter state running
+		if (controller->RunningScripts[statedata])
+			return;
+
+		state = SCRIPT_Running;
+		PutFirst ();
+		break;
+
+	default:
+		break;
+	}
+
+	if (state == SCRIPT_Running)
+	{
+		QWORD start = I_UTime ();
+		int *decoded = level.behavior->DecodedPC (pc);
+		int count;
+
+		if (decoded)
+		{
+			pc = decoded;
+			count = Interpret<true> (controller);
+			pc = level.behavior->UndecodedPC (pc);
+		}
+		else
+		{
+			count = Interpret<false> (controller);
+		}
+
+		if ((unsigned)script < 1000)
+		{
+			ScriptProfile[script].time += I_UTime () - start;
+			ScriptProfile[script].runs++;
+			ScriptProfile[script].instructions += count;
+		}
+	}
+
 	if (state == SCRIPT_PleaseRemove)
 	{
 		Unlink ();
@@ -3018,6 +3550,27 @@ BEGIN_COMMAND (scriptstat)
 	{
 		DACSThinker::ActiveThinker->DumpScriptStatus ();
 	}
+
+	// Time taken by every script that has run on this map
+	bool header = false;
+
+	for (int i = 0; i < 1000; i++)
+	{
+		const scriptprofile_s &prof = ScriptProfile[i];
+
+		if (!prof.runs)
+			continue;
+
+		if (!header)
+		{
+			Printf (PRINT_HIGH, "%s scripts:\n", level.behavior && level.behavior->GetCode () ? "Decoded" : "Reference");
+			Printf (PRINT_HIGH, "script      runs   p-codes   total ms   us/run\n");
+			header = true;
+		}
+
+		Printf (PRINT_HIGH, "%6d %9u %9u %10.3f %8.2f\n", i, (unsigned)prof.runs,
+			(unsigned)prof.instructions, prof.time / 1000.0, (double)prof.time / prof.runs);
+	}
 }
 END_COMMAND (scriptstat)
 
@@ -79,8 +79,16 @@ public:
 	int GetArrayVal (int arraynum, int index) const;
 	void SetArrayVal (int arraynum, int index, int value);
 
+	// Scripts are also decoded when they are loaded. These convert between
+	// an instruction in the lump and the same instruction decoded, and
+	// return NULL if it has no decoded counterpart.
+	int *DecodedPC (int *pc) const;
+	int *UndecodedPC (int *pc) const;
+	int *GetCode () const { return Code; }
+
 private:
 	struct ArrayInfo;
+	struct PCode;
 
 	ACSFormat Format;
 
@@ -96,12 +104,21 @@ private:
 	DWORD LanguageNeutral;
 	DWORD Localized;
 
+	int *Code;				// decoded instructions
+	int CodeSize;
+	int *CodeIndex;			// lump offset -> index in Code, or -1
+	int *CodeOffset;		// index in Code -> lump offset, or -1
+
 	static int STACK_ARGS SortScripts (const void *a, const void *b);
+	bool ReadPCode (int ofs, PCode &pcode) const;
+	void Decode ();
 	void AddLanguage (DWORD lang);
 	DWORD FindLanguage (DWORD lang, bool ignoreregion) const;
 	DWORD *CheckIfInList (DWORD lang);
 };
 
+class DACSThinker;
+
 class DLevelScript : public DObject
 {
 	DECLARE_SERIAL (DLevelScript, DObject)
@@ -430,6 +447,8 @@ protected:
 	void DoFadeRange (int r1, int g1, int b1, int a1,
 		int r2, int g2, int b2, int a2, fixed_t time);
 
+	template <bool DECODED> int Interpret (DACSThinker *controller);
+
 private:
 	DLevelScript ();
 
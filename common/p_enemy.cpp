@@ -347,6 +347,7 @@ BOOL P_Move (AActor *actor)
 	{
 		actor->x = origx;
 		actor->y = origy;
+		P_UpdateThingProxy (actor);
 		movefactor *= FRACUNIT / ORIG_FRICTION_FACTOR / 4;
 		actor->momx += FixedMul (deltax, movefactor);
 		actor->momy += FixedMul (deltay, movefactor);
@@ -667,14 +668,11 @@ void A_KeenDie (AActor *actor)
 {
 	A_Fall (actor);
 
-	// scan the remaining thinkers
-	// to see if all Keens are dead
-	AActor *other;
-	TThinkerIterator<AActor> iterator;
-
-	while ( (other = iterator.Next ()) )
+	// scan the remaining Keens
+	// to see if all of them are dead
+	for (AActor *other = AActor::FirstOfType (actor->type); other; other = other->NextOfType ())
 	{
-		if (other != actor && other->type == actor->type && other->health > 0)
+		if (other != actor && other->health > 0)
 		{
 			// other Keen not dead
 			return;
@@ -1186,6 +1184,7 @@ void A_SkelMissile (AActor *actor)
 
 		mo->x += mo->momx;
 		mo->y += mo->momy;
+		P_UpdateThingProxy (mo);
 		mo->tracer = actor->target;
 	}
 }
@@ -1404,6 +1403,7 @@ void A_VileChase (AActor *actor)
 					} else {
 						corpsehit->height = P_ThingInfoHeight(info);	// [RH] Use real mobj height
 						corpsehit->radius = info->radius;	// [RH] Use real radius
+						P_UpdateThingProxy (corpsehit);
 					}
 
 					corpsehit->flags = info->flags;
@@ -1528,6 +1528,7 @@ void A_VileAttack (AActor *actor)
 	// move the fire between the vile and the player
 	fire->x = actor->target->x - FixedMul (24*FRACUNIT, finecosine[an]);
 	fire->y = actor->target->y - FixedMul (24*FRACUNIT, finesine[an]);
+	P_UpdateThingProxy (fire);
 	P_RadiusAttack (fire, actor, 70, MOD_UNKNOWN);
 }
 
@@ -1665,15 +1666,7 @@ void A_PainShootSkull (AActor *actor, angle_t angle)
 		return;
 
 	// count total number of skull currently on the level
-	count = 0;
-
-	TThinkerIterator<AActor> iterator;
-
-	while ( (other = iterator.Next ()) )
-	{
-		if (other->type == MT_SKULL)
-			count++;
-	}
+	count = AActor::CountOfType (MT_SKULL);
 
 	// if there are already 20 skulls on the level,
 	// don't spit another one
@@ -1867,13 +1860,10 @@ void A_BossDeath (AActor *actor)
 	if (i == players.size())
 		return; // no one left alive, so do not end game
 
-	// scan the remaining thinkers to see if all bosses are dead
-	TThinkerIterator<AActor> iterator;
-	AActor *other;
-
-	while ( (other = iterator.Next ()) )
+	// scan the remaining bosses to see if all of them are dead
+	for (AActor *other = AActor::FirstOfType (actor->type); other; other = other->NextOfType ())
 	{
-		if (other != actor && other->type == actor->type && other->health > 0)
+		if (other != actor && other->health > 0)
 		{
 			// other boss not dead
 			return;
@@ -1948,25 +1938,22 @@ struct brain_s brain;   // killough 3/26/98: global state of boss brain
 void P_SpawnBrainTargets (void)	// killough 3/26/98: renamed old function
 {
 	AActor *other;
-	TThinkerIterator<AActor> iterator;
 
 	// find all the target spots
 	numbraintargets = 0;
 	brain.targeton = 0;
 	brain.easy = 0;				// killough 3/26/98: always init easy to 0
 
-	while ( (other = iterator.Next ()) )
+	for (other = AActor::FirstOfType (MT_BOSSTARGET); other; other = other->NextOfType ())
 	{
-		if (other->type == MT_BOSSTARGET)
-		{	// killough 2/7/98: remove limit on icon landings:
-			if (numbraintargets >= numbraintargets_alloc)
-			{
-				braintargets = (AActor **)Realloc (braintargets,
-					(numbraintargets_alloc = numbraintargets_alloc ?
-					 numbraintargets_alloc*2 : 32) *sizeof *braintargets);
-			}
-			braintargets[numbraintargets++] = other;
+		// killough 2/7/98: remove limit on icon landings:
+		if (numbraintargets >= numbraintargets_alloc)
+		{
+			braintargets = (AActor **)Realloc (braintargets,
+				(numbraintargets_alloc = numbraintargets_alloc ?
+				 numbraintargets_alloc*2 : 32) *sizeof *braintargets);
 		}
+		braintargets[numbraintargets++] = other;
 	}
 }
 
@@ -2188,6 +2175,7 @@ void A_Gibify(AActor *mo) // denis - squash thing
 	mo->flags &= ~MF_SOLID;
 	mo->height = 0;
 	mo->radius = 0;
+	P_UpdateThingProxy (mo);
 }
 
 VERSION_CONTROL (p_enemy_cpp, "$Id: p_enemy.cpp 3174 2012-05-11 01:03:43Z mike $")
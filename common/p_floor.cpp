@@ -543,6 +543,8 @@ BOOL EV_DoChange (line_t *line, EChange changetype, int tag)
 		default:
 			break;
 		}
+
+		P_MarkSectorChanged(sec);
 	}
 	return rtn;
 }
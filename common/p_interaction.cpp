@@ -1026,6 +1026,8 @@ void P_KillMobj(AActor *source, AActor *target, AActor *inflictor, bool joinkill
 		target->special = 0;
 	}
 	// [RH] Also set the thing's tid to 0. [why?]
+	// Unhash it first or Destroy won't find it to unhash later
+	target->RemoveFromHash ();
 	target->tid = 0;
 
 	if (serverside && target->flags & MF_COUNTKILL)
@@ -30,6 +30,7 @@
 #endif
 
 #include <set>
+#include <vector>
 
 #define FLOATSPEED		(FRACUNIT*4)
 
@@ -183,8 +184,65 @@ extern fixed_t			lowfloor;
 void P_LineOpening (const line_t *linedef, fixed_t x, fixed_t y, fixed_t refx=MINFIXED, fixed_t refy=0);
 void P_LineOpeningIntercept(const line_t *line, const intercept_t *in);
 
+//
+// Things in the blockmap
+//
+// The thing iterators test position and radius first, so those are kept
+// with the block links in one dense array rather than in the actors. An
+// actor keeps its entry from when it is first linked until it is deleted,
+// so entries unlinked or relinked during an iteration can still be
+// followed, as the links in the actors could.
+//
+// Anything that changes x, y or radius of a linked thing without
+// relinking it has to call P_UpdateThingProxy.
+//
+typedef struct
+{
+	fixed_t		x, y;
+	fixed_t		radius;
+	AActor		*actor;
+	int			block;			// block it is linked into, or -1
+	int			bnext;			// next entry in the block, or -1
+	int			bprev;			// previous entry, or -1 for the first
+} thingproxy_t;
+
+extern TArray<thingproxy_t> thingproxies;
+
+void P_ClearThingProxies (void);
+void P_UpdateThingProxy (AActor *thing);
+void P_FreeThingProxy (AActor *thing);
+
 BOOL P_BlockLinesIterator (int x, int y, BOOL(*func)(line_t*) );
-BOOL P_BlockThingsIterator (int x, int y, BOOL(*func)(AActor*), AActor *start=NULL);
+BOOL P_BlockThingsIterator (int x, int y, BOOL(*func)(AActor*), int start=-1);
+
+// Calls func only for the things that come closer to (nx,ny) than their
+// radius plus dist on both axes
+BOOL P_BlockThingsNearIterator (int x, int y, fixed_t nx, fixed_t ny, fixed_t dist,
+								BOOL(*func)(AActor*), int start=-1);
+
+//
+// The things found by P_GatherBlockThings, in the order
+// P_BlockThingsIterator would visit them block by block.
+//
+typedef struct
+{
+	std::vector<int>		proxies;		// entries of thingproxies
+	std::vector<int>		blocks;			// block each was linked into
+
+	// every thing in the blocks, for the distance test
+	std::vector<int>		allproxies, allblocks;
+	std::vector<fixed_t>	xs, ys, radii;
+	std::vector<unsigned char> near;
+} blockthings_t;
+
+// Gathers the things in blocks xl..xh, yl..yh that come closer to (nx,ny)
+// than their radius plus dist on both axes, in one sweep of the blocks
+void P_GatherBlockThings (int xl, int yl, int xh, int yh, fixed_t nx, fixed_t ny,
+						  fixed_t dist, blockthings_t &found);
+
+// The actor of the i'th thing gathered, or NULL if it has been unlinked
+// from its block since, which an iteration over the block would skip
+AActor *P_GatheredThing (const blockthings_t &found, size_t i);
 
 #define PT_ADDLINES 	1
 #define PT_ADDTHINGS	2
@@ -305,7 +363,7 @@ extern int				bmapwidth;
 extern int				bmapheight; 	// in mapblocks
 extern fixed_t			bmaporgx;
 extern fixed_t			bmaporgy;		// origin of block map
-extern AActor** 		blocklinks; 	// for thing chains
+extern int* 			blocklinks; 	// first entry of thingproxies in each block, or -1
 
 extern std::set<short>	movable_sectors;
 
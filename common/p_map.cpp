@@ -217,7 +217,7 @@ BOOL P_TeleportMove (AActor *thing, fixed_t x, fixed_t y, fixed_t z, BOOL telefr
 
 		for (bx=xl ; bx<=xh ; bx++)
 			for (by=yl ; by<=yh ; by++)
-				if (!P_BlockThingsIterator(bx,by,PIT_StompThing))
+				if (!P_BlockThingsNearIterator(bx,by,tmx,tmy,tmthing->radius,PIT_StompThing))
 					return false;
 	}
 
@@ -852,10 +852,10 @@ bool P_CheckPosition (AActor *thing, fixed_t x, fixed_t y)
 		{
 			for (by = yl; by <= yh; by++)
 			{
-				AActor *robin = NULL;
+				int robin = -1;
 				do
 				{
-					if (!P_BlockThingsIterator (bx, by, PIT_CheckThing, robin))
+					if (!P_BlockThingsNearIterator (bx, by, tmx, tmy, thing->radius, PIT_CheckThing, robin))
 					{ // [RH] If a thing can be stepped up on, we need to continue checking
 					  // other things in the blocks and see if we hit something that is
 					  // definitely blocking. Otherwise, we need to check the lines, or we
@@ -871,7 +871,7 @@ bool P_CheckPosition (AActor *thing, fixed_t x, fixed_t y)
 							if (thingblocker == NULL ||	BlockingMobj->z > thingblocker->z)
 								thingblocker = BlockingMobj;
 
-							robin = BlockingMobj->bnext;
+							robin = thingproxies[BlockingMobj->blockproxy].bnext;
 							BlockingMobj = NULL;
 						}
 						else if (thing->player &&
@@ -886,7 +886,7 @@ bool P_CheckPosition (AActor *thing, fixed_t x, fixed_t y)
 							// Nothing is blocking us, but this actor potentially could
 							// if there is something else to step on.
 							fakedblocker = BlockingMobj;
-							robin = BlockingMobj->bnext;
+							robin = thingproxies[BlockingMobj->blockproxy].bnext;
 							BlockingMobj = NULL;
 						}
 						else
@@ -897,9 +897,9 @@ bool P_CheckPosition (AActor *thing, fixed_t x, fixed_t y)
 					}
 					else
 					{
-						robin = NULL;
+						robin = -1;
 					}
-				} while (robin);
+				} while (robin != -1);
 			}
 		}
 
@@ -916,7 +916,7 @@ bool P_CheckPosition (AActor *thing, fixed_t x, fixed_t y)
 		// vanilla Doom's check for blocking things
 		for (bx=xl ; bx<=xh ; bx++)
 			for (by=yl ; by<=yh ; by++)
-				if (!P_BlockThingsIterator(bx,by,PIT_CheckThing))
+				if (!P_BlockThingsNearIterator(bx,by,tmx,tmy,thing->radius,PIT_CheckThing))
 					return false;
 
 		// check lines
@@ -992,7 +992,7 @@ bool P_TestMobjZ (AActor *actor)
 
 	for (bx = xl; bx <= xh; bx++)
 		for (by = yl; by <= yh; by++)
-			if (!P_BlockThingsIterator (bx, by, PIT_CheckOnmobjZ))
+			if (!P_BlockThingsNearIterator (bx, by, tmx, tmy, actor->radius, PIT_CheckOnmobjZ))
 				return false;
 
 	return true;
@@ -2887,9 +2887,6 @@ BOOL PIT_ZdoomRadiusAttack (AActor *thing)
 //
 void P_RadiusAttack (AActor *spot, AActor *source, int damage, int mod)
 {
-	int 		x;
-	int 		y;
-
 	int 		xl;
 	int 		xh;
 	int 		yl;
@@ -2910,16 +2907,36 @@ void P_RadiusAttack (AActor *spot, AActor *source, int damage, int mod)
 	bombmod = mod;
 	M_ActorPositionToVec3(&bombvec, spot);
 
-	for (y=yl ; y<=yh ; y++)
+	if (!serverside)
+		return;
+
+	// A death state can explode right away, from inside P_DamageMobj
+	static blockthings_t bombthings;
+	static int bombdepth;
+	blockthings_t nestedthings;
+	blockthings_t &found = bombdepth ? nestedthings : bombthings;
+
+	// Both PIT_ functions leave things alone from damage+1 units outside
+	// their box; the extra unit covers the rounding of the float one
+	P_GatherBlockThings (xl, yl, xh, yh, spot->x, spot->y,
+						 (damage + 2) << FRACBITS, found);
+
+	bombdepth++;
+
+	for (size_t i = 0; i < found.proxies.size (); i++)
 	{
-		for (x=xl ; x<=xh ; x++)
-		{
-			if (co_zdoomphys)
-				P_BlockThingsIterator (x, y, PIT_ZdoomRadiusAttack);
-			else
-				P_BlockThingsIterator (x, y, PIT_RadiusAttack);
-		}
+		AActor *thing = P_GatheredThing (found, i);
+
+		if (!thing)
+			continue;
+
+		if (co_zdoomphys)
+			PIT_ZdoomRadiusAttack (thing);
+		else
+			PIT_RadiusAttack (thing);
 	}
+
+	bombdepth--;
 }
 
 
@@ -2964,6 +2981,7 @@ BOOL PIT_ChangeSector (AActor *thing)
 		if ((demoplayback || demorecording) && democlassic) {
 			thing->height = 0;
 			thing->radius = 0;
+			P_UpdateThingProxy (thing);
 		}
 
 		// keep checking
@@ -302,6 +302,84 @@ void P_LineOpeningIntercept(const line_t *line, const intercept_t *in)
 	P_LineOpening(line, crossx, crossy);
 }
 
+//
+// THING PROXIES
+//
+
+TArray<thingproxy_t> thingproxies;
+static TArray<int> freethingproxies;
+
+//
+// P_ClearThingProxies
+// Called when the blockmap for a new level is set up.
+//
+void P_ClearThingProxies (void)
+{
+	thingproxies.Clear ();
+	freethingproxies.Clear ();
+
+	// things kept from the last level get new entries when they are linked
+	TThinkerIterator<AActor> iterator;
+	AActor *mo;
+
+	while ( (mo = iterator.Next ()) )
+		mo->blockproxy = -1;
+}
+
+//
+// P_UnlinkThingProxy
+//
+static void P_UnlinkThingProxy (thingproxy_t &proxy)
+{
+	if (proxy.block == -1)
+		return;
+
+	if (proxy.bprev == -1)
+		blocklinks[proxy.block] = proxy.bnext;
+	else
+		thingproxies[proxy.bprev].bnext = proxy.bnext;
+
+	if (proxy.bnext != -1)
+		thingproxies[proxy.bnext].bprev = proxy.bprev;
+
+	// bnext is kept so an iteration that is on this thing can go on
+	proxy.block = -1;
+}
+
+//
+// P_UpdateThingProxy
+//
+void P_UpdateThingProxy (AActor *thing)
+{
+	if (thing->blockproxy == -1)
+		return;
+
+	thingproxy_t &proxy = thingproxies[thing->blockproxy];
+
+	proxy.x = thing->x;
+	proxy.y = thing->y;
+	proxy.radius = thing->radius;
+}
+
+//
+// P_FreeThingProxy
+// Called when the actor is deleted. Nothing iterates over the blockmap
+// then, so the entry can be reused by the next thing linked.
+//
+void P_FreeThingProxy (AActor *thing)
+{
+	if (thing->blockproxy == -1)
+		return;
+
+	// still linked if MF_NOBLOCKMAP was set after it was linked
+	P_UnlinkThingProxy (thingproxies[thing->blockproxy]);
+
+	thingproxies[thing->blockproxy].actor = NULL;
+	freethingproxies.Push (thing->blockproxy);
+	thing->blockproxy = -1;
+}
+
+
 //
 // THING POSITION SETTING
 //
@@ -350,19 +428,12 @@ void AActor::UnlinkFromWorld ()
 		touching_sectorlist = NULL; //to be restored by P_SetThingPosition
 	}
 
-	if ( !(flags & MF_NOBLOCKMAP) )
+	if ( !(flags & MF_NOBLOCKMAP) && blockproxy != -1 )
 	{
-		// killough 8/11/98: simpler scheme using pointers-to-pointers for prev
-		// pointers, allows head node pointers to be treated like everything else
-		//
-		// Also more robust, since it doesn't depend on current position for
-		// unlinking. Old method required computing head node based on position
-		// at time of unlinking, assuming it was the same position as during
-		// linking.
-
-		AActor *_bnext, **_bprev = bprev;
-		if (_bprev && (*_bprev = _bnext = bnext))	// unlink from block map
-			_bnext->bprev = _bprev;
+		// The links don't depend on the current position, so things are
+		// unlinked from the block they were linked into even if they were
+		// moved since.
+		P_UnlinkThingProxy (thingproxies[blockproxy]);
 	}
 
 	subsector = NULL;
@@ -420,21 +491,36 @@ void AActor::LinkToWorld ()
 		int blockx = (x - bmaporgx)>>MAPBLOCKSHIFT;
 		int blocky = (y - bmaporgy)>>MAPBLOCKSHIFT;
 
-		if (blockx >= 0 && blockx < bmapwidth && blocky >= 0 && blocky < bmapheight)
-        {
-			// killough 8/11/98: simpler scheme using pointer-to-pointer prev
-			// pointers, allows head nodes to be treated like everything else
+		if (blockproxy == -1)
+		{
+			if (!freethingproxies.Pop (blockproxy))
+				blockproxy = thingproxies.Push (thingproxy_t());
+			thingproxies[blockproxy].block = -1;
+		}
 
-			AActor **link = &blocklinks[blocky*bmapwidth+blockx];
-			AActor *_bnext = *link;
+		thingproxy_t &proxy = thingproxies[blockproxy];
 
-			if ((bnext = _bnext))
-				_bnext->bprev = &bnext;
-			bprev = link;
-			*link = this;
+		// in case MF_NOBLOCKMAP was set and cleared while it was linked
+		P_UnlinkThingProxy (proxy);
+
+		proxy.x = x;
+		proxy.y = y;
+		proxy.radius = radius;
+		proxy.actor = this;
+
+		if (blockx >= 0 && blockx < bmapwidth && blocky >= 0 && blocky < bmapheight)
+        {
+			int block = blocky*bmapwidth+blockx;
+			int next = blocklinks[block];
+
+			if ((proxy.bnext = next) != -1)
+				thingproxies[next].bprev = blockproxy;
+			proxy.bprev = -1;
+			proxy.block = block;
+			blocklinks[block] = blockproxy;
 		}
 		else		// thing is off the map
-			bnext = NULL, bprev = NULL;
+			proxy.bnext = proxy.bprev = -1;
 	}
 }
 
@@ -529,25 +615,132 @@ BOOL P_BlockLinesIterator (int x, int y, BOOL(*func)(line_t*))
 //
 // P_BlockThingsIterator
 //
-BOOL P_BlockThingsIterator (int x, int y, BOOL(*func)(AActor*), AActor *actor)
+// func may link and unlink things, which can grow thingproxies, so the
+// entries are looked up again after each call.
+//
+BOOL P_BlockThingsIterator (int x, int y, BOOL(*func)(AActor*), int start)
 {
 	if (x<0 || y<0 || x>=bmapwidth || y>=bmapheight)
 		return true;
 	else
 	{
-		AActor *mobj;
+		int i;
 
-		for (mobj = (actor != NULL ? actor : blocklinks[y*bmapwidth+x]) ;
-			 mobj ;
-			 mobj = mobj->bnext)
+		for (i = (start != -1 ? start : blocklinks[y*bmapwidth+x]) ;
+			 i != -1 ;
+			 i = thingproxies[i].bnext)
 		{
-			if (!func (mobj))
+			if (!func (thingproxies[i].actor))
 				return false;
 		}
 	}
 	return true;
 }
 
+//
+// P_BlockThingsNearIterator
+// Same, but things that are too far away are skipped without looking at
+// the actors. For the PIT_ functions that would have returned true for
+// them anyway, after the same test on the actor's fields.
+//
+BOOL P_BlockThingsNearIterator (int x, int y, fixed_t nx, fixed_t ny, fixed_t dist,
+								BOOL(*func)(AActor*), int start)
+{
+	if (x<0 || y<0 || x>=bmapwidth || y>=bmapheight)
+		return true;
+	else
+	{
+		int i;
+
+		for (i = (start != -1 ? start : blocklinks[y*bmapwidth+x]) ;
+			 i != -1 ;
+			 i = thingproxies[i].bnext)
+		{
+			const thingproxy_t &proxy = thingproxies[i];
+			fixed_t blockdist = proxy.radius + dist;
+
+			if (abs(proxy.x - nx) >= blockdist || abs(proxy.y - ny) >= blockdist)
+				continue;
+
+			if (!func (proxy.actor))
+				return false;
+		}
+	}
+	return true;
+}
+
+//
+// P_GatherBlockThings
+//
+void P_GatherBlockThings (int xl, int yl, int xh, int yh, fixed_t nx, fixed_t ny,
+						  fixed_t dist, blockthings_t &found)
+{
+	int x, y, i;
+	size_t j, count;
+
+	found.proxies.clear ();
+	found.blocks.clear ();
+	found.allproxies.clear ();
+	found.allblocks.clear ();
+	found.xs.clear ();
+	found.ys.clear ();
+	found.radii.clear ();
+
+	for (y = MAX (yl, 0) ; y <= yh && y < bmapheight ; y++)
+	{
+		for (x = MAX (xl, 0) ; x <= xh && x < bmapwidth ; x++)
+		{
+			int block = y*bmapwidth+x;
+
+			for (i = blocklinks[block] ; i != -1 ; i = thingproxies[i].bnext)
+			{
+				const thingproxy_t &proxy = thingproxies[i];
+
+				found.allproxies.push_back (i);
+				found.allblocks.push_back (block);
+				found.xs.push_back (proxy.x);
+				found.ys.push_back (proxy.y);
+				found.radii.push_back (proxy.radius);
+			}
+		}
+	}
+
+	// Same test as P_BlockThingsNearIterator, without branches so the
+	// compiler can do several things at once
+	count = found.allproxies.size ();
+	found.near.resize (count);
+
+	for (j = 0 ; j < count ; j++)
+	{
+		fixed_t blockdist = found.radii[j] + dist;
+
+		found.near[j] = (abs (found.xs[j] - nx) < blockdist) &
+						(abs (found.ys[j] - ny) < blockdist);
+	}
+
+	for (j = 0 ; j < count ; j++)
+	{
+		if (found.near[j])
+		{
+			found.proxies.push_back (found.allproxies[j]);
+			found.blocks.push_back (found.allblocks[j]);
+		}
+	}
+}
+
+//
+// P_GatheredThing
+//
+AActor *P_GatheredThing (const blockthings_t &found, size_t i)
+{
+	const thingproxy_t &proxy = thingproxies[found.proxies[i]];
+
+	if (proxy.block != found.blocks[i])
+		return NULL;
+
+	return proxy.actor;
+}
+
 
 
 //
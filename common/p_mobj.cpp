@@ -83,6 +83,9 @@ AActor::~AActor ()
 
     // Zero all pointers generated by this->ptr()
     self.update_all(NULL);
+
+	RemoveFromTypeList ();
+	P_FreeThingProxy (this);
 }
 
 void MapThing::Serialize (FArchive &arc)
@@ -101,14 +104,14 @@ void MapThing::Serialize (FArchive &arc)
 
 AActor::AActor () :
     x(0), y(0), z(0), snext(NULL), sprev(NULL), angle(0), sprite(SPR_UNKN), frame(0),
-    pitch(0), roll(0), effects(0), bnext(NULL), bprev(NULL), subsector(NULL),
+    pitch(0), roll(0), effects(0), blockproxy(-1), subsector(NULL),
     floorz(0), ceilingz(0), dropoffz(0), floorsector(NULL), radius(0), height(0),
     momx(0), momy(0), momz(0), validcount(0), type(MT_UNKNOWNTHING), info(NULL), tics(0), state(NULL),
     flags(0), flags2(0), special1(0), special2(0), health(0), movedir(0), movecount(0),
     visdir(0), reactiontime(0), threshold(0), player(NULL), lastlook(0), special(0), inext(NULL),
-    iprev(NULL), translation(NULL), translucency(0), waterlevel(0), gear(0), onground(false),
+    iprev(NULL), tnext(NULL), tprev(NULL), translation(NULL), translucency(0), waterlevel(0), gear(0), onground(false),
     touching_sectorlist(NULL), deadtic(0), oldframe(0), rndindex(0), netid(0),
-    tid(0)
+    tid(0), prevx(0), prevy(0), prevz(0), prevangle(0), prevtic(-1)
 {
 	memset(args, 0, sizeof(args));
 	self.init(this);
@@ -118,7 +121,7 @@ AActor::AActor (const AActor &other) :
     x(other.x), y(other.y), z(other.z), snext(other.snext), sprev(other.sprev),
     angle(other.angle), sprite(other.sprite), frame(other.frame),
     pitch(other.pitch), roll(other.roll), effects(other.effects),
-    bnext(other.bnext), bprev(other.bprev), subsector(other.subsector),
+    blockproxy(-1), subsector(other.subsector),
     floorz(other.floorz), ceilingz(other.ceilingz), dropoffz(other.dropoffz),
     floorsector(other.floorsector),	radius(other.radius), height(other.height), momx(other.momx),
 	momy(other.momy), momz(other.momz), validcount(other.validcount),
@@ -127,11 +130,14 @@ AActor::AActor (const AActor &other) :
 	special2(other.special2), health(other.health), movedir(other.movedir),
 	movecount(other.movecount), visdir(other.visdir), reactiontime(other.reactiontime),
     threshold(other.threshold), player(other.player), lastlook(other.lastlook),
-    special(other.special),inext(other.inext), iprev(other.iprev), translation(other.translation),
+    special(other.special),inext(other.inext), iprev(other.iprev), tnext(NULL), tprev(NULL),
+    translation(other.translation),
     translucency(other.translucency), waterlevel(other.waterlevel), gear(other.gear),
     onground(other.onground), touching_sectorlist(other.touching_sectorlist),
     deadtic(other.deadtic), oldframe(other.oldframe),
-    rndindex(other.rndindex), netid(other.netid), tid(other.tid)
+    rndindex(other.rndindex), netid(other.netid), tid(other.tid),
+    prevx(other.prevx), prevy(other.prevy), prevz(other.prevz),
+    prevangle(other.prevangle), prevtic(-1)
 {
 	memcpy(args, other.args, sizeof(args));
 	self.init(this);
@@ -139,6 +145,11 @@ AActor::AActor (const AActor &other) :
 
 AActor &AActor::operator= (const AActor &other)
 {
+	bool relink = (type != other.type && (tprev || TypeHead[type] == this));
+
+	if (relink)
+		RemoveFromTypeList ();
+
 	x = other.x;
     y = other.y;
     z = other.z;
@@ -150,8 +161,6 @@ AActor &AActor::operator= (const AActor &other)
     pitch = other.pitch;
     roll = other.roll;
     effects = other.effects;
-    bnext = other.bnext;
-    bprev = other.bprev;
     subsector = other.subsector;
     floorz = other.floorz;
     ceilingz = other.ceilingz;
@@ -192,9 +201,20 @@ AActor &AActor::operator= (const AActor &other)
     rndindex = other.rndindex;
     netid = other.netid;
     tid = other.tid;
+    prevx = other.prevx;
+    prevy = other.prevy;
+    prevz = other.prevz;
+    prevangle = other.prevangle;
+    prevtic = other.prevtic;
     special = other.special;
     memcpy(args, other.args, sizeof(args));
 
+	if (relink)
+		AddToTypeList ();
+
+	// the block links stay this actor's own
+	P_UpdateThingProxy (this);
+
 	return *this;
 }
 
@@ -206,14 +226,14 @@ AActor &AActor::operator= (const AActor &other)
 
 AActor::AActor (fixed_t ix, fixed_t iy, fixed_t iz, mobjtype_t itype) :
     x(0), y(0), z(0), snext(NULL), sprev(NULL), angle(0), sprite(SPR_UNKN), frame(0),
-    pitch(0), roll(0), effects(0), bnext(NULL), bprev(NULL), subsector(NULL),
+    pitch(0), roll(0), effects(0), blockproxy(-1), subsector(NULL),
     floorz(0), ceilingz(0), dropoffz(0), floorsector(NULL), radius(0), height(0), momx(0), momy(0), momz(0),
     validcount(0), type(MT_UNKNOWNTHING), info(NULL), tics(0), state(NULL), flags(0), flags2(0),
     special1(0), special2(0), health(0), movedir(0), movecount(0), visdir(0),
     reactiontime(0), threshold(0), player(NULL), lastlook(0), special(0), inext(NULL),
-    iprev(NULL), translation(NULL), translucency(0), waterlevel(0), gear(0), onground(false),
+    iprev(NULL), tnext(NULL), tprev(NULL), translation(NULL), translucency(0), waterlevel(0), gear(0), onground(false),
     touching_sectorlist(NULL), deadtic(0), oldframe(0), rndindex(0), netid(0),
-    tid(0)
+    tid(0), prevx(0), prevy(0), prevz(0), prevangle(0), prevtic(-1)
 {
 	state_t *st;
 
@@ -226,6 +246,7 @@ AActor::AActor (fixed_t ix, fixed_t iy, fixed_t iz, mobjtype_t itype) :
 	self.init(this);
 	info = &mobjinfo[itype];
 	type = itype;
+	AddToTypeList ();
 	x = ix;
 	y = iy;
 	radius = info->radius;
@@ -381,6 +402,7 @@ void AActor::Destroy ()
 
 	// [RH] Unlink from tid chain
 	RemoveFromHash ();
+	RemoveFromTypeList ();
 
 	// unlink from sector and block lists
 	UnlinkFromWorld ();
@@ -838,6 +860,7 @@ void AActor::Serialize (FArchive &arc)
 		floorsector = subsector->sector;
 
 		AddToHash ();
+		AddToTypeList ();
 		if(playerid && validplayer(idplayer(playerid)))
 		{
 			player = &idplayer(playerid);
@@ -1584,6 +1607,8 @@ void AActor::AddToHash ()
 
 		inext = TIDHash[hash];
 		iprev = NULL;
+		if (inext)
+			inext->iprev = this;
 		TIDHash[hash] = this;
 	}
 }
@@ -1677,6 +1702,58 @@ AActor *AActor::FindGoal (const AActor *actor, int tid, int kind)
 
 // <------- [RH] End new functions
 
+AActor *AActor::TypeHead[NUMMOBJTYPES];
+AActor *AActor::TypeTail[NUMMOBJTYPES];
+int AActor::TypeCount[NUMMOBJTYPES];
+int AActor::ActorCount;
+
+//
+// AActor::AddToTypeList
+//
+// Appends an mobj to the list of mobjs of its type, so each list stays
+// in the same order as the thinker list and walking it finds mobjs in
+// the order a walk over every thinker would.
+//
+void AActor::AddToTypeList ()
+{
+	tnext = NULL;
+	tprev = TypeTail[type];
+
+	if (tprev)
+		tprev->tnext = this;
+	else
+		TypeHead[type] = this;
+
+	TypeTail[type] = this;
+	TypeCount[type]++;
+	ActorCount++;
+}
+
+//
+// AActor::RemoveFromTypeList
+//
+// Does nothing if the mobj isn't in its list.
+//
+void AActor::RemoveFromTypeList ()
+{
+	if (!tprev && TypeHead[type] != this)
+		return;
+
+	if (tprev)
+		tprev->tnext = tnext;
+	else
+		TypeHead[type] = tnext;
+
+	if (tnext)
+		tnext->tprev = tprev;
+	else
+		TypeTail[type] = tprev;
+
+	tnext = tprev = NULL;
+	TypeCount[type]--;
+	ActorCount--;
+}
+
 //
 // GAME SPAWN FUNCTIONS
 //
@@ -1754,6 +1831,7 @@ bool P_CheckMissileSpawn (AActor* th)
 	th->x += th->momx>>1;
 	th->y += th->momy>>1;
 	th->z += th->momz>>1;
+	P_UpdateThingProxy (th);
 
 	// killough 3/15/98: no dropoff (really = don't care for missiles)
 
@@ -2385,6 +2463,7 @@ void P_SpawnMapThing (mapthing2_t *mthing, int position)
 	{
 		mobj->radius = mobj->args[0] << FRACBITS;
 		mobj->height = mobj->args[1] << FRACBITS;
+		P_UpdateThingProxy (mobj);
 	}
 
 	if (mobj->tics > 0)
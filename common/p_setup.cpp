@@ -27,6 +27,8 @@
 #include <stdlib.h>
 #include <math.h>
 #include <set>
+#include <string>
+#include <vector>
 
 #include "m_alloc.h"
 #include "vectors.h"
@@ -45,6 +47,8 @@
 #include "p_lnspec.h"
 #include "v_palette.h"
 #include "c_console.h"
+#include "d_startup.h"
+#include "md5.h"
 
 #include "p_setup.h"
 
@@ -103,11 +107,12 @@ int 			bmapheight; 	// size in mapblocks
 
 int				*blockmap;		// int for larger maps ([RH] Made int because BOOM does)
 int				*blockmaplump;	// offsets in blockmap are from here
+static int		blockmapsize;	// ints in blockmaplump
 
 fixed_t 		bmaporgx;		// origin of block map
 fixed_t 		bmaporgy;
 
-AActor**		blocklinks;		// for thing chains
+int*			blocklinks;		// for thing chains, into thingproxies
 
 
 
@@ -368,6 +373,7 @@ void P_LoadSectors (int lump)
 	// denis - properly construct sectors so that smart pointers they contain don't get screwed
 	sectors = new sector_t[numsectors];
 	memset(sectors, 0, sizeof(sector_t)*numsectors);
+	P_ClearChangedSectors();
 
 	data = (byte *)W_CacheLumpNum (lump, PU_STATIC);
 
@@ -1175,7 +1181,8 @@ void P_CreateBlockMap()
 	}
 
 	// Create the blockmap lump
-	blockmaplump = (int *)Z_Malloc(sizeof(*blockmaplump) * (4+NBlocks+linetotal), PU_LEVEL, 0);
+	blockmapsize = 4+NBlocks+linetotal;
+	blockmaplump = (int *)Z_Malloc(sizeof(*blockmaplump) * blockmapsize, PU_LEVEL, 0);
 
 	// blockmap header
 	//
@@ -1223,6 +1230,273 @@ void P_CreateBlockMap()
 // jff 10/6/98
 // End new code added to speed up calculation of internal blockmap
 
+//
+// Level cache
+//
+// The blockmap and the line lists of the sectors are what take longest
+// to build on large maps, since P_GroupLines looks at every line for
+// every sector. Both are saved to a file named after the MD5 of the map
+// lumps they are built from, and read back from there on later loads of
+// the same map. Lines are saved as numbers and turned back into pointers
+// when they are read.
+//
+
+EXTERN_CVAR (levelcache)
+
+#define LEVELCACHE_MAGIC	"ODALVC01"
+
+typedef struct
+{
+	char	magic[8];
+	int		numvertexes;
+	int		numsectors;
+	int		numlines;
+	int		numsubsectors;
+	int		numsegs;
+	int		blockmapsize;
+	int		numsectorlines;		// entries in the line lists of all sectors
+
+	// followed by the blockmap, the line lists of the sectors in order,
+	// and the soundorg and blockbox of each sector
+} levelcacheheader_t;
+
+#define LEVELCACHE_SECTORINFO	6
+
+static std::string			levelcachename;
+static std::vector<byte>	levelcachedata;		// the whole file, if it was good
+static bool					levelcacheread;		// nothing needs to be saved
+
+//
+// P_OpenLevelCache
+// Reads the cache file for the map at lumpnum. A file that is cut short
+// or whose blockmap points outside itself is thrown away.
+//
+static void P_OpenLevelCache (int lumpnum)
+{
+	static const int cachedlumps[] =
+	{
+		ML_VERTEXES, ML_LINEDEFS, ML_SIDEDEFS, ML_SECTORS,
+		ML_SEGS, ML_SSECTORS, ML_BLOCKMAP
+	};
+	md5_state_t state;
+	md5_byte_t digest[16];
+	char name[64];
+	size_t i;
+
+	levelcachename.clear ();
+	levelcachedata.clear ();
+	levelcacheread = false;
+
+	if (!levelcache)
+		return;
+
+	md5_init (&state);
+	for (i = 0; i < sizeof(cachedlumps) / sizeof(cachedlumps[0]); i++)
+	{
+		unsigned lump = lumpnum + cachedlumps[i];
+		int length = W_LumpLength (lump);
+
+		md5_append (&state, (const md5_byte_t *)&length, sizeof(length));
+		md5_append (&state, (const md5_byte_t *)W_CacheLumpNum (lump, PU_CACHE), length);
+	}
+
+	// both change how the map lumps are read
+	md5_byte_t flags[2] = { HasBehavior, Args.CheckParm ("-blockmap") != 0 };
+	md5_append (&state, flags, sizeof(flags));
+	md5_finish (&state, digest);
+
+	strcpy (name, "levelcache-");
+	for (i = 0; i < 16; i++)
+		sprintf (name + 11 + i * 2, "%02X", digest[i]);
+	strcat (name, ".dat");
+
+	levelcachename = I_GetUserFileName (name);
+
+	FILE *fp = fopen (levelcachename.c_str (), "rb");
+	if (!fp)
+		return;
+
+	fseek (fp, 0, SEEK_END);
+	long length = ftell (fp);
+	fseek (fp, 0, SEEK_SET);
+
+	bool ok = length >= (long)sizeof(levelcacheheader_t);
+
+	if (ok)
+	{
+		levelcachedata.resize (length);
+		ok = fread (&levelcachedata[0], length, 1, fp) == 1;
+	}
+
+	fclose (fp);
+
+	if (ok)
+	{
+		const levelcacheheader_t *header = (levelcacheheader_t *)&levelcachedata[0];
+		const int *bmap = (const int *)(header + 1);
+
+		ok = !memcmp (header->magic, LEVELCACHE_MAGIC, 8)
+			&& header->numsectors >= 0 && header->numsectorlines >= 0
+			&& header->blockmapsize >= 4
+			&& length == (long)(sizeof(*header) + sizeof(int) *
+				((QWORD)header->blockmapsize + header->numsectorlines +
+				 (QWORD)header->numsectors * LEVELCACHE_SECTORINFO));
+
+		// every block's list has to start and end inside the blockmap, and
+		// hold only lines the map has
+		if (ok)
+		{
+			QWORD blocks = (QWORD)bmap[2] * bmap[3];
+
+			ok = bmap[2] >= 0 && bmap[3] >= 0 && blocks <= (QWORD)header->blockmapsize - 4;
+
+			for (i = 0; ok && i < blocks; i++)
+			{
+				int j = bmap[4 + i];
+
+				ok = j >= 4 && j < header->blockmapsize;
+
+				for ( ; ok && bmap[j] != -1; j++)
+					ok = bmap[j] >= 0 && bmap[j] < header->numlines
+						&& j + 1 < header->blockmapsize;
+			}
+		}
+	}
+
+	if (!ok)
+	{
+		levelcachedata.clear ();
+		remove (levelcachename.c_str ());
+	}
+}
+
+//
+// P_LevelCacheHeader
+// The header of the cache file, if it is for a map with these counts.
+//
+static const levelcacheheader_t *P_LevelCacheHeader (void)
+{
+	if (levelcachedata.empty ())
+		return NULL;
+
+	const levelcacheheader_t *header = (levelcacheheader_t *)&levelcachedata[0];
+
+	if (header->numvertexes != numvertexes || header->numsectors != numsectors
+		|| header->numlines != numlines)
+		return NULL;
+
+	return header;
+}
+
+//
+// P_ReadCachedBlockMap
+//
+static bool P_ReadCachedBlockMap (void)
+{
+	const levelcacheheader_t *header = P_LevelCacheHeader ();
+
+	if (!header)
+		return false;
+
+	blockmapsize = header->blockmapsize;
+	blockmaplump = (int *)Z_Malloc (sizeof(*blockmaplump) * blockmapsize, PU_LEVEL, 0);
+	memcpy (blockmaplump, header + 1, sizeof(*blockmaplump) * blockmapsize);
+
+	return true;
+}
+
+//
+// P_ReadCachedSectorLines
+// Fills in the line lists, soundorgs and blockboxes of the sectors, once
+// their linecounts are known.
+//
+static bool P_ReadCachedSectorLines (int total)
+{
+	const levelcacheheader_t *header = P_LevelCacheHeader ();
+
+	if (!header || header->numsubsectors != numsubsectors
+		|| header->numsegs != numsegs || header->numsectorlines != total)
+		return false;
+
+	const int *list = (const int *)(header + 1) + header->blockmapsize;
+	const int *info = list + total;
+	int i, j;
+
+	for (i = 0; i < total; i++)
+		if (list[i] < 0 || list[i] >= numlines)
+			return false;
+
+	line_t **linebuffer = (line_t **)Z_Malloc (total*sizeof(line_t *), PU_LEVEL, 0);
+	sector_t *sector = sectors;
+
+	for (i = 0; i < numsectors; i++, sector++, info += LEVELCACHE_SECTORINFO)
+	{
+		sector->lines = linebuffer;
+		for (j = 0; j < sector->linecount; j++)
+			*linebuffer++ = &lines[*list++];
+
+		sector->soundorg[0] = info[0];
+		sector->soundorg[1] = info[1];
+		for (j = 0; j < 4; j++)
+			sector->blockbox[j] = info[2 + j];
+	}
+
+	levelcacheread = true;
+	return true;
+}
+
+//
+// P_SaveLevelCache
+// Writes what was built for the map, unless it was read from the cache.
+//
+static void P_SaveLevelCache (void)
+{
+	std::vector<int> sectorlines, sectorinfo;
+	levelcacheheader_t header;
+	int i, j;
+
+	levelcachedata.clear ();
+
+	if (levelcacheread || levelcachename.empty ())
+		return;
+
+	for (i = 0; i < numsectors; i++)
+	{
+		sector_t *sector = &sectors[i];
+
+		for (j = 0; j < sector->linecount; j++)
+			sectorlines.push_back (sector->lines[j] - lines);
+
+		sectorinfo.push_back (sector->soundorg[0]);
+		sectorinfo.push_back (sector->soundorg[1]);
+		for (j = 0; j < 4; j++)
+			sectorinfo.push_back (sector->blockbox[j]);
+	}
+
+	memcpy (header.magic, LEVELCACHE_MAGIC, 8);
+	header.numvertexes = numvertexes;
+	header.numsectors = numsectors;
+	header.numlines = numlines;
+	header.numsubsectors = numsubsectors;
+	header.numsegs = numsegs;
+	header.blockmapsize = blockmapsize;
+	header.numsectorlines = sectorlines.size ();
+
+	FILE *fp = fopen (levelcachename.c_str (), "wb");
+	if (!fp)
+		return;
+
+	bool ok = fwrite (&header, sizeof(header), 1, fp) == 1
+		&& fwrite (blockmaplump, sizeof(*blockmaplump) * blockmapsize, 1, fp) == 1
+		&& (sectorlines.empty ()
+			|| fwrite (&sectorlines[0], sizeof(int) * sectorlines.size (), 1, fp) == 1)
+		&& (sectorinfo.empty ()
+			|| fwrite (&sectorinfo[0], sizeof(int) * sectorinfo.size (), 1, fp) == 1);
+
+	if (fclose (fp) != 0 || !ok)
+		remove (levelcachename.c_str ());
+}
+
 //
 // P_LoadBlockMap
 //
@@ -1232,12 +1506,17 @@ void P_LoadBlockMap (int lump)
 {
 	int count;
 
-	if (Args.CheckParm("-blockmap") || (count = W_LumpLength(lump)/2) >= 0x10000 || count < 4) 
+	if (P_ReadCachedBlockMap ())
+	{
+		// built on an earlier load of this map
+	}
+	else if (Args.CheckParm("-blockmap") || (count = W_LumpLength(lump)/2) >= 0x10000 || count < 4)
 		P_CreateBlockMap();
 	else
 	{
 		short *wadblockmaplump = (short *)W_CacheLumpNum (lump, PU_LEVEL);
 		int i;
+		blockmapsize = count;
 		blockmaplump = (int *)Z_Malloc(sizeof(*blockmaplump) * count, PU_LEVEL, 0);
 
 		// killough 3/1/98: Expand wad blockmap into larger internal one,
@@ -1266,8 +1545,9 @@ void P_LoadBlockMap (int lump)
 
 	// clear out mobj chains
 	count = sizeof(*blocklinks) * bmapwidth*bmapheight;
-	blocklinks = (AActor **)Z_Malloc (count, PU_LEVEL, 0);
-	memset (blocklinks, 0, count);
+	blocklinks = (int *)Z_Malloc (count, PU_LEVEL, 0);
+	memset (blocklinks, 0xff, count);	// no things, -1
+	P_ClearThingProxies ();
 	blockmap = blockmaplump+4;
 }
 
@@ -1321,6 +1601,9 @@ void P_GroupLines (void)
 		}
 	}
 
+	if (P_ReadCachedSectorLines (total))
+		return;
+
 	// build line tables for each sector
 	linebuffer = (line_t **)Z_Malloc (total*sizeof(line_t *), PU_LEVEL, 0);
 	sector = sectors;
@@ -1461,6 +1744,8 @@ void P_SetupLevel (char *lumpname, int position)
 	//		LINEDEFS and THINGS need to be handled accordingly.
 	//		If it is, we also need to distinguish between projectile cross and hit
 	HasBehavior = W_CheckLumpName (lumpnum+ML_BEHAVIOR, "BEHAVIOR");
+
+	P_OpenLevelCache (lumpnum);
 	//oldshootactivation = !HasBehavior;
 
 	// note: most of this ordering is important
@@ -1504,6 +1789,7 @@ void P_SetupLevel (char *lumpname, int position)
 		}
 	}
 	P_GroupLines ();
+	P_SaveLevelCache ();
 	P_SetupSlopes();
 
     po_NumPolyobjs = 0;
@@ -1551,6 +1837,9 @@ void P_SetupLevel (char *lumpname, int position)
 	// preload graphics
 	if (precache)
 		R_PrecacheLevel ();
+
+	// free whatever was prefetched but not used
+	W_CancelPrefetch ();
 }
 
 //
@@ -1560,7 +1849,9 @@ void P_Init (void)
 {
 	P_InitSwitchList ();
 	P_InitPicAnims ();
+	D_BeginStartupStage ("R_InitSprites");
 	R_InitSprites (sprnames);
+	D_EndStartupStage ();
 }
 
 
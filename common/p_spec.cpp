@@ -31,6 +31,8 @@
 //-----------------------------------------------------------------------------
 
 
+#include <algorithm>
+
 #include "m_alloc.h"
 #include "doomdef.h"
 #include "doomstat.h"
@@ -65,6 +67,45 @@
 
 std::list<movingsector_t> movingsectors;
 
+// Sectors that have been changed by a mover this level and the current
+// change generation.  The server advances the generation each time it sends
+// packets so that clients only need the sectors changed since the last
+// generation they acknowledged.
+std::vector<int> changedsectors;
+unsigned int sectorgeneration = 1;
+
+//
+// P_MarkSectorChanged
+//
+// Stamps the sector with the current change generation, adding it to the
+// sorted list of changed sectors the first time it changes.
+//
+void P_MarkSectorChanged(sector_t *sector)
+{
+	if (!sector)
+		return;
+
+	if (sector->changegen == 0)
+	{
+		int sectornum = sector - sectors;
+		std::vector<int>::iterator itr =
+			std::lower_bound(changedsectors.begin(), changedsectors.end(), sectornum);
+		changedsectors.insert(itr, sectornum);
+	}
+
+	sector->changegen = sectorgeneration;
+}
+
+//
+// P_ClearChangedSectors
+//
+// Empties the list of changed sectors when a new level is loaded.
+//
+void P_ClearChangedSectors()
+{
+	changedsectors.clear();
+}
+
 //
 // P_FindMovingSector
 //
@@ -109,6 +150,7 @@ void P_AddMovingCeiling(sector_t *sector)
 	movesec->moving_ceiling = true;
 
 	sector->moveable = true;
+	P_MarkSectorChanged(sector);
 	// [SL] 2012-05-04 - Register this sector as a moveable sector with the
 	// reconciliation system for unlagging
 	Unlag::getInstance().registerSector(sector);
@@ -144,6 +186,7 @@ void P_AddMovingFloor(sector_t *sector)
 	movesec->moving_floor = true;
 
 	sector->moveable = true;
+	P_MarkSectorChanged(sector);
 	// [SL] 2012-05-04 - Register this sector as a moveable sector with the
 	// reconciliation system for unlagging
 	Unlag::getInstance().registerSector(sector);
@@ -29,6 +29,7 @@
 #define __P_SPEC__
 
 #include <list>
+#include <vector>
 #include "dsectoreffect.h"
 
 typedef struct movingsector_s
@@ -52,6 +53,13 @@ void P_RemoveMovingFloor(sector_t *sector);
 bool P_MovingCeilingCompleted(sector_t *sector);
 bool P_MovingFloorCompleted(sector_t *sector);
 
+// Sector numbers of every sector changed by a mover this level, sorted
+extern std::vector<int> changedsectors;
+extern unsigned int sectorgeneration;
+
+void P_MarkSectorChanged(sector_t *sector);
+void P_ClearChangedSectors();
+
 //jff 2/23/98 identify the special classes that can share sectors
 
 typedef enum
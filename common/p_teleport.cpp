@@ -124,7 +124,6 @@ BOOL EV_LineTeleport (line_t *line, int side, AActor *thing)
 	fixed_t 	oldz;
 	player_t	*player;
 	sector_t*	sector;
-	TThinkerIterator<AActor> iterator;
 
     // don't teleport missiles
     if (thing->flags & MF_MISSILE)
@@ -137,16 +136,15 @@ BOOL EV_LineTeleport (line_t *line, int side, AActor *thing)
 
 	tag = line->id;
 	// Yeah, cycle through all of them...
+	// One walk over the teleportmen is shared by every tagged sector, so
+	// later sectors only see the ones after those already looked at.
+	m = AActor::FirstOfType (MT_TELEPORTMAN);
 	for (i = 0; i < numsectors; i++)
 	{
 		if (sectors[ i ].tag == tag )
 		{
-			while ( (m = iterator.Next ()) )
+			for ( ; m; m = m->NextOfType ())
 			{
-				// not a teleportman
-				if (m->type != MT_TELEPORTMAN)
-					continue;
-				
 				sector = m->subsector->sector;
 				// wrong sector
 				if (sector-sectors != i )
@@ -704,6 +704,7 @@ void P_TranslateTeleportThings (void)
 
 						// It's a teleportman, so set it's tid to match
 						// the sector's tag.
+						other->RemoveFromHash ();
 						other->tid = lines[i].args[0];
 						other->AddToHash ();
 
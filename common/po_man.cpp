@@ -1029,7 +1029,7 @@ static void LinkPolyobj (polyobj_t *po)
 static BOOL CheckMobjBlocking (seg_t *seg, polyobj_t *po)
 {
 	AActor *mobj;
-	int i, j;
+	int i, j, k;
 	int left, right, top, bottom;
 	fixed_t tmbbox[4];
 	line_t *ld;
@@ -1057,8 +1057,9 @@ static BOOL CheckMobjBlocking (seg_t *seg, polyobj_t *po)
 	{
 		for (i = left; i <= right; i++)
 		{
-			for (mobj = blocklinks[j+i]; mobj; mobj = mobj->bnext)
+			for (k = blocklinks[j+i]; k != -1; k = thingproxies[k].bnext)
 			{
+				mobj = thingproxies[k].actor;
 				if (mobj->flags&MF_SOLID || mobj->player)
 				{
 					tmbbox[BOXTOP] = mobj->y+mobj->radius;
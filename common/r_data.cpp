@@ -23,6 +23,13 @@
 //
 //-----------------------------------------------------------------------------
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
 #include "i_system.h"
 #include "z_zone.h"
 #include "m_alloc.h"
@@ -43,11 +50,18 @@
 
 #include "v_palette.h"
 #include "v_video.h"
+#include "c_cvars.h"
+#include "md5.h"
+#include "d_startup.h"
 
 #include <ctype.h>
+#include <stdio.h>
 #include <cstddef>
 
 #include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
 
 //
 // Graphics.
@@ -94,7 +108,18 @@ int*			flattranslation;
 int*			texturetranslation;
 
 // [RH] Tutti-Frutti fix
-unsigned int	dc_mask;
+R_THREADLOCAL unsigned int	dc_mask;
+
+// Textures and flats held in memory by R_PrecacheLevel
+static std::vector<int>	pinnedtextures;
+static std::vector<int>	pinnedflats;
+static bool*			flatpinned;		// by flatnum, for R_FlatPinned
+
+// Composites already saved in the texture cache file
+static std::vector<long> texcacheofs;		// offset of each texture, or -1
+static bool				texcacheindexed;
+
+static void STACK_ARGS R_FinishPrecache (void);
 
 
 //
@@ -146,30 +171,30 @@ void R_DrawColumnInCache (const column_t *patch, byte *cache,
 	}
 }
 
+static bool R_FinishQueuedComposite (int texnum);
+
 //
-// R_GenerateComposite
-// Using the texture definition,
-//	the composite texture is created from the patches,
-//	and each column is cached.
+// R_CompositeTexture
+// Using the texture definition, the patches are drawn into the
+// composite block. The patches are cached as they are needed unless
+// the caller already has them in memory.
 //
 // Rewritten by Lee Killough for performance and to fix Medusa bug
 
-void R_GenerateComposite (int texnum)
+static void R_CompositeTexture (int texnum, byte *block, patch_t **patches)
 {
-	byte *block = (byte *)Z_Malloc (texturecompositesize[texnum], PU_STATIC,
-						   (void **) &texturecomposite[texnum]);
 	texture_t *texture = textures[texnum];
 	// Composite the columns together.
 	texpatch_t *patch = texture->patches;
 	short *collump = texturecolumnlump[texnum];
 	unsigned *colofs = texturecolumnofs[texnum]; // killough 4/9/98: make 32-bit
-	int i = texture->patchcount;
+	int i;
 	// killough 4/9/98: marks to identify transparent regions in merged textures
 	byte *marks = (byte *)Calloc (texture->width, texture->height), *source;
 
-	for (; --i >=0; patch++)
+	for (i = 0; i < texture->patchcount; i++, patch++)
 	{
-		patch_t *realpatch = W_CachePatch (patch->patch);
+		patch_t *realpatch = patches ? patches[i] : W_CachePatch (patch->patch);
 		int x1 = patch->originx, x2 = x1 + realpatch->width();
 		const int *cofs = realpatch->columnofs-x1;
 		if (x1<0)
@@ -217,6 +242,25 @@ void R_GenerateComposite (int texnum)
 		}
 	M_Free(source); 				// free temporary column
 	M_Free(marks);				// free transparency marks
+}
+
+//
+// R_GenerateComposite
+// Using the texture definition,
+//	the composite texture is created from the patches,
+//	and each column is cached.
+//
+
+void R_GenerateComposite (int texnum)
+{
+	// The precache worker may already be building it
+	if (R_FinishQueuedComposite (texnum))
+		return;
+
+	byte *block = (byte *)Z_Malloc (texturecompositesize[texnum], PU_STATIC,
+						   (void **) &texturecomposite[texnum]);
+
+	R_CompositeTexture (texnum, block, NULL);
 
 	// Now that the texture has been built in column cache,
 	// it is purgable from zone memory.
@@ -467,11 +511,19 @@ void R_InitTextures (void)
 		maxoff2 = 0;
 	}
 
+	// The composites are owned by the arrays about to be freed
+	R_FinishPrecache ();
+	pinnedtextures.clear ();
+	pinnedflats.clear ();
+	texcacheindexed = false;
+
 	// denis - fix memory leaks
 	for (i = 0; i < numtextures; i++)
 	{
 		delete[] texturecolumnlump[i];
 		delete[] texturecolumnofs[i];
+		if (texturecomposite[i])
+			Z_Free (texturecomposite[i]);
 	}
 
 	// denis - fix memory leaks
@@ -659,6 +711,11 @@ void R_InitFlats (void)
 
 	flatwarpedwhen = new int[numflats+1];
 	memset (flatwarpedwhen, 0xff, sizeof(int) * (numflats+1));
+
+	delete[] flatpinned;
+
+	flatpinned = new bool[numflats+1];
+	memset (flatpinned, 0, sizeof(bool) * (numflats+1));
 }
 
 
@@ -802,9 +859,15 @@ unsigned int R_BlendForColormap (int map)
 //
 void R_InitData (void)
 {
+	D_BeginStartupStage ("R_InitColormaps");
 	R_InitColormaps ();
+	D_EndStartupStage ();
+	D_BeginStartupStage ("R_InitTextures");
 	R_InitTextures ();
+	D_EndStartupStage ();
+	D_BeginStartupStage ("R_InitFlats");
 	R_InitFlats ();
+	D_EndStartupStage ();
 	R_InitSpriteLumps ();
 
 	// haleyjd 01/28/10: also initialize tantoangle_acc table
@@ -897,6 +960,428 @@ int R_TextureNumForName (const char *name)
 
 
 
+//
+// COMPOSITE PRECACHE
+// When a level is loaded, the composites of the textures it uses are
+// built by a worker thread and kept at PU_STATIC until the next level is
+// loaded. The zone is not thread safe, so the worker only uses copies of
+// the patches and blocks that were allocated before it started. Drawing
+// a texture the worker has not got to yet waits for it to be finished.
+//
+// Finished composites are also appended to a cache file named after the
+// MD5s of the loaded wads, and are read back from there on later loads.
+//
+
+EXTERN_CVAR (r_texturecache)
+
+#define TEXCACHE_MAGIC		"ODATXC01"
+
+typedef struct
+{
+	int				texnum;
+	byte*			block;
+	patch_t**		patches;
+	long			cacheofs;		// where the worker saved it, or -1
+	volatile bool	done;
+} compositejob_t;
+
+static compositejob_t*	compositejobs;
+static int				numcompositejobs;
+static std::vector<int>	texturejob;			// index into compositejobs, or -1
+static std::vector<byte *> compositepatches;	// freed by the worker
+static std::string		texcachename;
+static bool				texcachesave;		// worker appends to texcachename
+
+static bool				compositeworker_started;
+#ifdef _WIN32
+static HANDLE			compositeworker;
+#else
+static pthread_t		compositeworker;
+#endif
+
+#ifdef _MSC_VER
+#define COMPOSITE_BARRIER()	MemoryBarrier()
+#else
+#define COMPOSITE_BARRIER()	__sync_synchronize()
+#endif
+
+//
+// R_TextureCacheName
+// The cache file for the loaded wads.
+//
+static std::string R_TextureCacheName (void)
+{
+	md5_state_t state;
+	md5_byte_t digest[16];
+	char name[64];
+
+	md5_init (&state);
+	for (size_t i = 0; i < wadhashes.size (); i++)
+		md5_append (&state, (const md5_byte_t *)wadhashes[i].c_str (), wadhashes[i].length ());
+	md5_finish (&state, digest);
+
+	strcpy (name, "texcache-");
+	for (int i = 0; i < 16; i++)
+		sprintf (name + 9 + i * 2, "%02X", digest[i]);
+	strcat (name, ".dat");
+
+	return I_GetUserFileName (name);
+}
+
+//
+// R_IndexTextureCache
+// Finds the composites saved in the cache file. A file that does not
+// match the loaded textures or was cut short is thrown away.
+//
+static void R_IndexTextureCache (void)
+{
+	if (texcacheindexed)
+		return;
+
+	texcacheindexed = true;
+	texcacheofs.assign (numtextures, -1);
+	texcachename = R_TextureCacheName ();
+
+	FILE *fp = fopen (texcachename.c_str (), "rb");
+	if (!fp)
+		return;
+
+	char magic[8];
+	int count;
+	bool ok = (fread (magic, 1, 8, fp) == 8 && !memcmp (magic, TEXCACHE_MAGIC, 8)
+			   && fread (&count, sizeof(count), 1, fp) == 1 && count == numtextures);
+
+	fseek (fp, 0, SEEK_END);
+	long length = ftell (fp);
+	long ofs = 8 + sizeof(int);
+
+	while (ok && ofs < length)
+	{
+		int rec[2];		// texture number, size
+
+		fseek (fp, ofs, SEEK_SET);
+		ok = (fread (rec, sizeof(rec), 1, fp) == 1
+			  && rec[0] >= 0 && rec[0] < numtextures
+			  && rec[1] == texturecompositesize[rec[0]]
+			  && ofs + (long)sizeof(rec) + rec[1] <= length);
+
+		if (ok)
+		{
+			texcacheofs[rec[0]] = ofs;
+			ofs += sizeof(rec) + rec[1];
+		}
+	}
+
+	fclose (fp);
+
+	if (!ok)
+	{
+		texcacheofs.assign (numtextures, -1);
+		remove (texcachename.c_str ());
+	}
+}
+
+//
+// R_ReadCachedComposite
+//
+static bool R_ReadCachedComposite (FILE *fp, int texnum)
+{
+	if (fseek (fp, texcacheofs[texnum] + 2 * sizeof(int), SEEK_SET))
+		return false;
+
+	byte *block = (byte *)Z_Malloc (texturecompositesize[texnum], PU_STATIC,
+						   (void **) &texturecomposite[texnum]);
+
+	if (fread (block, texturecompositesize[texnum], 1, fp) != 1)
+	{
+		Z_Free (block);
+		texcacheofs[texnum] = -1;
+		return false;
+	}
+
+	return true;
+}
+
+//
+// R_CompositeWorker
+//
+#ifdef _WIN32
+static DWORD WINAPI R_CompositeWorker (LPVOID)
+#else
+static void *R_CompositeWorker (void *)
+#endif
+{
+	FILE *fp = NULL;
+
+	if (texcachesave)
+	{
+		fp = fopen (texcachename.c_str (), "ab");
+		if (fp)
+		{
+			fseek (fp, 0, SEEK_END);
+			if (ftell (fp) == 0)
+			{
+				int count = numtextures;
+
+				fwrite (TEXCACHE_MAGIC, 1, 8, fp);
+				fwrite (&count, sizeof(count), 1, fp);
+			}
+		}
+	}
+
+	for (int i = 0; i < numcompositejobs; i++)
+	{
+		compositejob_t &job = compositejobs[i];
+
+		R_CompositeTexture (job.texnum, job.block, job.patches);
+
+		if (fp)
+		{
+			int rec[2] = { job.texnum, texturecompositesize[job.texnum] };
+
+			job.cacheofs = ftell (fp);
+			if (fwrite (rec, sizeof(rec), 1, fp) != 1
+				|| fwrite (job.block, rec[1], 1, fp) != 1)
+			{
+				// stop saving, the partial record is caught when indexing
+				job.cacheofs = -1;
+				fclose (fp);
+				fp = NULL;
+			}
+		}
+
+		COMPOSITE_BARRIER();
+		job.done = true;
+	}
+
+	if (fp)
+		fclose (fp);
+
+	for (size_t i = 0; i < compositepatches.size (); i++)
+		M_Free (compositepatches[i]);
+
+	return 0;
+}
+
+//
+// R_InstallComposite
+// Hands a finished composite over to texturecomposite.
+//
+static void R_InstallComposite (compositejob_t &job)
+{
+	COMPOSITE_BARRIER();
+
+	Z_ChangeUser (job.block, &texturecomposite[job.texnum]);
+	job.block = NULL;
+
+	if (job.cacheofs >= 0)
+		texcacheofs[job.texnum] = job.cacheofs;
+
+	texturejob[job.texnum] = -1;
+	pinnedtextures.push_back (job.texnum);
+}
+
+//
+// R_FinishQueuedComposite
+// Waits for the worker to build a texture that is about to be drawn.
+// Returns false if the texture was not queued.
+//
+static bool R_FinishQueuedComposite (int texnum)
+{
+	if (texturejob.empty () || texturejob[texnum] < 0)
+		return false;
+
+	compositejob_t &job = compositejobs[texturejob[texnum]];
+
+	while (!job.done)
+		I_Yield ();
+
+	R_InstallComposite (job);
+	return true;
+}
+
+//
+// R_FinishPrecache
+// Waits for the worker to finish all queued composites.
+//
+static void STACK_ARGS R_FinishPrecache (void)
+{
+	if (compositeworker_started)
+	{
+#ifdef _WIN32
+		WaitForSingleObject (compositeworker, INFINITE);
+		CloseHandle (compositeworker);
+#else
+		pthread_join (compositeworker, NULL);
+#endif
+		compositeworker_started = false;
+	}
+
+	for (int i = 0; i < numcompositejobs; i++)
+	{
+		if (compositejobs[i].block)
+			R_InstallComposite (compositejobs[i]);
+		delete[] compositejobs[i].patches;
+	}
+
+	delete[] compositejobs;
+	compositejobs = NULL;
+	numcompositejobs = 0;
+	compositepatches.clear ();
+	texturejob.clear ();
+}
+
+//
+// R_UnpinPrecache
+// Lets the zone purge what the last level precached.
+//
+static void R_UnpinPrecache (void)
+{
+	size_t i;
+
+	for (i = 0; i < pinnedtextures.size (); i++)
+		if (texturecomposite[pinnedtextures[i]])
+			Z_ChangeTag (texturecomposite[pinnedtextures[i]], PU_CACHE);
+
+	for (i = 0; i < pinnedflats.size (); i++)
+	{
+		W_CacheLumpNum (firstflat + pinnedflats[i], PU_CACHE);
+		flatpinned[pinnedflats[i]] = false;
+	}
+
+	pinnedtextures.clear ();
+	pinnedflats.clear ();
+}
+
+//
+// R_FlatPinned
+// True if R_PrecacheLevel is holding the flat in memory for the level.
+//
+bool R_FlatPinned (int flatnum)
+{
+	return flatpinned[flatnum];
+}
+
+//
+// R_PrecacheComposites
+// Builds the composites of the textures in hitlist, reading them from
+// the cache file when it has them and queueing the rest for the worker.
+//
+static void R_PrecacheComposites (const byte *hitlist)
+{
+	std::vector<int> queue;
+	bool usecache = r_texturecache;
+	int i, j;
+
+	if (usecache)
+		R_IndexTextureCache ();
+
+	FILE *fp = NULL;
+	int fromcache = 0;
+
+	for (i = 0; i < numtextures; i++)
+	{
+		// only textures made of several patches, or tall ones, are composited
+		if (!hitlist[i] || !texturetype2[i])
+			continue;
+
+		if (texturecomposite[i])
+		{
+			Z_ChangeTag (texturecomposite[i], PU_STATIC);
+			pinnedtextures.push_back (i);
+			continue;
+		}
+
+		if (usecache && texcacheofs[i] >= 0)
+		{
+			if (!fp)
+				fp = fopen (texcachename.c_str (), "rb");
+
+			if (fp && R_ReadCachedComposite (fp, i))
+			{
+				pinnedtextures.push_back (i);
+				fromcache++;
+				continue;
+			}
+		}
+
+		queue.push_back (i);
+	}
+
+	if (fp)
+		fclose (fp);
+
+	if (queue.empty ())
+	{
+		if (fromcache)
+			DPrintf ("R_PrecacheLevel: %d composites read from cache\n", fromcache);
+		return;
+	}
+
+	// Give the worker its own copies of the patches
+	std::map<int, byte *> copies;
+
+	compositejobs = new compositejob_t[queue.size ()];
+	numcompositejobs = queue.size ();
+	texturejob.assign (numtextures, -1);
+
+	for (size_t q = 0; q < queue.size (); q++)
+	{
+		compositejob_t &job = compositejobs[q];
+		texture_t *texture = textures[queue[q]];
+
+		job.texnum = queue[q];
+		job.cacheofs = -1;
+		job.done = false;
+		job.patches = new patch_t *[texture->patchcount];
+
+		for (j = 0; j < texture->patchcount; j++)
+		{
+			int lump = texture->patches[j].patch;
+			std::map<int, byte *>::iterator it = copies.find (lump);
+
+			if (it == copies.end ())
+			{
+				byte *copy = (byte *)Malloc (W_LumpLength (lump));
+
+				memcpy (copy, W_CacheLumpNum (lump, PU_CACHE), W_LumpLength (lump));
+				compositepatches.push_back (copy);
+				it = copies.insert (std::make_pair (lump, copy)).first;
+			}
+
+			job.patches[j] = (patch_t *)it->second;
+		}
+
+		job.block = (byte *)Z_Malloc (texturecompositesize[job.texnum], PU_STATIC, NULL);
+		texturejob[job.texnum] = q;
+	}
+
+	texcachesave = usecache;
+
+	DPrintf ("R_PrecacheLevel: %d composites read from cache, %d queued\n",
+			 fromcache, numcompositejobs);
+
+	static bool registered = false;
+
+	if (!registered)
+	{
+		atterm (R_FinishPrecache);
+		registered = true;
+	}
+
+#ifdef _WIN32
+	compositeworker = CreateThread (NULL, 0, R_CompositeWorker, NULL, 0, NULL);
+	compositeworker_started = (compositeworker != NULL);
+#else
+	compositeworker_started =
+		(pthread_create (&compositeworker, NULL, R_CompositeWorker, NULL) == 0);
+#endif
+
+	// build them now if there is no worker
+	if (!compositeworker_started)
+		R_CompositeWorker (NULL);
+}
+
 //
 // R_PrecacheLevel
 // Preloads all relevant graphics for the level.
@@ -908,6 +1393,10 @@ void R_PrecacheLevel (void)
 	byte *hitlist;
 	int i;
 
+	// Let go of the last level's textures
+	R_FinishPrecache ();
+	R_UnpinPrecache ();
+
 	if (demoplayback)
 		return;
 
@@ -924,8 +1413,21 @@ void R_PrecacheLevel (void)
 		hitlist[sectors[i].floorpic] = hitlist[sectors[i].ceilingpic] = 1;
 
 	for (i = numflats - 1; i >= 0; i--)
-		if (hitlist[i])
+	{
+		if (!hitlist[i])
+			continue;
+
+		if (clientside)
+		{
+			// pinned at PU_STATIC, so R_ReleaseFlats leaves it alone
+			// until R_UnpinPrecache
+			W_CacheLumpNum (firstflat + i, PU_STATIC);
+			pinnedflats.push_back (i);
+			flatpinned[i] = true;
+		}
+		else
 			W_CacheLumpNum (firstflat + i, PU_CACHE);
+	}
 
 	// Precache textures.
 	memset (hitlist, 0, numtextures);
@@ -962,6 +1464,10 @@ void R_PrecacheLevel (void)
 		}
 	}
 
+	// The server never draws them
+	if (clientside)
+		R_PrecacheComposites (hitlist);
+
 	// Precache sprites.
 	memset (hitlist, 0, numsprites);
 
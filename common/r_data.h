@@ -90,6 +90,7 @@ byte* R_GetColumn (int tex, int col);
 // I/O, setting up the stuff.
 void R_InitData (void);
 void R_PrecacheLevel (void);
+bool R_FlatPinned (int flatnum);
 
 
 // Retrieval.
@@ -118,7 +119,7 @@ int R_FindSkin (const char *name);	// [RH] Find a skin
 unsigned int SlopeDiv(unsigned int num, unsigned int den);
 
 // [RH] Tutti-Frutti fix
-extern "C" unsigned int		dc_mask;
+extern "C" R_THREADLOCAL unsigned int	dc_mask;
 
 #endif
 
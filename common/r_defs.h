@@ -56,6 +56,22 @@ extern int MaxDrawSegs;
 #define MAXWIDTH				2048
 #define MAXHEIGHT				1536
 
+// The column and span drawer state (dc_* and ds_*) is thread-local so that
+// several render threads can replay queued draw commands at once (see
+// r_thread.cpp). The assembly drawers address it as plain symbols, so there
+// is no threaded drawing with USEASM.
+#if defined(USEASM) || defined(_XBOX)
+#define R_THREADLOCAL
+#elif defined(_MSC_VER)
+#define R_THREADLOCAL			__declspec(thread)
+#define R_THREADED_DRAWING
+#elif defined(__GNUC__) && (!defined(__APPLE__) || defined(__clang__))
+#define R_THREADLOCAL			__thread
+#define R_THREADED_DRAWING
+#else
+#define R_THREADLOCAL
+#endif
+
 
 
 //
@@ -171,6 +187,9 @@ struct sector_s
                     // If (sector->moveable) the server sends information
                     // about this sector when a client connects.
 
+	unsigned int changegen;	// sector change generation in which a mover last
+							// changed this sector, or 0 if it never changed
+
 	// jff 2/26/98 lockout machinery for stairbuilding
 	int stairlock;		// -2 on first locked -1 after thinker done 0 normally
 	int prevsec;		// -1 or number of sector for previous step
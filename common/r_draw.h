@@ -32,21 +32,21 @@ extern "C" int*			columnofs;
 
 extern "C" int			dc_pitch;		// [RH] Distance between rows
 
-extern "C" lighttable_t*	dc_colormap;
+extern "C" R_THREADLOCAL lighttable_t*	dc_colormap;
 extern "C" unsigned int*	dc_shademap;	// [RH] For high/true color modes
-extern "C" int			dc_x;
-extern "C" int			dc_yl;
-extern "C" int			dc_yh;
-extern "C" fixed_t		dc_iscale;
+extern "C" R_THREADLOCAL int			dc_x;
+extern "C" R_THREADLOCAL int			dc_yl;
+extern "C" R_THREADLOCAL int			dc_yh;
+extern "C" R_THREADLOCAL fixed_t		dc_iscale;
 extern "C" fixed_t		dc_texturemid;
-extern "C" fixed_t		dc_texturefrac;
-extern "C" int			dc_color;		// [RH] For flat colors (no texturing)
+extern "C" R_THREADLOCAL fixed_t		dc_texturefrac;
+extern "C" R_THREADLOCAL int			dc_color;		// [RH] For flat colors (no texturing)
 
 // first pixel in a column
-extern "C" byte*			dc_source;
+extern "C" R_THREADLOCAL byte*			dc_source;
 
 // [RH] Temporary buffer for column drawing
-extern "C" byte			dc_temp[1536*4];
+extern "C" R_THREADLOCAL byte			dc_temp[1536*4];
 extern "C" unsigned int	dc_tspans[4][256];
 extern "C" unsigned int	*dc_ctspan[4];
 extern "C" unsigned int	horizspans[4];
@@ -91,13 +91,13 @@ void rt_map2cols_c (int hx, int sx, int yl, int yh);
 void rt_map4cols_c (int sx, int yl, int yh);
 void rt_lucent1col (int hx, int sx, int yl, int yh);
 void rt_lucent2cols (int hx, int sx, int yl, int yh);
-void rt_lucent4cols (int sx, int yl, int yh);
+void rt_lucent4cols_c (int sx, int yl, int yh);
 void rt_tlate1col (int hx, int sx, int yl, int yh);
 void rt_tlate2cols (int hx, int sx, int yl, int yh);
 void rt_tlate4cols (int sx, int yl, int yh);
 void rt_tlatelucent1col (int hx, int sx, int yl, int yh);
 void rt_tlatelucent2cols (int hx, int sx, int yl, int yh);
-void rt_tlatelucent4cols (int sx, int yl, int yh);
+void rt_tlatelucent4cols_c (int sx, int yl, int yh);
 extern "C" void rt_copy1col_asm (int hx, int sx, int yl, int yh);
 extern "C" void rt_copy2cols_asm (int hx, int sx, int yl, int yh);
 extern "C" void rt_copy4cols_asm (int sx, int yl, int yh);
@@ -107,6 +107,8 @@ extern "C" void rt_map4cols_asm1 (int sx, int yl, int yh);
 extern "C" void rt_map4cols_asm2 (int sx, int yl, int yh);
 
 extern void (*rt_map4cols)(int sx, int yl, int yh);
+extern void (*rt_lucent4cols)(int sx, int yl, int yh);
+extern void (*rt_tlatelucent4cols)(int sx, int yl, int yh);
 
 #ifdef USEASM
 #define rt_copy1col		rt_copy1col_asm
@@ -164,6 +166,28 @@ void	R_DrawTranslatedColumnD_C (void);
 void	R_DrawSpanD (void);
 #endif
 
+// SSE2/AVX2 span and rt_*4cols drawers, chosen at runtime by
+// R_InitSIMDDrawers (r_drawsimd.cpp)
+#if !defined(USEASM) && (defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)) \
+	&& (defined(__clang__) || (defined(_MSC_VER) && _MSC_VER >= 1700) \
+		|| (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define R_SIMDDRAWERS
+
+void	R_DrawSpanP_SSE2 (void);
+void	R_DrawSpanD_SSE2 (void);
+void	rt_map4cols_SSE2 (int sx, int yl, int yh);
+void	rt_lucent4cols_SSE2 (int sx, int yl, int yh);
+void	rt_tlatelucent4cols_SSE2 (int sx, int yl, int yh);
+
+void	R_DrawSpanP_AVX2 (void);
+void	R_DrawSpanD_AVX2 (void);
+void	rt_map4cols_AVX2 (int sx, int yl, int yh);
+void	rt_lucent4cols_AVX2 (int sx, int yl, int yh);
+void	rt_tlatelucent4cols_AVX2 (int sx, int yl, int yh);
+
+void	R_InitSIMDDrawers (BOOL is8bit);
+#endif
+
 void	R_DrawTlatedLucentColumnP_C (void);
 #define R_DrawTlatedLucentColumn R_DrawTlatedLucentColumnP_C
 void	R_StretchColumnP_C (void);
@@ -175,35 +199,35 @@ void	R_FillSpan (void);
 
 extern "C" int				ds_colsize;		// [RH] Distance between columns
 
-extern "C" int				ds_y;
-extern "C" int				ds_x1;
-extern "C" int				ds_x2;
+extern "C" R_THREADLOCAL int				ds_y;
+extern "C" R_THREADLOCAL int				ds_x1;
+extern "C" R_THREADLOCAL int				ds_x2;
 
-extern "C" lighttable_t*	ds_colormap;
+extern "C" R_THREADLOCAL lighttable_t*	ds_colormap;
 
-extern "C" dsfixed_t		ds_xfrac;
-extern "C" dsfixed_t		ds_yfrac;
-extern "C" dsfixed_t		ds_xstep;
-extern "C" dsfixed_t		ds_ystep;
+extern "C" R_THREADLOCAL dsfixed_t		ds_xfrac;
+extern "C" R_THREADLOCAL dsfixed_t		ds_yfrac;
+extern "C" R_THREADLOCAL dsfixed_t		ds_xstep;
+extern "C" R_THREADLOCAL dsfixed_t		ds_ystep;
 
 // start of a 64*64 tile image
-extern "C" byte*			ds_source;
+extern "C" R_THREADLOCAL byte*			ds_source;
 
-extern "C" int				ds_color;		// [RH] For flat color (no texturing)
+extern "C" R_THREADLOCAL int				ds_color;		// [RH] For flat color (no texturing)
 
 // [SL] 2012-03-19 - For sloped planes
-extern "C" double			ds_iu;
-extern "C" double			ds_iv;
-extern "C" double			ds_iustep;
-extern "C" double			ds_ivstep;
-extern "C" double			ds_id;
-extern "C" double			ds_idstep;
-extern "C" byte				*slopelighting[MAXWIDTH];
+extern "C" R_THREADLOCAL double			ds_iu;
+extern "C" R_THREADLOCAL double			ds_iv;
+extern "C" R_THREADLOCAL double			ds_iustep;
+extern "C" R_THREADLOCAL double			ds_ivstep;
+extern "C" R_THREADLOCAL double			ds_id;
+extern "C" R_THREADLOCAL double			ds_idstep;
+extern "C" R_THREADLOCAL byte				*slopelighting[MAXWIDTH];
 
 extern byte*			translationtables;
-extern byte*			dc_translation;
+extern R_THREADLOCAL byte*	dc_translation;
 
-extern fixed_t dc_translevel;
+extern R_THREADLOCAL fixed_t dc_translevel;
 
 enum
 {
@@ -217,7 +241,7 @@ enum
 	NUM_TRANSLATION_TABLES
 };
 
-extern byte*			dc_translation;
+extern R_THREADLOCAL byte*	dc_translation;
 
 #define TRANSLATION(a,b)	(((a)<<8)|(b))
 
@@ -66,6 +66,7 @@ particle_t *NewParticle (void);
 void R_InitParticles (void);
 void R_ClearParticles (void);
 void R_DrawParticle (vissprite_t *, int, int);
+void R_FillParticle (int x1, int x2, int yl, int yh, unsigned int fg, unsigned int *bg2rgb);
 void R_ProjectParticle (particle_t *, const sector_t* sector, int fakeside);
 void R_FindParticleSubsectors();
 
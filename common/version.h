@@ -49,7 +49,7 @@
 // earlier than this version.
 #define SAVESIG "ODAMEXSAVE060   "	// Needs to be exactly 16 chars long
 
-#define NETDEMOVER 2
+#define NETDEMOVER 3
 
 // denis - per-file svn version stamps
 class file_version
@@ -37,6 +37,13 @@
 #define strcmpi	strcasecmp
 #endif
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sys/mman.h>
+#endif
+
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -50,6 +57,7 @@
 #include "cmdlib.h"
 #include "m_argv.h"
 #include "md5.h"
+#include "c_dispatch.h"
 
 #include "w_wad.h"
 
@@ -60,6 +68,8 @@
 #include <vector>
 #include <iostream>
 #include <iomanip>
+#include <map>
+#include <set>
 
 
 //
@@ -218,28 +228,219 @@ void uppercopy (char *to, const char *from)
 }
 
 
-// denis - Standard MD5SUM
-std::string W_MD5(std::string filename)
+//
+// WAD HASH CACHE
+// Hashing a large wad takes seconds, so the MD5 of every file hashed is
+// kept in a file in the user's directory along with the file's size,
+// modification time and inode. A file that still matches all three is
+// not read again.
+//
+
+typedef struct
+{
+	std::string	hash;
+	QWORD		size;
+	QWORD		mtime;
+	QWORD		inode;
+} wadhash_t;
+
+static std::map<std::string, wadhash_t> wadhashcache;	// by canonical path
+static std::set<std::string> wadhashprefetched;		// hashed by W_HashFiles, not looked up yet
+static bool		wadhashcache_loaded;
+
+static struct
+{
+	unsigned	hits;
+	unsigned	misses;
+	QWORD		bytes;			// read while hashing
+	QWORD		ms;				// spent hashing, wall clock
+} wadhashstats;
+
+#define WADHASH_FILE		"wadhashes.txt"
+#define WADHASH_CHUNK		(1 << 20)
+#define WADHASH_MAXTHREADS	4	// hashing is mostly waiting on the disk
+
+//
+// W_CanonicalPath
+//
+static std::string W_CanonicalPath (const std::string &filename)
+{
+#ifdef _WIN32
+	char path[_MAX_PATH];
+
+	if (_fullpath (path, filename.c_str (), sizeof(path)))
+		return path;
+#else
+	char *path = realpath (filename.c_str (), NULL);
+
+	if (path)
+	{
+		std::string result = path;
+		free (path);
+		return result;
+	}
+#endif
+
+	return filename;
+}
+
+//
+// W_StatFile
+//
+static bool W_StatFile (const std::string &filename, wadhash_t &info)
+{
+	struct stat st;
+
+	if (stat (filename.c_str (), &st) == -1)
+		return false;
+
+	info.size = st.st_size;
+	info.mtime = st.st_mtime;
+	info.inode = st.st_ino;
+
+	return true;
+}
+
+//
+// W_LoadHashCache
+//
+static void W_LoadHashCache (void)
 {
-	const int file_chunk_size = 8192;
-	FILE *fp = fopen(filename.c_str(), "rb");
+	wadhashcache_loaded = true;
+
+	FILE *fp = fopen (I_GetUserFileName (WADHASH_FILE).c_str (), "r");
+
+	if (!fp)
+		return;
+
+	char line[1024];
+
+	while (fgets (line, sizeof(line), fp))
+	{
+		char hash[33];
+		unsigned long long size, mtime, inode;
+		int pathofs;
+
+		if (sscanf (line, "%32s %llu %llu %llu %n", hash, &size, &mtime, &inode, &pathofs) < 4)
+			continue;
 
-	if(!fp)
+		std::string path = line + pathofs;
+		size_t end = path.find_last_not_of ("\r\n");
+
+		if (strlen (hash) != 32 || end == std::string::npos)
+			continue;
+
+		wadhash_t &entry = wadhashcache[path.substr (0, end + 1)];
+
+		entry.hash = hash;
+		entry.size = size;
+		entry.mtime = mtime;
+		entry.inode = inode;
+	}
+
+	fclose (fp);
+}
+
+//
+// W_SaveHashCache
+//
+static void W_SaveHashCache (void)
+{
+	FILE *fp = fopen (I_GetUserFileName (WADHASH_FILE).c_str (), "w");
+
+	if (!fp)
+		return;
+
+	for (std::map<std::string, wadhash_t>::iterator it = wadhashcache.begin ();
+		 it != wadhashcache.end (); ++it)
+	{
+		fprintf (fp, "%s %llu %llu %llu %s\n", it->second.hash.c_str (),
+				 (unsigned long long)it->second.size, (unsigned long long)it->second.mtime,
+				 (unsigned long long)it->second.inode, it->first.c_str ());
+	}
+
+	fclose (fp);
+}
+
+//
+// W_CachedMD5
+// The cached hash of a file, or an empty string if it has changed since.
+//
+static std::string W_CachedMD5 (const std::string &path, const wadhash_t &info)
+{
+	if (!wadhashcache_loaded)
+		W_LoadHashCache ();
+
+	std::map<std::string, wadhash_t>::iterator it = wadhashcache.find (path);
+
+	if (it == wadhashcache.end () || it->second.size != info.size
+		|| it->second.mtime != info.mtime || it->second.inode != info.inode)
 		return "";
 
+	return it->second.hash;
+}
+
+//
+// W_HashFile
+// Reads a whole file through MD5. Safe to call from any thread.
+//
+static std::string W_HashFile (const std::string &filename, QWORD &bytes)
+{
 	md5_state_t state;
-	md5_init(&state);
+	md5_byte_t digest[16];
 
-	unsigned n = 0;
-	unsigned char buf[file_chunk_size];
+	md5_init (&state);
+	bytes = 0;
 
-	while((n = fread(buf, 1, sizeof(buf), fp)))
-		md5_append(&state, (unsigned char *)buf, n);
+#ifndef _WIN32
+	int fd = open (filename.c_str (), O_RDONLY | O_BINARY);
 
-	md5_byte_t digest[16];
-	md5_finish(&state, digest);
+	if (fd == -1)
+		return "";
+
+	struct stat st;
+	void *map = MAP_FAILED;
+
+	if (fstat (fd, &st) == 0 && st.st_size > 0)
+		map = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	if (map != MAP_FAILED)
+	{
+		const md5_byte_t *data = (const md5_byte_t *)map;
+
+		madvise (map, st.st_size, MADV_SEQUENTIAL);
+
+		for (off_t ofs = 0; ofs < st.st_size; ofs += WADHASH_CHUNK)
+			md5_append (&state, data + ofs, (int)std::min ((off_t)WADHASH_CHUNK, st.st_size - ofs));
+
+		bytes = st.st_size;
+		munmap (map, st.st_size);
+		close (fd);
+	}
+	else
+	{
+		close (fd);
+#endif
+		FILE *fp = fopen (filename.c_str (), "rb");
+
+		if (!fp)
+			return "";
 
-	fclose(fp);
+		std::vector<md5_byte_t> buf (WADHASH_CHUNK);
+		size_t n;
+
+		while ((n = fread (&buf[0], 1, buf.size (), fp)))
+		{
+			md5_append (&state, &buf[0], n);
+			bytes += n;
+		}
+
+		fclose (fp);
+#ifndef _WIN32
+	}
+#endif
+
+	md5_finish (&state, digest);
 
 	std::stringstream hash;
 
@@ -249,6 +450,524 @@ std::string W_MD5(std::string filename)
 	return hash.str().c_str();
 }
 
+// denis - Standard MD5SUM
+std::string W_MD5(std::string filename)
+{
+	wadhash_t info;
+	std::string path = W_CanonicalPath (filename);
+
+	if (!W_StatFile (path, info))
+		return "";
+
+	info.hash = W_CachedMD5 (path, info);
+
+	if (!info.hash.empty())
+	{
+		// W_HashFiles already counted it as a miss
+		if (!wadhashprefetched.erase (path))
+			wadhashstats.hits++;
+		return info.hash;
+	}
+
+	QWORD bytes, start = I_MSTime ();
+
+	info.hash = W_HashFile (path, bytes);
+
+	if (info.hash.empty())
+		return "";
+
+	wadhashstats.misses++;
+	wadhashstats.bytes += bytes;
+	wadhashstats.ms += I_MSTime () - start;
+
+	wadhashcache[path] = info;
+	W_SaveHashCache ();
+
+	return info.hash;
+}
+
+//
+// Files hashed by the workers of W_HashFiles
+//
+typedef struct
+{
+	std::string	path;
+	wadhash_t	info;
+	QWORD		bytes;
+} hashjob_t;
+
+static std::vector<hashjob_t> hashjobs;
+static volatile int nexthashjob;
+
+//
+// W_HashWorker
+//
+#ifdef _WIN32
+static DWORD WINAPI W_HashWorker (LPVOID)
+#else
+static void *W_HashWorker (void *)
+#endif
+{
+	int job;
+
+#ifdef _WIN32
+	while ((job = InterlockedExchangeAdd ((LONG *)&nexthashjob, 1)) < (int)hashjobs.size ())
+#else
+	while ((job = __sync_fetch_and_add (&nexthashjob, 1)) < (int)hashjobs.size ())
+#endif
+		hashjobs[job].info.hash = W_HashFile (hashjobs[job].path, hashjobs[job].bytes);
+
+	return 0;
+}
+
+//
+// W_NumHashThreads
+//
+static int W_NumHashThreads (void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+
+	GetSystemInfo (&info);
+	int cpus = info.dwNumberOfProcessors;
+#else
+	int cpus = (int)sysconf (_SC_NPROCESSORS_ONLN);
+#endif
+
+	return std::max (1, std::min (cpus, WADHASH_MAXTHREADS));
+}
+
+//
+// W_HashFiles
+// Hashes the files that are not in the cache yet, several at once, so the
+// W_MD5 calls that follow find them there.
+//
+void W_HashFiles (const std::vector<std::string> &filenames)
+{
+	size_t i;
+
+	hashjobs.clear ();
+
+	for (i = 0; i < filenames.size (); i++)
+	{
+		hashjob_t job;
+
+		job.path = W_CanonicalPath (filenames[i]);
+
+		if (!W_StatFile (job.path, job.info) || !W_CachedMD5 (job.path, job.info).empty ())
+			continue;
+
+		for (size_t j = 0; j < hashjobs.size (); j++)
+			if (hashjobs[j].path == job.path)
+				job.path.clear ();
+
+		if (!job.path.empty ())
+			hashjobs.push_back (job);
+	}
+
+	// one file is hashed just as quickly by W_MD5
+	if (hashjobs.size () < 2)
+	{
+		hashjobs.clear ();
+		return;
+	}
+
+	int numthreads = std::min (W_NumHashThreads (), (int)hashjobs.size ());
+	QWORD start = I_MSTime ();
+
+	nexthashjob = 0;
+
+#ifdef _WIN32
+	std::vector<HANDLE> threads;
+
+	for (i = 1; i < (size_t)numthreads; i++)
+	{
+		HANDLE thread = CreateThread (NULL, 0, W_HashWorker, NULL, 0, NULL);
+
+		if (thread)
+			threads.push_back (thread);
+	}
+
+	W_HashWorker (NULL);
+
+	for (i = 0; i < threads.size (); i++)
+	{
+		WaitForSingleObject (threads[i], INFINITE);
+		CloseHandle (threads[i]);
+	}
+#else
+	std::vector<pthread_t> threads;
+
+	for (i = 1; i < (size_t)numthreads; i++)
+	{
+		pthread_t thread;
+
+		if (pthread_create (&thread, NULL, W_HashWorker, NULL) == 0)
+			threads.push_back (thread);
+	}
+
+	W_HashWorker (NULL);
+
+	for (i = 0; i < threads.size (); i++)
+		pthread_join (threads[i], NULL);
+#endif
+
+	wadhashstats.ms += I_MSTime () - start;
+
+	for (i = 0; i < hashjobs.size (); i++)
+	{
+		if (hashjobs[i].info.hash.empty ())
+			continue;
+
+		wadhashstats.misses++;
+		wadhashstats.bytes += hashjobs[i].bytes;
+		wadhashcache[hashjobs[i].path] = hashjobs[i].info;
+		wadhashprefetched.insert (hashjobs[i].path);
+	}
+
+	hashjobs.clear ();
+	W_SaveHashCache ();
+}
+
+BEGIN_COMMAND (wadhashstats)
+{
+	if (!wadhashcache_loaded)
+		W_LoadHashCache ();
+
+	Printf (PRINT_HIGH, "%u files in the wad hash cache\n", (unsigned)wadhashcache.size ());
+	Printf (PRINT_HIGH, "%u hashes found in the cache, %u worked out\n",
+			wadhashstats.hits, wadhashstats.misses);
+
+	if (wadhashstats.bytes)
+	{
+		Printf (PRINT_HIGH, "%.1f MB hashed in %.2f seconds (%.1f MB/s)\n",
+				wadhashstats.bytes / 1048576.0, wadhashstats.ms / 1000.0,
+				wadhashstats.ms ? wadhashstats.bytes / 1048.576 / wadhashstats.ms : 0.0);
+	}
+}
+END_COMMAND (wadhashstats)
+
+//
+// OPEN WAD FILES
+// When the set of wads changes, the ones that stay loaded are not opened
+// and their directories not read again.
+//
+
+typedef struct
+{
+	std::string	path;			// canonical
+	wadhash_t	info;			// size, mtime and inode when it was opened
+	FILE		*handle;
+	std::vector<lumpinfo_t> lumps;	// its directory, as W_AddFile read it
+	bool		used;			// part of the files being loaded
+} openwad_t;
+
+static std::vector<openwad_t> openwads;
+
+//
+// W_CloseUnusedFiles
+// Closes the wads that are not part of the loaded set anymore.
+//
+static void W_CloseUnusedFiles (void)
+{
+	for (size_t i = openwads.size (); i-- > 0; )
+	{
+		if (!openwads[i].used)
+		{
+			fclose (openwads[i].handle);
+			openwads.erase (openwads.begin () + i);
+		}
+	}
+}
+
+//
+// LUMP PREFETCH
+// Lumps that will be needed soon, such as those of the next map, can be
+// read on a worker thread ahead of time. The worker opens the wads by
+// itself and reads into its own buffers, so it never touches the zone
+// or the handles the game thread reads from. W_ReadLump then copies a
+// prefetched lump out of its buffer instead of going to the disk.
+//
+
+typedef struct
+{
+	unsigned	lump;
+	std::string	path;
+	FILE		*handle;		// lumpinfo when the prefetch was started,
+	int			position;		// to make sure the lump is still the same
+	int			size;
+	byte		*data;			// NULL if it could not be read
+} prefetchlump_t;
+
+static std::vector<prefetchlump_t> prefetchlumps;
+static bool		prefetchworker_started;
+static volatile bool prefetch_cancel;	// stop reading, it is not needed
+#ifdef _WIN32
+static HANDLE	prefetchworker;
+#else
+static pthread_t prefetchworker;
+#endif
+
+//
+// W_PrefetchWorker
+//
+#ifdef _WIN32
+static DWORD WINAPI W_PrefetchWorker (LPVOID)
+#else
+static void *W_PrefetchWorker (void *)
+#endif
+{
+	FILE *fp = NULL;
+	std::string fppath;
+
+	for (size_t i = 0; i < prefetchlumps.size () && !prefetch_cancel; i++)
+	{
+		prefetchlump_t &job = prefetchlumps[i];
+
+		if (!fp || fppath != job.path)
+		{
+			if (fp)
+				fclose (fp);
+			fppath = job.path;
+			fp = fopen (fppath.c_str (), "rb");
+		}
+
+		if (!fp || fseek (fp, job.position, SEEK_SET))
+			continue;
+
+		job.data = (byte *)malloc (job.size ? job.size : 1);
+
+		if (job.data && fread (job.data, 1, job.size, fp) != (size_t)job.size)
+		{
+			free (job.data);
+			job.data = NULL;
+		}
+	}
+
+	if (fp)
+		fclose (fp);
+
+	return 0;
+}
+
+//
+// W_FinishPrefetch
+// Waits for the worker to be done with all its lumps.
+//
+static void W_FinishPrefetch (void)
+{
+	if (!prefetchworker_started)
+		return;
+
+#ifdef _WIN32
+	WaitForSingleObject (prefetchworker, INFINITE);
+	CloseHandle (prefetchworker);
+#else
+	pthread_join (prefetchworker, NULL);
+#endif
+
+	prefetchworker_started = false;
+}
+
+//
+// W_CancelPrefetch
+// Throws away whatever has been prefetched.
+//
+void W_CancelPrefetch (void)
+{
+	prefetch_cancel = true;
+	W_FinishPrefetch ();
+	prefetch_cancel = false;
+
+	for (size_t i = 0; i < prefetchlumps.size (); i++)
+		free (prefetchlumps[i].data);
+
+	prefetchlumps.clear ();
+}
+
+//
+// W_PrefetchLumps
+// Starts reading count lumps from first on in the background.
+//
+void W_PrefetchLumps (unsigned first, unsigned count)
+{
+	W_CancelPrefetch ();
+
+	for (unsigned lump = first; lump < first + count && lump < numlumps; lump++)
+	{
+		prefetchlump_t job;
+		size_t i;
+
+		for (i = 0; i < openwads.size (); i++)
+			if (openwads[i].handle == lumpinfo[lump].handle)
+				break;
+
+		if (i == openwads.size () || lumpinfo[lump].size < 0)
+			continue;
+
+		job.lump = lump;
+		job.path = openwads[i].path;
+		job.handle = lumpinfo[lump].handle;
+		job.position = lumpinfo[lump].position;
+		job.size = lumpinfo[lump].size;
+		job.data = NULL;
+
+		prefetchlumps.push_back (job);
+	}
+
+	if (prefetchlumps.empty ())
+		return;
+
+#ifdef _WIN32
+	prefetchworker = CreateThread (NULL, 0, W_PrefetchWorker, NULL, 0, NULL);
+	prefetchworker_started = (prefetchworker != NULL);
+#else
+	prefetchworker_started =
+		(pthread_create (&prefetchworker, NULL, W_PrefetchWorker, NULL) == 0);
+#endif
+
+	// not worth reading them now instead
+	if (!prefetchworker_started)
+		prefetchlumps.clear ();
+}
+
+//
+// W_ReadPrefetched
+// Copies a lump out of the prefetched ones. Returns false if it is not
+// among them.
+//
+static bool W_ReadPrefetched (unsigned lump, void *dest)
+{
+	for (size_t i = 0; i < prefetchlumps.size (); i++)
+	{
+		prefetchlump_t &job = prefetchlumps[i];
+
+		if (job.lump != lump)
+			continue;
+
+		W_FinishPrefetch ();
+
+		const lumpinfo_t *l = lumpinfo + lump;
+
+		if (!job.data || job.handle != l->handle || job.position != l->position
+			|| job.size != l->size)
+			return false;
+
+		memcpy (dest, job.data, job.size);
+		free (job.data);
+		job.data = NULL;
+
+		return true;
+	}
+
+	return false;
+}
+
+//
+// Lumps can also be read ahead into the file cache of the OS while the
+// game thread is busy with something else, so it finds them there once
+// it gets to them. Nothing is kept, so this needs no buffers and never
+// has to be waited for.
+//
+
+#define READAHEAD_GAP		65536		// read through gaps smaller than this
+#define READAHEAD_CHUNK		65536
+
+static bool W_SpanBefore (const readaheadspan_t &a, const readaheadspan_t &b)
+{
+	if (a.path != b.path)
+		return a.path < b.path;
+	return a.position < b.position;
+}
+
+//
+// W_PlanReadAhead
+// Turns a list of lumps into the spans of the wads they are in. Lumps
+// that are close to each other are read as one span.
+//
+void W_PlanReadAhead (const std::vector<unsigned> &lumps, std::vector<readaheadspan_t> &spans)
+{
+	std::vector<readaheadspan_t> pieces;
+	size_t i;
+
+	for (i = 0; i < lumps.size (); i++)
+	{
+		unsigned lump = lumps[i];
+		size_t w;
+
+		if (lump >= numlumps || lumpinfo[lump].size <= 0)
+			continue;
+
+		for (w = 0; w < openwads.size (); w++)
+			if (openwads[w].handle == lumpinfo[lump].handle)
+				break;
+
+		if (w == openwads.size ())
+			continue;
+
+		readaheadspan_t piece;
+
+		piece.path = openwads[w].path;
+		piece.position = lumpinfo[lump].position;
+		piece.size = lumpinfo[lump].size;
+		pieces.push_back (piece);
+	}
+
+	std::sort (pieces.begin (), pieces.end (), W_SpanBefore);
+
+	for (i = 0; i < pieces.size (); i++)
+	{
+		if (!spans.empty ())
+		{
+			readaheadspan_t &last = spans.back ();
+			int end = last.position + last.size;
+
+			if (last.path == pieces[i].path && pieces[i].position <= end + READAHEAD_GAP)
+			{
+				last.size = std::max (end, pieces[i].position + pieces[i].size) - last.position;
+				continue;
+			}
+		}
+
+		spans.push_back (pieces[i]);
+	}
+}
+
+//
+// W_ReadAhead
+// Reads the spans and throws the data away. It opens the wads by itself,
+// so it can run on any thread. Stops early once *cancel is set.
+//
+void W_ReadAhead (const std::vector<readaheadspan_t> &spans, const volatile bool *cancel)
+{
+	FILE *fp = NULL;
+	std::string fppath;
+	byte *buffer = (byte *)malloc (READAHEAD_CHUNK);
+
+	for (size_t i = 0; buffer && i < spans.size () && !*cancel; i++)
+	{
+		if (!fp || fppath != spans[i].path)
+		{
+			if (fp)
+				fclose (fp);
+			fppath = spans[i].path;
+			fp = fopen (fppath.c_str (), "rb");
+		}
+
+		if (!fp || fseek (fp, spans[i].position, SEEK_SET))
+			continue;
+
+		for (int left = spans[i].size; left > 0 && !*cancel; left -= READAHEAD_CHUNK)
+		{
+			if (fread (buffer, 1, std::min (left, READAHEAD_CHUNK), fp) == 0)
+				break;
+		}
+	}
+
+	if (fp)
+		fclose (fp);
+	free (buffer);
+}
 
 //
 // LUMP BASED ROUTINES.
@@ -276,12 +995,44 @@ std::string W_AddFile (std::string filename)
 	size_t			length;
 	size_t			startlump;
 	filelump_t*		fileinfo;
+	filelump_t*		fileinfo_p;
 	filelump_t		singleinfo;
+	openwad_t		wad;
 
 	FixPathSeparator (filename);
 	std::string name = filename;
 	M_AppendExtension (name, ".wad");
 
+	wad.path = W_CanonicalPath (filename);
+
+	// still open from the last set of files?
+	if (W_StatFile (wad.path, wad.info))
+	{
+		for (i = 0; i < openwads.size (); i++)
+		{
+			openwad_t &open = openwads[i];
+
+			if (open.used || open.path != wad.path || open.info.size != wad.info.size
+				|| open.info.mtime != wad.info.mtime || open.info.inode != wad.info.inode)
+				continue;
+
+			Printf (PRINT_HIGH, "adding %s\n (%d lumps, already open)\n",
+					filename.c_str(), (int)open.lumps.size ());
+
+			lumpinfo = (lumpinfo_t *)Realloc (lumpinfo, (numlumps + open.lumps.size ())*sizeof(lumpinfo_t));
+
+			if (!lumpinfo)
+				I_Error ("Couldn't realloc lumpinfo");
+
+			if (!open.lumps.empty ())
+				memcpy (lumpinfo + numlumps, &open.lumps[0], open.lumps.size ()*sizeof(lumpinfo_t));
+			numlumps += open.lumps.size ();
+			open.used = true;
+
+			return W_MD5(filename);
+		}
+	}
+
     // open the file
 	if ( (handle = fopen (filename.c_str(), "rb")) == NULL)
 	{
@@ -335,17 +1086,29 @@ std::string W_AddFile (std::string filename)
 
 	lump_p = &lumpinfo[startlump];
 
-	for (i=startlump ; i<numlumps ; i++,lump_p++, fileinfo++)
+	for (i=startlump, fileinfo_p = fileinfo ; i<numlumps ; i++,lump_p++, fileinfo_p++)
 	{
 		lump_p->handle = handle;
-		lump_p->position = LONG(fileinfo->filepos);
-		lump_p->size = LONG(fileinfo->size);
-		strncpy (lump_p->name, fileinfo->name, 8);
+		lump_p->position = LONG(fileinfo_p->filepos);
+		lump_p->size = LONG(fileinfo_p->size);
+		strncpy (lump_p->name, fileinfo_p->name, 8);
 
 		// W_CheckNumForName needs all lump names in upper case
 		std::transform(lump_p->name, lump_p->name+8, lump_p->name, toupper);
 	}
 
+	if (fileinfo != &singleinfo)
+		Z_Free (fileinfo);
+
+	// keep the file open and its directory for the next set of files
+	if (!wad.path.empty () && W_StatFile (wad.path, wad.info))
+	{
+		wad.handle = handle;
+		wad.lumps.assign (lumpinfo + startlump, lumpinfo + numlumps);
+		wad.used = true;
+		openwads.push_back (wad);
+	}
+
 	return W_MD5(filename);
 }
 
@@ -527,6 +1290,15 @@ std::vector<std::string> W_InitMultipleFiles (std::vector<std::string> &filename
 
 	std::vector<std::string> hashes(filenames);
 
+	// lump numbers are about to change
+	W_CancelPrefetch ();
+
+	// hash whatever is not in the hash cache yet on several threads
+	W_HashFiles (filenames);
+
+	for (i = 0; i < openwads.size (); i++)
+		openwads[i].used = false;
+
 	// open each file once, load headers, and count lumps
 	int j = 0;
 	std::vector<std::string> loaded;
@@ -541,6 +1313,8 @@ std::vector<std::string> W_InitMultipleFiles (std::vector<std::string> &filename
 	filenames = loaded;
 	hashes.resize(j);
 
+	W_CloseUnusedFiles ();
+
 	if (!numlumps)
 		I_Error ("W_InitFiles: no files found");
 
@@ -665,6 +1439,9 @@ W_ReadLump
 	if (lump >= numlumps)
 		I_Error ("W_ReadLump: %i >= numlumps",lump);
 
+	if (W_ReadPrefetched (lump, dest))
+		return;
+
 	l = lumpinfo + lump;
 
 	fseek (l->handle, l->position, SEEK_SET);
@@ -832,6 +1609,8 @@ int W_FindLump (const char *name, int *lastlump)
 
 void W_Close ()
 {
+	W_CancelPrefetch ();
+
 	// store closed handles, so that fclose isn't called multiple times
 	// for the same handle
 	std::vector<FILE *> handles;
@@ -848,6 +1627,13 @@ void W_Close ()
 		}
 		lump_p++;
 	}
+
+	// the rest were not loaded anyway
+	for (size_t i = 0; i < openwads.size (); i++)
+		if (std::find(handles.begin(), handles.end(), openwads[i].handle) == handles.end())
+			fclose(openwads[i].handle);
+
+	openwads.clear ();
 }
 
 VERSION_CONTROL (w_wad_cpp, "$Id: w_wad.cpp 3174 2012-05-11 01:03:43Z mike $")
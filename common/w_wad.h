@@ -91,6 +91,7 @@ extern	lumpinfo_t*	lumpinfo;
 extern	size_t	numlumps;
 
 std::string W_MD5(std::string filename);
+void W_HashFiles (const std::vector<std::string> &filenames);
 std::vector<std::string> W_InitMultipleFiles (std::vector<std::string> &filenames);
 
 int		W_CheckNumForName (const char *name, int ns = ns_global);
@@ -109,6 +110,20 @@ void	W_Profile (const char *fname);
 
 void	W_Close ();
 
+void	W_PrefetchLumps (unsigned first, unsigned count);
+void	W_CancelPrefetch (void);
+
+// A piece of a wad to read ahead
+typedef struct
+{
+	std::string	path;
+	int			position;
+	int			size;
+} readaheadspan_t;
+
+void	W_PlanReadAhead (const std::vector<unsigned> &lumps, std::vector<readaheadspan_t> &spans);
+void	W_ReadAhead (const std::vector<readaheadspan_t> &spans, const volatile bool *cancel);
+
 int		W_FindLump (const char *name, int *lastlump);	// [RH]	Find lumps with duplication
 bool	W_CheckLumpName (unsigned lump, const char *name);	// [RH] True if lump's name == name // denis - todo - replace with map<>
 
@@ -102,6 +102,10 @@ void Z_Init (void)
 	}
 }
 
+// Called before purgable blocks are thrown out, so that anything still
+// reading cached data without owning it can finish with it first.
+void (*Z_PurgeHook) (void) = NULL;
+
 
 //
 // Z_Free2
@@ -218,6 +222,9 @@ void* Z_Malloc2(size_t size, int tag, void *user, const char *file, int line)
 			}
 			else
 			{
+				if (Z_PurgeHook)
+					Z_PurgeHook ();
+
 				// free the rover block (adding the size to base)
 				
 				// the rover can be the base block
@@ -428,6 +435,24 @@ Z_ChangeTag2
     block->tag = tag;
 }
 
+//
+// Z_ChangeUser
+// Gives a block a new owner, for blocks that were allocated before the
+// pointer that will own them could be set.
+//
+void Z_ChangeUser (void *ptr, void *user)
+{
+    memblock_t*	block;
+
+    block = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
+
+    if (block->id != ZONEID)
+        I_Error ("Z_ChangeUser: changed a pointer without ZONEID");
+
+    block->user = (void **)user;
+    *(void **)user = ptr;
+}
+
 //
 // Z_FreeMemory
 //
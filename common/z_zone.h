@@ -52,6 +52,9 @@ void	Z_DumpHeap (int lowtag, int hightag);
 void	Z_FileDumpHeap (FILE *f);
 void	Z_CheckHeap (void);
 size_t 	Z_FreeMemory (void);
+void	Z_ChangeUser (void *ptr, void *user);
+
+extern void (*Z_PurgeHook) (void);
 
 // Don't use these, use the macros instead!
 void*   Z_Malloc2 (size_t size, int tag, void *user, const char *file, int line);
@@ -75,6 +75,7 @@
 #include "m_swap.h"
 #include "gi.h"
 #include "sv_main.h"
+#include "d_startup.h"
 
 EXTERN_CVAR (sv_timelimit)
 EXTERN_CVAR (sv_nomonsters)
@@ -895,6 +896,7 @@ std::vector<size_t> D_DoomWadReboot(
 {
 	std::vector<size_t> fails;
 	size_t i;
+	QWORD start = I_MSTime(), files, parse, end;
 
 	if (modifiedgame && (gameinfo.flags & GI_SHAREWARE))
 		I_Error ("\nYou cannot switch WAD with the shareware version. Register!");
@@ -904,8 +906,7 @@ std::vector<size_t> D_DoomWadReboot(
 	G_ExitLevel(0, 0);
 	DThinker::DestroyAllThinkers();
 
-	// Close all open WAD files
-	W_Close();
+	// Wads that stay loaded are kept open by W_InitMultipleFiles
 
 	// [ML] 9/11/10: Reset custom wad level information from MAPINFO et al.
     // I have never used memset, I hope I am not invoking satan by doing this :(
@@ -927,7 +928,11 @@ std::vector<size_t> D_DoomWadReboot(
         numwadclusterinfos = 0;
     }
 
-	// Restart the memory manager
+	// Restart the memory manager. What R_Init and P_Init build from the
+	// lumps is rebuilt too, even for wads that stay loaded: W_MergeLumps
+	// moves the sprites, flats and colormaps of every file to the end of
+	// the directory, so their lump numbers shift as soon as any file in
+	// the list has a different number of lumps.
 	Z_Init();
 
 	SetLanguageIDs ();
@@ -962,6 +967,10 @@ std::vector<size_t> D_DoomWadReboot(
 	wadhashes = W_InitMultipleFiles (wadfiles);
 	SV_InitMultipleFiles (wadfiles);
 
+	D_ReadAheadStartupLumps ();
+
+	files = I_MSTime();
+
 	// get skill / episode / map from parms
 	strcpy (startmap, (gameinfo.flags & GI_MAPxx) ? "MAP01" : "E1M1");
 
@@ -980,12 +989,23 @@ std::vector<size_t> D_DoomWadReboot(
 		G_ParseMusInfo ();
 		S_ParseSndInfo();
 
+		parse = I_MSTime();
+
 		R_Init();
 		P_Init();
 	} else {					// let DoomMain know it doesn't have to do everything
 		RebootInit = true;
+		parse = I_MSTime();
 	}
 
+	end = I_MSTime();
+	Printf (PRINT_HIGH, "Wad switch took %u ms (unloading and opening wads %u ms, parsing lumps %u ms, R_Init and P_Init %u ms)\n",
+			(unsigned)(end - start), (unsigned)(files - start), (unsigned)(parse - files), (unsigned)(end - parse));
+
+	// unless D_DoomMain is still starting up and does this itself
+	if (DefaultsLoaded)
+		D_FinishStartup ();
+
 	return fails;
 }
 
@@ -1000,6 +1020,8 @@ void D_DoomMain (void)
 {
 	const char *iwad;
 
+	D_BeginStartupStage ("D_DoomMain");
+
 	M_ClearRandom();
 	// [AM] Init rand() PRNG, needed for non-deterministic maplist shuffling.
 	srand(time(NULL));
@@ -1019,7 +1041,9 @@ void D_DoomMain (void)
 
 	Printf (PRINT_HIGH, "Heapsize: %u megabytes\n", got_heapsize);
 
+	D_BeginStartupStage ("M_LoadDefaults");
 	M_LoadDefaults ();			// load before initing other systems
+	D_EndStartupStage ();
 	C_ExecCmdLineParams (true, false);	// [RH] do all +set commands on the command line
 
 	if (!RebootInit) {
@@ -1027,18 +1051,27 @@ void D_DoomMain (void)
 		if(!iwad)
 			iwad = "";
 
+		D_BeginStartupStage ("W_InitMultipleFiles");
 		D_AddDefWads(iwad);
 		D_AddCmdParameterFiles();
 
 		wadhashes = W_InitMultipleFiles (wadfiles);
 		SV_InitMultipleFiles (wadfiles);
+		D_EndStartupStage ();
+
+		// Everything after this reads lumps, so start reading them
+		D_ReadAheadStartupLumps ();
 
 		// [RH] Initialize localizable strings.
+		D_BeginStartupStage ("GStrings");
 		GStrings.LoadStrings (W_GetNumForName ("LANGUAGE"), STRING_TABLE_SIZE, false);
 		GStrings.Compact ();
+		D_EndStartupStage ();
 
 		//D_InitStrings ();
+		D_BeginStartupStage ("DeHackEd");
 		D_DoDefDehackedPatch();
+		D_EndStartupStage ();
 	}
 
 	I_Init ();
@@ -1099,24 +1132,34 @@ void D_DoomMain (void)
 	// insert them into the level and cluster data.
 	G_SetLevelStrings ();
 	// [RH] Parse through all loaded mapinfo lumps
+	D_BeginStartupStage ("G_ParseMapInfo");
 	G_ParseMapInfo ();
+	D_EndStartupStage ();
 	// [ML] Parse the musinfo lump
 	G_ParseMusInfo ();
 	// [RH] Parse any SNDINFO lumps
+	D_BeginStartupStage ("S_ParseSndInfo");
 	S_ParseSndInfo();
+	D_EndStartupStage ();
 
 	// Check for -file in shareware
 	if (modifiedgame && (gameinfo.flags & GI_SHAREWARE))
 		I_Error ("You cannot -file with the shareware version. Register!");
 
 	Printf (PRINT_HIGH, "R_Init: Init DOOM refresh daemon.\n");
+	D_BeginStartupStage ("R_Init");
 	R_Init ();
+	D_EndStartupStage ();
 
 	Printf (PRINT_HIGH, "P_Init: Init Playloop state.\n");
+	D_BeginStartupStage ("P_Init");
 	P_Init ();
+	D_EndStartupStage ();
 
 	Printf (PRINT_HIGH, "SV_InitNetwork: Checking network game status.\n");
+	D_BeginStartupStage ("SV_InitNetwork");
     SV_InitNetwork();
+	D_EndStartupStage ();
 
 	// [RH] Initialize items. Still only used for the give command. :-(
 	InitItems ();
@@ -1125,6 +1168,8 @@ void D_DoomMain (void)
 	// about to begin the game.
 	cvar_t::EnableNoSet ();
 
+	D_FinishStartup ();
+
 	// [RH] Now that all game subsystems have been initialized,
 	// do all commands on the command line other than +set
 	C_ExecCmdLineParams (false, false);
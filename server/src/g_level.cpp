@@ -60,6 +60,8 @@
 #include "s_sndseq.h"
 #include "sc_man.h"
 #include "sv_main.h"
+#include "sv_sqp.h"
+#include "sv_demo.h"
 #include "sv_maplist.h"
 #include "sv_vote.h"
 #include "v_video.h"
@@ -138,96 +140,112 @@ const char* GetBase(const char* in)
 	return out;
 }
 
-BEGIN_COMMAND (wad) // denis - changes wads
+//
+// G_SplitWadArgs
+// Sorts the arguments of the wad command into wads and patch files. The
+// IWAD, if one was passed, comes first in wads.
+//
+static bool G_SplitWadArgs (const std::vector<std::string> &args,
+                            std::vector<std::string> &wads,
+                            std::vector<std::string> &patches)
 {
-	std::vector<std::string> wads, patches, hashes;
 	bool AddedIWAD = false;
-	bool Reboot = false;
-	QWORD i, j;
-
-	// [Russell] print out some useful info
-	if (argc == 1)
-	{
-	    Printf(PRINT_HIGH, "Usage: wad pwad [...] [deh/bex [...]]\n");
-	    Printf(PRINT_HIGH, "       wad iwad [pwad [...]] [deh/bex [...]]\n");
-	    Printf(PRINT_HIGH, "\n");
-	    Printf(PRINT_HIGH, "Load a wad file on the fly, pwads/dehs/bexs require extension\n");
-	    Printf(PRINT_HIGH, "eg: wad doom\n");
-
-	    return;
-	}
+	size_t i;
 
 	// Did we pass an IWAD?
-	if (W_IsIWAD(argv[1])) {
+	if (!args.empty() && W_IsIWAD(args[0])) {
 		std::string ext;
 
-		if (!M_ExtractFileExtension(argv[1], ext)) {
-			wads.push_back(std::string(argv[1]) + ".wad");
+		if (!M_ExtractFileExtension(args[0], ext)) {
+			wads.push_back(args[0] + ".wad");
 		} else {
-			wads.push_back(argv[1]);
+			wads.push_back(args[0]);
 		}
 		AddedIWAD = true;
 	}
 
 	// Are the passed params WAD files or patch files?
-	for (i = 1; i < argc; i++) {
+	for (i = 0; i < args.size(); i++) {
 		std::string ext;
 
-		if (M_ExtractFileExtension(argv[i], ext)) {
-			if ((ext == "wad") && !W_IsIWAD(argv[i])) {
+		if (M_ExtractFileExtension(args[i], ext)) {
+			if ((ext == "wad") && !W_IsIWAD(args[i])) {
 				// Wad that isn't an IWAD
-				wads.push_back(argv[i]);
+				wads.push_back(args[i]);
 			} else if  (ext == "deh" || ext == "bex") {
 				// Patch file
-				patches.push_back(argv[i]);
+				patches.push_back(args[i]);
 			}
 		}
 	}
 
-	// Check our environment, if the same WADs are used, ignore this command.
+	return AddedIWAD;
+}
+
+//
+// G_WadsChanged
+// True if loading wads and patches would need a wad switch.
+//
+static bool G_WadsChanged (const std::vector<std::string> &wads,
+                           const std::vector<std::string> &patches,
+                           bool AddedIWAD)
+{
+	size_t i, j;
 
 	// Did we switch IWAD files?
 	if (AddedIWAD && !wadfiles.empty()) {
 		if (StdStringCompare(M_ExtractFileName(wads[0]), M_ExtractFileName(wadfiles[1]), true) != 0) {
-			Reboot = true;
+			return true;
 		}
 	}
 
 	// Do the sizes of the WAD lists not match up?
-	if (!Reboot) {
-		if (wadfiles.size() - 2 != wads.size() - (AddedIWAD ? 1 : 0)) {
-			Reboot = true;
-		}
+	if (wadfiles.size() - 2 != wads.size() - (AddedIWAD ? 1 : 0)) {
+		return true;
 	}
 
 	// Do our WAD lists match up exactly?
-	if (!Reboot) {
-		for (i = 2, j = (AddedIWAD ? 1 : 0); i < wadfiles.size() && j < wads.size(); i++, j++) {
-			if (StdStringCompare(M_ExtractFileName(wads[j]), M_ExtractFileName(wadfiles[i]), true) != 0) {
-				Reboot = true;
-				break;
-			}
+	for (i = 2, j = (AddedIWAD ? 1 : 0); i < wadfiles.size() && j < wads.size(); i++, j++) {
+		if (StdStringCompare(M_ExtractFileName(wads[j]), M_ExtractFileName(wadfiles[i]), true) != 0) {
+			return true;
 		}
 	}
 
 	// Do the sizes of the patch lists not match up?
-	if (!Reboot) {
-		if (patchfiles.size() != patches.size()) {
-			Reboot = true;
-		}
+	if (patchfiles.size() != patches.size()) {
+		return true;
 	}
 
 	// Do our patchfile lists match up exactly?
-	if (!Reboot) {
-		for (i = 0, j = 0; i < patchfiles.size() && j < patches.size(); i++, j++) {
-			if (StdStringCompare(M_ExtractFileName(patches[j]), M_ExtractFileName(patchfiles[i]), true) != 0) {
-				Reboot = true;
-				break;
-			}
+	for (i = 0, j = 0; i < patchfiles.size() && j < patches.size(); i++, j++) {
+		if (StdStringCompare(M_ExtractFileName(patches[j]), M_ExtractFileName(patchfiles[i]), true) != 0) {
+			return true;
 		}
 	}
 
-	if (Reboot) {
+	return false;
+}
+
+BEGIN_COMMAND (wad) // denis - changes wads
+{
+	std::vector<std::string> wads, patches;
+
+	// [Russell] print out some useful info
+	if (argc == 1)
+	{
+	    Printf(PRINT_HIGH, "Usage: wad pwad [...] [deh/bex [...]]\n");
+	    Printf(PRINT_HIGH, "       wad iwad [pwad [...]] [deh/bex [...]]\n");
+	    Printf(PRINT_HIGH, "\n");
+	    Printf(PRINT_HIGH, "Load a wad file on the fly, pwads/dehs/bexs require extension\n");
+	    Printf(PRINT_HIGH, "eg: wad doom\n");
+
+	    return;
+	}
+
+	bool AddedIWAD = G_SplitWadArgs(std::vector<std::string>(argv + 1, argv + argc), wads, patches);
+
+	// Check our environment, if the same WADs are used, ignore this command.
+	if (G_WadsChanged(wads, patches, AddedIWAD)) {
 		if (!AddedIWAD) {
 			wads.insert(wads.begin(), wadfiles[1]);
 		}
@@ -367,6 +385,8 @@ void G_DoNewGame (void)
 {
 	size_t i;
 
+	SV_NetDemoMapChange();
+
 	for(i = 0; i < players.size(); i++)
 	{
 		if(!players[i].ingame())
@@ -548,6 +568,43 @@ void G_InitNew (const char *mapname)
 	//	SV_ServerSettingChange();
 }
 
+//
+// G_PrefetchNextMap
+// Reads the lumps of the map that follows the intermission on a worker
+// thread, so that loading it does not wait on the disk. Nothing is read
+// when the next maplist entry switches wads, as the map would be looked
+// up in wads about to be closed.
+//
+static void G_PrefetchNextMap (void)
+{
+	std::string next;
+	size_t next_index;
+
+	if (Maplist::instance().get_next_index(next_index)) {
+		maplist_entry_t maplist_entry;
+
+		if (!Maplist::instance().get_map_by_index(next_index, maplist_entry))
+			return;
+
+		if (!maplist_entry.wads.empty()) {
+			std::vector<std::string> wads, patches;
+			bool AddedIWAD = G_SplitWadArgs(maplist_entry.wads, wads, patches);
+
+			if (G_WadsChanged(wads, patches, AddedIWAD))
+				return;
+		}
+
+		next = maplist_entry.map;
+	} else {
+		next = G_NextMap();
+	}
+
+	int lumpnum = W_CheckNumForName(next.c_str());
+
+	if (lumpnum != -1)
+		W_PrefetchLumps(lumpnum + 1, ML_BEHAVIOR);
+}
+
 //
 // G_DoCompleted
 //
@@ -609,6 +666,10 @@ void G_DoCompleted (void)
 	for(i = 0; i < players.size(); i++)
 		if(players[i].ingame())
 			G_PlayerFinishLevel(players[i]);
+
+	// Only the intermission gets here. A wad switch also exits the level,
+	// but starts a new game before the ticker runs ga_completed.
+	G_PrefetchNextMap();
 }
 
 //
@@ -631,6 +692,8 @@ void G_DoLoadLevel (int position)
 		lastposition = position;
 
 	G_InitLevelLocals ();
+	SV_InvalidateLevelState ();
+	SV_QryInvalidateCache ();
 
 	if (firstmapinit) {
 		Printf (PRINT_HIGH, "--- %s: \"%s\" ---\n", level.mapname, level.level_name);
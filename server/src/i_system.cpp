@@ -230,6 +230,30 @@ QWORD I_MSTime (void)
 }
 #endif
 
+//
+// I_UTime
+// Returns a microsecond timer for profiling; only differences are meaningful
+//
+QWORD I_UTime (void)
+{
+#ifdef WIN32
+	static LARGE_INTEGER freq;
+	LARGE_INTEGER now;
+
+	if (!freq.QuadPart)
+		QueryPerformanceFrequency (&freq);
+	QueryPerformanceCounter (&now);
+
+	return (QWORD)now.QuadPart * 1000000 / (QWORD)freq.QuadPart;
+#else
+	struct timeval tv;
+
+	gettimeofday (&tv, NULL);
+
+	return (QWORD)tv.tv_sec * 1000000 + (QWORD)tv.tv_usec;
+#endif
+}
+
 //
 // I_GetTime
 // returns time in 1/35th second tics
@@ -114,6 +114,12 @@ CVAR_FUNC_DECL (sv_shufflemaplist,	"0", "Randomly shuffle the maplist",
 // Network compression (experimental)
 CVAR (sv_networkcompression, "1", "Network compression",
       CVARTYPE_BOOL, CVAR_ARCHIVE | CVAR_SERVERINFO)
+// Record a netdemo of each player's point of view
+CVAR_FUNC_DECL (sv_netdemo, "0", "Record a netdemo for every player in the game",
+      CVARTYPE_BOOL, CVAR_ARCHIVE | CVAR_NOENABLEDISABLE)
+// Directory serverside netdemos are written to
+CVAR (sv_netdemodir, "", "Directory to write serverside netdemos to",
+      CVARTYPE_STRING, CVAR_ARCHIVE | CVAR_NOENABLEDISABLE)
 // NAT firewall workaround port number
 CVAR (sv_natport,	"0", "NAT firewall workaround, this is a port number",
       CVARTYPE_INT, CVAR_ARCHIVE | CVAR_NOENABLEDISABLE)
@@ -0,0 +1,826 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id$
+//
+// Copyright (C) 2006-2012 by The Odamex Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Serverside netdemo recording.  Each connected player gets a netdemo of
+//	their own point of view, built from the messages the server sends them.
+//	The files use the same format as the client's NetDemo class so they can
+//	be played back by any client.
+//
+//	File I/O happens on a separate writer thread.  The game thread only
+//	copies data into jobs and places them on a single producer, single
+//	consumer queue.  Snapshot index entries are written to the file as they
+//	are made and the header is rewritten at each snapshot, so a netdemo
+//	remains seekable even if the server dies before the recording is
+//	finished.
+//
+//-----------------------------------------------------------------------------
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#include <time.h>
+#include <string>
+#include <vector>
+
+#include "doomtype.h"
+#include "doomstat.h"
+#include "d_player.h"
+#include "c_console.h"
+#include "c_cvars.h"
+#include "c_dispatch.h"
+#include "i_system.h"
+#include "i_net.h"
+#include "farchive.h"
+#include "g_level.h"
+#include "p_acs.h"
+#include "p_ctf.h"
+#include "p_saveg.h"
+#include "version.h"
+#include "sv_main.h"
+#include "sv_sqpold.h"
+#include "sv_demo.h"
+
+EXTERN_CVAR (sv_netdemo)
+EXTERN_CVAR (sv_netdemodir)
+
+//
+// The netdemo file format.  These values must match those of the client's
+// NetDemo class in cl_demo.h.
+//
+
+#define NETDEMO_HEADER_SIZE			64
+#define NETDEMO_MESSAGE_HEADER_SIZE	9
+#define NETDEMO_INDEX_ENTRY_SIZE	8
+#define NETDEMO_INDEX_MESSAGE_SIZE	9
+#define NETDEMO_SNAPSHOT_SPACING	(20 * TICRATE)
+#define NETDEMO_MAX_SNAPSHOT_SIZE	131072
+
+typedef enum
+{
+	msg_packet		= 0xAA,
+	msg_snapshot,
+	msg_index
+} netdemo_message_t;
+
+typedef enum
+{
+	index_snapshot,
+	index_map
+} netdemo_index_t;
+
+typedef struct
+{
+	uint32_t	ticnum;
+	uint32_t	offset;
+} netdemo_index_entry_t;
+
+typedef struct
+{
+	FILE*			fp;
+	std::string		filename;
+	uint32_t		offset;				// file offset of the next chunk
+	uint32_t		starting_gametic;
+	int				last_map_tic;
+	bool			mapchanged;			// a map snapshot is needed
+	std::vector<byte>	captured;		// messages sent to the player this tic
+	std::vector<netdemo_index_entry_t> snapshot_index;
+	std::vector<netdemo_index_entry_t> map_index;
+} netdemo_recorder_t;
+
+static netdemo_recorder_t *recorders[MAXPLAYERS];
+
+//
+// Writer thread and its job queue
+//
+
+typedef struct
+{
+	FILE*		fp;
+	long		offset;		// where to write data, or -1 to append
+	byte*		data;		// owned by the job, freed once written
+	size_t		length;
+	bool		flush;
+	bool		close;
+} netdemo_job_t;
+
+#ifdef _MSC_VER
+#define NETDEMO_BARRIER()	MemoryBarrier()
+#else
+#define NETDEMO_BARRIER()	__sync_synchronize()
+#endif
+
+static const size_t NETDEMO_QUEUE_SIZE = 4096;
+
+static netdemo_job_t netdemo_queue[NETDEMO_QUEUE_SIZE];
+static volatile size_t netdemo_head = 0;	// next slot filled by the game
+static volatile size_t netdemo_tail = 0;	// next slot emptied by the writer
+static volatile bool netdemo_writer_running = false;
+static bool netdemo_writer_started = false;
+
+#ifdef _WIN32
+static HANDLE netdemo_writer;
+#else
+static pthread_t netdemo_writer;
+#endif
+
+// Statistics
+static unsigned int netdemo_jobs = 0;
+static unsigned int netdemo_stalls = 0;
+static volatile unsigned int netdemo_write_errors = 0;
+
+//
+// SV_NetDemoWriteJob
+//
+// Performs the file operations of a single job.  Called by the writer
+// thread, or by the game thread if the writer could not be started.
+//
+static void SV_NetDemoWriteJob(netdemo_job_t &job)
+{
+	if (job.data)
+	{
+		if (job.offset >= 0)
+			fseek(job.fp, job.offset, SEEK_SET);
+
+		if (fwrite(job.data, 1, job.length, job.fp) < job.length)
+			netdemo_write_errors++;
+
+		if (job.offset >= 0)
+			fseek(job.fp, 0, SEEK_END);
+
+		delete [] job.data;
+	}
+
+	if (job.flush)
+		fflush(job.fp);
+
+	if (job.close)
+		fclose(job.fp);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI SV_NetDemoWriterThread(LPVOID)
+#else
+static void *SV_NetDemoWriterThread(void *)
+#endif
+{
+	while (true)
+	{
+		size_t tail = netdemo_tail;
+
+		if (tail == netdemo_head)
+		{
+			if (!netdemo_writer_running)
+			{
+				// make sure nothing was queued before we were told to stop
+				NETDEMO_BARRIER();
+				if (netdemo_tail == netdemo_head)
+					break;
+				continue;
+			}
+
+			I_Yield();
+			continue;
+		}
+
+		NETDEMO_BARRIER();
+		netdemo_job_t job = netdemo_queue[tail];
+		NETDEMO_BARRIER();
+
+		SV_NetDemoWriteJob(job);
+		netdemo_tail = (tail + 1) % NETDEMO_QUEUE_SIZE;
+	}
+
+	return 0;
+}
+
+//
+// SV_NetDemoStopWriter
+//
+// Waits for the writer thread to finish all queued jobs and exit.
+//
+static void SV_NetDemoStopWriter()
+{
+	if (!netdemo_writer_started)
+		return;
+
+	NETDEMO_BARRIER();
+	netdemo_writer_running = false;
+
+#ifdef _WIN32
+	WaitForSingleObject(netdemo_writer, INFINITE);
+	CloseHandle(netdemo_writer);
+#else
+	pthread_join(netdemo_writer, NULL);
+#endif
+
+	netdemo_writer_started = false;
+}
+
+//
+// SV_NetDemoShutdown
+//
+static void SV_NetDemoShutdown()
+{
+	SV_NetDemoStopAll();
+	SV_NetDemoStopWriter();
+}
+
+//
+// SV_NetDemoStartWriter
+//
+static void SV_NetDemoStartWriter()
+{
+	static bool registered = false;
+
+	if (netdemo_writer_started)
+		return;
+
+	if (!registered)
+	{
+		atterm(SV_NetDemoShutdown);
+		registered = true;
+	}
+
+	netdemo_writer_running = true;
+
+#ifdef _WIN32
+	netdemo_writer = CreateThread(NULL, 0, SV_NetDemoWriterThread, NULL, 0, NULL);
+	netdemo_writer_started = (netdemo_writer != NULL);
+#else
+	netdemo_writer_started =
+		(pthread_create(&netdemo_writer, NULL, SV_NetDemoWriterThread, NULL) == 0);
+#endif
+
+	if (!netdemo_writer_started)
+	{
+		netdemo_writer_running = false;
+		Printf(PRINT_HIGH, "Unable to start the netdemo writer thread, "
+		                   "netdemos will be written by the game thread.\n");
+	}
+}
+
+//
+// SV_NetDemoQueueJob
+//
+// Hands a job to the writer thread.  If the queue is full the game thread
+// waits for space rather than dropping part of a recording.
+//
+static void SV_NetDemoQueueJob(const netdemo_job_t &job)
+{
+	netdemo_jobs++;
+
+	if (!netdemo_writer_started)
+	{
+		netdemo_job_t copy = job;
+		SV_NetDemoWriteJob(copy);
+		return;
+	}
+
+	size_t next = (netdemo_head + 1) % NETDEMO_QUEUE_SIZE;
+
+	if (next == netdemo_tail)
+	{
+		netdemo_stalls++;
+
+		while (next == netdemo_tail)
+			I_Yield();
+	}
+
+	netdemo_queue[netdemo_head] = job;
+	NETDEMO_BARRIER();
+	netdemo_head = next;
+}
+
+//
+// SV_NetDemoWrite
+//
+// Queues a copy of data to be written at offset, or appended to the file
+// when offset is -1.
+//
+static void SV_NetDemoWrite(netdemo_recorder_t *rec, const byte *data,
+                            size_t length, long offset = -1, bool flush = false)
+{
+	netdemo_job_t job;
+
+	job.fp = rec->fp;
+	job.offset = offset;
+	job.data = new byte[length];
+	job.length = length;
+	job.flush = flush;
+	job.close = false;
+
+	memcpy(job.data, data, length);
+	SV_NetDemoQueueJob(job);
+
+	if (offset < 0)
+		rec->offset += length;
+}
+
+//
+// Little-endian helpers for the file format
+//
+
+static byte *SV_NetDemoPutShort(byte *p, uint16_t val)
+{
+	p[0] = val & 0xFF;
+	p[1] = (val >> 8) & 0xFF;
+	return p + 2;
+}
+
+static byte *SV_NetDemoPutLong(byte *p, uint32_t val)
+{
+	p[0] = val & 0xFF;
+	p[1] = (val >> 8) & 0xFF;
+	p[2] = (val >> 16) & 0xFF;
+	p[3] = (val >> 24) & 0xFF;
+	return p + 4;
+}
+
+//
+// SV_NetDemoWriteHeader
+//
+// Writes the header at the start of the file.  The index offsets are left
+// at zero until the recording is finished, which tells the client to
+// rebuild the index from the index messages in the file.
+//
+static void SV_NetDemoWriteHeader(netdemo_recorder_t *rec, bool finished,
+                                  uint32_t snapshot_index_offset = 0,
+                                  uint32_t map_index_offset = 0)
+{
+	byte header[NETDEMO_HEADER_SIZE];
+	memset(header, 0, sizeof(header));
+
+	byte *p = header;
+	memcpy(p, "ODAD", 4);
+	p += 4;
+	*p++ = NETDEMOVER;
+	*p++ = 0;		// compression
+
+	p = SV_NetDemoPutShort(p, finished ? rec->snapshot_index.size() : 0);
+	p = SV_NetDemoPutLong(p, snapshot_index_offset);
+	p = SV_NetDemoPutShort(p, finished ? rec->map_index.size() : 0);
+	p = SV_NetDemoPutLong(p, map_index_offset);
+	p = SV_NetDemoPutShort(p, NETDEMO_SNAPSHOT_SPACING);
+	p = SV_NetDemoPutLong(p, rec->starting_gametic);
+	p = SV_NetDemoPutLong(p, gametic);
+
+	SV_NetDemoWrite(rec, header, sizeof(header), 0, true);
+}
+
+//
+// SV_NetDemoWriteChunk
+//
+static void SV_NetDemoWriteChunk(netdemo_recorder_t *rec, const byte *data,
+                                 size_t length, netdemo_message_t type)
+{
+	byte *chunk = new byte[NETDEMO_MESSAGE_HEADER_SIZE + length];
+
+	byte *p = chunk;
+	*p++ = static_cast<byte>(type);
+	p = SV_NetDemoPutLong(p, length);
+	p = SV_NetDemoPutLong(p, gametic);
+
+	if (length)
+		memcpy(p, data, length);
+
+	netdemo_job_t job;
+
+	job.fp = rec->fp;
+	job.offset = -1;
+	job.data = chunk;
+	job.length = NETDEMO_MESSAGE_HEADER_SIZE + length;
+	job.flush = false;
+	job.close = false;
+
+	SV_NetDemoQueueJob(job);
+	rec->offset += job.length;
+}
+
+//
+// SV_NetDemoWriteIndex
+//
+// Writes an index table, used when a recording is finished.
+//
+static void SV_NetDemoWriteIndex(netdemo_recorder_t *rec,
+                                 const std::vector<netdemo_index_entry_t> &index)
+{
+	if (index.empty())
+		return;
+
+	std::vector<byte> buf(index.size() * NETDEMO_INDEX_ENTRY_SIZE);
+
+	byte *p = &buf[0];
+	for (size_t i = 0; i < index.size(); i++)
+	{
+		p = SV_NetDemoPutLong(p, index[i].ticnum);
+		p = SV_NetDemoPutLong(p, index[i].offset);
+	}
+
+	SV_NetDemoWrite(rec, &buf[0], buf.size());
+}
+
+//
+// SV_NetDemoSnapshot
+//
+// Writes the entire state of the game with G_WriteNetDemoSnapshot, as the
+// client does.  The snapshot is shared by every recorder that needs one
+// during the same gametic.
+//
+static const byte *SV_NetDemoSnapshot(size_t &length)
+{
+	static byte snapbuf[NETDEMO_MAX_SNAPSHOT_SIZE];
+	static size_t snaplength = 0;
+	static int snaptic = -1;
+
+	if (snaptic == gametic)
+	{
+		length = snaplength;
+		return snapbuf;
+	}
+
+	snaplength = G_WriteNetDemoSnapshot(snapbuf, NETDEMO_MAX_SNAPSHOT_SIZE);
+	if (snaplength > NETDEMO_MAX_SNAPSHOT_SIZE)
+		snaplength = 0;
+
+	snaptic = gametic;
+	length = snaplength;
+	return snapbuf;
+}
+
+//
+// SV_NetDemoWriteSnapshot
+//
+// Writes a snapshot, records it in the index both in memory and in the file,
+// and rewrites the header so the file can be seeked up to this point.
+//
+static void SV_NetDemoWriteSnapshot(netdemo_recorder_t *rec, bool mapchange)
+{
+	size_t length;
+	const byte *snapshot = SV_NetDemoSnapshot(length);
+
+	if (length == 0)
+		return;
+
+	netdemo_index_entry_t entry;
+	entry.ticnum = gametic;
+	entry.offset = rec->offset;
+
+	SV_NetDemoWriteChunk(rec, snapshot, length, msg_snapshot);
+
+	byte msg[NETDEMO_INDEX_MESSAGE_SIZE];
+
+	if (mapchange)
+	{
+		rec->map_index.push_back(entry);
+		rec->last_map_tic = gametic;
+
+		msg[0] = index_map;
+		SV_NetDemoPutLong(SV_NetDemoPutLong(msg + 1, entry.ticnum), entry.offset);
+		SV_NetDemoWriteChunk(rec, msg, sizeof(msg), msg_index);
+	}
+
+	rec->snapshot_index.push_back(entry);
+
+	msg[0] = index_snapshot;
+	SV_NetDemoPutLong(SV_NetDemoPutLong(msg + 1, entry.ticnum), entry.offset);
+	SV_NetDemoWriteChunk(rec, msg, sizeof(msg), msg_index);
+
+	SV_NetDemoWriteHeader(rec, false);
+}
+
+//
+// SV_NetDemoWriteLocalCmd
+//
+// Generates the position and angle of the recorded player, taking the
+// place of ticcmds.  Matches NetDemo::writeLocalCmd.
+//
+static void SV_NetDemoWriteLocalCmd(buf_t *netbuffer, player_t &player)
+{
+	AActor *mo = player.mo;
+	if (!mo)
+		return;
+
+	MSG_WriteByte(netbuffer, svc_netdemocap);
+	MSG_WriteByte(netbuffer, player.cmd.ucmd.buttons);
+	MSG_WriteByte(netbuffer, player.cmd.ucmd.impulse);
+	MSG_WriteShort(netbuffer, player.cmd.ucmd.yaw);
+	MSG_WriteShort(netbuffer, player.cmd.ucmd.forwardmove);
+	MSG_WriteShort(netbuffer, player.cmd.ucmd.sidemove);
+	MSG_WriteShort(netbuffer, player.cmd.ucmd.upmove);
+	MSG_WriteShort(netbuffer, player.cmd.ucmd.pitch);
+
+	MSG_WriteByte(netbuffer, mo->waterlevel);
+	MSG_WriteLong(netbuffer, mo->x);
+	MSG_WriteLong(netbuffer, mo->y);
+	MSG_WriteLong(netbuffer, mo->z);
+	MSG_WriteLong(netbuffer, mo->momx);
+	MSG_WriteLong(netbuffer, mo->momy);
+	MSG_WriteLong(netbuffer, mo->momz);
+	MSG_WriteLong(netbuffer, mo->angle);
+	MSG_WriteLong(netbuffer, mo->pitch);
+	MSG_WriteLong(netbuffer, player.viewheight);
+	MSG_WriteLong(netbuffer, player.deltaviewheight);
+	MSG_WriteLong(netbuffer, player.jumpTics);
+	MSG_WriteLong(netbuffer, mo->reactiontime);
+	MSG_WriteByte(netbuffer, player.readyweapon);
+	MSG_WriteByte(netbuffer, player.pendingweapon);
+}
+
+//
+// SV_NetDemoWriteConnection
+//
+// Emulates the launcher response and the start of the connection sequence
+// so the client can join the recorded game during playback.  The rest of
+// the connection sequence (map name, full update) is captured from the
+// messages the server sends the player.
+//
+static void SV_NetDemoWriteConnection(netdemo_recorder_t *rec, player_t &player)
+{
+	static buf_t tempbuf(MAX_UDP_PACKET);
+
+	SZ_Clear(&tempbuf);
+	SV_WriteServerInfo(&tempbuf, 0, false);
+	SV_NetDemoWriteChunk(rec, tempbuf.data, tempbuf.cursize, msg_packet);
+
+	SZ_Clear(&tempbuf);
+
+	// The packet sequence id
+	MSG_WriteLong(&tempbuf, 0);
+
+	MSG_WriteMarker(&tempbuf, svc_consoleplayer);
+	MSG_WriteByte(&tempbuf, player.id);
+	MSG_WriteString(&tempbuf, player.client.digest.c_str());
+
+	MSG_WriteMarker(&tempbuf, svc_serversettings);
+	SV_WriteServerSettings(&tempbuf);
+
+	MSG_WriteMarker(&tempbuf, svc_spectate);
+	MSG_WriteByte(&tempbuf, player.id);
+	MSG_WriteByte(&tempbuf, player.spectator);
+
+	SV_NetDemoWriteChunk(rec, tempbuf.data, tempbuf.cursize, msg_packet);
+}
+
+//
+// SV_NetDemoFileName
+//
+static std::string SV_NetDemoFileName(player_t &player)
+{
+	char timestr[32];
+	time_t now = time(NULL);
+	strftime(timestr, sizeof(timestr), "%Y%m%d_%H%M%S", localtime(&now));
+
+	// keep only characters that are safe in a file name
+	std::string name;
+	for (const char *c = player.userinfo.netname; *c; c++)
+	{
+		if (isalnum((unsigned char)*c) || *c == '-' || *c == '_')
+			name += *c;
+	}
+
+	char filename[256];
+	sprintf(filename, "odasrv_%s_%s_%d_%s.odd", timestr, level.mapname,
+	        player.id, name.c_str());
+
+	std::string dir = sv_netdemodir.cstring();
+	if (dir.empty())
+		return I_GetUserFileName(filename);
+
+	if (dir[dir.length() - 1] != PATHSEPCHAR && dir[dir.length() - 1] != '/')
+		dir += PATHSEPCHAR;
+
+	return dir + filename;
+}
+
+//
+// SV_NetDemoStart
+//
+// Starts recording a player's point of view.  Call before the map name and
+// full update are sent to the player.
+//
+void SV_NetDemoStart(player_t &player)
+{
+	if (!sv_netdemo || recorders[player.id])
+		return;
+
+	std::string filename = SV_NetDemoFileName(player);
+
+	FILE *fp = fopen(filename.c_str(), "wb");
+	if (!fp)
+	{
+		Printf(PRINT_HIGH, "Unable to create netdemo file %s.\n", filename.c_str());
+		return;
+	}
+
+	SV_NetDemoStartWriter();
+
+	netdemo_recorder_t *rec = new netdemo_recorder_t;
+
+	rec->fp = fp;
+	rec->filename = filename;
+	rec->offset = 0;
+	rec->starting_gametic = gametic;
+	rec->last_map_tic = gametic;
+	rec->mapchanged = true;
+
+	recorders[player.id] = rec;
+
+	SV_NetDemoWriteHeader(rec, false);
+	rec->offset = NETDEMO_HEADER_SIZE;
+
+	SV_NetDemoWriteConnection(rec, player);
+
+	Printf(PRINT_HIGH, "Recording netdemo %s.\n", filename.c_str());
+}
+
+//
+// SV_NetDemoFinish
+//
+// Finishes a netdemo, writing the full index and final header.
+//
+static void SV_NetDemoFinish(int id)
+{
+	netdemo_recorder_t *rec = recorders[id];
+	if (!rec)
+		return;
+
+	recorders[id] = NULL;
+
+	// write any remaining messages and the end-of-demo marker
+	rec->captured.push_back(svc_netdemostop);
+	SV_NetDemoWriteChunk(rec, &rec->captured[0], rec->captured.size(), msg_packet);
+
+	uint32_t snapshot_index_offset = rec->offset;
+	SV_NetDemoWriteIndex(rec, rec->snapshot_index);
+
+	uint32_t map_index_offset = rec->offset;
+	SV_NetDemoWriteIndex(rec, rec->map_index);
+
+	SV_NetDemoWriteHeader(rec, true, snapshot_index_offset, map_index_offset);
+
+	netdemo_job_t job;
+	job.fp = rec->fp;
+	job.offset = -1;
+	job.data = NULL;
+	job.length = 0;
+	job.flush = false;
+	job.close = true;
+	SV_NetDemoQueueJob(job);
+
+	Printf(PRINT_HIGH, "Netdemo %s has stopped.\n", rec->filename.c_str());
+
+	delete rec;
+}
+
+//
+// SV_NetDemoStop
+//
+void SV_NetDemoStop(player_t &player)
+{
+	SV_NetDemoFinish(player.id);
+}
+
+//
+// SV_NetDemoStopAll
+//
+void SV_NetDemoStopAll()
+{
+	for (int i = 0; i < MAXPLAYERS; i++)
+		SV_NetDemoFinish(i);
+}
+
+//
+// SV_NetDemoMapChange
+//
+// Called when a new map is about to be sent to the players.  Players that
+// are not being recorded yet start a new netdemo, everyone else gets a map
+// snapshot once the map has loaded.
+//
+void SV_NetDemoMapChange()
+{
+	if (!sv_netdemo)
+		return;
+
+	for (size_t i = 0; i < players.size(); i++)
+	{
+		if (!players[i].ingame())
+			continue;
+
+		if (recorders[players[i].id])
+			recorders[players[i].id]->mapchanged = true;
+		else
+			SV_NetDemoStart(players[i]);
+	}
+}
+
+//
+// SV_NetDemoCapture
+//
+// Copies the messages of a packet sent to a player.  Called before the
+// packet is compressed, as the netdemo stores the messages uncompressed.
+//
+void SV_NetDemoCapture(player_t &player, const byte *data, size_t length)
+{
+	netdemo_recorder_t *rec = recorders[player.id];
+	if (!rec || !length)
+		return;
+
+	rec->captured.insert(rec->captured.end(), data, data + length);
+}
+
+//
+// SV_NetDemoTicker
+//
+// Writes one message per recorded player holding everything sent to them
+// this tic, followed by snapshots when they are due.  Called once per tic
+// after packets are sent.
+//
+void SV_NetDemoTicker()
+{
+	static buf_t netbuf_localcmd(1024);
+
+	for (size_t i = 0; i < players.size(); i++)
+	{
+		netdemo_recorder_t *rec = recorders[players[i].id];
+		if (!rec)
+			continue;
+
+		SZ_Clear(&netbuf_localcmd);
+		SV_NetDemoWriteLocalCmd(&netbuf_localcmd, players[i]);
+		rec->captured.insert(rec->captured.end(), netbuf_localcmd.data,
+		                     netbuf_localcmd.data + netbuf_localcmd.cursize);
+
+		if (rec->captured.empty())
+			SV_NetDemoWriteChunk(rec, NULL, 0, msg_packet);
+		else
+			SV_NetDemoWriteChunk(rec, &rec->captured[0], rec->captured.size(), msg_packet);
+
+		rec->captured.clear();
+
+		if (gamestate != GS_LEVEL)
+			continue;
+
+		if (rec->mapchanged)
+		{
+			SV_NetDemoWriteSnapshot(rec, true);
+			rec->mapchanged = false;
+		}
+		else if (gametic != rec->last_map_tic &&
+		         (gametic - rec->last_map_tic) % NETDEMO_SNAPSHOT_SPACING == 0)
+		{
+			SV_NetDemoWriteSnapshot(rec, false);
+		}
+	}
+}
+
+CVAR_FUNC_IMPL (sv_netdemo)
+{
+	if (!var.asInt())
+		SV_NetDemoStopAll();
+}
+
+BEGIN_COMMAND (netdemostatus)
+{
+	int count = 0;
+
+	for (int i = 0; i < MAXPLAYERS; i++)
+	{
+		if (recorders[i])
+		{
+			Printf(PRINT_HIGH, "%s: %u bytes, %u snapshots\n",
+			       recorders[i]->filename.c_str(), recorders[i]->offset,
+			       (unsigned)recorders[i]->snapshot_index.size());
+			count++;
+		}
+	}
+
+	size_t queued = (netdemo_head + NETDEMO_QUEUE_SIZE - netdemo_tail) % NETDEMO_QUEUE_SIZE;
+
+	Printf(PRINT_HIGH, "%d netdemos recording, writer thread %s\n", count,
+	       netdemo_writer_started ? "running" : "not running");
+	Printf(PRINT_HIGH, "%u jobs queued, %u queued in total, %u queue stalls, "
+	       "%u write errors\n", (unsigned)queued, netdemo_jobs, netdemo_stalls,
+	       netdemo_write_errors);
+}
+END_COMMAND (netdemostatus)
+
+VERSION_CONTROL (sv_demo_cpp, "$Id$")
@@ -0,0 +1,36 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id$
+//
+// Copyright (C) 2006-2012 by The Odamex Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Serverside netdemo recording
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __SV_DEMO_H__
+#define __SV_DEMO_H__
+
+#include "doomtype.h"
+#include "d_player.h"
+
+void SV_NetDemoStart(player_t &player);
+void SV_NetDemoStop(player_t &player);
+void SV_NetDemoStopAll();
+void SV_NetDemoMapChange();
+void SV_NetDemoCapture(player_t &player, const byte *data, size_t length);
+void SV_NetDemoTicker();
+
+#endif // __SV_DEMO_H__
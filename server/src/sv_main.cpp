@@ -62,6 +62,8 @@
 #include "p_unlag.h"
 #include "sv_vote.h"
 #include "sv_maplist.h"
+#include "sv_demo.h"
+#include "farchive.h"
 
 #include <algorithm>
 #include <sstream>
@@ -285,6 +287,7 @@ team_t SV_GoodTeam (void);
 
 void SV_SendServerSettings (client_t *cl);
 void SV_ServerSettingChange (void);
+static void SV_ServerInfoChanged (cvar_t &var);
 
 // some doom functions
 void P_KillMobj (AActor *source, AActor *target, AActor *inflictor, bool joinkill);
@@ -766,6 +769,8 @@ void SV_InitNetwork (void)
 
 	gametime = I_GetTime ();
 
+	cvar_t::Subscribe(CVAR_SERVERINFO, SV_ServerInfoChanged);
+
 	// Nes - Connect with the master servers. (If valid)
 	SV_InitMasters();
 }
@@ -787,6 +792,7 @@ int SV_GetFreeClient(void)
 	}
 
 	players.push_back(player_t());
+	SV_QryInvalidateCache();
 
 	// generate player id
 	players.back().id = free_player_ids.front();
@@ -862,12 +868,15 @@ void SV_RemoveDisconnectedPlayer(player_t &player)
 
 	Unlag::getInstance().unregisterPlayer(player_id);
 
+	SV_NetDemoStop(player);
+
 	// remove this player from the global players vector
 	for (size_t i=0; i<players.size(); i++)
 	{
 		if (players[i].id == player_id)
 		{
 			players.erase(players.begin() + i);
+			SV_QryInvalidateCache();
 			free_player_ids.push(player_id);
 			break;
 		}
@@ -1679,24 +1688,148 @@ void SV_UpdateHiddenMobj (void)
 // SV_UpdateSectors
 // Update doors, floors, ceilings etc... that have at some point moved
 //
-void SV_UpdateSectors(client_t* cl)
+// Only sectors in the changedsectors list are visited.  Runs of consecutive
+// sector numbers are batched into a single svc_sectorrange message so the
+// sector number is not repeated for every sector.
+//
+void SV_UpdateSectors(buf_t *buf)
 {
-	for (int sectornum = 0; sectornum < numsectors; sectornum++)
+	size_t i = 0;
+
+	while (i < changedsectors.size())
 	{
-		sector_t* sector = &sectors[sectornum];
+		// find the end of this run of consecutive sector numbers
+		int first = changedsectors[i];
+		size_t count = 1;
+		while (i + count < changedsectors.size() && count < 255 &&
+			   changedsectors[i + count] == first + (int)count)
+			count++;
+
+		MSG_WriteMarker(buf, svc_sectorrange);
+		MSG_WriteShort(buf, first);
+		MSG_WriteByte(buf, count);
+
+		for (size_t j = 0; j < count; j++)
+		{
+			sector_t* sector = &sectors[first + j];
+
+			MSG_WriteShort(buf, P_FloorHeight(sector) >> FRACBITS);
+			MSG_WriteShort(buf, P_CeilingHeight(sector) >> FRACBITS);
+			MSG_WriteShort(buf, sector->floorpic);
+			MSG_WriteShort(buf, sector->ceilingpic);
+		}
 
-		if (sector->moveable)
+		i += count;
+	}
+}
+
+//
+// SV_UpdateSwitches
+// Update switches that have been pressed or are waiting to pop back out
+//
+void SV_UpdateSwitches(buf_t *buf)
+{
+	for (int l=0; l<numlines; l++)
+	{
+		unsigned state = 0, time = 0;
+		if(P_GetButtonInfo(&lines[l], state, time) || lines[l].wastoggled)
 		{
-			MSG_WriteMarker(&cl->reliablebuf, svc_sector);
-			MSG_WriteShort(&cl->reliablebuf, sectornum);
-			MSG_WriteShort(&cl->reliablebuf, P_FloorHeight(sector) >> FRACBITS);
-			MSG_WriteShort(&cl->reliablebuf, P_CeilingHeight(sector) >> FRACBITS);
-			MSG_WriteShort(&cl->reliablebuf, sector->floorpic);
-			MSG_WriteShort(&cl->reliablebuf, sector->ceilingpic);
+			MSG_WriteMarker (buf, svc_switch);
+			MSG_WriteLong (buf, l);
+			MSG_WriteByte (buf, lines[l].wastoggled);
+			MSG_WriteByte (buf, state);
+			MSG_WriteLong (buf, time);
 		}
 	}
 }
 
+//
+// Level state for full updates
+//
+// The sector and switch messages sent in a full update are the same for
+// every client, so they are built and LZO compressed at most once per tic and
+// shared by every client that joins during that tic.  The compressed blob is
+// streamed to the client in svc_levelstate chunks.
+//
+static const size_t LEVELSTATE_CHUNK_SIZE = 512;
+
+static std::vector<byte> levelstate;
+static int levelstate_id = 0;
+static int levelstate_tic = -1;
+
+//
+// SV_InvalidateLevelState
+//
+// Forces the level state to be rebuilt, such as when a new level is loaded
+// during the tic it was last built.
+//
+void SV_InvalidateLevelState()
+{
+	levelstate_tic = -1;
+}
+
+static void SV_BuildLevelState()
+{
+	if (levelstate_tic == gametic)
+		return;
+
+	static buf_t raw(MAX_UDP_PACKET * 128);
+	raw.clear();
+
+	SV_UpdateSectors(&raw);
+	SV_UpdateSwitches(&raw);
+
+	FLZOMemFile memfile;
+	memfile.Open();			// open for writing
+
+	FArchive arc(memfile);
+	arc.WriteCount(raw.size());
+	arc.Write(raw.ptr(), raw.size());
+	arc.Close();
+
+	levelstate.resize(memfile.Length());
+	memfile.WriteToBuffer(&levelstate[0], levelstate.size());
+
+	levelstate_tic = gametic;
+	levelstate_id++;
+
+	DPrintf("SV_BuildLevelState: %d bytes compressed to %d bytes\n",
+			(int)raw.size(), (int)levelstate.size());
+}
+
+//
+// SV_SendLevelState
+//
+// Streams the compressed level state to a client in chunks that each fit
+// comfortably in a single packet.
+//
+static bool SV_SendLevelState(player_t &pl)
+{
+	client_t *cl = &pl.client;
+
+	SV_BuildLevelState();
+
+	for (size_t offset = 0; offset < levelstate.size(); offset += LEVELSTATE_CHUNK_SIZE)
+	{
+		size_t len = levelstate.size() - offset;
+		if (len > LEVELSTATE_CHUNK_SIZE)
+			len = LEVELSTATE_CHUNK_SIZE;
+
+		MSG_WriteMarker(&cl->reliablebuf, svc_levelstate);
+		MSG_WriteLong(&cl->reliablebuf, levelstate_id);
+		MSG_WriteLong(&cl->reliablebuf, levelstate.size());
+		MSG_WriteLong(&cl->reliablebuf, offset);
+		MSG_WriteShort(&cl->reliablebuf, len);
+		MSG_WriteChunk(&cl->reliablebuf, &levelstate[offset], len);
+
+		if (cl->reliablebuf.cursize >= 600)
+			if (!SV_SendPacket(pl))
+				return false;
+	}
+
+	return true;
+}
+
 //
 // SV_DestroyFinishedMovingSectors
 //
@@ -1887,15 +2020,25 @@ void SV_SendMovingSectorUpdate(player_t &player, sector_t *sector)
 // SV_UpdateMovingSectors
 // Update doors, floors, ceilings etc... that are actively moving
 //
+// Sectors that have not changed since the last generation the client
+// acknowledged are skipped.
+//
 void SV_UpdateMovingSectors(player_t &player)
 {
+	client_t *cl = &player.client;
+
 	std::list<movingsector_t>::iterator itr;
 	for (itr = movingsectors.begin(); itr != movingsectors.end(); ++itr)
 	{
 		sector_t *sector = itr->sector;
-		
+
+		if (sector->changegen <= cl->sectorgen)
+			continue;
+
 		SV_SendMovingSectorUpdate(player, sector);
 	}
+
+	cl->pendingsectorgen = sectorgeneration;
 }
 
 
@@ -1974,55 +2117,95 @@ void SV_ClientFullUpdate (player_t &pl)
 	if(sv_gametype == GM_CTF)
 		CTF_Connect(pl);
 
-	// update sectors
-	SV_UpdateSectors(cl);
-	if (cl->reliablebuf.cursize >= 600)
-		if(!SV_SendPacket(pl))
-			return;
-
-	// update switches
-	for (int l=0; l<numlines; l++)
-	{
-		unsigned state = 0, time = 0;
-		if(P_GetButtonInfo(&lines[l], state, time) || lines[l].wastoggled)
-		{
-			MSG_WriteMarker (&cl->reliablebuf, svc_switch);
-			MSG_WriteLong (&cl->reliablebuf, l);
-			MSG_WriteByte (&cl->reliablebuf, lines[l].wastoggled);
-			MSG_WriteByte (&cl->reliablebuf, state);
-			MSG_WriteLong (&cl->reliablebuf, time);
-		}
-	}
+	// update sectors and switches
+	cl->sectorgen = 0;
+	if (!SV_SendLevelState(pl))
+		return;
 
 	SV_SendPacket(pl);
 }
 
+// Serverinfo cvars already written out the way svc_serversettings and
+// launcher queries send them, rebuilt only after one of them changes
+static buf_t serverinfo_settings(MAX_UDP_PACKET);
+static buf_t serverinfo_query(MAX_UDP_PACKET);
+static byte serverinfo_count;
+static bool serverinfo_changed = true;
+
 //
-//	SV_SendServerSettings
+//	SV_ServerInfoChanged
 //
-//	Sends server setting info
+//	Subscribed to changes of CVAR_SERVERINFO cvars
 //
+static void SV_ServerInfoChanged (cvar_t &var)
+{
+	serverinfo_changed = true;
+}
 
-void SV_SendServerSettings (client_t *cl)
+//
+//	SV_UpdateServerInfo
+//
+//	Writes out the serverinfo cvars again if any have changed
+//
+static void SV_UpdateServerInfo (void)
 {
-	// GhostlyDeath <June 19, 2008> -- Loop through all CVARs and send the CVAR_SERVERINFO stuff only
-	cvar_t *var = GetFirstCvar();
+	if (!serverinfo_changed)
+		return;
 
-	MSG_WriteMarker(&cl->reliablebuf, svc_serversettings);
+	SZ_Clear(&serverinfo_settings);
+	SZ_Clear(&serverinfo_query);
+	serverinfo_count = 0;
 
-	while (var)
+	for (cvar_t *var = GetFirstCvar(CVAR_SERVERINFO); var; var = var->GetNext(CVAR_SERVERINFO))
 	{
-		if (var->flags() & CVAR_SERVERINFO)
-		{
-			MSG_WriteByte(&cl->reliablebuf, 1);
-			MSG_WriteString(&cl->reliablebuf, var->name());
-			MSG_WriteString(&cl->reliablebuf, var->cstring());
-		}
+		MSG_WriteByte(&serverinfo_settings, 1);
+		MSG_WriteString(&serverinfo_settings, var->name());
+		MSG_WriteString(&serverinfo_settings, var->cstring());
 
-		var = var->GetNext();
+		MSG_WriteString(&serverinfo_query, var->name());
+		MSG_WriteString(&serverinfo_query, var->cstring());
+		serverinfo_count++;
 	}
 
-	MSG_WriteByte(&cl->reliablebuf, 2);
+	MSG_WriteByte(&serverinfo_settings, 2);
+
+	serverinfo_changed = false;
+}
+
+//
+//	SV_WriteServerSettings
+//
+//	Writes the body of svc_serversettings to buf
+//
+void SV_WriteServerSettings (buf_t *buf)
+{
+	SV_UpdateServerInfo();
+	SZ_Write(buf, serverinfo_settings.data, serverinfo_settings.cursize);
+}
+
+//
+//	SV_WriteServerInfoQuery
+//
+//	Writes the count and names and values of the serverinfo cvars, as
+//	launcher queries want them, to buf
+//
+void SV_WriteServerInfoQuery (buf_t *buf)
+{
+	SV_UpdateServerInfo();
+	MSG_WriteByte(buf, serverinfo_count);
+	SZ_Write(buf, serverinfo_query.data, serverinfo_query.cursize);
+}
+
+//
+//	SV_SendServerSettings
+//
+//	Sends server setting info
+//
+
+void SV_SendServerSettings (client_t *cl)
+{
+	MSG_WriteMarker(&cl->reliablebuf, svc_serversettings);
+	SV_WriteServerSettings(&cl->reliablebuf);
 }
 
 //
@@ -2032,6 +2215,8 @@ void SV_SendServerSettings (client_t *cl)
 //
 void SV_ServerSettingChange (void)
 {
+	SV_QryInvalidateCache();
+
 	if (gamestate != GS_LEVEL)
 		return;
 
@@ -2472,6 +2657,8 @@ void SV_ConnectClient (void)
 		}
 	}
 
+	SV_NetDemoStart(players[n]);
+
 	// send a map name
 	MSG_WriteMarker   (&cl->reliablebuf, svc_loadmap);
 	MSG_WriteString (&cl->reliablebuf, level.mapname);
@@ -3503,6 +3690,45 @@ void SV_FlushPlayerCmds(player_t &player)
 		player.cmds.pop();
 }
 
+// The most ticcmds that are processed in a single gametic, and the deepest
+// the ticcmd queue is allowed to grow before catching up
+static const size_t MAX_TICCMD_QUEUE = TICRATE / 4;
+
+//
+// SV_UpdateTiccmdJitter
+//
+// Updates the estimate of how much the arrival times of a client's ticcmds
+// deviate from the rate the client sent them at, and from that the queue
+// depth that absorbs the deviation without starving or adding more latency
+// than necessary.
+//
+static void SV_UpdateTiccmdJitter(client_t *cl, int tic, QWORD arrivaltime)
+{
+	const int ms_per_tic = 1000 / TICRATE;
+
+	if (cl->lastcmdarrival && tic > cl->lastcmdarrivaltic)
+	{
+		int expected = (tic - cl->lastcmdarrivaltic) * ms_per_tic;
+		int actual = (int)(arrivaltime - cl->lastcmdarrival);
+		int deviation = abs(actual - expected);
+
+		// don't let a single stall (eg, the client loading) dominate
+		if (deviation > 1000)
+			deviation = 1000;
+
+		// J += (|D| - J) / 16, as for RTP interarrival jitter, with J kept
+		// scaled by 16
+		cl->cmdjitter += deviation - ((cl->cmdjitter + 8) >> 4);
+	}
+
+	cl->lastcmdarrival = arrivaltime;
+	cl->lastcmdarrivaltic = tic;
+
+	// queue enough ticcmds to cover twice the mean deviation
+	size_t target = 1 + (2 * (cl->cmdjitter >> 4) + ms_per_tic - 1) / ms_per_tic;
+	cl->cmdtarget = target < MAX_TICCMD_QUEUE ? target : MAX_TICCMD_QUEUE;
+}
+
 //
 // SV_CalculateNumTiccmds
 //
@@ -3510,34 +3736,29 @@ void SV_FlushPlayerCmds(player_t &player)
 // most circumstances, it should be 1 per gametic to have the smoothest
 // player movement possible.
 //
+// The queue is allowed to hold as many ticcmds as the client's arrival
+// jitter calls for (see SV_UpdateTiccmdJitter).  Anything beyond that only
+// adds latency, so an extra ticcmd is processed to catch up.
+//
 int SV_CalculateNumTiccmds(player_t &player)
 {
 	if (!player.mo || player.cmds.empty())
 		return 0;
 
 	const int minimum_cmds = 1;
-	const size_t maximum_queue_size = TICRATE / 4;
+	client_t *cl = &player.client;
 	
 	if (!sv_ticbuffer || player.spectator || player.playerstate == PST_DEAD)
 	{
 		// Process all queued ticcmds.
-		return maximum_queue_size;
+		return MAX_TICCMD_QUEUE;
 	}
-	if (player.mo->momx == 0 && player.mo->momy == 0 && player.mo->momz == 0)
+	if (player.cmds.size() > cl->cmdtarget)
 	{
-		// Player is not moving
-		return 2 * minimum_cmds;
-	}
-	if (player.cmds.size() > maximum_queue_size)
-	{
-		// The player experienced a large latency spike so try to catch up by
-		// processing more than one ticcmd at the expense of appearing perfectly
-		//  smooth
-		return 2 * minimum_cmds;
-	}
-	if (P_AtInterval(TICRATE/2) && !P_VisibleToPlayers(player.mo))
-	{
-		// Every half second, run two commands if no one can see this player
+		// The queue is deeper than needed to absorb this client's jitter so
+		// try to catch up by processing more than one ticcmd at the expense
+		// of appearing perfectly smooth
+		cl->cmdcatchups++;
 		return 2 * minimum_cmds;
 	}
 
@@ -3566,7 +3787,15 @@ void SV_ProcessPlayerCmd(player_t &player)
 	if (!player.mo)
 		return;
 
+	client_t *cl = &player.client;
+
+	// the client has sent ticcmds before but none arrived in time for this tic
+	if (player.cmds.empty() && cl->lastcmdarrival && !player.spectator &&
+		gamestate == GS_LEVEL)
+		cl->cmdstarvations++;
+
 	int num_cmds = SV_CalculateNumTiccmds(player);	
+	QWORD now = I_MSTime();
 
 	for (int i = 0; i < num_cmds && !player.cmds.empty(); i++)
 	{
@@ -3622,6 +3851,10 @@ void SV_ProcessPlayerCmd(player_t &player)
 			player.mo->RunThink();
 		}
 
+		// smoothed time this ticcmd spent waiting in the queue
+		int delay = (int)(now - player.cmds.front().arrivaltime);
+		cl->cmddelay += delay - ((cl->cmddelay + 8) >> 4);
+
 		player.cmds.pop();		// remove this tic from the queue after being processed
 	}
 }
@@ -3675,6 +3908,8 @@ void SV_GetPlayerCmd(player_t &player)
 	curcmd.ucmd.msec			= 0;	// unused
 	curcmd.ucmd.use				= 0;	// unused
 
+	prevcmd.arrivaltime = curcmd.arrivaltime = I_MSTime();
+
 	// out of order packet
 	// TODO: Insert into the appropriate place in the queue
 	if (!player.mo || cl->lastclientcmdtic > tic)
@@ -3689,6 +3924,7 @@ void SV_GetPlayerCmd(player_t &player)
 	}
 
 	player.cmds.push(curcmd);
+	SV_UpdateTiccmdJitter(cl, tic, curcmd.arrivaltime);
 
 	cl->lastclientcmdtic = tic;
 	cl->lastcmdtic = gametic;
@@ -3793,6 +4029,7 @@ void SV_Spectate (player_t &player) {
 		player.mo->x = MSG_ReadLong();
 		player.mo->y = MSG_ReadLong();
 		player.mo->z = MSG_ReadLong();
+		P_UpdateThingProxy (player.mo);
 	} else {
 		SV_SetPlayerSpec(player, Code);
 	}
@@ -4621,7 +4858,11 @@ void SV_StepTics (QWORD tics)
 
 		SV_WriteCommands();
 		SV_SendPackets();
+		SV_NetDemoTicker();
 		SV_ClearClientsBPS();
+
+		// sector changes made after this point belong to a new generation
+		sectorgeneration++;
 		SV_CheckTimeouts();
 		
 		// Since clients are only sent sector updates every 3rd tic, don't destroy
@@ -4730,6 +4971,12 @@ BEGIN_COMMAND (playerinfo)
 	Printf (PRINT_HIGH, " userinfo.color   - %d \n",		  player->userinfo.color);
 	Printf (PRINT_HIGH, " userinfo.skin    - %s \n",		  skins[player->userinfo.skin].name);
 	Printf (PRINT_HIGH, " userinfo.gender  - %d \n",		  player->userinfo.gender);
+	Printf (PRINT_HIGH, " ticcmd queue     - %d (target %d) \n",
+			(int)player->cmds.size(), (int)player->client.cmdtarget);
+	Printf (PRINT_HIGH, " ticcmd jitter    - %d ms \n",	  player->client.cmdjitter >> 4);
+	Printf (PRINT_HIGH, " ticcmd delay     - %d ms \n",	  player->client.cmddelay >> 4);
+	Printf (PRINT_HIGH, " starvations      - %d \n",		  player->client.cmdstarvations);
+	Printf (PRINT_HIGH, " catch-ups        - %d \n",		  player->client.cmdcatchups);
 //	Printf (PRINT_HIGH, " time             - %d \n",		  player->GameTime);
 	Printf (PRINT_HIGH, "--------------------------------------- \n");
 }
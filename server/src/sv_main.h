@@ -51,6 +51,8 @@ public:
 extern client_c clients;
 
 void SV_InitNetwork (void);
+void SV_WriteServerSettings (buf_t *buf);
+void SV_WriteServerInfoQuery (buf_t *buf);
 void SV_SendDisconnectSignal();
 void SV_SendReconnectSignal();
 void SV_ExitLevel();
@@ -80,6 +82,7 @@ void SV_ActorTracer(AActor *actor);
 void SV_ForceSetTeam(player_t &who, team_t team);
 void SV_CheckTeam(player_t &player);
 void SV_SendUserInfo(player_t &player, client_t* cl);
+void SV_InvalidateLevelState();
 void SV_Suicide(player_t &player);
 void SV_SpawnMobj(AActor *mo);
 void SV_TouchSpecial(AActor *special, player_t *player);
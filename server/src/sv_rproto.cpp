@@ -31,6 +31,7 @@
 #include "sv_main.h"
 #include "huffman.h"
 #include "i_net.h"
+#include "sv_demo.h"
 
 QWORD I_MSTime (void);
 
@@ -125,10 +126,12 @@ bool SV_SendPacket(player_t &pl)
 	cl->packetbegin[cl->packetnum] = cl->relpackets.cursize;
 	cl->packetsize[cl->packetnum] = cl->reliablebuf.cursize;
 	cl->packetseq[cl->packetnum] = cl->sequence;
+	cl->packetsectorgen[cl->packetnum] = 0;
 
 	if (cl->reliablebuf.cursize)
 		SZ_Write (&cl->relpackets, cl->reliablebuf.data, cl->reliablebuf.cursize);
 
+	byte thispacket = cl->packetnum;
 
 	cl->packetnum++; // packetnum will never be more than 255
 	                 // because sizeof(packetnum) == 1. Don't need
@@ -154,11 +157,19 @@ bool SV_SendPacket(player_t &pl)
 	  {
          SZ_Write (&sendd, cl->netbuf.data, cl->netbuf.cursize);
 	     cl->unreliable_bps += cl->netbuf.cursize;
+
+		 // once acknowledged, the client has every moving sector change
+		 // up to this generation
+		 cl->packetsectorgen[thispacket] = cl->pendingsectorgen;
 	  }
     
 	SZ_Clear(&cl->netbuf);
 	SZ_Clear(&cl->reliablebuf);
+	cl->pendingsectorgen = 0;
 	
+	// netdemos store the messages uncompressed and without the sequence id
+	SV_NetDemoCapture(pl, sendd.data + sizeof(int), sendd.cursize - sizeof(int));
+
 	// compress the packet, but not the sequence id
 	if(sv_networkcompression && sendd.size() > sizeof(int))
 		SV_CompressPacket(sendd, sizeof(int), cl);
@@ -185,6 +196,17 @@ void SV_AcknowledgePacket(player_t &player)
 
 	cl->compressor.packet_acked(sequence);
 
+	// advance the client's acknowledged sector change generation
+	for (int n = 0; n < 256; n++)
+	{
+		if (cl->packetseq[n] == sequence)
+		{
+			if (cl->packetsectorgen[n] > cl->sectorgen)
+				cl->sectorgen = cl->packetsectorgen[n];
+			break;
+		}
+	}
+
 	// packet is missed
 	if (sequence - cl->last_sequence > 1)
 	{
@@ -20,6 +20,7 @@
 //
 //-----------------------------------------------------------------------------
 
+#include <map>
 #include <string>
 #include <vector>
 
@@ -40,6 +41,34 @@
 extern std::vector<std::string> patchfiles, wadnames, wadhashes;
 static buf_t ml_message(MAX_UDP_PACKET);
 
+// Pre-serialized response body, shared by every query until invalidated
+static buf_t QryCache(MAX_UDP_PACKET);
+static bool QryCacheValid = false;
+static DWORD QryCacheVersion = 0;
+static QWORD QryCacheTime = 0;
+
+// Longest time a cached response is served, in milliseconds
+#define QRY_CACHE_LIFETIME 1000
+
+// Per-address token buckets for rate limiting
+struct QryBucket_t
+{
+    DWORD Tokens;
+    QWORD LastTime;
+};
+
+static std::map<DWORD, QryBucket_t> QryBuckets;
+
+#define QRY_BUCKET_SIZE 8
+#define QRY_BUCKET_RATE 2
+#define QRY_BUCKET_REFILL (QRY_BUCKET_SIZE * 1000 / QRY_BUCKET_RATE)
+#define QRY_MAX_BUCKETS 4096
+
+// Statistics
+static DWORD QryCacheHits = 0;
+static DWORD QryCacheRebuilds = 0;
+static DWORD QryDropped = 0;
+
 EXTERN_CVAR (sv_usemasters)
 EXTERN_CVAR (sv_hostname)
 EXTERN_CVAR (sv_maxclients)
@@ -76,12 +105,6 @@ EXTERN_CVAR (sv_natport)
 
 extern unsigned int last_revision;
 
-struct CvarField_t 
-{ 
-    std::string Name;
-    std::string Value;
-} CvarField;
-
 // The TAG identifier, changing this to a new value WILL break any application 
 // trying to contact this one that does not have the exact same value
 #define TAG_ID 0xAD0
@@ -108,112 +131,86 @@ struct CvarField_t
 //
 // IntQryBuildInformation()
 //
-// Protocol building routine, the passed parameter is the enquirer version
-static void IntQryBuildInformation(const DWORD &EqProtocolVersion, 
-    const DWORD &EqTime)
+// Protocol building routine, the passed parameter is the enquirer version.
+// Everything after the enquirer's time field is written here, so the result
+// can be cached and shared between queries.
+static void IntQryBuildInformation(const DWORD &EqProtocolVersion,
+    buf_t *buf)
 {
-    std::vector<CvarField_t> Cvars;
-
-    // bond - time
-    MSG_WriteLong(&ml_message, EqTime);
-
     // The servers real protocol version
     // bond - real protocol
-    MSG_WriteLong(&ml_message, PROTOCOL_VERSION);
+    MSG_WriteLong(buf, PROTOCOL_VERSION);
 
     // Built revision of server
-    MSG_WriteLong(&ml_message, last_revision);
+    MSG_WriteLong(buf, last_revision);
 
-    cvar_t *var = GetFirstCvar();
-    
-    // Count our cvars and add them
-    while (var)
-    {
-        if (var->flags() & CVAR_SERVERINFO)
-        {
-            CvarField.Name = var->name();
-            CvarField.Value = var->cstring();
-            
-            Cvars.push_back(CvarField);
-        }
-        
-        var = var->GetNext();
-    }
-    
-    // Cvar count
-    MSG_WriteByte(&ml_message, (BYTE)Cvars.size());
-    
-    // Write cvars
-    for (size_t i = 0; i < Cvars.size(); ++i)
-	{
-        MSG_WriteString(&ml_message, Cvars[i].Name.c_str());
-		MSG_WriteString(&ml_message, Cvars[i].Value.c_str());
-	}
+    // Cvar count, names and values
+    SV_WriteServerInfoQuery(buf);
 	
-	MSG_WriteString(&ml_message, (strlen(join_password.cstring()) ? MD5SUM(join_password.cstring()).c_str() : ""));
-	MSG_WriteString(&ml_message, level.mapname);
+	MSG_WriteString(buf, (strlen(join_password.cstring()) ? MD5SUM(join_password.cstring()).c_str() : ""));
+	MSG_WriteString(buf, level.mapname);
 	
     int timeleft = (int)(sv_timelimit - level.time/(TICRATE*60));
 	if (timeleft < 0) 
         timeleft = 0;
         
-    MSG_WriteShort(&ml_message, timeleft);
+    MSG_WriteShort(buf, timeleft);
     
     // Team data
-    MSG_WriteByte(&ml_message, 2);
+    MSG_WriteByte(buf, 2);
     
     // Blue
-    MSG_WriteString(&ml_message, "Blue");
-    MSG_WriteLong(&ml_message, 0x000000FF);
-    MSG_WriteShort(&ml_message, (short)TEAMpoints[it_blueflag]);
+    MSG_WriteString(buf, "Blue");
+    MSG_WriteLong(buf, 0x000000FF);
+    MSG_WriteShort(buf, (short)TEAMpoints[it_blueflag]);
 
-    MSG_WriteString(&ml_message, "Red");
-    MSG_WriteLong(&ml_message, 0x00FF0000);
-    MSG_WriteShort(&ml_message, (short)TEAMpoints[it_redflag]);
+    MSG_WriteString(buf, "Red");
+    MSG_WriteLong(buf, 0x00FF0000);
+    MSG_WriteShort(buf, (short)TEAMpoints[it_redflag]);
 
     // TODO: When real dynamic teams are implemented
     //byte TeamCount = (byte)sv_teamsinplay;
-    //MSG_WriteByte(&ml_message, TeamCount);
+    //MSG_WriteByte(buf, TeamCount);
     
     //for (byte i = 0; i < TeamCount; ++i)
     //{
         // TODO - Figure out where the info resides
-        //MSG_WriteString(&ml_message, "");
-        //MSG_WriteLong(&ml_message, 0);
-        //MSG_WriteShort(&ml_message, TEAMpoints[i]);        
+        //MSG_WriteString(buf, "");
+        //MSG_WriteLong(buf, 0);
+        //MSG_WriteShort(buf, TEAMpoints[i]);        
     //}
 
 	// Patch files	
-	MSG_WriteByte(&ml_message, patchfiles.size());
+	MSG_WriteByte(buf, patchfiles.size());
 	
 	for (size_t i = 0; i < patchfiles.size(); ++i)
 	{
-        MSG_WriteString(&ml_message, patchfiles[i].c_str());
+        MSG_WriteString(buf, patchfiles[i].c_str());
 	}
 	
 	// Wad files
-	MSG_WriteByte(&ml_message, wadnames.size());
+	MSG_WriteByte(buf, wadnames.size());
 	
 	for (size_t i = 0; i < wadnames.size(); ++i)
     {
-        MSG_WriteString(&ml_message, wadnames[i].c_str());
-        MSG_WriteString(&ml_message, wadhashes[i].c_str());
+        MSG_WriteString(buf, wadnames[i].c_str());
+        MSG_WriteString(buf, wadhashes[i].c_str());
     }
     
-    MSG_WriteByte(&ml_message, players.size());
+    MSG_WriteByte(buf, players.size());
     
     // Player info
     for (size_t i = 0; i < players.size(); ++i)
     {
-        MSG_WriteString(&ml_message, players[i].userinfo.netname);
-        MSG_WriteByte(&ml_message, players[i].userinfo.team);
-        MSG_WriteShort(&ml_message, players[i].ping);
+        MSG_WriteString(buf, players[i].userinfo.netname);
+        MSG_WriteByte(buf, players[i].userinfo.team);
+        MSG_WriteShort(buf, players[i].ping);
 
         int timeingame = (time(NULL) - players[i].JoinTime)/60;
         if (timeingame < 0) 
             timeingame = 0;
 
-        MSG_WriteShort(&ml_message, timeingame);
+        MSG_WriteShort(buf, timeingame);
 
         // FIXME - Treat non-players (downloaders/others) as spectators too for
         // now
@@ -224,14 +221,118 @@ static void IntQryBuildInformation(const DWORD &EqProtocolVersion,
             (players[i].playerstate != PST_DEAD) &&
             (players[i].playerstate != PST_REBORN)));
 
-        MSG_WriteBool(&ml_message, spectator);
+        MSG_WriteBool(buf, spectator);
 
-        MSG_WriteShort(&ml_message, players[i].fragcount);
-        MSG_WriteShort(&ml_message, players[i].killcount);
-        MSG_WriteShort(&ml_message, players[i].deathcount);
+        MSG_WriteShort(buf, players[i].fragcount);
+        MSG_WriteShort(buf, players[i].killcount);
+        MSG_WriteShort(buf, players[i].deathcount);
     }
 }
 
+//
+// IntQryGetCachedInformation()
+//
+// Returns the response body for the given enquirer version, rebuilding it
+// only when it has been invalidated or has gone stale.  Pings, frags and
+// times are not tracked individually, so the cache also expires after
+// QRY_CACHE_LIFETIME milliseconds to keep them reasonably fresh.
+static const buf_t &IntQryGetCachedInformation(const DWORD &EqProtocolVersion)
+{
+    QWORD now = I_MSTime();
+
+    if (QryCacheValid && QryCacheVersion == EqProtocolVersion &&
+        now - QryCacheTime < QRY_CACHE_LIFETIME)
+    {
+        QryCacheHits++;
+        return QryCache;
+    }
+
+    SZ_Clear(&QryCache);
+    IntQryBuildInformation(EqProtocolVersion, &QryCache);
+
+    QryCacheValid = !QryCache.overflowed;
+    QryCacheVersion = EqProtocolVersion;
+    QryCacheTime = now;
+    QryCacheRebuilds++;
+
+    return QryCache;
+}
+
+//
+// SV_QryInvalidateCache()
+//
+// Forces the next query to rebuild the cached response.  Called whenever
+// server cvars, the player list or the map change.
+void SV_QryInvalidateCache()
+{
+    QryCacheValid = false;
+}
+
+//
+// IntQryAllowQuery()
+//
+// Token bucket rate limiting per source address.  Each address may burst up
+// to QRY_BUCKET_SIZE queries, refilled at QRY_BUCKET_RATE queries per second.
+// Queries beyond that are dropped before any response is built.
+static bool IntQryAllowQuery(const netadr_t &from)
+{
+    QWORD now = I_MSTime();
+
+    DWORD ip = (from.ip[0] << 24) | (from.ip[1] << 16) |
+               (from.ip[2] << 8) | from.ip[3];
+
+    // Forget addresses whose buckets have refilled if the table grows large,
+    // this keeps spoofed floods from using up memory
+    if (QryBuckets.size() >= QRY_MAX_BUCKETS)
+    {
+        std::map<DWORD, QryBucket_t>::iterator it = QryBuckets.begin();
+
+        while (it != QryBuckets.end())
+        {
+            if (now - it->second.LastTime >= QRY_BUCKET_REFILL)
+                QryBuckets.erase(it++);
+            else
+                ++it;
+        }
+
+        if (QryBuckets.size() >= QRY_MAX_BUCKETS)
+            QryBuckets.clear();
+    }
+
+    std::map<DWORD, QryBucket_t>::iterator it = QryBuckets.find(ip);
+
+    if (it == QryBuckets.end())
+    {
+        QryBucket_t &Bucket = QryBuckets[ip];
+
+        Bucket.Tokens = QRY_BUCKET_SIZE * 1000 - 1000;
+        Bucket.LastTime = now;
+
+        return true;
+    }
+
+    QryBucket_t &Bucket = it->second;
+
+    // Tokens are stored in thousandths so refills are exact per millisecond
+    QWORD Tokens = Bucket.Tokens + (now - Bucket.LastTime) * QRY_BUCKET_RATE;
+
+    if (Tokens > QRY_BUCKET_SIZE * 1000)
+        Tokens = QRY_BUCKET_SIZE * 1000;
+
+    Bucket.Tokens = (DWORD)Tokens;
+    Bucket.LastTime = now;
+
+    if (Bucket.Tokens < 1000)
+    {
+        QryDropped++;
+        return false;
+    }
+
+    Bucket.Tokens -= 1000;
+
+    return true;
+}
+
 //
 // IntQrySendResponse()
 // 
@@ -359,7 +460,12 @@ static DWORD IntQrySendResponse(const WORD &TagId,
     else
         MSG_WriteLong(&ml_message, EqProtocolVersion);
     
-    IntQryBuildInformation(EqProtocolVersion, EqTime);
+    // bond - time
+    MSG_WriteLong(&ml_message, EqTime);
+
+    const buf_t &Info = IntQryGetCachedInformation(EqProtocolVersion);
+
+    SZ_Write(&ml_message, Info.data, Info.cursize);
     
     NET_SendPacket(ml_message, net_from);
 
@@ -386,8 +492,23 @@ DWORD SV_QryParseEnquiry(const DWORD &Tag)
     {
         return 1;
     }
+
+    // It is ours, but this address is querying too often
+    if (!IntQryAllowQuery(net_from))
+    {
+        return 0;
+    }
     
     return IntQrySendResponse(TagId, TagApplication, TagQRId, TagPacketType);
 }
 
+BEGIN_COMMAND (sqpstats)
+{
+    Printf(PRINT_HIGH, "Queries served from cache: %u\n", QryCacheHits);
+    Printf(PRINT_HIGH, "Responses rebuilt: %u\n", QryCacheRebuilds);
+    Printf(PRINT_HIGH, "Queries dropped by rate limit: %u\n", QryDropped);
+    Printf(PRINT_HIGH, "Addresses tracked: %u\n", (unsigned)QryBuckets.size());
+}
+END_COMMAND (sqpstats)
+
 VERSION_CONTROL (sv_sqp_cpp, "$Id: sv_sqp.cpp 3174 2012-05-11 01:03:43Z mike $")
@@ -39,5 +39,6 @@
 #define VERSIONPATCH(VERSION) ((VERSION % 256) % 10)
 
 DWORD SV_QryParseEnquiry(const DWORD &Tag);
+void SV_QryInvalidateCache();
 
 #endif // __SV_SQP_H__
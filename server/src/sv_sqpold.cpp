@@ -142,24 +142,23 @@ bool SV_IsValidToken(DWORD token)
 }
 
 //
-// SV_SendServerInfo
-// 
-// Sends server info to a launcher
+// SV_WriteServerInfo
+//
+// Writes the server info sent to launchers and connecting clients.  Also
+// used to begin netdemos recorded by the server.
 // TODO: Clean up and reinvent.
-void SV_SendServerInfo()
+void SV_WriteServerInfo(buf_t *buf, DWORD token, bool masterkey)
 {
 	size_t i;
 
-	SZ_Clear(&ml_message);
-	
-	MSG_WriteLong(&ml_message, CHALLENGE);
-	MSG_WriteLong(&ml_message, SV_NewToken());
+	MSG_WriteLong(buf, CHALLENGE);
+	MSG_WriteLong(buf, token);
 
 	// if master wants a key to be presented, present it we will
-	if(MSG_BytesLeft() == 4)
-		MSG_WriteLong(&ml_message, MSG_ReadLong());
+	if(masterkey && MSG_BytesLeft() == 4)
+		MSG_WriteLong(buf, MSG_ReadLong());
 
-	MSG_WriteString(&ml_message, (char *)sv_hostname.cstring());
+	MSG_WriteString(buf, (char *)sv_hostname.cstring());
 
 	byte playersingame = 0;
 	for (i = 0; i < players.size(); ++i)
@@ -168,122 +167,132 @@ void SV_SendServerInfo()
 			playersingame++;
 	}
 
-	MSG_WriteByte(&ml_message, playersingame);
-	MSG_WriteByte(&ml_message, sv_maxclients.asInt());
+	MSG_WriteByte(buf, playersingame);
+	MSG_WriteByte(buf, sv_maxclients.asInt());
 
-	MSG_WriteString(&ml_message, level.mapname);
+	MSG_WriteString(buf, level.mapname);
 
 	size_t numwads = wadnames.size();
 	if(numwads > 0xff)numwads = 0xff;
 
-	MSG_WriteByte(&ml_message, numwads - 1);
+	MSG_WriteByte(buf, numwads - 1);
 
 	for (i = 1; i < numwads; ++i)
-		MSG_WriteString(&ml_message, wadnames[i].c_str());
+		MSG_WriteString(buf, wadnames[i].c_str());
 
-	MSG_WriteBool(&ml_message, (sv_gametype == GM_DM || sv_gametype == GM_TEAMDM));
-	MSG_WriteByte(&ml_message, sv_skill.asInt());
-	MSG_WriteBool(&ml_message, (sv_gametype == GM_TEAMDM));
-	MSG_WriteBool(&ml_message, (sv_gametype == GM_CTF));
+	MSG_WriteBool(buf, (sv_gametype == GM_DM || sv_gametype == GM_TEAMDM));
+	MSG_WriteByte(buf, sv_skill.asInt());
+	MSG_WriteBool(buf, (sv_gametype == GM_TEAMDM));
+	MSG_WriteBool(buf, (sv_gametype == GM_CTF));
 
 	for (i = 0; i < players.size(); ++i)
 	{
 		if (players[i].ingame())
 		{
-			MSG_WriteString(&ml_message, players[i].userinfo.netname);
-			MSG_WriteShort(&ml_message, players[i].fragcount);
-			MSG_WriteLong(&ml_message, players[i].ping);
+			MSG_WriteString(buf, players[i].userinfo.netname);
+			MSG_WriteShort(buf, players[i].fragcount);
+			MSG_WriteLong(buf, players[i].ping);
 
 			if (sv_gametype == GM_TEAMDM || sv_gametype == GM_CTF)
-				MSG_WriteByte(&ml_message, players[i].userinfo.team);
+				MSG_WriteByte(buf, players[i].userinfo.team);
 			else
-				MSG_WriteByte(&ml_message, TEAM_NONE);
+				MSG_WriteByte(buf, TEAM_NONE);
 		}
 	}
 
 	for (i = 1; i < numwads; ++i)
-		MSG_WriteString(&ml_message, wadhashes[i].c_str());
+		MSG_WriteString(buf, wadhashes[i].c_str());
 
-	MSG_WriteString(&ml_message, sv_website.cstring());
+	MSG_WriteString(buf, sv_website.cstring());
 
 	if (sv_gametype == GM_TEAMDM || sv_gametype == GM_CTF)
 	{
-		MSG_WriteLong(&ml_message, sv_scorelimit.asInt());
+		MSG_WriteLong(buf, sv_scorelimit.asInt());
 		
 		for(size_t i = 0; i < NUMTEAMS; i++)
 		{
 			if ((sv_gametype == GM_CTF && i < 2) || (sv_gametype != GM_CTF && i < sv_teamsinplay)) {
-				MSG_WriteByte(&ml_message, 1);
-				MSG_WriteLong(&ml_message, TEAMpoints[i]);
+				MSG_WriteByte(buf, 1);
+				MSG_WriteLong(buf, TEAMpoints[i]);
 			} else {
-				MSG_WriteByte(&ml_message, 0);
+				MSG_WriteByte(buf, 0);
 			}
 		}
 	}
 	
-	MSG_WriteShort(&ml_message, VERSION);
+	MSG_WriteShort(buf, VERSION);
 
 //bond===========================
-	MSG_WriteString(&ml_message, (char *)sv_email.cstring());
+	MSG_WriteString(buf, (char *)sv_email.cstring());
 
 	int timeleft = (int)(sv_timelimit - level.time/(TICRATE*60));
 	if (timeleft<0) timeleft=0;
 
-	MSG_WriteShort(&ml_message,sv_timelimit.asInt());
-	MSG_WriteShort(&ml_message,timeleft);
-	MSG_WriteShort(&ml_message,sv_fraglimit.asInt());
-
-	MSG_WriteBool(&ml_message, (sv_itemsrespawn ? true : false));
-	MSG_WriteBool(&ml_message, (sv_weaponstay ? true : false));
-	MSG_WriteBool(&ml_message, (sv_friendlyfire ? true : false));
-	MSG_WriteBool(&ml_message, (sv_allowexit ? true : false));
-	MSG_WriteBool(&ml_message, (sv_infiniteammo ? true : false));
-	MSG_WriteBool(&ml_message, (sv_nomonsters ? true : false));
-	MSG_WriteBool(&ml_message, (sv_monstersrespawn ? true : false));
-	MSG_WriteBool(&ml_message, (sv_fastmonsters ? true : false));
-	MSG_WriteBool(&ml_message, (sv_allowjump ? true : false));
-	MSG_WriteBool(&ml_message, (sv_freelook ? true : false));
-	MSG_WriteBool(&ml_message, (sv_waddownload ? true : false));
-	MSG_WriteBool(&ml_message, (sv_emptyreset ? true : false));
-	MSG_WriteBool(&ml_message, (sv_cleanmaps ? true : false));
-	MSG_WriteBool(&ml_message, (sv_fragexitswitch ? true : false));
+	MSG_WriteShort(buf,sv_timelimit.asInt());
+	MSG_WriteShort(buf,timeleft);
+	MSG_WriteShort(buf,sv_fraglimit.asInt());
+
+	MSG_WriteBool(buf, (sv_itemsrespawn ? true : false));
+	MSG_WriteBool(buf, (sv_weaponstay ? true : false));
+	MSG_WriteBool(buf, (sv_friendlyfire ? true : false));
+	MSG_WriteBool(buf, (sv_allowexit ? true : false));
+	MSG_WriteBool(buf, (sv_infiniteammo ? true : false));
+	MSG_WriteBool(buf, (sv_nomonsters ? true : false));
+	MSG_WriteBool(buf, (sv_monstersrespawn ? true : false));
+	MSG_WriteBool(buf, (sv_fastmonsters ? true : false));
+	MSG_WriteBool(buf, (sv_allowjump ? true : false));
+	MSG_WriteBool(buf, (sv_freelook ? true : false));
+	MSG_WriteBool(buf, (sv_waddownload ? true : false));
+	MSG_WriteBool(buf, (sv_emptyreset ? true : false));
+	MSG_WriteBool(buf, (sv_cleanmaps ? true : false));
+	MSG_WriteBool(buf, (sv_fragexitswitch ? true : false));
 
 	for (i = 0; i < players.size(); ++i)
 	{
 		if (players[i].ingame())
 		{
-			MSG_WriteShort(&ml_message, players[i].killcount);
-			MSG_WriteShort(&ml_message, players[i].deathcount);
+			MSG_WriteShort(buf, players[i].killcount);
+			MSG_WriteShort(buf, players[i].deathcount);
 			
 			int timeingame = (time(NULL) - players[i].JoinTime)/60;
 			if (timeingame<0) timeingame=0;
-				MSG_WriteShort(&ml_message, timeingame);
+				MSG_WriteShort(buf, timeingame);
 		}
 	}
 	
 //bond===========================
 
-    MSG_WriteLong(&ml_message, (DWORD)0x01020304);
-    MSG_WriteShort(&ml_message, sv_maxplayers.asInt());
+    MSG_WriteLong(buf, (DWORD)0x01020304);
+    MSG_WriteShort(buf, sv_maxplayers.asInt());
     
     for (i = 0; i < players.size(); ++i)
     {
         if (players[i].ingame())
         {
-            MSG_WriteBool(&ml_message, (players[i].spectator ? true : false));
+            MSG_WriteBool(buf, (players[i].spectator ? true : false));
         }
     }
 
-    MSG_WriteLong(&ml_message, (DWORD)0x01020305);
-    MSG_WriteShort(&ml_message, strlen(join_password.cstring()) ? 1 : 0);
+    MSG_WriteLong(buf, (DWORD)0x01020305);
+    MSG_WriteShort(buf, strlen(join_password.cstring()) ? 1 : 0);
     
     // GhostlyDeath -- Send Game Version info
-    MSG_WriteLong(&ml_message, GAMEVER);
+    MSG_WriteLong(buf, GAMEVER);
 
-    MSG_WriteByte(&ml_message, patchfiles.size());
+    MSG_WriteByte(buf, patchfiles.size());
     
     for (size_t i = 0; i < patchfiles.size(); ++i)
-        MSG_WriteString(&ml_message, patchfiles[i].c_str());
+        MSG_WriteString(buf, patchfiles[i].c_str());
+}
+
+//
+// SV_SendServerInfo
+// 
+// Sends server info to a launcher
+void SV_SendServerInfo()
+{
+	SZ_Clear(&ml_message);
+	SV_WriteServerInfo(&ml_message, SV_NewToken(), true);
 
 	NET_SendPacket(ml_message, net_from);
 }
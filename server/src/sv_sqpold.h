@@ -26,6 +26,10 @@
 #ifndef __SV_SQPOLD_H__
 #define __SV_SQPOLD_H__
 
+#include "doomtype.h"
+#include "i_net.h"
+
+void SV_WriteServerInfo (buf_t *buf, DWORD token, bool masterkey);
 void SV_SendServerInfo ();
 bool SV_IsValidToken(DWORD token);
 
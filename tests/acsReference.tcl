@@ -0,0 +1,166 @@
+#!/bin/bash
+# \
+exec tclsh "$0" "$@"
+
+source tests/commands/common.tcl
+
+#
+# runs the same ACS scripts through the decoded interpreter and through the
+# reference one (-acsreference) and compares what they print
+#
+
+set wadfile acsref.wad
+
+# p-codes used by the script
+array set pcd {
+ TERMINATE 1 PUSHNUMBER 3 MULTIPLY 16 MODULUS 18 LT 21 ASSIGNSCRIPTVAR 25
+ PUSHSCRIPTVAR 28 ADDSCRIPTVAR 31 INCSCRIPTVAR 46 GOTO 52 DELAYDIRECT 56
+ RANDOMDIRECT 58 IFNOTGOTO 79 BEGINPRINT 85 PRINTSTRING 87 PRINTNUMBER 88
+ ENDPRINTBOLD 101
+}
+
+proc op { name args } {
+ global pcd
+ return [binary format i* [concat $pcd($name) $args]]
+}
+
+# The script code, starting at offset 8 of the lump, with end as the
+# offset of its last p-code
+proc scriptCode { end } {
+ set code ""
+ append code [op PUSHNUMBER 0] [op ASSIGNSCRIPTVAR 0]
+ append code [op PUSHNUMBER 1] [op ASSIGNSCRIPTVAR 1]
+ append code [op PUSHNUMBER 0] [op ASSIGNSCRIPTVAR 2]
+ set loop [expr 8 + [string length $code]]
+ append code [op PUSHSCRIPTVAR 0] [op PUSHNUMBER 20] [op LT] [op IFNOTGOTO $end]
+ append code [op PUSHSCRIPTVAR 0] [op PUSHSCRIPTVAR 1] [op MULTIPLY] [op ADDSCRIPTVAR 2]
+ append code [op PUSHSCRIPTVAR 0] [op PUSHNUMBER 3] [op MODULUS] [op ADDSCRIPTVAR 1]
+ append code [op INCSCRIPTVAR 0]
+ append code [op BEGINPRINT]
+ append code [op PUSHNUMBER 0] [op PRINTSTRING]
+ append code [op PUSHSCRIPTVAR 0] [op PRINTNUMBER]
+ append code [op PUSHNUMBER 1] [op PRINTSTRING]
+ append code [op PUSHSCRIPTVAR 2] [op PRINTNUMBER]
+ append code [op PUSHNUMBER 1] [op PRINTSTRING]
+ append code [op RANDOMDIRECT 0 255] [op PRINTNUMBER]
+ append code [op ENDPRINTBOLD]
+ append code [op DELAYDIRECT 1]
+ append code [op GOTO $loop]
+ append code [op TERMINATE]
+ return $code
+}
+
+# An open script that prints 20 lines, one a tic, using the sequences the
+# decoder fuses and a random number
+proc behavior {} {
+ set code [scriptCode 0]
+ set code [scriptCode [expr 8 + [string length $code] - 4]]
+
+ set strings [binary format {a4x a1x} "ACS " " "]
+ set stringsofs [expr 8 + [string length $code]]
+ set dirofs [expr $stringsofs + [string length $strings]]
+ set dirofs [expr ($dirofs + 3) & ~3]
+
+ set lump [binary format a4i ACS\0 $dirofs]
+ append lump $code $strings
+ append lump [string repeat \0 [expr $dirofs - [string length $lump]]]
+ # script 1, type open
+ append lump [binary format iiii 1 1001 8 0]
+ append lump [binary format iii 2 $stringsofs [expr $stringsofs + 5]]
+ return $lump
+}
+
+# A square room split down the middle into two subsectors
+proc writeWad { filename } {
+ set lumps {}
+
+ lappend lumps MAP01 ""
+ # tid x y z angle type flags special args
+ lappend lumps THINGS [binary format ssssssscc5 0 64 128 0 0 1 0x707 0 {0 0 0 0 0}]
+ # v1 v2 flags special args sides
+ set linedefs ""
+ foreach {v1 v2} {0 3 3 2 2 1 1 0} {
+  append linedefs [binary format ssscc5ss $v1 $v2 1 0 {0 0 0 0 0} [expr [string length $linedefs] / 16] -1]
+ }
+ lappend lumps LINEDEFS $linedefs
+ set sidedefs ""
+ for {set i 0} {$i < 4} {incr i} {
+  append sidedefs [binary format ssa8a8a8s 0 0 - - STARTAN3 0]
+ }
+ lappend lumps SIDEDEFS $sidedefs
+ lappend lumps VERTEXES [binary format s* {0 0 256 0 256 256 0 256 128 0 128 256}]
+ # v1 v2 angle linedef side offset
+ lappend lumps SEGS [binary format s* {
+  0 3 16384 0 0 0   3 5 0 1 0 0   4 0 -32768 3 0 128
+  5 2 0 1 0 128   2 1 -16384 2 0 0   1 4 -32768 3 0 0
+ }]
+ lappend lumps SSECTORS [binary format s* {3 0 3 3}]
+ # partition, right box, left box (top bottom left right), right child, left child
+ lappend lumps NODES [binary format s* {
+  128 0 0 256  256 0 128 256  256 0 0 128  -32767 -32768
+ }]
+ lappend lumps SECTORS [binary format ssa8a8sss 0 128 FLOOR4_8 CEIL3_5 192 0 0]
+ lappend lumps REJECT [binary format c 0]
+ lappend lumps BLOCKMAP ""
+ lappend lumps BEHAVIOR [behavior]
+
+ set data ""
+ set directory ""
+ foreach {name lump} $lumps {
+  append directory [binary format iia8 [expr 12 + [string length $data]] [string length $lump] $name]
+  append data $lump
+ }
+
+ set file [open $filename w]
+ fconfigure $file -translation binary
+ puts -nonewline $file [binary format a4ii PWAD [expr [llength $lumps] / 2] [expr 12 + [string length $data]]]
+ puts -nonewline $file $data$directory
+ close $file
+}
+
+# the lines the script printed, without the timestamps
+proc scriptOutput { extraArgs } {
+ global client clientout wadfile
+
+ startClient none "-file $wadfile $extraArgs"
+ clear
+ client "map MAP01"
+ wait 3
+
+ set lines {}
+ while { ![eof $clientout] } {
+  if { [regexp {ACS [0-9]+ [0-9]+ [0-9]+} [gets $clientout] line] } {
+   lappend lines $line
+  }
+ }
+
+ end
+ return $lines
+}
+
+proc main {} {
+ global wadfile
+
+ writeWad $wadfile
+
+ set decoded [scriptOutput ""]
+ set reference [scriptOutput "-acsreference"]
+
+ if { [llength $decoded] != 20 } {
+  puts "FAIL (20 lines|[llength $decoded] lines)"
+ } elseif { $decoded != $reference } {
+  puts "FAIL ($reference|$decoded)"
+ } else {
+  puts "PASS decoded scripts match -acsreference"
+ }
+
+ file delete $wadfile
+}
+
+set error [catch { main }]
+
+if { $error } {
+ puts "FAIL Test crashed!"
+}
+
+end
@@ -25,15 +25,15 @@ proc startServer {} {
  server "map 1"
 }
 
-proc startClient { {serverPort none} } {
+proc startClient { {serverPort none} {extraArgs ""} } {
  global client clientout clientcon
 
  set client [open odamex.con w]
 
  if { $serverPort != "none" } {
-  set clientcon [open "|./odamex -port 10501 -connect localhost:$serverPort -nosound -novideo +logfile odamex.log -confile odamex.con > tmp" w]
+  set clientcon [open "|./odamex -port 10501 -connect localhost:$serverPort -nosound -novideo $extraArgs +logfile odamex.log -confile odamex.con > tmp" w]
  } else {
-  set clientcon [open "|./odamex -port 10501 -nosound -novideo +logfile odamex.log -confile odamex.con > tmp" w]
+  set clientcon [open "|./odamex -port 10501 -nosound -novideo $extraArgs +logfile odamex.log -confile odamex.con > tmp" w]
  }
  set clientout [open odamex.log r]
 
@@ -0,0 +1,41 @@
+#!/bin/bash
+# \
+exec tclsh "$0" "$@"
+
+source tests/commands/common.tcl
+
+#
+# draws random spans and rows of four columns with the SIMD drawers the
+# CPU can run and with the C ones, which have to put out exactly the same
+# pixels
+#
+
+proc main {} {
+ global clientout
+
+ startClient none
+ clear
+ client "drawertest"
+ wait 1
+
+ set result ""
+ while { ![eof $clientout] } {
+  regexp {drawertest: .*} [gets $clientout] result
+ }
+
+ if { [regexp {drawertest: [A-Za-z0-9]+ drawers match the C drawers} $result line] } {
+  puts "PASS $line"
+ } else {
+  puts "FAIL (drawertest: drawers match the C drawers|$result)"
+ }
+
+ end
+}
+
+set error [catch { main }]
+
+if { $error } {
+ puts "FAIL Test crashed!"
+}
+
+end